@@ -56,18 +56,31 @@ endif (FFTW_INCLUDES)
 # add the header to the include paths
 find_path (FFTW_INCLUDES fftw3.h ${FFTW_ROOT})
 
-# the following for each allows you to specify in the calling script which library you want
-# to link using COMPONENTS (for example fftw3-3, fftw3f-3 or fftw3l-3)
+# the following for each allows you to specify in the calling script which libraries you want
+# to link using COMPONENTS (for example fftw3-3, fftw3f-3 or fftw3l-3), all of them are added to FFTW_LIBRARIES
+set(FFTW_LIBRARIES "")
+list(REMOVE_DUPLICATES FFTW_FIND_COMPONENTS)
 foreach(FIND_FFTW_COMPONENT ${FFTW_FIND_COMPONENTS})
   string(TOLOWER ${FIND_FFTW_COMPONENT} FIND_FFTW_COMPONENT_LOWER) # convert to lower case
-  set(FIND_FFTW_COMPONENT_NAME lib${FIND_FFTW_COMPONENT_LOWER}) # add the lib prefix
+  string(REPLACE "-" "_" FIND_FFTW_COMPONENT_VARIABLE ${FIND_FFTW_COMPONENT_LOWER})
+
+  # the library names are lib<component> on Windows and fftw3f etc. on Unix
+  string(REGEX REPLACE "-3$" "" FIND_FFTW_COMPONENT_UNIX ${FIND_FFTW_COMPONENT_LOWER})
 
   # link the library
-  find_library (FFTW_LIBRARIES
-          NAMES ${FIND_FFTW_COMPONENT_NAME}
+  find_library (FFTW_${FIND_FFTW_COMPONENT_VARIABLE}_LIBRARY
+          NAMES lib${FIND_FFTW_COMPONENT_LOWER} ${FIND_FFTW_COMPONENT_UNIX}
           PATH_SUFFIXES lib64 lib
           PATHS "/usr/local/lib" ${FFTW_ROOT})
 
+  if (FFTW_${FIND_FFTW_COMPONENT_VARIABLE}_LIBRARY)
+    list(APPEND FFTW_LIBRARIES ${FFTW_${FIND_FFTW_COMPONENT_VARIABLE}_LIBRARY})
+  else ()
+    # make find_package_handle_standard_args fail if a component is missing
+    set(FFTW_LIBRARIES "FFTW_LIBRARIES-NOTFOUND")
+    break()
+  endif ()
+  mark_as_advanced (FFTW_${FIND_FFTW_COMPONENT_VARIABLE}_LIBRARY)
 endforeach()
 
 MESSAGE(STATUS "Found FFTW 3 in ${FFTW_INCLUDES}")
@@ -19,52 +19,73 @@
 ////////////////////////////////////////////////////////////
 
 #include "Application.hpp"
-#include "SettingsParser.hpp"
+#include "FeatureWriter.hpp"
 
 #include <SFML/Window/Event.hpp>
 
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 
 namespace
 {
-    bool isPowerOf2(int x)
+    // layout of the panes
+    const float margin         = 100.f;
+    const float paneSpacing    = 10.f;
+    const float minimumHeight  = 120.f;
+    const float spectrumWidth  = 240.f;
+
+    // a shorter drag is a click, it clears the selection
+    const float minimumSelection = 3.f;
+
+    std::time_t modificationTime(const std::string& filename)
     {
-        // check if number is bigger than 1 and exactly on bit is set
-        return (x > 1) && !(x & (x - 1));
+        struct stat status;
+        if (stat(filename.c_str(), &status) != 0)
+            return 0;
+        return status.st_mtime;
     }
 }
 
 
 Application::Application() :
     m_window(sf::VideoMode(1280, 720), "FFT Spectrogram"),
-    m_FFTSize(1024)
+    m_isSelecting(false),
+    m_isFollowing(false),
+    m_showTracks(false),
+    m_showWhitened(false),
+    m_settingsWatcher("settings.txt"),
+    m_activePane(0),
+    m_verticalScroll(0.f),
+    m_showSpectrum(false),
+    m_isSpectrumOutdated(true)
 {
     m_window.setFramerateLimit(60);
 
-    // load a sound
-    if (!m_soundBuffer.loadFromFile("1000Hz.wav"))
-    {
-        std::cout << "Could not load Soundfile!" << std::endl;
-        // maybe throw exeption
-    }
-
-    std::cout << "Sound information:" << std::endl;
-    std::cout << " " << m_soundBuffer.getDuration().asSeconds() << " seconds"           << std::endl;
-    std::cout << " " << m_soundBuffer.getSampleRate()           << " samples / seconds" << std::endl;
-    std::cout << " " << m_soundBuffer.getChannelCount()         << " channels"          << std::endl;
-    std::cout << " " << m_soundBuffer.getSampleCount()          << " samples"           << std::endl;
+    m_pool = std::unique_ptr<ThreadPool>(new ThreadPool(m_settings.threads));
+    m_playbackClock.setLatency(sf::milliseconds(m_settings.audioLatency));
 
-    m_sound.setBuffer(m_soundBuffer);
+    // load the sounds
+    createPanes(false);
 
-    m_spectrogram = std::unique_ptr<Spectrogram>(new Spectrogram(m_soundBuffer, m_FFTSize));
-    m_spectrogram->setPosition(100, 100);
-
-    m_spectrogram->generate();
+    // the sound may still be decoded, the information is from its header
+    const Pane& pane = m_panes.front();
+    std::cout << "Sound information:" << std::endl;
+    std::cout << " " << pane.spectrogram->getDuration().asSeconds() << " seconds"           << std::endl;
+    std::cout << " " << pane.sampleRate                             << " samples / seconds" << std::endl;
+    std::cout << " " << pane.channelCount                           << " channels"          << std::endl;
+    std::cout << " " << pane.sampleCount                            << " samples"           << std::endl;
 
-    m_playProgressBar.setPosition(m_spectrogram->getPosition());
-    m_playProgressBar.setSize(sf::Vector2f(2.f, m_spectrogram->getLocalBounds().height));
     m_playProgressBar.setFillColor(sf::Color(133, 15, 15)); // dark red
+    m_selectionShape.setFillColor(sf::Color(255, 255, 255, 40));
+    m_selectionShape.setOutlineColor(sf::Color(255, 255, 255, 160));
+    m_selectionShape.setOutlineThickness(1.f);
+    layoutWaveform();
+    layoutSpectrumPanel();
+    updatePlayProgressBar();
 
     // save the initial mouse position
     m_previousMousePos = m_window.mapPixelToCoords(sf::Mouse::getPosition(m_window));
@@ -125,6 +146,9 @@ void Application::handleEvents()
             // update the view to the new size of the window
             sf::FloatRect visibleArea(0.f, 0.f, event.size.width, event.size.height);
             m_window.setView(sf::View(visibleArea));
+            layoutPanes();
+            layoutWaveform();
+            layoutSpectrumPanel();
         }
 
         else if (event.type == sf::Event::KeyReleased) {
@@ -133,84 +157,126 @@ void Application::handleEvents()
                 m_window.close();
             }
 
-            // play the sound if space was released
+            // play the sound, or the selected region, if space was released
             else if (event.key.code == sf::Keyboard::Space)
             {
-                if (m_sound.getStatus() == sf::Sound::Playing)
+                if (m_regionStream)
+                {
+                    if (m_regionStream->getStatus() == sf::SoundStream::Playing)
+                        m_regionStream->pause();
+                    else
+                        m_regionStream->play();
+                }
+                else if (m_sound.getStatus() == sf::Sound::Playing)
                     m_sound.pause();
                 else
                     m_sound.play();
 
+                updatePlaybackClock();
                 updatePlayProgressBar();
             }
 
+            // keep the play progress bar in the middle of the window
+            else if (event.key.code == sf::Keyboard::F)
+            {
+                m_isFollowing = !m_isFollowing;
+                std::cout << "Following the playback " << (m_isFollowing ? "on" : "off") << std::endl;
+            }
+
+            // play the next file
+            else if (event.key.code == sf::Keyboard::Tab)
+            {
+                setActivePane((m_activePane + 1) % m_panes.size());
+            }
+
+            // scroll through the panes
+            else if (event.key.code == sf::Keyboard::Up || event.key.code == sf::Keyboard::Down)
+            {
+                m_verticalScroll += (event.key.code == sf::Keyboard::Down) ? minimumHeight : -minimumHeight;
+                layoutPanes();
+            }
+
+            // show the tracks of the spectral peaks
+            else if (event.key.code == sf::Keyboard::P)
+            {
+                m_showTracks = !m_showTracks;
+                for (Pane& pane : m_panes)
+                    pane.spectrogram->setTrackOverlayVisible(m_showTracks);
+            }
+
+            // show the levels above the noise floor of every bin
+            else if (event.key.code == sf::Keyboard::N)
+            {
+                m_showWhitened = !m_showWhitened;
+                for (Pane& pane : m_panes)
+                    pane.spectrogram->setWhitened(m_showWhitened);
+                std::cout << "Whitening " << (m_showWhitened ? "on" : "off") << std::endl;
+            }
+
+            // jump through the onsets
+            else if (event.key.code == sf::Keyboard::Right || event.key.code == sf::Keyboard::Left)
+            {
+                jumpToEvent(event.key.code == sf::Keyboard::Right);
+            }
+
+            // save the onsets next to the sound
+            else if (event.key.code == sf::Keyboard::E)
+            {
+                const Pane& pane = m_panes[m_activePane];
+                const std::string filename = pane.filename + ".events.csv";
+                if (!pane.filename.empty() && pane.spectrogram->saveEvents(filename))
+                    std::cout << "Saved " << pane.spectrogram->getEventCount() << " events to " << filename << std::endl;
+            }
+
+            // show the average spectrum of the active pane, or of its selection
+            else if (event.key.code == sf::Keyboard::W)
+            {
+                m_showSpectrum = !m_showSpectrum;
+            }
+
             else if (event.key.code == sf::Keyboard::L)
             {
-                SettingsParser settings;
-                if (settings.loadFromFile("settings.txt"))
-                {
-                    std::string filename;
-                    settings.get("filename", filename);
-
-                    int newFFTSize = -1;
-                    settings.get("FFTSize", newFFTSize);
-
-                    if (!filename.empty())
-                    {
-                        if (isPowerOf2(newFFTSize))
-                        {
-                            m_FFTSize = newFFTSize;
-                        }
-                        else
-                        {
-                            std::cout << "The FFTSize has to be a power of 2." << std::endl;
-                        }
-
-                        // try to load the new sound
-                        if (m_soundBuffer.loadFromFile(filename))
-                        {
-                            m_spectrogram = std::unique_ptr<Spectrogram>(new Spectrogram(m_soundBuffer, m_FFTSize));
-                            m_spectrogram->setPosition(100.f, 100.f);
-                            m_spectrogram->generate();
-                        }
-                        else
-                        {
-                            std::cout << "Could not load soundfile with name: " << filename << std::endl;
-                            // maybe throw exeption
-                        }
-                    }
-                    else
-                    {
-                        std::cout << "There was no filename specified in the settings file!" << std::endl;
-                    }
-                }
-                else
-                {
-                    std::cout << "Could not load settings file!" << std::endl;
-                }
+                reloadSettings();
             }
         }
 
+        // select a region with the right mouse button
+        else if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Right)
+        {
+            m_selectionStart = m_window.mapPixelToCoords(sf::Vector2i(event.mouseButton.x, event.mouseButton.y));
+            m_isSelecting = true;
+        }
+
+        else if (event.type == sf::Event::MouseButtonReleased && event.mouseButton.button == sf::Mouse::Right && m_isSelecting)
+        {
+            m_isSelecting = false;
+            selectRegion(m_window.mapPixelToCoords(sf::Vector2i(event.mouseButton.x, event.mouseButton.y)));
+        }
+
         else if (event.type == sf::Event::MouseWheelScrolled)
         {
             // "centered" zooming
             if (event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel)
             {
+                // the first pane is zoomed, the others follow it
+                Spectrogram& spectrogram = *m_panes.front().spectrogram;
+
                 // calculate the distance between the mouse and the left border of the spectrogram
                 const sf::Vector2f mousePosition = m_window.mapPixelToCoords(sf::Mouse::getPosition(m_window));
-                sf::FloatRect spectrogramRect = m_spectrogram->getLocalBounds();
-                float distance = mousePosition.x - m_spectrogram->getPosition().x;
+                sf::FloatRect spectrogramRect = spectrogram.getLocalBounds();
+                float distance = mousePosition.x - spectrogram.getPosition().x;
                 // calculate the ration between the mouse and the width of the spectrogram
                 float ratio = distance / spectrogramRect.width;
 
                 // scale the spectrogram
-                m_spectrogram->scale(1.f + 0.5f * event.mouseWheelScroll.delta, 1.f);
+                spectrogram.scale(1.f + 0.5f * event.mouseWheelScroll.delta, 1.f);
 
                 // position spectrogram so that the ratio between the mouse and the width
                 // of the spectrogram is the same as it was before scrolling
-                float newDistance = m_spectrogram->getLocalBounds().width * ratio;
-                m_spectrogram->setPosition(mousePosition.x - newDistance, m_spectrogram->getPosition().y);
+                float newDistance = spectrogram.getLocalBounds().width * ratio;
+                spectrogram.setPosition(mousePosition.x - newDistance, spectrogram.getPosition().y);
 
+                layoutPanes();
                 updatePlayProgressBar();
             }
         }
@@ -220,6 +286,12 @@ void Application::handleEvents()
 
 void Application::update()
 {
+    // the settings file was saved
+    if (m_settingsWatcher.hasChanged())
+    {
+        reloadSettings();
+    }
+
     if (m_hasFocus)
     {
         // scrolling
@@ -228,7 +300,10 @@ void Application::update()
             sf::Vector2f mousePosition(m_window.mapPixelToCoords(sf::Mouse::getPosition(m_window)));
             sf::Vector2f difference = mousePosition - m_previousMousePos;
 
-            m_spectrogram->move(difference.x, 0.f);
+            // scrolling by hand stops following the playback
+            m_isFollowing = false;
+            m_panes.front().spectrogram->move(difference.x, 0.f);
+            layoutPanes();
 
             updatePlayProgressBar();
         }
@@ -237,14 +312,65 @@ void Application::update()
     // save the mouse coordinates
     m_previousMousePos = m_window.mapPixelToCoords(sf::Mouse::getPosition(m_window));
 
-    // do the FFT
-    m_spectrogram->updateImage();
-    m_spectrogram->updateImage();
-
-    if (m_sound.getStatus() == sf::Sound::Playing)
+    updatePlaybackClock();
+    if (isPlaying())
     {
+        if (m_isFollowing)
+            followPlayback();
         updatePlayProgressBar();
     }
+
+    // the panes on screen are generated first
+    const sf::View& view = m_window.getView();
+    const sf::FloatRect visibleArea(view.getCenter().x - view.getSize().x / 2.f, view.getCenter().y - view.getSize().y / 2.f,
+                                    view.getSize().x, view.getSize().y);
+    for (std::size_t i = 0; i < m_panes.size(); ++i)
+    {
+        Pane& pane = m_panes[i];
+
+        // the decoded sound can be played now, and is cached for the next spectrogram
+        if (pane.loader && !pane.soundBuffer && pane.loader->isDone())
+        {
+            pane.soundBuffer = pane.loader->getSoundBuffer();
+            m_cache.addSoundBuffer(pane.filename, pane.soundBuffer);
+            std::cout << "Decoded " << pane.filename << " in " << pane.loader->getDecodeTime().asMilliseconds() << " ms" << std::endl;
+            if (pane.loader->hasFailed())
+                std::cout << "Could not decode all of " << pane.filename << ", the rest is silent." << std::endl;
+            if (i == m_activePane)
+                setActivePane(m_activePane);
+        }
+
+        // report the throughput once
+        if (!pane.isReported && pane.spectrogram->isGenerated())
+        {
+            const sf::Time time = pane.spectrogram->getGenerationTime();
+            std::cout << "Generated " << pane.spectrogram->getFrameCount() << " frames in " << time.asMilliseconds() << " ms ("
+                      << pane.spectrogram->getFrameCount() / std::max(time.asSeconds(), 0.001f) << " frames / second)" << std::endl;
+            // counted from the start of the loading, to compare the pipelined decoding with decoding first
+            std::cout << " first column after " << (pane.loadTime + pane.spectrogram->getFirstColumnTime()).asMilliseconds() << " ms, all after "
+                      << (pane.loadTime + time).asMilliseconds() << " ms " << (pane.loader ? "(decoded while generating)" : "(decoded before)") << std::endl;
+            const Arena::Statistics scratch = pane.spectrogram->getScratchStatistics();
+            std::cout << " scratch: " << scratch.allocations << " arrays with " << scratch.allocatedBytes / 1024 << " KB from "
+                      << scratch.blocks << " blocks with " << scratch.reservedBytes / 1024 << " KB" << std::endl;
+            pane.isReported = true;
+        }
+
+        const bool isVisible = pane.spectrogram->getLocalBounds().intersects(visibleArea);
+        pane.spectrogram->setPriority(isVisible ? ThreadPool::Priority::High : ThreadPool::Priority::Low);
+        pane.spectrogram->setVisibleArea(visibleArea);
+
+        // colorize the generated columns
+        pane.spectrogram->updateImage();
+        pane.spectrogram->updateImage();
+    }
+
+    // the waveform of the active pane follows its pan and zoom
+    const Pane& activePane = m_panes[m_activePane];
+    const Spectrogram& spectrogram = *activePane.spectrogram;
+    m_waveform.update(spectrogram.getPeakIndex(), activePane.sampleRate,
+                      spectrogram.getPosition().x, spectrogram.getFramesPerSecond() * spectrogram.getScale().x);
+
+    updateSpectrumPanel();
 }
 
 
@@ -253,12 +379,27 @@ void Application::draw()
     // clear the window to dark grey
     m_window.clear(sf::Color(50, 50, 50));
 
-    // draw the spectrogram
-    m_window.draw(*m_spectrogram);
+    // draw the spectrograms
+    for (const Pane& pane : m_panes)
+        m_window.draw(*pane.spectrogram);
+
+    // the selection is kept in the coordinates of the spectrogram, so it follows the pan and zoom
+    if (m_regionStream)
+    {
+        const sf::FloatRect area = m_panes[m_activePane].spectrogram->getTransform().transformRect(m_selection);
+        m_selectionShape.setPosition(area.left, area.top);
+        m_selectionShape.setSize(sf::Vector2f(area.width, area.height));
+        m_window.draw(m_selectionShape);
+    }
 
     // draw the play progress bar
     m_window.draw(m_playProgressBar);
 
+    // the waveform is drawn last, the panes may be scrolled below it
+    m_window.draw(m_waveform);
+    if (m_showSpectrum)
+        m_window.draw(m_spectrumPanel);
+
     // display the windows content
     m_window.display();
 }
@@ -266,8 +407,415 @@ void Application::draw()
 
 void Application::updatePlayProgressBar()
 {
-    auto position = m_spectrogram->getPosition();
-    position.x += m_spectrogram->getLocalBounds().width * m_sound.getPlayingOffset().asSeconds() / m_sound.getBuffer()->getDuration().asSeconds();
+    const Spectrogram& spectrogram = *m_panes[m_activePane].spectrogram;
+    auto position = spectrogram.getPosition();
+    // the padding at the end makes the image a bit longer than the sound, so the frame rate is used
+    position.x += m_playbackClock.getOffset().asSeconds() * spectrogram.getFramesPerSecond() * spectrogram.getScale().x;
 
     m_playProgressBar.setPosition(position);
+    m_playProgressBar.setSize(sf::Vector2f(2.f, spectrogram.getLocalBounds().height));
+    m_waveform.setPlayPosition(position.x);
+}
+
+
+void Application::followPlayback()
+{
+    // the first pane is moved, the others follow it
+    Spectrogram& reference = *m_panes.front().spectrogram;
+    const float offset = m_playbackClock.getOffset().asSeconds() * reference.getFramesPerSecond() * reference.getScale().x;
+    const float center = m_window.getView().getCenter().x;
+    reference.setPosition(center - offset, reference.getPosition().y);
+    layoutPanes();
+}
+
+
+void Application::jumpToEvent(bool isForward)
+{
+    const Spectrogram& spectrogram = *m_panes[m_activePane].spectrogram;
+
+    // search from the sample that is played, the heard offset lags by the latency and would find the last onset again
+    const sf::Time offset = m_regionStream ? m_regionStream->getStart() + m_regionStream->getPlayingOffset() : m_sound.getPlayingOffset();
+    sf::Time event;
+    const bool isFound = isForward ? spectrogram.findNextEvent(offset, event)
+                                   : spectrogram.findPreviousEvent(offset, event);
+    if (!isFound)
+        return;
+
+    // the onsets are in the whole sound
+    clearSelection();
+
+    // a stopped sound would start from the beginning again
+    if (m_sound.getStatus() == sf::Sound::Stopped)
+    {
+        m_sound.play();
+        m_sound.pause();
+    }
+    m_sound.setPlayingOffset(event);
+    updatePlaybackClock();
+
+    followPlayback();
+    updatePlayProgressBar();
+}
+
+
+void Application::updatePlaybackClock()
+{
+    // the offset of the stream starts at the region
+    if (m_regionStream)
+        m_playbackClock.update(m_regionStream->getStatus(), m_regionStream->getStart() + m_regionStream->getPlayingOffset());
+    else
+        m_playbackClock.update(m_sound.getStatus(), m_sound.getPlayingOffset());
+}
+
+
+bool Application::isPlaying() const
+{
+    if (m_regionStream)
+        return m_regionStream->getStatus() == sf::SoundStream::Playing;
+    return m_sound.getStatus() == sf::Sound::Playing;
+}
+
+
+void Application::selectRegion(const sf::Vector2f& position)
+{
+    clearSelection();
+
+    // a click only clears the selection
+    if (std::abs(position.x - m_selectionStart.x) < minimumSelection || std::abs(position.y - m_selectionStart.y) < minimumSelection)
+        return;
+
+    const Pane& pane = m_panes[m_activePane];
+    const Spectrogram& spectrogram = *pane.spectrogram;
+    if (!pane.soundBuffer || pane.soundBuffer->getSampleCount() == 0)
+        return;
+
+    // clamp the rectangle to the image, the rows are the bins from the top down
+    const sf::Transform& toLocal = spectrogram.getInverseTransform();
+    const sf::Vector2f start = toLocal.transformPoint(m_selectionStart);
+    const sf::Vector2f end = toLocal.transformPoint(position);
+    const float frameCount = static_cast<float>(spectrogram.getFrameCount());
+    const float binCount = static_cast<float>(spectrogram.getBinCount());
+    const float left = std::max(std::min(start.x, end.x), 0.f);
+    const float right = std::min(std::max(start.x, end.x), frameCount);
+    const float top = std::max(std::min(start.y, end.y), 0.f);
+    const float bottom = std::min(std::max(start.y, end.y), binCount);
+    if (left >= right || top >= bottom)
+        return;
+
+    const float binWidth = spectrogram.getBinWidth();
+    const sf::Time startTime = sf::seconds(left / spectrogram.getFramesPerSecond());
+    const sf::Time endTime = sf::seconds(right / spectrogram.getFramesPerSecond());
+    const float lowFrequency = (binCount - bottom) * binWidth;
+    const float highFrequency = (binCount - top) * binWidth;
+
+    // the region is resynthesized at the sample rate of the sound, with the framing of the spectrogram,
+    // out-of-core sizes would need plans far larger than the cache, so their framing is shorter
+    unsigned int FFTSize = m_settings.FFTSize;
+    if (FFTSize > Spectrogram::largestInCoreSize)
+        FFTSize = Spectrogram::largestInCoreSize;
+    m_sound.pause();
+    m_selection = sf::FloatRect(left, top, right - left, bottom - top);
+    m_regionStream.reset(new RegionStream(pane.soundBuffer, m_cache.getFFTPlan(FFTSize), m_cache.getInverseFFTPlan(FFTSize)));
+    m_regionStream->setRegion(startTime, endTime, lowFrequency, highFrequency);
+    m_regionStream->play();
+
+    // the average spectrum of the selected time is read from the stored frames
+    m_panes[m_activePane].spectrogram->setSpectrumRange(static_cast<unsigned int>(left), static_cast<unsigned int>(std::ceil(right)));
+    m_spectrumPanel.clear();
+    m_isSpectrumOutdated = true;
+
+    std::cout << "Playing " << startTime.asSeconds() << " s to " << endTime.asSeconds() << " s, "
+              << lowFrequency << " Hz to " << highFrequency << " Hz" << std::endl;
+
+    updatePlaybackClock();
+    updatePlayProgressBar();
+}
+
+
+void Application::clearSelection()
+{
+    if (m_regionStream && m_activePane < m_panes.size())
+    {
+        m_panes[m_activePane].spectrogram->clearSpectrumRange();
+        m_spectrumPanel.clear();
+        m_isSpectrumOutdated = true;
+    }
+    m_regionStream.reset();
+    updatePlaybackClock();
+}
+
+
+void Application::layoutWaveform()
+{
+    const float width = static_cast<float>(m_window.getSize().x);
+    m_waveform.setArea(sf::FloatRect(0.f, paneSpacing, width, margin - 2.f * paneSpacing));
+}
+
+
+void Application::layoutSpectrumPanel()
+{
+    const sf::Vector2f size(m_window.getSize());
+    m_spectrumPanel.setArea(sf::FloatRect(size.x - spectrumWidth, margin, spectrumWidth, std::max(size.y - 2.f * margin, minimumHeight)));
+}
+
+
+void Application::updateSpectrumPanel()
+{
+    if (!m_showSpectrum || !m_isSpectrumOutdated)
+        return;
+
+    const Spectrogram& spectrogram = *m_panes[m_activePane].spectrogram;
+    if (spectrogram.getMode() == Settings::Mode::Transfer)
+    {
+        // the transfer function is only averaged over the whole sound
+        CrossSpectrum::Traces traces;
+        if (spectrogram.getTransferFunction(traces))
+        {
+            m_spectrumPanel.update(traces);
+            m_isSpectrumOutdated = false;
+        }
+        return;
+    }
+
+    // the whole sound is averaged once it is generated, a selection once its frames are summed up
+    PowerSpectrum::Traces traces;
+    if (spectrogram.getAverageSpectrum(m_settings.spectrumPercentile, traces))
+    {
+        m_spectrumPanel.update(traces);
+        m_isSpectrumOutdated = false;
+    }
+}
+
+
+void Application::reloadSettings()
+{
+    Settings settings = m_settings;
+    if (!settings.loadFromFile("settings.txt"))
+        return;
+
+    // only rebuild what is affected by the changed values
+    const unsigned int changes = settings.compare(m_settings);
+    m_settings = settings;
+
+    m_playbackClock.setLatency(sf::milliseconds(m_settings.audioLatency));
+    if (changes & Settings::Spectrum)
+        m_isSpectrumOutdated = true;
+
+    if (changes & Settings::Resources)
+    {
+        // the spectrograms use the old pool, they have to go first
+        clearSelection();
+        m_sound.stop();
+        m_panes.clear();
+        m_pool.reset();
+        m_pool = std::unique_ptr<ThreadPool>(new ThreadPool(m_settings.threads));
+        createPanes(false);
+    }
+    else if (changes & (Settings::Transform | Settings::Storage | Settings::Export))
+    {
+        createPanes(false);
+    }
+    else
+    {
+        // the sounds are only decoded again if they are not cached or the files were modified
+        createPanes(true);
+
+        // the kept spectrograms still have the old colors
+        if (changes & Settings::Colors)
+        {
+            for (Pane& pane : m_panes)
+            {
+                pane.spectrogram->setDynamicRange(m_settings.floorPercentile, m_settings.ceilingPercentile);
+                pane.spectrogram->redraw();
+            }
+        }
+    }
+}
+
+
+void Application::createPanes(bool keepUnchanged)
+{
+    // keep the zoom and position of the view
+    const sf::Vector2f scale = m_panes.empty() ? sf::Vector2f(1.f, 1.f) : m_panes.front().spectrogram->getScale();
+    const sf::Vector2f position = m_panes.empty() ? sf::Vector2f(margin, margin) : m_panes.front().spectrogram->getPosition();
+
+    // load the sounds, skip the ones that don't fit into the memory limit
+    std::vector<Pane> panes;
+    std::size_t memoryUsage = 0;
+    for (const std::string& filename : m_settings.filenames)
+    {
+        Pane pane;
+        pane.filename = filename;
+        sf::Clock loadClock;
+        pane.soundBuffer = m_cache.findSoundBuffer(filename);
+        if (!pane.soundBuffer && m_settings.isDecodingPipelined)
+        {
+            // only the header is read now, the samples are decoded while the spectrogram is generated
+            pane.modificationTime = modificationTime(filename);
+            std::shared_ptr<SoundLoader> loader = std::make_shared<SoundLoader>();
+            if (loader->openFromFile(filename))
+            {
+                pane.loader = loader;
+                pane.sampleRate = loader->getSampleRate();
+                pane.channelCount = loader->getChannelCount();
+                pane.sampleCount = loader->getSampleCount();
+            }
+        }
+        else
+        {
+            if (!pane.soundBuffer)
+                pane.soundBuffer = m_cache.getSoundBuffer(filename);
+            if (pane.soundBuffer)
+            {
+                pane.sampleRate = pane.soundBuffer->getSampleRate();
+                pane.channelCount = pane.soundBuffer->getChannelCount();
+                pane.sampleCount = static_cast<std::size_t>(pane.soundBuffer->getSampleCount());
+                pane.loadTime = loadClock.getElapsedTime();
+            }
+        }
+
+        if (!pane.soundBuffer && !pane.loader)
+        {
+            std::cout << "Could not load soundfile with name: " << filename << std::endl;
+            // maybe throw exeption
+            continue;
+        }
+
+        // a file that doesn't fit is skipped on its own, a smaller one after it may still fit
+        const std::size_t paneMemoryUsage = Spectrogram::estimateMemoryUsage(pane.sampleCount, pane.channelCount, pane.sampleRate, m_settings);
+        memoryUsage += paneMemoryUsage;
+        if (m_settings.memoryLimit > 0 && memoryUsage > m_settings.memoryLimit * std::size_t(1024 * 1024))
+        {
+            memoryUsage -= paneMemoryUsage;
+            std::cout << "Skipping " << filename << ", with it the spectrograms of all files would use more than the "
+                      << m_settings.memoryLimit << " MB of memoryLimit." << std::endl;
+            continue;
+        }
+
+        if (keepUnchanged)
+        {
+            // reuse the spectrogram of the same sound, also if it is still decoded from a file that wasn't modified since
+            auto unchanged = std::find_if(m_panes.begin(), m_panes.end(),
+                                          [&pane] (const Pane& oldPane)
+                                          {
+                                              if (!oldPane.spectrogram)
+                                                  return false;
+                                              if (pane.soundBuffer)
+                                                  return oldPane.soundBuffer == pane.soundBuffer;
+                                              return !oldPane.soundBuffer && oldPane.loader && oldPane.filename == pane.filename
+                                                     && oldPane.modificationTime == pane.modificationTime;
+                                          });
+            if (unchanged != m_panes.end())
+            {
+                pane.spectrogram = std::move(unchanged->spectrogram);
+                if (!pane.soundBuffer)
+                    pane.loader = unchanged->loader;
+                pane.loadTime = unchanged->loadTime;
+                pane.isReported = unchanged->isReported;
+            }
+        }
+
+        panes.push_back(std::move(pane));
+    }
+
+    if (panes.empty())
+    {
+        if (!m_panes.empty())
+            return; // keep showing the old ones
+
+        // show at least an empty spectrogram
+        Pane pane;
+        pane.soundBuffer = std::make_shared<const sf::SoundBuffer>();
+        panes.push_back(std::move(pane));
+    }
+
+    // destroy the old spectrograms first, so their textures and images can be reused
+    m_panes.clear();
+    m_panes = std::move(panes);
+
+    for (Pane& pane : m_panes)
+    {
+        if (!pane.spectrogram)
+            pane.spectrogram = createSpectrogram(pane);
+    }
+
+    m_panes.front().spectrogram->setScale(scale.x, 1.f);
+    m_panes.front().spectrogram->setPosition(position);
+    layoutPanes();
+
+    setActivePane(std::min(m_activePane, m_panes.size() - 1));
+}
+
+
+std::unique_ptr<Spectrogram> Application::createSpectrogram(const Pane& pane)
+{
+    std::unique_ptr<Spectrogram> spectrogram(pane.soundBuffer ? new Spectrogram(pane.soundBuffer, m_settings, m_cache)
+                                                              : new Spectrogram(pane.loader, m_settings, m_cache));
+    if (!pane.filename.empty())
+    {
+        std::unique_ptr<FrameSink> sink = FrameSink::create(m_settings.exportFormat, pane.filename);
+        if (m_settings.isExportingFeatures)
+            sink.reset(new FeatureWriter(pane.filename + ".features.npy", std::move(sink)));
+        spectrogram->setFrameSink(std::move(sink));
+    }
+    spectrogram->setTrackOverlayVisible(m_showTracks);
+    spectrogram->setWhitened(m_showWhitened);
+    spectrogram->generate(*m_pool);
+    return spectrogram;
+}
+
+
+void Application::layoutPanes()
+{
+    const Spectrogram& reference = *m_panes.front().spectrogram;
+
+    // share the height of the window
+    const float availableHeight = m_window.getSize().y - 2.f * margin - (m_panes.size() - 1) * paneSpacing;
+    const float paneHeight = std::max(availableHeight / m_panes.size(), minimumHeight);
+
+    // don't scroll further than the last pane
+    const float contentHeight = m_panes.size() * (paneHeight + paneSpacing) - paneSpacing;
+    m_verticalScroll = std::min(std::max(m_verticalScroll, 0.f), std::max(contentHeight - availableHeight, 0.f));
+
+    const sf::Vector2f referenceScale = reference.getScale();
+    const float left = reference.getPosition().x;
+    float top = margin - m_verticalScroll;
+    for (Pane& pane : m_panes)
+    {
+        Spectrogram& spectrogram = *pane.spectrogram;
+
+        // align the panes in time, even if the sounds have a different sample rate
+        const float timeScale = reference.getFramesPerSecond() / spectrogram.getFramesPerSecond();
+        const float heightScale = paneHeight / spectrogram.getBinCount();
+
+        spectrogram.setScale(referenceScale.x * timeScale, heightScale);
+        spectrogram.setPosition(left, top);
+
+        top += paneHeight + paneSpacing;
+    }
+}
+
+
+void Application::setActivePane(std::size_t index)
+{
+    // the selection belongs to the spectrogram of the old pane
+    clearSelection();
+    m_activePane = index;
+    m_spectrumPanel.clear();
+    m_isSpectrumOutdated = true;
+
+    // play the sound of the active pane
+    if (m_soundBuffer != m_panes[m_activePane].soundBuffer)
+    {
+        m_sound.stop();
+        m_soundBuffer = m_panes[m_activePane].soundBuffer;
+
+        // a sound that is still decoded can't be played yet
+        if (m_soundBuffer)
+            m_sound.setBuffer(*m_soundBuffer);
+        else
+            m_sound.resetBuffer();
+    }
+
+    updatePlayProgressBar();
 }
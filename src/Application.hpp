@@ -22,13 +22,23 @@
 #define FFTSPECTRUM_APPLICATION_HPP
 
 #include "Spectrogram.hpp"
+#include "Settings.hpp"
+#include "FileWatcher.hpp"
+#include "ResourceCache.hpp"
+#include "ThreadPool.hpp"
+#include "Waveform.hpp"
+#include "PlaybackClock.hpp"
+#include "RegionStream.hpp"
+#include "SpectrumPanel.hpp"
 
 #include <SFML/Graphics/RenderWindow.hpp>
 #include <SFML/Graphics/RectangleShape.hpp>
 #include <SFML/Audio/SoundBuffer.hpp>
 #include <SFML/Audio/Sound.hpp>
 
+#include <ctime>
 #include <memory>
+#include <vector>
 
 class Application
 {
@@ -47,13 +57,115 @@ private:
 
     void updatePlayProgressBar();
 
+    /**
+     * @brief Scrolls the panes so the play progress bar stays in the middle of the window.
+     */
+    void followPlayback();
+
+    /**
+     * @brief Moves the playback of the active pane to its next or previous onset.
+     */
+    void jumpToEvent(bool isForward);
+
+    /**
+     * @brief Updates the playback clock from the region stream if a region is selected,
+     *        otherwise from the sound.
+     */
+    void updatePlaybackClock();
+
+    /**
+     * @brief Returns whether the sound or the region stream is playing.
+     */
+    bool isPlaying() const;
+
+    /**
+     * @brief Selects the time and frequency region under the rectangle between the start
+     *        of the drag and the position (in window coordinates) and starts playing it.
+     */
+    void selectRegion(const sf::Vector2f& position);
+
+    /**
+     * @brief Stops the region stream and plays the whole sound again.
+     */
+    void clearSelection();
+
+    /**
+     * @brief Places the waveform strip in the top margin, over the whole width of the window.
+     */
+    void layoutWaveform();
+
+    /**
+     * @brief Places the average spectrum at the right border, next to the panes.
+     */
+    void layoutSpectrumPanel();
+
+    /**
+     * @brief Shows the average spectrum of the active pane once it is computed.
+     */
+    void updateSpectrumPanel();
+
+    void reloadSettings();
+
+    /**
+     * @brief Creates the panes for the files in the settings. Panes whose file and
+     *        parameters didn't change are kept if keepUnchanged is true.
+     */
+    void createPanes(bool keepUnchanged);
+
+    struct Pane;
+
+    /**
+     * @brief Creates the spectrogram of a pane and starts generating it.
+     */
+    std::unique_ptr<Spectrogram> createSpectrogram(const Pane& pane);
+
+    /**
+     * @brief Stacks the panes vertically and gives them the horizontal position and
+     *        zoom of the first pane, so the same point in time is below each other.
+     */
+    void layoutPanes();
+
+    void setActivePane(std::size_t index);
+
+
+    struct Pane
+    {
+        std::string                             filename;
+        std::shared_ptr<const sf::SoundBuffer>  soundBuffer;    // null while the loader decodes the sound
+        std::shared_ptr<SoundLoader>            loader;         // null if the sound was decoded before
+        std::time_t                             modificationTime = 0;   // of the file the loader decodes
+        std::unique_ptr<Spectrogram>            spectrogram;
+        unsigned int                            sampleRate = 0;
+        unsigned int                            channelCount = 0;
+        std::size_t                             sampleCount = 0;
+        sf::Time                                loadTime;       // spent decoding before the generation started
+        bool                                    isReported = false;
+    };
 
     sf::RenderWindow                m_window;
-    sf::SoundBuffer                 m_soundBuffer;
+    ResourceCache                   m_cache;
+    std::unique_ptr<ThreadPool>     m_pool;
+    std::shared_ptr<const sf::SoundBuffer> m_soundBuffer;
     sf::Sound                       m_sound;
-    unsigned int                    m_FFTSize;
-    std::unique_ptr<Spectrogram>    m_spectrogram;
+    PlaybackClock                   m_playbackClock;
+    std::unique_ptr<RegionStream>   m_regionStream;     // null while nothing is selected
+    sf::FloatRect                   m_selection;        // in the local coordinates of the active spectrogram
+    sf::Vector2f                    m_selectionStart;   // where the drag started, in window coordinates
+    bool                            m_isSelecting;
+    sf::RectangleShape              m_selectionShape;
+    bool                            m_isFollowing;
+    bool                            m_showTracks;
+    bool                            m_showWhitened;
+    Settings                        m_settings;
+    FileWatcher                     m_settingsWatcher;
+    std::vector<Pane>               m_panes;
+    std::size_t                     m_activePane;
+    float                           m_verticalScroll;
     sf::RectangleShape              m_playProgressBar;
+    Waveform                        m_waveform;
+    SpectrumPanel                   m_spectrumPanel;
+    bool                            m_showSpectrum;
+    bool                            m_isSpectrumOutdated;   // the panel waits for the average of the active pane
     sf::Vector2f                    m_previousMousePos;
     bool                            m_hasFocus;
 };
@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "Arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+
+namespace
+{
+    const std::size_t cacheLineSize = 64;
+
+    std::size_t alignedSize(std::size_t size)
+    {
+        return (size + cacheLineSize - 1) / cacheLineSize * cacheLineSize;
+    }
+}
+
+
+Arena::Scope::Scope(Arena& arena) :
+    m_arena(arena),
+    m_data(nullptr),
+    m_capacity(0),
+    m_used(0)
+{
+
+}
+
+
+Arena::Scope::~Scope()
+{
+    m_arena.releaseBlocks(m_blocks, m_statistics);
+}
+
+
+void* Arena::Scope::allocateBytes(std::size_t size)
+{
+    size = alignedSize(std::max<std::size_t>(size, 1));
+
+    ++m_statistics.allocations;
+    m_statistics.allocatedBytes += size;
+
+    // the last block is filled first, a new one is taken when it doesn't fit
+    if (m_blocks.empty() || m_used + size > m_capacity)
+    {
+        std::lock_guard<std::mutex> lock(m_arena.m_mutex);
+        const std::size_t index = m_arena.acquireBlock(size);
+        m_blocks.push_back(index);
+        m_data = m_arena.m_blocks[index].data;   // the memory of a block never moves
+        m_capacity = m_arena.m_blocks[index].size;
+        m_used = 0;
+    }
+
+    void* pointer = m_data + m_used;
+    m_used += size;
+    return pointer;
+}
+
+
+Arena::Arena(std::size_t blockSize) :
+    m_blockSize(alignedSize(blockSize))
+{
+
+}
+
+
+Arena::Statistics Arena::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
+
+
+void Arena::resetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_statistics = Statistics();
+}
+
+
+std::size_t Arena::acquireBlock(std::size_t size)
+{
+    // the smallest free block that fits
+    auto best = m_freeBlocks.end();
+    for (auto it = m_freeBlocks.begin(); it != m_freeBlocks.end(); ++it)
+    {
+        if (m_blocks[*it].size >= size && (best == m_freeBlocks.end() || m_blocks[*it].size < m_blocks[*best].size))
+            best = it;
+    }
+    if (best != m_freeBlocks.end())
+    {
+        const std::size_t index = *best;
+        m_freeBlocks.erase(best);
+        return index;
+    }
+
+    Block block;
+    block.size = std::max(size, m_blockSize);
+    block.memory = std::unique_ptr<unsigned char[]>(new unsigned char[block.size + cacheLineSize - 1]);
+    const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(block.memory.get());
+    block.data = block.memory.get() + (cacheLineSize - address % cacheLineSize) % cacheLineSize;
+    m_blocks.push_back(std::move(block));
+
+    ++m_statistics.blocks;
+    m_statistics.reservedBytes += m_blocks.back().size;
+    return m_blocks.size() - 1;
+}
+
+
+void Arena::releaseBlocks(const std::vector<std::size_t>& blocks, const Statistics& statistics)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_freeBlocks.insert(m_freeBlocks.end(), blocks.begin(), blocks.end());
+    m_statistics.allocations += statistics.allocations;
+    m_statistics.allocatedBytes += statistics.allocatedBytes;
+}
@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_ARENA_HPP
+#define FFTSPECTRUM_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief The Arena class hands out scratch memory in large blocks, so the jobs of
+ *        a generation don't go to the heap for every buffer. A job allocates through
+ *        a Scope, which takes blocks from the arena and gives them back when it is
+ *        destroyed, so the next job reuses them. All blocks are freed together with
+ *        the arena. The allocations are counted, to see how much scratch a run needs.
+ */
+class Arena
+{
+public:
+    struct Statistics
+    {
+        std::size_t allocations     = 0;    ///< the number of arrays handed out
+        std::size_t allocatedBytes  = 0;    ///< the sum of their sizes
+        std::size_t blocks          = 0;    ///< the number of blocks taken from the heap
+        std::size_t reservedBytes   = 0;    ///< the sum of their sizes
+    };
+
+    /**
+     * @brief A Scope is used by one thread at a time. Its arrays stay valid until it is destroyed.
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(Arena& arena);
+
+        ~Scope();
+
+        /**
+         * @brief Returns an uninitialized array that is aligned to a cache line.
+         */
+        template <typename T>
+        T*      allocate(std::size_t count);
+
+    private:
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+
+        void*   allocateBytes(std::size_t size);
+
+        Arena&                  m_arena;
+        std::vector<std::size_t> m_blocks;      // indices into the blocks of the arena, the last one is filled
+        unsigned char*          m_data;         // of the last block
+        std::size_t             m_capacity;
+        std::size_t             m_used;         // bytes of the last block that are handed out
+        Statistics              m_statistics;
+    };
+
+    /**
+     * @param blockSize The size of a block, larger arrays get a block of their own
+     */
+    explicit Arena(std::size_t blockSize = 256 * 1024);
+
+    /**
+     * @brief Returns the statistics since the last reset, the blocks are counted when they are created.
+     */
+    Statistics  getStatistics() const;
+
+    /**
+     * @brief Starts counting from zero, the blocks are kept.
+     */
+    void        resetStatistics();
+
+private:
+
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+
+    struct Block
+    {
+        std::unique_ptr<unsigned char[]>    memory;
+        unsigned char*                      data;   // memory aligned to a cache line
+        std::size_t                         size;
+    };
+
+    /**
+     * @brief Returns the index of a free block of at least the given size, a new one is created if there is none.
+     */
+    std::size_t acquireBlock(std::size_t size);
+
+    void        releaseBlocks(const std::vector<std::size_t>& blocks, const Statistics& statistics);
+
+    const std::size_t           m_blockSize;
+    mutable std::mutex          m_mutex;
+    std::vector<Block>          m_blocks;       // guarded by m_mutex, like the members below
+    std::vector<std::size_t>    m_freeBlocks;
+    Statistics                  m_statistics;
+};
+
+
+template <typename T>
+T* Arena::Scope::allocate(std::size_t count)
+{
+    static_assert(std::is_trivially_destructible<T>::value, "the arena doesn't call destructors");
+    return static_cast<T*>(allocateBytes(count * sizeof(T)));
+}
+
+#endif //FFTSPECTRUM_ARENA_HPP
@@ -0,0 +1,185 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "BatchGenerator.hpp"
+#include "SoundLoader.hpp"
+#include "Spectrogram.hpp"
+
+#include <algorithm>
+
+
+namespace
+{
+    Settings headlessSettings(Settings settings)
+    {
+        // the frames only go to the sinks, nothing is drawn
+        settings.isHeadless = true;
+        return settings;
+    }
+
+    // passes the frames on and tells when the spectrogram is done with it
+    class CompletionSink : public FrameSink
+    {
+    public:
+        CompletionSink(std::unique_ptr<FrameSink> sink, std::function<void()> listener) :
+            m_sink(std::move(sink)),
+            m_listener(listener)
+        {
+
+        }
+
+        virtual ~CompletionSink()
+        {
+            m_sink.reset();
+            m_listener();
+        }
+
+        virtual bool begin(const Description& description)
+        {
+            return !m_sink || m_sink->begin(description);
+        }
+
+        virtual bool write(const float* frame)
+        {
+            return !m_sink || m_sink->write(frame);
+        }
+
+        virtual bool finish()
+        {
+            return !m_sink || m_sink->finish();
+        }
+
+    private:
+        std::unique_ptr<FrameSink>  m_sink;
+        std::function<void()>       m_listener;
+    };
+}
+
+
+BatchGenerator::BatchGenerator(const Settings& settings, ThreadPool& pool, ResourceCache& cache) :
+    m_settings(headlessSettings(settings)),
+    m_pool(pool),
+    m_cache(cache),
+    m_memoryUsage(0)
+{
+
+}
+
+
+BatchGenerator::~BatchGenerator()
+{
+    // the sinks of the cancelled spectrograms still call back, so the lock must not be held
+    std::list<Job> jobs;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        jobs.swap(m_jobs);
+    }
+    for (Job& job : jobs)
+        job.spectrogram.reset();
+}
+
+
+bool BatchGenerator::addFile(const std::string& filename, SinkFactory createSink)
+{
+    std::shared_ptr<SoundLoader> loader = std::make_shared<SoundLoader>();
+    if (!loader->openFromFile(filename))
+        return false;
+
+    const std::size_t memoryUsage = Spectrogram::estimateMemoryUsage(loader->getSampleCount(), loader->getChannelCount(),
+                                                                     loader->getSampleRate(), m_settings);
+    waitForSlot(memoryUsage);
+    start(std::unique_ptr<Spectrogram>(new Spectrogram(loader, m_settings, m_cache)), memoryUsage, createSink);
+    return true;
+}
+
+
+void BatchGenerator::addSound(std::shared_ptr<const sf::SoundBuffer> soundBuffer, SinkFactory createSink)
+{
+    const std::size_t memoryUsage = Spectrogram::estimateMemoryUsage(static_cast<std::size_t>(soundBuffer->getSampleCount()),
+                                                                     soundBuffer->getChannelCount(), soundBuffer->getSampleRate(), m_settings);
+    waitForSlot(memoryUsage);
+    start(std::unique_ptr<Spectrogram>(new Spectrogram(soundBuffer, m_settings, m_cache)), memoryUsage, createSink);
+}
+
+
+void BatchGenerator::wait()
+{
+    std::list<Job> finished;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobFinished.wait(lock, [this]
+    {
+        return std::all_of(m_jobs.begin(), m_jobs.end(), [] (const Job& job) { return job.isFinished; });
+    });
+    finished.swap(m_jobs);
+    m_memoryUsage = 0;
+    lock.unlock();
+}
+
+
+void BatchGenerator::waitForSlot(std::size_t memoryUsage)
+{
+    const std::size_t maxJobs = std::max(m_pool.getThreadCount(), 1u);
+    const std::size_t memoryLimit = m_settings.memoryLimit * std::size_t(1024 * 1024);
+
+    // the finished spectrograms are destroyed after the lock is released, they wait for their last task
+    std::list<Job> finished;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobFinished.wait(lock, [&]
+    {
+        for (auto job = m_jobs.begin(); job != m_jobs.end();)
+        {
+            auto current = job++;
+            if (current->isFinished)
+            {
+                m_memoryUsage -= current->memoryUsage;
+                finished.splice(finished.end(), m_jobs, current);
+            }
+        }
+
+        // a sound that is larger than the limit still gets through on its own
+        return m_jobs.empty() || (m_jobs.size() < maxJobs && (memoryLimit == 0 || m_memoryUsage + memoryUsage <= memoryLimit));
+    });
+    lock.unlock();
+}
+
+
+void BatchGenerator::start(std::unique_ptr<Spectrogram> spectrogram, std::size_t memoryUsage, const SinkFactory& createSink)
+{
+    Spectrogram* generated = spectrogram.get();
+    Job* job = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(Job());
+        job = &m_jobs.back();
+        job->spectrogram = std::move(spectrogram);
+        job->memoryUsage = memoryUsage;
+        job->isFinished = false;
+        m_memoryUsage += memoryUsage;
+    }
+
+    // the jobs are only removed by this thread, and only when they are finished, so the job outlives the sink
+    generated->setFrameSink(std::unique_ptr<FrameSink>(new CompletionSink(createSink(*generated), [this, job]
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        job->isFinished = true;
+        m_jobFinished.notify_all();
+    })));
+    generated->generate(m_pool);
+}
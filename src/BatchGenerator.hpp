@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_BATCHGENERATOR_HPP
+#define FFTSPECTRUM_BATCHGENERATOR_HPP
+
+#include "FrameSink.hpp"
+#include "ResourceCache.hpp"
+#include "Settings.hpp"
+#include "ThreadPool.hpp"
+
+#include <SFML/Audio/SoundBuffer.hpp>
+
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+class Spectrogram;
+
+/**
+ * @brief The BatchGenerator class generates the spectrograms of many sounds on the thread
+ *        pool without a window or an image and hands the frames of every sound to its own sink. Several
+ *        files are transformed at once and decoded while they are transformed: as many as
+ *        there are threads, fewer if they would use more than the memory limit. A sound is
+ *        done when its spectrogram lets go of the sink, after the last frame or when the sink
+ *        failed.
+ */
+class BatchGenerator
+{
+public:
+    /**
+     * @brief Creates the sink of a sound once its spectrogram is set up. It is called on the
+     *        thread that adds the sound.
+     */
+    typedef std::function<std::unique_ptr<FrameSink>(const Spectrogram& spectrogram)> SinkFactory;
+
+    BatchGenerator(const Settings& settings, ThreadPool& pool, ResourceCache& cache);
+
+    /**
+     * @brief Cancels the sounds in flight.
+     */
+    ~BatchGenerator();
+
+    /**
+     * @brief Starts to generate a file. Blocks while too many sounds are in flight.
+     *
+     * @return false if the file can't be opened
+     */
+    bool                addFile(const std::string& filename, SinkFactory createSink);
+
+    /**
+     * @brief Starts to generate a sound that is loaded already. Blocks while too many sounds are in flight.
+     */
+    void                addSound(std::shared_ptr<const sf::SoundBuffer> soundBuffer, SinkFactory createSink);
+
+    /**
+     * @brief Waits until all sounds are done.
+     */
+    void                wait();
+
+private:
+    struct Job
+    {
+        std::unique_ptr<Spectrogram>    spectrogram;
+        std::size_t                     memoryUsage;
+        bool                            isFinished;
+    };
+
+    BatchGenerator(const BatchGenerator&);
+    BatchGenerator& operator=(const BatchGenerator&);
+
+    /**
+     * @brief Waits until a sound of the memory usage can be started and destroys the finished spectrograms.
+     */
+    void                waitForSlot(std::size_t memoryUsage);
+
+    void                start(std::unique_ptr<Spectrogram> spectrogram, std::size_t memoryUsage, const SinkFactory& createSink);
+
+    const Settings              m_settings;
+    ThreadPool&                 m_pool;
+    ResourceCache&              m_cache;
+    std::list<Job>              m_jobs;
+    std::size_t                 m_memoryUsage;  // of the sounds in flight
+    std::mutex                  m_mutex;
+    std::condition_variable     m_jobFinished;
+};
+
+#endif //FFTSPECTRUM_BATCHGENERATOR_HPP
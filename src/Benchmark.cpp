@@ -0,0 +1,720 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+// Compares the accuracy and the speed of the FFT backends and of the out-of-core transform,
+// and measures how much faster than real time a region is resynthesized and a sound is decimated.
+// Build it with -D BUILD_BENCHMARK=ON and run it from anywhere, it needs no files.
+// It returns 1 if a backend or the out-of-core transform is less accurate than expected, if
+// the resynthesis doesn't reproduce the passed band, if the decimator doesn't match a plain
+// loop over its taps, if a block doesn't survive the LZ4 round trip, or if one of the checks
+// of the spectrogram fails.
+
+#include "Decimator.hpp"
+#include "FFT.hpp"
+#include "LargeFFT.hpp"
+#include "LZ4.hpp"
+#include "Resynthesizer.hpp"
+#include "Spectrogram.hpp"
+#include "TileServer.hpp"
+
+#include <SFML/Network/IpAddress.hpp>
+#include <SFML/Network/TcpSocket.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    struct Reference
+    {
+        std::vector<long double> input;
+        std::vector<long double> real;
+        std::vector<long double> imag;
+    };
+
+
+    // a direct DFT with long double accumulation, O(N^2)
+    Reference naiveDFT(const std::vector<long double>& input)
+    {
+        const std::size_t length = input.size();
+        const long double pi = 3.141592653589793238462643383279502884L;
+
+        Reference reference;
+        reference.input = input;
+        reference.real.resize(length / 2 + 1);
+        reference.imag.resize(length / 2 + 1);
+        for (std::size_t k = 0; k <= length / 2; ++k)
+        {
+            long double real = 0, imag = 0;
+            for (std::size_t n = 0; n < length; ++n)
+            {
+                // reduce the index first, so the angle stays exact for large k * n
+                const long double angle = 2 * pi * static_cast<long double>((k * n) % length) / length;
+                real += input[n] * std::cos(angle);
+                imag -= input[n] * std::sin(angle);
+            }
+            reference.real[k] = real;
+            reference.imag[k] = imag;
+        }
+        return reference;
+    }
+
+
+    /**
+     * @brief Transforms the input of the reference, prints the error and the time per FFT.
+     *
+     * @return false if the error is more than 100 times the epsilon of the precision
+     */
+    template <typename Backend>
+    bool benchmark(const char* name, const Reference& reference)
+    {
+        typedef typename Backend::Scalar Scalar;
+        const unsigned int length = static_cast<unsigned int>(reference.input.size());
+
+        std::vector<Scalar> input(reference.input.begin(), reference.input.end());
+        BasicFFT<Backend> fft(length);
+
+        // the error relative to the largest magnitude of the spectrum
+        fft.process(&input[0]);
+        long double maximumError = 0, maximumMagnitude = 0;
+        for (std::size_t k = 0; k < reference.real.size(); ++k)
+        {
+            const long double realError = fft.realPart()[k] - reference.real[k];
+            const long double imagError = fft.imagPart()[k] - reference.imag[k];
+            maximumError = std::max(maximumError, std::sqrt(realError * realError + imagError * imagError));
+            maximumMagnitude = std::max(maximumMagnitude, std::sqrt(reference.real[k] * reference.real[k] + reference.imag[k] * reference.imag[k]));
+        }
+        const double errorDecibel = (maximumError > 0) ? static_cast<double>(20 * std::log10(maximumError / maximumMagnitude)) : -400.0;
+        const double toleranceDecibel = 20 * std::log10(static_cast<double>(std::numeric_limits<Scalar>::epsilon()) * 100);
+        const bool isAccurate = errorDecibel <= toleranceDecibel;
+
+        // repeat for at least 100 ms
+        unsigned int repeats = 0;
+        const auto start = std::chrono::steady_clock::now();
+        auto elapsed = std::chrono::steady_clock::duration::zero();
+        while (elapsed < std::chrono::milliseconds(100))
+        {
+            for (unsigned int i = 0; i < 16; ++i)
+                fft.process(&input[0]);
+            repeats += 16;
+            elapsed = std::chrono::steady_clock::now() - start;
+        }
+        const double microseconds = std::chrono::duration<double, std::micro>(elapsed).count() / repeats;
+
+        std::cout << std::setw(8) << length << "  " << std::left << std::setw(22) << name << std::right
+                  << std::setw(12) << std::fixed << std::setprecision(1) << errorDecibel << " dB"
+                  << std::setw(12) << std::setprecision(2) << microseconds << " us"
+                  << (isAccurate ? "" : "  FAILED") << std::endl;
+
+        return isAccurate;
+    }
+
+
+    /**
+     * @brief Transforms the input of the reference back and forth, prints the error and the time per inverse FFT.
+     *
+     * @return false if the error is more than 100 times the epsilon of the precision
+     */
+    template <typename Backend>
+    bool benchmarkInverse(const char* name, const Reference& reference)
+    {
+        typedef typename Backend::Scalar Scalar;
+        typedef BasicFFTPlan<Backend> Plan;
+        const unsigned int length = static_cast<unsigned int>(reference.input.size());
+
+        std::vector<Scalar> input(reference.input.begin(), reference.input.end());
+        std::vector<Scalar> output(length);
+        BasicFFT<Backend> fft(length);
+        BasicInverseFFT<Backend> inverseFFT(std::make_shared<const Plan>(length, Plan::Inverse));
+
+        // the error relative to the largest sample
+        fft.process(&input[0]);
+        inverseFFT.realPart() = fft.realPart();
+        inverseFFT.imagPart() = fft.imagPart();
+        inverseFFT.process(&output[0]);
+        long double maximumError = 0, maximumSample = 0;
+        for (unsigned int n = 0; n < length; ++n)
+        {
+            maximumError = std::max(maximumError, std::abs(static_cast<long double>(output[n]) / length - reference.input[n]));
+            maximumSample = std::max(maximumSample, std::abs(reference.input[n]));
+        }
+        const double errorDecibel = (maximumError > 0) ? static_cast<double>(20 * std::log10(maximumError / maximumSample)) : -400.0;
+        const double toleranceDecibel = 20 * std::log10(static_cast<double>(std::numeric_limits<Scalar>::epsilon()) * 100);
+        const bool isAccurate = errorDecibel <= toleranceDecibel;
+
+        // the inverse may overwrite the bins, they are copied in again like a caller would
+        unsigned int repeats = 0;
+        const auto start = std::chrono::steady_clock::now();
+        auto elapsed = std::chrono::steady_clock::duration::zero();
+        while (elapsed < std::chrono::milliseconds(100))
+        {
+            for (unsigned int i = 0; i < 16; ++i)
+            {
+                std::copy(fft.realPart().begin(), fft.realPart().end(), inverseFFT.realPart().begin());
+                std::copy(fft.imagPart().begin(), fft.imagPart().end(), inverseFFT.imagPart().begin());
+                inverseFFT.process(&output[0]);
+            }
+            repeats += 16;
+            elapsed = std::chrono::steady_clock::now() - start;
+        }
+        const double microseconds = std::chrono::duration<double, std::micro>(elapsed).count() / repeats;
+
+        std::cout << std::setw(8) << length << "  " << std::left << std::setw(22) << name << std::right
+                  << std::setw(12) << std::fixed << std::setprecision(1) << errorDecibel << " dB"
+                  << std::setw(12) << std::setprecision(2) << microseconds << " us"
+                  << (isAccurate ? "" : "  FAILED") << std::endl;
+
+        return isAccurate;
+    }
+
+
+    /**
+     * @brief Resynthesizes the band below 1 kHz of two tones, prints the suppression of the
+     *        upper tone and how much faster than real time the samples are rendered in the
+     *        chunks of the region stream.
+     *
+     * @return false if the lower tone is not reproduced within -40 dB
+     */
+    bool benchmarkResynthesis(unsigned int FFTLength)
+    {
+        const unsigned int sampleRate = 44100;
+        const std::size_t frameCount = 60 * sampleRate;
+        const double pi = 3.141592653589793;
+
+        std::vector<sf::Int16> samples(frameCount * 2);
+        std::vector<float> lowTone(frameCount);
+        for (std::size_t i = 0; i < frameCount; ++i)
+        {
+            lowTone[i] = static_cast<float>(0.4 * std::sin(2 * pi * 440 * i / sampleRate));
+            const double highTone = 0.4 * std::sin(2 * pi * 5000 * i / sampleRate);
+            samples[2 * i] = samples[2 * i + 1] = static_cast<sf::Int16>(std::lrint((lowTone[i] + highTone) * 32767));
+        }
+
+        Resynthesizer resynthesizer(std::make_shared<const FFTPlan>(FFTLength), std::make_shared<const FFTPlan>(FFTLength, FFTPlan::Inverse),
+                                    &samples[0], frameCount, 2, sampleRate);
+        resynthesizer.setRegion(0, frameCount, 0.f, 1000.f);
+
+        // 20 ms chunks like the stream
+        std::vector<float> output(frameCount);
+        const std::size_t chunkSize = sampleRate / 50;
+        const auto start = std::chrono::steady_clock::now();
+        std::size_t rendered = 0;
+        while (rendered < frameCount)
+        {
+            const std::size_t count = resynthesizer.render(&output[rendered], std::min(chunkSize, frameCount - rendered));
+            if (count == 0)
+                break;
+            rendered += count;
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // the tone is cut at the borders of the region, they are left out
+        double maximumError = 0;
+        for (std::size_t i = FFTLength; i + FFTLength < frameCount; ++i)
+            maximumError = std::max(maximumError, std::abs(static_cast<double>(output[i]) - lowTone[i]));
+        const double errorDecibel = (maximumError > 0) ? 20 * std::log10(maximumError / 0.4) : -400.0;
+        const bool isAccurate = rendered == frameCount && errorDecibel <= -40.0;
+
+        std::cout << std::setw(8) << FFTLength << "  " << std::left << std::setw(22) << "resynthesis" << std::right
+                  << std::setw(12) << std::fixed << std::setprecision(1) << errorDecibel << " dB"
+                  << std::setw(12) << std::setprecision(0) << frameCount / sampleRate / std::max(seconds, 1e-9) << " x real time"
+                  << (isAccurate ? "" : "  FAILED") << std::endl;
+
+        return isAccurate;
+    }
+
+
+    // the decimation by 2 written as a plain loop over the odd taps, with a bounds check per tap
+    std::vector<float> decimateDirectly(const std::vector<float>& input, const std::vector<float>& oddTaps)
+    {
+        const long long halfLength = static_cast<long long>(oddTaps.size()) - 1;
+        const long long inputCount = static_cast<long long>(input.size());
+        std::vector<float> output((input.size() + 1) / 2);
+        for (long long m = 0; m < static_cast<long long>(output.size()); ++m)
+        {
+            float sum = 0.f;
+            for (long long j = 0; j < static_cast<long long>(oddTaps.size()); ++j)
+            {
+                const long long index = 2 * m + 2 * j - halfLength;
+                if (index >= 0 && index < inputCount)
+                    sum += oddTaps[j] * input[index];
+            }
+            output[m] = 0.5f * input[2 * m] + sum;
+        }
+        return output;
+    }
+
+
+    /**
+     * @brief Decimates 60 seconds of noise by 2 with the decimator and with a plain loop over the
+     *        same taps, prints the difference and the speed of both. The taps are read from the
+     *        response of the decimator to an impulse on an odd sample.
+     *
+     * @return false if the outputs differ by more than 1e-5
+     */
+    bool benchmarkDecimator(std::mt19937& generator)
+    {
+        const unsigned int sampleRate = 44100;
+        const std::size_t frameCount = 60 * sampleRate;
+        const Decimator decimator(2);
+
+        // an impulse at x[2k + 1] gives y[m] = oddTaps[j] for m = k + tapCount / 2 - j
+        const std::size_t tapCount = 24, k = tapCount - 1;
+        std::vector<float> impulse(4 * tapCount, 0.f);
+        impulse[2 * k + 1] = 1.f;
+        const std::vector<float> response = decimator.process(impulse);
+        std::vector<float> oddTaps(tapCount);
+        for (std::size_t j = 0; j < tapCount; ++j)
+            oddTaps[j] = response[k + tapCount / 2 - j];
+
+        std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+        std::vector<float> input(frameCount);
+        for (float& sample : input)
+            sample = distribution(generator);
+
+        // the fastest of 5 runs each
+        std::vector<float> output, reference;
+        double seconds = std::numeric_limits<double>::max(), referenceSeconds = seconds;
+        for (unsigned int run = 0; run < 5; ++run)
+        {
+            auto start = std::chrono::steady_clock::now();
+            output = decimator.process(input);
+            seconds = std::min(seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+            start = std::chrono::steady_clock::now();
+            reference = decimateDirectly(input, oddTaps);
+            referenceSeconds = std::min(referenceSeconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        double maximumError = 0;
+        for (std::size_t m = 0; m < std::min(output.size(), reference.size()); ++m)
+            maximumError = std::max(maximumError, std::abs(static_cast<double>(output[m]) - reference[m]));
+        const bool isAccurate = output.size() == reference.size() && maximumError <= 1e-5;
+
+        const double errorDecibel = (maximumError > 0) ? 20 * std::log10(maximumError) : -400.0;
+        std::cout << std::setw(8) << tapCount * 2 - 1 << "  " << std::left << std::setw(22) << "plain loop" << std::right
+                  << std::setw(12) << "" << "   "
+                  << std::setw(12) << std::fixed << std::setprecision(0) << 60 / std::max(referenceSeconds, 1e-9) << " x real time" << std::endl;
+        std::cout << std::setw(8) << tapCount * 2 - 1 << "  " << std::left << std::setw(22) << "decimator" << std::right
+                  << std::setw(12) << std::setprecision(1) << errorDecibel << " dB"
+                  << std::setw(12) << std::setprecision(0) << 60 / std::max(seconds, 1e-9) << " x real time"
+                  << (isAccurate ? "" : "  FAILED") << std::endl;
+
+        return isAccurate;
+    }
+
+
+    /**
+     * @brief Transforms random samples with the out-of-core FFT and compares the magnitudes with
+     *        the ones of the radix-2/4 transform in long double, prints the error and the time
+     *        per FFT, including the powers.
+     *
+     * @return false if the error is more than 100 times the epsilon of a float, the precision of the powers
+     */
+    bool benchmarkLargeFFT(unsigned int length, std::mt19937& generator)
+    {
+        std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+        std::vector<long double> input(length);
+        for (long double& sample : input)
+            sample = distribution(generator);
+
+        std::vector<long double> referenceInput(input);
+        BasicFFT<RadixBackend<long double>> reference(length);
+        reference.process(&referenceInput[0]);
+
+        ResourceCache cache;
+        ThreadPool pool;
+        LargeFFT fft(length, cache);
+        std::copy(input.begin(), input.end(), fft.getInput());
+
+        std::vector<float> powers(length / 2 + 1);
+        const auto start = std::chrono::steady_clock::now();
+        fft.process(pool, ThreadPool::Priority::High);
+        fft.getPeakPowers(1, length / 2 + 1, &powers[0], pool, ThreadPool::Priority::High);
+        const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // the error relative to the largest magnitude of the spectrum
+        long double maximumError = 0, maximumMagnitude = 0;
+        for (std::size_t k = 0; k < powers.size(); ++k)
+        {
+            const long double real = reference.realPart()[k];
+            const long double imag = reference.imagPart()[k];
+            const long double magnitude = std::sqrt(real * real + imag * imag);
+            maximumError = std::max(maximumError, std::abs(std::sqrt(static_cast<long double>(powers[k])) - magnitude));
+            maximumMagnitude = std::max(maximumMagnitude, magnitude);
+        }
+        const double errorDecibel = (maximumError > 0) ? static_cast<double>(20 * std::log10(maximumError / maximumMagnitude)) : -400.0;
+        const double toleranceDecibel = 20 * std::log10(static_cast<double>(std::numeric_limits<float>::epsilon()) * 100);
+        const bool isAccurate = errorDecibel <= toleranceDecibel;
+
+        std::cout << std::setw(8) << length << "  " << std::left << std::setw(22) << "out of core" << std::right
+                  << std::setw(12) << std::fixed << std::setprecision(1) << errorDecibel << " dB"
+                  << std::setw(12) << std::setprecision(2) << milliseconds << " ms"
+                  << (isAccurate ? "" : "  FAILED") << std::endl;
+
+        return isAccurate;
+    }
+
+
+    /**
+     * @brief Compresses blocks that are easy to get wrong with the LZ4 compressor of the chunked
+     *        export and decompresses them again: empty and short ones, noise, silence, a short
+     *        pattern whose matches overlap their own output, and byte shuffled magnitudes like
+     *        the ones of a chunk. A block that is cut short has to be refused.
+     *
+     * @return false if a block doesn't come back unchanged or a cut block is accepted
+     */
+    bool checkLZ4(std::mt19937& generator)
+    {
+        std::uniform_int_distribution<int> byteDistribution(0, 255);
+        std::normal_distribution<float> levelDistribution(-60.f, 10.f);
+        const std::size_t sizes[] = {0, 1, 5, 12, 13, 100, 4099, 65543, 1 << 20};
+
+        unsigned int blockCount = 0, failedCount = 0;
+        double magnitudeRatio = 0;
+        for (std::size_t size : sizes)
+        {
+            // noise, silence, the pattern and the magnitudes
+            for (unsigned int kind = 0; kind < 4; ++kind)
+            {
+                std::vector<std::uint8_t> block(size);
+                if (kind == 0)
+                {
+                    for (std::uint8_t& byte : block)
+                        byte = static_cast<std::uint8_t>(byteDistribution(generator));
+                }
+                else if (kind == 2)
+                {
+                    for (std::size_t i = 0; i < size; ++i)
+                        block[i] = static_cast<std::uint8_t>(i % 7);
+                }
+                else if (kind == 3)
+                {
+                    // the first bytes of all values, then the second bytes and so on, like the ChunkedWriter
+                    const std::size_t valueCount = size / sizeof(float);
+                    for (std::size_t i = 0; i < valueCount; ++i)
+                    {
+                        const float level = levelDistribution(generator);
+                        std::uint8_t bytes[sizeof(float)];
+                        std::memcpy(bytes, &level, sizeof(float));
+                        for (std::size_t byte = 0; byte < sizeof(float); ++byte)
+                            block[byte * valueCount + i] = bytes[byte];
+                    }
+                }
+
+                std::vector<std::uint8_t> compressed(lz4::compressBound(size));
+                const std::size_t compressedSize = lz4::compress(block.data(), size, compressed.data());
+                std::vector<std::uint8_t> decompressed(size);
+                bool isRestored = lz4::decompress(compressed.data(), compressedSize, decompressed.data(), size) && decompressed == block;
+                if (compressedSize > 1)
+                    isRestored &= !lz4::decompress(compressed.data(), compressedSize - 1, decompressed.data(), size);
+
+                ++blockCount;
+                if (!isRestored)
+                {
+                    ++failedCount;
+                    std::cout << "lz4: a block of " << size << " bytes (kind " << kind << ") doesn't survive the round trip" << std::endl;
+                }
+                if (kind == 3 && size == sizes[8])
+                    magnitudeRatio = static_cast<double>(compressedSize) / size;
+            }
+        }
+
+        std::cout << "lz4: " << blockCount - failedCount << " of " << blockCount << " blocks restored, the shuffled magnitudes compress to "
+                  << std::fixed << std::setprecision(0) << magnitudeRatio * 100 << " %" << (failedCount == 0 ? "" : "  FAILED") << std::endl;
+
+        return failedCount == 0;
+    }
+
+
+    /**
+     * @brief Generates the spectrogram of clicks and steps through the onsets like the right
+     *        arrow key does, from the offset that the sound reports after it was set to the
+     *        last onset. The offset is rounded down to a sample, like the sound does.
+     *
+     * @return false if a step doesn't move forward or a click is missed
+     */
+    bool checkOnsetNavigation()
+    {
+        const unsigned int sampleRate = 44100;
+        const unsigned int clickCount = 8;
+
+        // a click of 5 ms every half second, in faint noise
+        std::mt19937 generator(2);
+        std::uniform_int_distribution<int> noise(-30, 30);
+        std::vector<sf::Int16> samples(clickCount * sampleRate / 2);
+        for (std::size_t i = 0; i < samples.size(); ++i)
+        {
+            const bool isClick = (i + sampleRate / 4) % (sampleRate / 2) < sampleRate / 200;
+            samples[i] = static_cast<sf::Int16>(noise(generator) * (isClick ? 500 : 1));
+        }
+        std::shared_ptr<sf::SoundBuffer> soundBuffer = std::make_shared<sf::SoundBuffer>();
+        soundBuffer->loadFromSamples(&samples[0], samples.size(), 1, sampleRate);
+
+        Settings settings;
+        ResourceCache cache;
+        ThreadPool pool(settings.threads);
+        Spectrogram spectrogram(soundBuffer, settings, cache);
+        spectrogram.generate(pool);
+        while (!spectrogram.isGenerated())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        pool.wait();
+
+        unsigned int stepCount = 0;
+        bool isForward = true;
+        sf::Time offset;
+        sf::Time event;
+        while (spectrogram.findNextEvent(offset, event))
+        {
+            const sf::Time reported = sf::seconds(std::floor(event.asSeconds() * sampleRate) / sampleRate);
+            isForward &= (stepCount == 0 || reported > offset);
+            if (!isForward)
+                break;
+            offset = reported;
+            ++stepCount;
+        }
+        const bool isCorrect = isForward && stepCount == clickCount;
+
+        std::cout << "onset navigation: " << stepCount << " of " << clickCount << " clicks"
+                  << (isForward ? "" : ", stuck on an onset") << (isCorrect ? "" : "  FAILED") << std::endl;
+
+        return isCorrect;
+    }
+
+
+    // reads from the socket until the buffer holds the given number of bytes
+    bool receiveBytes(sf::TcpSocket& socket, std::string& buffer, std::size_t size)
+    {
+        char data[4096];
+        while (buffer.size() < size)
+        {
+            std::size_t received = 0;
+            if (socket.receive(data, sizeof(data), received) != sf::Socket::Done)
+                return false;
+            buffer.append(data, received);
+        }
+        return true;
+    }
+
+
+    // sends a request and reads the line of the reply, the bytes after it stay in the buffer
+    std::string request(sf::TcpSocket& socket, std::string& buffer, const std::string& line)
+    {
+        const std::string text = line + '\n';
+        if (socket.send(text.data(), text.size()) != sf::Socket::Done)
+            return std::string();
+
+        std::size_t end;
+        while ((end = buffer.find('\n')) == std::string::npos)
+        {
+            if (!receiveBytes(socket, buffer, buffer.size() + 1))
+                return std::string();
+        }
+        const std::string reply = buffer.substr(0, end);
+        buffer.erase(0, end + 1);
+        return reply;
+    }
+
+
+    // receives the tile that follows an OK of a TILE request and returns its bytes
+    bool receiveTile(sf::TcpSocket& socket, std::string& buffer, const std::string& reply, std::string& tile)
+    {
+        std::istringstream stream(reply);
+        std::string status;
+        unsigned int width = 0, height = 0;
+        std::size_t size = 0;
+        if (!(stream >> status >> width >> height >> size) || status != "OK" || !receiveBytes(socket, buffer, size))
+            return false;
+        tile = buffer.substr(0, size);
+        buffer.erase(0, size);
+        return width > 0 && height > 0;
+    }
+
+
+    /**
+     * @brief Serves the spectrogram of a tone on loopback and sends every request of the
+     *        protocol once, then a tile that doesn't exist. The sound is written next to the
+     *        benchmark and removed afterwards. Some connections are opened and closed on the
+     *        way, like a client that connects per tile.
+     *
+     * @return false if a reply is not as expected
+     */
+    bool checkTileServer()
+    {
+        const unsigned int sampleRate = 44100;
+        const char* const filename = "TileServerCheck.wav";
+        const double pi = 3.141592653589793;
+
+        std::vector<sf::Int16> samples(2 * sampleRate);
+        for (std::size_t i = 0; i < samples.size(); ++i)
+            samples[i] = static_cast<sf::Int16>(std::lrint(8000 * std::sin(2 * pi * 1000 * i / sampleRate)));
+        sf::SoundBuffer soundBuffer;
+        if (!soundBuffer.loadFromSamples(&samples[0], samples.size(), 1, sampleRate) || !soundBuffer.saveToFile(filename))
+        {
+            std::cout << "tile server: could not write " << filename << "  FAILED" << std::endl;
+            return false;
+        }
+
+        Settings settings;
+        settings.filenames.assign(1, filename);
+        TileServer server(settings);
+        bool isCorrect = server.start(0);
+
+        unsigned int frameCount = 0, binCount = 0;
+        std::string failed;
+        for (unsigned int connectionCount = 0; isCorrect && connectionCount < 8; ++connectionCount)
+        {
+            sf::TcpSocket socket;
+            std::string buffer;
+            if (socket.connect(sf::IpAddress::LocalHost, server.getPort()) != sf::Socket::Done)
+            {
+                failed = "connect";
+                break;
+            }
+
+            std::istringstream info(request(socket, buffer, std::string("INFO ") + filename));
+            std::string status;
+            if (!(info >> status >> frameCount >> binCount) || status != "OK" || frameCount == 0 || binCount == 0)
+                failed = "INFO";
+            socket.disconnect();
+        }
+
+        sf::TcpSocket socket;
+        std::string buffer;
+        if (failed.empty() && socket.connect(sf::IpAddress::LocalHost, server.getPort()) != sf::Socket::Done)
+            failed = "connect";
+
+        std::string tile;
+        if (failed.empty() && (!receiveTile(socket, buffer, request(socket, buffer, std::string("TILE raw 0 0 0 ") + filename), tile)
+                               || tile.size() != std::min(frameCount, TileServer::tileSize) * std::min(binCount, TileServer::tileSize) * sizeof(float)))
+            failed = "TILE raw";
+        if (failed.empty() && (!receiveTile(socket, buffer, request(socket, buffer, std::string("TILE png 0 0 0 ") + filename), tile)
+                               || tile.compare(0, 4, "\x89PNG") != 0))
+            failed = "TILE png";
+        if (failed.empty() && request(socket, buffer, std::string("TILE raw 0 999 0 ") + filename).compare(0, 5, "ERROR") != 0)
+            failed = "TILE outside of the sound";
+        if (failed.empty() && request(socket, buffer, "STATS").compare(0, 14, "OK requests=11") != 0)
+            failed = "STATS";
+        if (failed.empty() && request(socket, buffer, "SHUTDOWN") != "OK")
+            failed = "SHUTDOWN";
+
+        if (failed.empty())
+            server.wait();
+        server.stop();
+        std::remove(filename);
+
+        isCorrect &= failed.empty();
+        std::cout << "tile server: " << frameCount << " frames of " << binCount << " bins on loopback"
+                  << (failed.empty() ? "" : ", " + failed + " failed") << (isCorrect ? "" : "  FAILED") << std::endl;
+
+        return isCorrect;
+    }
+}
+
+
+int main()
+{
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+
+    std::cout << "  length  backend                      max. error     time / FFT" << std::endl;
+
+    bool isAccurate = true;
+
+    for (unsigned int length = 256; length <= 16384; length *= 4)
+    {
+        std::vector<long double> input(length);
+        for (long double& sample : input)
+            sample = distribution(generator);
+
+        const Reference reference = naiveDFT(input);
+
+#ifdef FFTSPECTRUM_USE_FFTW
+        isAccurate &= benchmark<FFTWBackend<float>>("FFTW float", reference);
+        isAccurate &= benchmark<FFTWBackend<double>>("FFTW double", reference);
+#ifdef FFTSPECTRUM_BENCHMARK_FFTW_LONG_DOUBLE
+        isAccurate &= benchmark<FFTWBackend<long double>>("FFTW long double", reference);
+#endif
+#endif
+        isAccurate &= benchmark<RadixBackend<float>>("radix-2/4 float", reference);
+        isAccurate &= benchmark<RadixBackend<double>>("radix-2/4 double", reference);
+        isAccurate &= benchmark<RadixBackend<long double>>("radix-2/4 long double", reference);
+        std::cout << std::endl;
+    }
+
+    std::cout << "  length  inverse                      max. error     time / FFT" << std::endl;
+
+    for (unsigned int length = 256; length <= 16384; length *= 4)
+    {
+        std::vector<long double> input(length);
+        for (long double& sample : input)
+            sample = distribution(generator);
+
+        // the round trip needs no reference spectrum
+        Reference reference;
+        reference.input = input;
+
+#ifdef FFTSPECTRUM_USE_FFTW
+        isAccurate &= benchmarkInverse<FFTWBackend<float>>("FFTW float", reference);
+        isAccurate &= benchmarkInverse<FFTWBackend<double>>("FFTW double", reference);
+#ifdef FFTSPECTRUM_BENCHMARK_FFTW_LONG_DOUBLE
+        isAccurate &= benchmarkInverse<FFTWBackend<long double>>("FFTW long double", reference);
+#endif
+#endif
+        isAccurate &= benchmarkInverse<RadixBackend<float>>("radix-2/4 float", reference);
+        isAccurate &= benchmarkInverse<RadixBackend<double>>("radix-2/4 double", reference);
+        isAccurate &= benchmarkInverse<RadixBackend<long double>>("radix-2/4 long double", reference);
+        std::cout << std::endl;
+    }
+
+    // the sizes above the largest one that is transformed in core
+    std::cout << "  length  magnitudes                   max. error     time / FFT" << std::endl;
+    for (unsigned int length = 2 * Spectrogram::largestInCoreSize; length <= 8 * Spectrogram::largestInCoreSize; length *= 2)
+        isAccurate &= benchmarkLargeFFT(length, generator);
+    std::cout << std::endl;
+
+    // 60 seconds of a stereo sound
+    std::cout << "  length  band below 1 kHz             max. error     speed" << std::endl;
+    for (unsigned int length = 1024; length <= 8192; length *= 2)
+        isAccurate &= benchmarkResynthesis(length);
+    std::cout << std::endl;
+
+    // 60 seconds of noise
+    std::cout << "    taps  decimation by 2              max. error     speed" << std::endl;
+    isAccurate &= benchmarkDecimator(generator);
+    std::cout << std::endl;
+
+    isAccurate &= checkLZ4(generator);
+    isAccurate &= checkOnsetNavigation();
+    isAccurate &= checkTileServer();
+
+    return isAccurate ? 0 : 1;
+}
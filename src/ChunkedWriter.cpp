@@ -0,0 +1,139 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "ChunkedWriter.hpp"
+#include "LZ4.hpp"
+
+#include <iostream>
+
+
+namespace
+{
+    const std::uint32_t version = 3;
+    const std::uint32_t shuffleFlag = 1;
+
+    // all values are little endian, like the machines this runs on
+    template <typename T>
+    void writeValue(std::ofstream& file, T value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+}
+
+
+ChunkedWriter::ChunkedWriter(const std::string& filename) :
+    m_filename(filename),
+    m_frameCount(0),
+    m_binCount(0)
+{
+
+}
+
+
+bool ChunkedWriter::begin(const Description& description)
+{
+    m_file.open(m_filename, std::ios::binary | std::ios::trunc);
+    if (!m_file)
+    {
+        std::cout << "Could not open " << m_filename << " for writing." << std::endl;
+        return false;
+    }
+    m_frameCount = description.frameCount;
+    m_binCount = description.binCount;
+    m_chunk.reserve(static_cast<std::size_t>(framesPerChunk) * m_binCount);
+
+    m_file.write("FSPC", 4);
+    writeValue<std::uint32_t>(m_file, version);
+    writeValue<std::uint32_t>(m_file, description.frameCount);
+    writeValue<std::uint32_t>(m_file, description.binCount);
+    writeValue<std::uint32_t>(m_file, framesPerChunk);
+    writeValue<std::uint32_t>(m_file, description.FFTSize);
+    writeValue<float>(m_file, description.sampleRate);
+    writeValue<std::uint32_t>(m_file, shuffleFlag);
+    writeValue<std::uint32_t>(m_file, description.hopSize);
+    writeValue<float>(m_file, description.binWidth);
+
+    return static_cast<bool>(m_file);
+}
+
+
+bool ChunkedWriter::write(const float* frame)
+{
+    m_chunk.insert(m_chunk.end(), frame, frame + m_binCount);
+    if (m_chunk.size() < static_cast<std::size_t>(framesPerChunk) * m_binCount)
+        return true;
+
+    return writeChunk();
+}
+
+
+bool ChunkedWriter::finish()
+{
+    if (!m_chunk.empty() && !writeChunk())
+        return false;
+
+    // the index of the chunks lets readers seek to any chunk
+    const std::uint64_t indexOffset = static_cast<std::uint64_t>(m_file.tellp());
+    for (std::uint64_t offset : m_chunkOffsets)
+        writeValue<std::uint64_t>(m_file, offset);
+    writeValue<std::uint64_t>(m_file, indexOffset);
+    m_file.write("FSPI", 4);
+
+    m_file.close();
+    if (m_file.fail())
+        return false;
+
+    std::cout << "Exported " << m_frameCount << " frames of " << m_binCount << " bins to " << m_filename << "." << std::endl;
+    return true;
+}
+
+
+bool ChunkedWriter::writeChunk()
+{
+    m_chunkOffsets.push_back(static_cast<std::uint64_t>(m_file.tellp()));
+
+    // group the bytes by significance, the exponents of neighbouring values are similar and compress well
+    const std::size_t valueCount = m_chunk.size();
+    const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(&m_chunk[0]);
+    m_shuffled.resize(valueCount * sizeof(float));
+    for (std::size_t i = 0; i < valueCount; ++i)
+    {
+        for (std::size_t byte = 0; byte < sizeof(float); ++byte)
+            m_shuffled[byte * valueCount + i] = bytes[i * sizeof(float) + byte];
+    }
+
+    m_compressed.resize(lz4::compressBound(m_shuffled.size()));
+    std::size_t compressedSize = lz4::compress(&m_shuffled[0], m_shuffled.size(), &m_compressed[0]);
+
+    // incompressible chunks are stored as they are, which is marked by equal sizes
+    const std::uint8_t* data = &m_compressed[0];
+    if (compressedSize >= m_shuffled.size())
+    {
+        compressedSize = m_shuffled.size();
+        data = &m_shuffled[0];
+    }
+
+    writeValue<std::uint32_t>(m_file, static_cast<std::uint32_t>(m_shuffled.size()));
+    writeValue<std::uint32_t>(m_file, static_cast<std::uint32_t>(compressedSize));
+    m_file.write(reinterpret_cast<const char*>(data), compressedSize);
+
+    m_chunk.clear();
+    return static_cast<bool>(m_file);
+}
@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_CHUNKEDWRITER_HPP
+#define FFTSPECTRUM_CHUNKEDWRITER_HPP
+
+#include "FrameSink.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The ChunkedWriter class writes the frames in compressed chunks of 64 frames, so a
+ *        reader can decompress any range of frames without reading the whole file.
+ *        Every chunk is byte shuffled (all first bytes of the floats, then all second
+ *        bytes and so on) and compressed with LZ4. See the README for the file layout.
+ */
+class ChunkedWriter : public FrameSink
+{
+public:
+    ChunkedWriter(const std::string& filename);
+
+    virtual bool    begin(const Description& description);
+
+    virtual bool    write(const float* frame);
+
+    virtual bool    finish();
+
+    static const unsigned int framesPerChunk = 64;
+
+private:
+
+    bool            writeChunk();
+
+    const std::string           m_filename;
+    std::ofstream               m_file;
+    unsigned int                m_frameCount;
+    unsigned int                m_binCount;
+    std::vector<float>          m_chunk;            // the frames of the current chunk
+    std::vector<std::uint8_t>   m_shuffled;
+    std::vector<std::uint8_t>   m_compressed;
+    std::vector<std::uint64_t>  m_chunkOffsets;
+};
+
+#endif //FFTSPECTRUM_CHUNKEDWRITER_HPP
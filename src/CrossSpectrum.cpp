@@ -0,0 +1,146 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "CrossSpectrum.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(FFTSPECTRUM_NO_SIMD) \
+    && !defined(FFTSPECTRUM_FFT_DOUBLE) && !defined(FFTSPECTRUM_FFT_LONG_DOUBLE)
+#define FFTSPECTRUM_SSE
+#include <emmintrin.h>
+#endif
+
+
+namespace
+{
+    const double pi = 3.141592653589793;
+
+#ifdef FFTSPECTRUM_SSE
+    // adds four single precision products to the double precision sums
+    inline void accumulate(double* sums, __m128 values)
+    {
+        _mm_storeu_pd(sums,     _mm_add_pd(_mm_loadu_pd(sums),     _mm_cvtps_pd(values)));
+        _mm_storeu_pd(sums + 2, _mm_add_pd(_mm_loadu_pd(sums + 2), _mm_cvtps_pd(_mm_movehl_ps(values, values))));
+    }
+#endif
+}
+
+
+CrossSpectrum::CrossSpectrum(unsigned int binCount) :
+    m_binCount(binCount),
+    m_frameCount(0),
+    m_referencePowers(binCount, 0.0),
+    m_responsePowers(binCount, 0.0),
+    m_crossReal(binCount, 0.0),
+    m_crossImag(binCount, 0.0)
+{
+
+}
+
+
+void CrossSpectrum::add(const FFTScalar* referenceReal, const FFTScalar* referenceImag,
+                        const FFTScalar* responseReal, const FFTScalar* responseImag)
+{
+    unsigned int k = 0;
+#ifdef FFTSPECTRUM_SSE
+    for (; k + 4 <= m_binCount; k += 4)
+    {
+        const __m128 xr = _mm_loadu_ps(referenceReal + k);
+        const __m128 xi = _mm_loadu_ps(referenceImag + k);
+        const __m128 yr = _mm_loadu_ps(responseReal + k);
+        const __m128 yi = _mm_loadu_ps(responseImag + k);
+        accumulate(&m_referencePowers[k], _mm_add_ps(_mm_mul_ps(xr, xr), _mm_mul_ps(xi, xi)));
+        accumulate(&m_responsePowers[k],  _mm_add_ps(_mm_mul_ps(yr, yr), _mm_mul_ps(yi, yi)));
+        accumulate(&m_crossReal[k],       _mm_add_ps(_mm_mul_ps(xr, yr), _mm_mul_ps(xi, yi)));
+        accumulate(&m_crossImag[k],       _mm_sub_ps(_mm_mul_ps(xr, yi), _mm_mul_ps(xi, yr)));
+    }
+#endif
+    for (; k < m_binCount; ++k)
+    {
+        const double xr = referenceReal[k];
+        const double xi = referenceImag[k];
+        const double yr = responseReal[k];
+        const double yi = responseImag[k];
+        m_referencePowers[k] += xr * xr + xi * xi;
+        m_responsePowers[k]  += yr * yr + yi * yi;
+        m_crossReal[k]       += xr * yr + xi * yi;
+        m_crossImag[k]       += xr * yi - xi * yr;
+    }
+    ++m_frameCount;
+}
+
+
+void CrossSpectrum::merge(const CrossSpectrum& other)
+{
+    for (unsigned int k = 0; k < m_binCount; ++k)
+    {
+        m_referencePowers[k] += other.m_referencePowers[k];
+        m_responsePowers[k]  += other.m_responsePowers[k];
+        m_crossReal[k]       += other.m_crossReal[k];
+        m_crossImag[k]       += other.m_crossImag[k];
+    }
+    m_frameCount += other.m_frameCount;
+}
+
+
+void CrossSpectrum::clear()
+{
+    std::fill(m_referencePowers.begin(), m_referencePowers.end(), 0.0);
+    std::fill(m_responsePowers.begin(), m_responsePowers.end(), 0.0);
+    std::fill(m_crossReal.begin(), m_crossReal.end(), 0.0);
+    std::fill(m_crossImag.begin(), m_crossImag.end(), 0.0);
+    m_frameCount = 0;
+}
+
+
+unsigned int CrossSpectrum::getFrameCount() const
+{
+    return m_frameCount;
+}
+
+
+unsigned int CrossSpectrum::getBinCount() const
+{
+    return m_binCount;
+}
+
+
+void CrossSpectrum::getTraces(Traces& traces) const
+{
+    traces.coherence.assign(m_binCount, 0.f);
+    traces.gain.assign(m_binCount, 0.f);
+    traces.phase.assign(m_binCount, 0.f);
+
+    // bins without energy in a channel have no transfer function, they stay at 0
+    const double silence = 1e-30;
+    for (unsigned int k = 0; k < m_binCount; ++k)
+    {
+        const double crossPower = m_crossReal[k] * m_crossReal[k] + m_crossImag[k] * m_crossImag[k];
+        const double autoPowers = m_referencePowers[k] * m_responsePowers[k];
+        if (autoPowers > silence)
+            traces.coherence[k] = static_cast<float>(std::min(crossPower / autoPowers, 1.0));
+        if (m_referencePowers[k] > silence)
+            traces.gain[k] = static_cast<float>(10.0 * std::log10(std::max(crossPower, silence) / (m_referencePowers[k] * m_referencePowers[k])));
+        if (crossPower > silence)
+            traces.phase[k] = static_cast<float>(std::atan2(m_crossImag[k], m_crossReal[k]) * 180.0 / pi);
+    }
+}
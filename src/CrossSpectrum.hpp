@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_CROSSSPECTRUM_HPP
+#define FFTSPECTRUM_CROSSSPECTRUM_HPP
+
+#include "FFT.hpp"
+
+#include <vector>
+
+/**
+ * @brief The CrossSpectrum class accumulates the auto-spectra of a reference and a
+ *        response channel and their cross-spectrum, frame by frame. From the sums it
+ *        estimates the transfer function H1 = Sxy / Sxx and the magnitude-squared
+ *        coherence |Sxy|^2 / (Sxx Syy). Partial spectra of different threads are merged
+ *        by adding them up. For single precision transforms the bins are added with SSE.
+ */
+class CrossSpectrum
+{
+public:
+    struct Traces
+    {
+        std::vector<float>  coherence;  ///< in range [0, 1]
+        std::vector<float>  gain;       ///< the magnitude of the transfer function in dB
+        std::vector<float>  phase;      ///< the phase of the transfer function in degrees
+    };
+
+    explicit CrossSpectrum(unsigned int binCount);
+
+    /**
+     * @brief Adds a frame, the arrays hold the bins of both transforms.
+     */
+    void            add(const FFTScalar* referenceReal, const FFTScalar* referenceImag,
+                        const FFTScalar* responseReal, const FFTScalar* responseImag);
+
+    /**
+     * @brief Adds the frames of another spectrum with the same number of bins to this one.
+     */
+    void            merge(const CrossSpectrum& other);
+
+    void            clear();
+
+    unsigned int    getFrameCount() const;
+
+    unsigned int    getBinCount() const;
+
+    void            getTraces(Traces& traces) const;
+
+private:
+
+    unsigned int        m_binCount;
+    unsigned int        m_frameCount;
+    std::vector<double> m_referencePowers;  // Sxx
+    std::vector<double> m_responsePowers;   // Syy
+    std::vector<double> m_crossReal;        // Sxy = conj(X) Y
+    std::vector<double> m_crossImag;
+};
+
+#endif //FFTSPECTRUM_CROSSSPECTRUM_HPP
@@ -0,0 +1,158 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "Decimator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+
+namespace
+{
+    const int   halfLength  = 23;      // the filter has 2 * 23 + 1 = 47 taps
+    const float kaiserBeta  = 7.857f;  // for 80 dB stop band attenuation
+    const float passband    = 0.4f;    // usable bandwidth relative to the output sample rate
+    const float pi          = 3.14159265358979f;
+
+    // modified bessel function of the first kind, order 0
+    float besselI0(float x)
+    {
+        float sum = 1.f;
+        float term = 1.f;
+        for (int k = 1; k < 30; ++k)
+        {
+            term *= (x / (2.f * k)) * (x / (2.f * k));
+            sum += term;
+        }
+        return sum;
+    }
+}
+
+
+Decimator::Decimator(unsigned int factor) :
+    m_factor(factor)
+{
+    // half-band low-pass: 0.5 * sinc(k / 2), windowed with a Kaiser window
+    // the taps at even offsets are 0, so only the odd ones are stored
+    float sum = 0.f;
+    for (int k = -halfLength; k <= halfLength; k += 2)
+    {
+        const float x = static_cast<float>(k) / halfLength;
+        const float window = besselI0(kaiserBeta * std::sqrt(1.f - x * x)) / besselI0(kaiserBeta);
+        const float tap = 0.5f * std::sin(pi * k / 2.f) / (pi * k / 2.f) * window;
+        m_oddTaps.push_back(tap);
+        sum += tap;
+    }
+
+    // normalize to unity gain at DC, the center tap is 0.5
+    for (float& tap : m_oddTaps)
+        tap *= 0.5f / sum;
+}
+
+
+std::vector<float> Decimator::process(const sf::Int16* samples, std::size_t sampleCount, unsigned int channelCount) const
+{
+    // mix down to mono
+    const std::size_t frameCount = sampleCount / channelCount;
+    const float scale = 1.f / (32767.f * channelCount);
+    std::vector<float> mono(frameCount);
+    for (std::size_t i = 0; i < frameCount; ++i)
+    {
+        int sum = 0;
+        for (unsigned int channel = 0; channel < channelCount; ++channel)
+            sum += samples[i * channelCount + channel];
+        mono[i] = sum * scale;
+    }
+
+    return process(std::move(mono));
+}
+
+
+std::vector<float> Decimator::process(std::vector<float> mono) const
+{
+    // one half-band stage per factor of 2
+    std::vector<float> decimated;
+    for (unsigned int factor = m_factor; factor > 1; factor /= 2)
+    {
+        decimateByTwo(mono, decimated);
+        mono.swap(decimated);
+    }
+
+    return mono;
+}
+
+
+unsigned int Decimator::getFactor() const
+{
+    return m_factor;
+}
+
+
+unsigned int Decimator::chooseFactor(unsigned int sampleRate, float maxFrequency)
+{
+    unsigned int factor = 1;
+    if (maxFrequency <= 0.f)
+        return factor;
+
+    while (passband * sampleRate / (factor * 2) >= maxFrequency)
+        factor *= 2;
+
+    return factor;
+}
+
+
+void Decimator::decimateByTwo(const std::vector<float>& input, std::vector<float>& output) const
+{
+    // polyphase form: y[m] = 0.5 * x[2m] + sum_j oddTaps[j] * x[2m + 2j - 23]
+    // the taps in the outer loop, so the inner one runs over consecutive outputs and gets vectorized
+    // without reordering the sum of a single output; the odd samples of a block and its sums stay
+    // in the cache, and with a fixed block size in local arrays the compiler needs no checks for
+    // the remainder or overlaps
+    const std::size_t blockSize = 1024;
+    const std::size_t offset = halfLength;
+    const std::size_t tapCount = offset + 1;
+    const std::size_t outputCount = (input.size() + 1) / 2;
+
+    output.resize(outputCount);
+    float odd[blockSize + tapCount];
+    float sums[blockSize];
+    for (std::size_t begin = 0; begin < outputCount; begin += blockSize)
+    {
+        // odd[i] = x[2 * (begin + i) - 23], zero padded outside of the input
+        for (std::size_t i = 0; i < blockSize + tapCount; ++i)
+        {
+            const std::size_t position = 2 * (begin + i);
+            odd[i] = (position >= offset && position - offset < input.size()) ? input[position - offset] : 0.f;
+        }
+
+        std::fill(sums, sums + blockSize, 0.f);
+        for (std::size_t j = 0; j < tapCount; ++j)
+        {
+            const float tap = m_oddTaps[j];
+            for (std::size_t m = 0; m < blockSize; ++m)
+                sums[m] += tap * odd[m + j];
+        }
+
+        const std::size_t end = std::min(begin + blockSize, outputCount);
+        for (std::size_t m = begin; m < end; ++m)
+            output[m] = 0.5f * input[2 * m] + sums[m - begin];
+    }
+}
@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_DECIMATOR_HPP
+#define FFTSPECTRUM_DECIMATOR_HPP
+
+#include <SFML/Config.hpp>
+
+#include <vector>
+
+/**
+ * @brief The Decimator class lowers the sample rate of a sound by a power of two.
+ *        Every stage low-pass filters with a 47 tap half-band FIR (Kaiser window, about 80 dB
+ *        stop band attenuation) and drops every second sample. The filter is evaluated in
+ *        polyphase form, so only the kept samples are computed and half of the taps are 0.
+ *        Frequencies below 40% of the new sample rate are passed unchanged.
+ */
+class Decimator
+{
+public:
+    /**
+     * @param factor The decimation factor, a power of 2 (1 doesn't filter at all)
+     */
+    Decimator(unsigned int factor);
+
+    /**
+     * @brief Mixes the interleaved channels down to mono, scales the samples to [-1, 1] and decimates them.
+     *
+     * @param samples       The interleaved samples
+     * @param sampleCount   The number of samples (of all channels)
+     * @param channelCount  The number of channels
+     *
+     * @return The decimated samples, about sampleCount / channelCount / factor of them
+     */
+    std::vector<float>  process(const sf::Int16* samples, std::size_t sampleCount, unsigned int channelCount) const;
+
+    /**
+     * @brief Decimates mono samples that are mixed down and scaled already.
+     *
+     * @return The decimated samples, about mono.size() / factor of them
+     */
+    std::vector<float>  process(std::vector<float> mono) const;
+
+    unsigned int        getFactor() const;
+
+    /**
+     * @brief Returns the largest factor that keeps all frequencies up to maxFrequency.
+     *
+     * @param sampleRate    The sample rate of the sound
+     * @param maxFrequency  The highest frequency of interest in Hz, 0 disables the decimation
+     */
+    static unsigned int chooseFactor(unsigned int sampleRate, float maxFrequency);
+
+private:
+
+    void                decimateByTwo(const std::vector<float>& input, std::vector<float>& output) const;
+
+    const unsigned int  m_factor;
+    std::vector<float>  m_oddTaps;  // the taps at odd offsets from the center, the others are 0 (except the center)
+};
+
+#endif //FFTSPECTRUM_DECIMATOR_HPP
@@ -20,100 +20,386 @@
 
 #include "FFT.hpp"
 
-#include <mutex>
-#include <cmath>
-#include <numeric>
 #include <algorithm>
+#include <cmath>
 
-namespace
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(FFTSPECTRUM_NO_SIMD)
+#define FFTSPECTRUM_SSE
+#include <emmintrin.h>
+#endif
+
+
+#ifdef FFTSPECTRUM_USE_FFTW
+
+std::mutex& fftwPlannerMutex()
 {
-    std::mutex s_fftwMutex;
-    const float epsilon = std::numeric_limits<float>::epsilon();
+    static std::mutex mutex;
+    return mutex;
 }
 
+#endif // FFTSPECTRUM_USE_FFTW
 
-FFT::FFT(unsigned int FFTLength) :
-    m_outputSize(FFTLength / 2 + 1) // FFTW returns N/2+1
+
+namespace
 {
-    m_realPart.resize(m_outputSize);
-    m_imagPart.resize(m_outputSize);
+    const long double pi = 3.141592653589793238462643383279502884L;
+
+    unsigned int log2(unsigned int powerOf2)
+    {
+        unsigned int bits = 0;
+        while ((1u << bits) < powerOf2)
+            ++bits;
+        return bits;
+    }
+
+
+    /**
+     * @brief Combines four transforms of the given size into one of 4 * size, for every block.
+     *        Because of the bit reversed order they are stored as [0 mod 4, 2 mod 4, 1 mod 4, 3 mod 4].
+     *        The twiddles are w1, w2 and w3 for k < size, each as real and imaginary array.
+     */
+    template <typename T>
+    void radix4Stage(T* zReal, T* zImag, const T* twiddles, unsigned int size, unsigned int complexLength)
+    {
+        const T* w1Real = twiddles;
+        const T* w1Imag = twiddles + size;
+        const T* w2Real = twiddles + 2 * size;
+        const T* w2Imag = twiddles + 3 * size;
+        const T* w3Real = twiddles + 4 * size;
+        const T* w3Imag = twiddles + 5 * size;
+
+        for (unsigned int block = 0; block < complexLength; block += 4 * size)
+        {
+            T* real0 = zReal + block;
+            T* imag0 = zImag + block;
+            T* real1 = real0 + size;
+            T* imag1 = imag0 + size;
+            T* real2 = real1 + size;
+            T* imag2 = imag1 + size;
+            T* real3 = real2 + size;
+            T* imag3 = imag2 + size;
+
+            for (unsigned int k = 0; k < size; ++k)
+            {
+                const T aReal = real0[k];
+                const T aImag = imag0[k];
+                const T cReal = real1[k] * w2Real[k] - imag1[k] * w2Imag[k];
+                const T cImag = real1[k] * w2Imag[k] + imag1[k] * w2Real[k];
+                const T bReal = real2[k] * w1Real[k] - imag2[k] * w1Imag[k];
+                const T bImag = real2[k] * w1Imag[k] + imag2[k] * w1Real[k];
+                const T dReal = real3[k] * w3Real[k] - imag3[k] * w3Imag[k];
+                const T dImag = real3[k] * w3Imag[k] + imag3[k] * w3Real[k];
+
+                const T t0Real = aReal + cReal, t0Imag = aImag + cImag;
+                const T t1Real = aReal - cReal, t1Imag = aImag - cImag;
+                const T t2Real = bReal + dReal, t2Imag = bImag + dImag;
+                const T t3Real = bReal - dReal, t3Imag = bImag - dImag;
+
+                real0[k] = t0Real + t2Real;
+                imag0[k] = t0Imag + t2Imag;
+                real1[k] = t1Real + t3Imag;    // t1 - i * t3
+                imag1[k] = t1Imag - t3Real;
+                real2[k] = t0Real - t2Real;
+                imag2[k] = t0Imag - t2Imag;
+                real3[k] = t1Real - t3Imag;    // t1 + i * t3
+                imag3[k] = t1Imag + t3Real;
+            }
+        }
+    }
+
+
+#ifdef FFTSPECTRUM_SSE
+
+    // The SIMD stages compute the same butterflies for 4 (float) or 2 (double) consecutive k at once.
+    // The arrays are std::vectors without alignment guarantee, so unaligned loads are used.
+
+    struct FloatSSE
+    {
+        typedef float  Scalar;
+        typedef __m128 Vector;
+        static const unsigned int width = 4;
+        static Vector load(const float* p)              { return _mm_loadu_ps(p); }
+        static void   store(float* p, Vector v)         { _mm_storeu_ps(p, v); }
+        static Vector add(Vector a, Vector b)           { return _mm_add_ps(a, b); }
+        static Vector sub(Vector a, Vector b)           { return _mm_sub_ps(a, b); }
+        static Vector mul(Vector a, Vector b)           { return _mm_mul_ps(a, b); }
+    };
+
+    struct DoubleSSE
+    {
+        typedef double  Scalar;
+        typedef __m128d Vector;
+        static const unsigned int width = 2;
+        static Vector load(const double* p)             { return _mm_loadu_pd(p); }
+        static void   store(double* p, Vector v)        { _mm_storeu_pd(p, v); }
+        static Vector add(Vector a, Vector b)           { return _mm_add_pd(a, b); }
+        static Vector sub(Vector a, Vector b)           { return _mm_sub_pd(a, b); }
+        static Vector mul(Vector a, Vector b)           { return _mm_mul_pd(a, b); }
+    };
+
+
+    template <typename SIMD>
+    void radix4StageSIMD(typename SIMD::Scalar* zReal, typename SIMD::Scalar* zImag, const typename SIMD::Scalar* twiddles,
+                         unsigned int size, unsigned int complexLength)
+    {
+        typedef typename SIMD::Scalar T;
+        typedef typename SIMD::Vector V;
+
+        // the first stages are smaller than a vector
+        if (size < SIMD::width)
+        {
+            radix4Stage(zReal, zImag, twiddles, size, complexLength);
+            return;
+        }
+
+        const T* w1Real = twiddles;
+        const T* w1Imag = twiddles + size;
+        const T* w2Real = twiddles + 2 * size;
+        const T* w2Imag = twiddles + 3 * size;
+        const T* w3Real = twiddles + 4 * size;
+        const T* w3Imag = twiddles + 5 * size;
+
+        for (unsigned int block = 0; block < complexLength; block += 4 * size)
+        {
+            T* real0 = zReal + block;
+            T* imag0 = zImag + block;
+            T* real1 = real0 + size;
+            T* imag1 = imag0 + size;
+            T* real2 = real1 + size;
+            T* imag2 = imag1 + size;
+            T* real3 = real2 + size;
+            T* imag3 = imag2 + size;
+
+            for (unsigned int k = 0; k < size; k += SIMD::width)
+            {
+                const V aReal = SIMD::load(real0 + k);
+                const V aImag = SIMD::load(imag0 + k);
+
+                V xReal = SIMD::load(real1 + k), xImag = SIMD::load(imag1 + k);
+                V wReal = SIMD::load(w2Real + k), wImag = SIMD::load(w2Imag + k);
+                const V cReal = SIMD::sub(SIMD::mul(xReal, wReal), SIMD::mul(xImag, wImag));
+                const V cImag = SIMD::add(SIMD::mul(xReal, wImag), SIMD::mul(xImag, wReal));
+
+                xReal = SIMD::load(real2 + k); xImag = SIMD::load(imag2 + k);
+                wReal = SIMD::load(w1Real + k); wImag = SIMD::load(w1Imag + k);
+                const V bReal = SIMD::sub(SIMD::mul(xReal, wReal), SIMD::mul(xImag, wImag));
+                const V bImag = SIMD::add(SIMD::mul(xReal, wImag), SIMD::mul(xImag, wReal));
+
+                xReal = SIMD::load(real3 + k); xImag = SIMD::load(imag3 + k);
+                wReal = SIMD::load(w3Real + k); wImag = SIMD::load(w3Imag + k);
+                const V dReal = SIMD::sub(SIMD::mul(xReal, wReal), SIMD::mul(xImag, wImag));
+                const V dImag = SIMD::add(SIMD::mul(xReal, wImag), SIMD::mul(xImag, wReal));
+
+                const V t0Real = SIMD::add(aReal, cReal), t0Imag = SIMD::add(aImag, cImag);
+                const V t1Real = SIMD::sub(aReal, cReal), t1Imag = SIMD::sub(aImag, cImag);
+                const V t2Real = SIMD::add(bReal, dReal), t2Imag = SIMD::add(bImag, dImag);
+                const V t3Real = SIMD::sub(bReal, dReal), t3Imag = SIMD::sub(bImag, dImag);
+
+                SIMD::store(real0 + k, SIMD::add(t0Real, t2Real));
+                SIMD::store(imag0 + k, SIMD::add(t0Imag, t2Imag));
+                SIMD::store(real1 + k, SIMD::add(t1Real, t3Imag));
+                SIMD::store(imag1 + k, SIMD::sub(t1Imag, t3Real));
+                SIMD::store(real2 + k, SIMD::sub(t0Real, t2Real));
+                SIMD::store(imag2 + k, SIMD::sub(t0Imag, t2Imag));
+                SIMD::store(real3 + k, SIMD::sub(t1Real, t3Imag));
+                SIMD::store(imag3 + k, SIMD::add(t1Imag, t3Real));
+            }
+        }
+    }
 
-    // make the initial state meaningful
-    std::fill(m_realPart.begin(), m_realPart.end(), 0.f );
-    std::fill(m_imagPart.begin(), m_imagPart.end(), 0.f );
+    void radix4Stage(float* zReal, float* zImag, const float* twiddles, unsigned int size, unsigned int complexLength)
+    {
+        radix4StageSIMD<FloatSSE>(zReal, zImag, twiddles, size, complexLength);
+    }
 
-    m_magnitudeVector.reserve(m_outputSize);
+    void radix4Stage(double* zReal, double* zImag, const double* twiddles, unsigned int size, unsigned int complexLength)
+    {
+        radix4StageSIMD<DoubleSSE>(zReal, zImag, twiddles, size, complexLength);
+    }
 
-    std::vector<float> tempInput(FFTLength);
-    std::vector<float> tempReal(FFTLength);
-    std::vector<float> tempImag(FFTLength);
+#endif // FFTSPECTRUM_SSE
 
-    fftwf_iodim dim;
-    dim.n  = FFTLength;
-    dim.is = 1;
-    dim.os = 1;
+    /**
+     * @brief Transforms the bit reversed complex sequence of the plan in place.
+     */
+    template <typename T>
+    void transformComplex(const typename RadixBackend<T>::Plan& plan, T* zReal, T* zImag)
+    {
+        const unsigned int complexLength = static_cast<unsigned int>(plan.bitReverse.size());
 
-    std::lock_guard<std::mutex> lock(s_fftwMutex);
-    m_plan = fftwf_plan_guru_split_dft_r2c(1, &dim, 0, NULL, &tempInput[0], &tempReal[0], &tempImag[0], FFTW_ESTIMATE);
+        unsigned int size = 1;
+
+        // a single radix-2 stage if the number of stages is odd
+        if (log2(complexLength) % 2 == 1)
+        {
+            for (unsigned int i = 0; i < complexLength; i += 2)
+            {
+                const T real0 = zReal[i], imag0 = zImag[i];
+                const T real1 = zReal[i + 1], imag1 = zImag[i + 1];
+                zReal[i]     = real0 + real1;
+                zImag[i]     = imag0 + imag1;
+                zReal[i + 1] = real0 - real1;
+                zImag[i + 1] = imag0 - imag1;
+            }
+            size = 2;
+        }
+
+        // radix-4 stages
+        const T* twiddles = plan.stageTwiddles.empty() ? nullptr : &plan.stageTwiddles[0];
+        for (; size < complexLength; size *= 4)
+        {
+            radix4Stage(zReal, zImag, twiddles, size, complexLength);
+            twiddles += 6 * size;
+        }
+    }
 }
 
 
-FFT::~FFT()
+template <typename T>
+typename RadixBackend<T>::Plan RadixBackend<T>::createPlan(unsigned int length)
 {
-    std::lock_guard<std::mutex> lock(s_fftwMutex);
-    fftwf_destroy_plan(m_plan);
+    // the real input is transformed as a complex sequence of half the length
+    const unsigned int complexLength = std::max(length / 2, 1u);
+    const unsigned int bits = log2(complexLength);
+
+    Plan plan;
+    plan.length = length;
+
+    plan.bitReverse.resize(complexLength);
+    for (unsigned int i = 0; i < complexLength; ++i)
+    {
+        unsigned int reversed = 0;
+        for (unsigned int bit = 0; bit < bits; ++bit)
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        plan.bitReverse[i] = reversed;
+    }
+
+    // every stage gets its own table, so the butterflies read the twiddles contiguously
+    for (unsigned int size = (bits % 2 == 1) ? 2 : 1; size < complexLength; size *= 4)
+    {
+        for (unsigned int multiple = 1; multiple <= 3; ++multiple)
+        {
+            for (unsigned int k = 0; k < size; ++k)
+                plan.stageTwiddles.push_back(static_cast<T>(std::cos(2 * pi * multiple * k / (4 * size))));
+            for (unsigned int k = 0; k < size; ++k)
+                plan.stageTwiddles.push_back(static_cast<T>(-std::sin(2 * pi * multiple * k / (4 * size))));
+        }
+    }
+
+    // the twiddles of the final split
+    plan.twiddleReal.resize(complexLength + 1);
+    plan.twiddleImag.resize(complexLength + 1);
+    for (unsigned int k = 0; k <= complexLength; ++k)
+    {
+        const long double angle = 2 * pi * k / length;
+        plan.twiddleReal[k] = static_cast<T>(std::cos(angle));
+        plan.twiddleImag[k] = static_cast<T>(-std::sin(angle));
+    }
+
+    return plan;
 }
 
 
-void FFT::process(const float *input)
+template <typename T>
+typename RadixBackend<T>::Plan RadixBackend<T>::createInversePlan(unsigned int length)
 {
-    float* nonConstInput = const_cast<float*>(input);   // fftw does not take const input even though the data not be manipulated!
-    fftwf_execute_split_dft_r2c(m_plan, nonConstInput, &m_realPart[0], &m_imagPart[0]);
-    m_magnitudeVector.clear();
-    m_logarithmicMagnitudeVector.clear();
+    // the inverse runs the same complex transform on the conjugate
+    return createPlan(length);
 }
 
 
-const std::vector<float>& FFT::realPart()
+template <typename T>
+void RadixBackend<T>::destroyPlan(Plan&)
 {
-    return m_realPart;
+
 }
 
 
-const std::vector<float>& FFT::imagPart()
+template <typename T>
+RadixBackend<T>::Workspace::Workspace(const Plan& plan) :
+    real(plan.bitReverse.size()),
+    imag(plan.bitReverse.size())
 {
-  return m_imagPart;
+
 }
 
 
-const std::vector<float> &FFT::magnitudeVector()
+template <typename T>
+void RadixBackend<T>::execute(const Plan& plan, Workspace& workspace, const T* input, T* real, T* imag)
 {
-    if (m_magnitudeVector.size() == 0)
+    const unsigned int complexLength = static_cast<unsigned int>(plan.bitReverse.size());
+    const T* twiddleReal = &plan.twiddleReal[0];
+    const T* twiddleImag = &plan.twiddleImag[0];
+    T* zReal = &workspace.real[0];
+    T* zImag = &workspace.imag[0];
+
+    // the even samples become the real part and the odd samples the imaginary part, in bit reversed order
+    for (unsigned int n = 0; n < complexLength; ++n)
     {
-        for (std::size_t i = 0; i < m_outputSize; ++i)
-        {
-            m_magnitudeVector.push_back(std::sqrt(m_realPart[i] * m_realPart[i] + m_imagPart[i] * m_imagPart[i]));
-        }
+        const unsigned int reversed = plan.bitReverse[n];
+        zReal[reversed] = input[2 * n];
+        zImag[reversed] = input[2 * n + 1];
     }
 
-    return m_magnitudeVector;
+    transformComplex(plan, zReal, zImag);
+
+    // split the complex transform into the transforms of the even and odd samples and combine them
+    for (unsigned int k = 0; k <= complexLength; ++k)
+    {
+        const unsigned int index = k % complexLength;
+        const unsigned int mirrored = (complexLength - k) % complexLength;
+
+        const T evenReal = (zReal[index] + zReal[mirrored]) / 2;
+        const T evenImag = (zImag[index] - zImag[mirrored]) / 2;
+        const T oddReal  = (zImag[index] + zImag[mirrored]) / 2;
+        const T oddImag  = (zReal[mirrored] - zReal[index]) / 2;
+
+        real[k] = evenReal + oddReal * twiddleReal[k] - oddImag * twiddleImag[k];
+        imag[k] = evenImag + oddReal * twiddleImag[k] + oddImag * twiddleReal[k];
+    }
 }
 
 
-const std::vector<float> &FFT::logarithmicMagnitudeVector()
+template <typename T>
+void RadixBackend<T>::executeInverse(const Plan& plan, Workspace& workspace, T* real, T* imag, T* output)
 {
-    // update the magnitude vector
-    magnitudeVector();
+    const unsigned int complexLength = static_cast<unsigned int>(plan.bitReverse.size());
+    const T* twiddleReal = &plan.twiddleReal[0];
+    const T* twiddleImag = &plan.twiddleImag[0];
+    T* zReal = &workspace.real[0];
+    T* zImag = &workspace.imag[0];
 
-    if (m_logarithmicMagnitudeVector.size() == 0)
+    // undo the split: the transforms of the even and the odd samples become one complex sequence,
+    // it is conjugated, so the forward transform computes the inverse
+    for (unsigned int k = 0; k < complexLength; ++k)
     {
-        m_logarithmicMagnitudeVector.resize(m_magnitudeVector.size(), 0.f);
-        std::transform(m_magnitudeVector.begin(), m_magnitudeVector.end(), m_logarithmicMagnitudeVector.begin(),
-                       [] (float magnitude)
-                       {
-                           return std::log10(magnitude / 100 + epsilon); // log of 0 is undefined
-                       });
+        const unsigned int mirrored = complexLength - k;
+
+        const T evenReal = real[k] + real[mirrored];
+        const T evenImag = imag[k] - imag[mirrored];
+        const T differenceReal = real[k] - real[mirrored];
+        const T differenceImag = imag[k] + imag[mirrored];
+
+        // times the conjugated twiddle
+        const T oddReal = differenceReal * twiddleReal[k] + differenceImag * twiddleImag[k];
+        const T oddImag = differenceImag * twiddleReal[k] - differenceReal * twiddleImag[k];
+
+        const unsigned int reversed = plan.bitReverse[k];
+        zReal[reversed] = evenReal - oddImag;       // even + i * odd, conjugated
+        zImag[reversed] = -(evenImag + oddReal);
     }
 
-    return m_logarithmicMagnitudeVector;
+    transformComplex(plan, zReal, zImag);
+
+    // the even samples are in the real part and the odd samples in the conjugated imaginary part
+    for (unsigned int n = 0; n < complexLength; ++n)
+    {
+        output[2 * n]     = zReal[n];
+        output[2 * n + 1] = -zImag[n];
+    }
 }
+
+
+template struct RadixBackend<float>;
+template struct RadixBackend<double>;
+template struct RadixBackend<long double>;
@@ -21,30 +21,267 @@
 #ifndef FFT_H
 #define FFT_H
 
+#ifdef FFTSPECTRUM_USE_FFTW
 #include <fftw3.h>
+#include <mutex>
+#endif
 
+#include <memory>
 #include <vector> // replace with boost aligned vector for SIMD
 
-class FFT
+
+// The precision of the transform is chosen with the FFT_PRECISION CMake option
+#if defined(FFTSPECTRUM_FFT_LONG_DOUBLE)
+typedef long double FFTScalar;
+#elif defined(FFTSPECTRUM_FFT_DOUBLE)
+typedef double FFTScalar;
+#else
+typedef float FFTScalar;
+#endif
+
+
+/**
+ * @brief A backend computes the real to complex transform for BasicFFT. It provides
+ *        the Scalar type, a Plan that is shared between threads, a per FFT Workspace
+ *        and static createPlan(), destroyPlan() and execute() functions. Because the
+ *        backend is a template parameter, the calls are resolved at compile time.
+ *
+ *        For the inverse transform a backend also provides createInversePlan() and
+ *        executeInverse(), which turns the N/2+1 bins back into N samples scaled by N.
+ *        The inverse may overwrite the bins.
+ *
+ *        The RadixBackend is an in-tree radix-2/4 transform for power of 2 lengths.
+ *        It transforms the real input as a complex sequence of half the length and
+ *        doesn't need any library. For float and double the butterflies use SSE,
+ *        unless FFTSPECTRUM_NO_SIMD is defined (FFT_SIMD CMake option).
+ */
+template <typename T>
+struct RadixBackend
+{
+    typedef T Scalar;
+
+    struct Plan
+    {
+        unsigned int                length;
+        std::vector<unsigned int>   bitReverse;     // of the half length complex transform
+        std::vector<T>              stageTwiddles;  // per radix-4 stage of size s: w1, w2 and w3 for k < s, real and imag parts
+        std::vector<T>              twiddleReal;    // cos(2 pi k / length) for k <= length / 2
+        std::vector<T>              twiddleImag;    // -sin(2 pi k / length) for k <= length / 2
+    };
+
+    struct Workspace
+    {
+        explicit Workspace(const Plan& plan);
+
+        std::vector<T> real;
+        std::vector<T> imag;
+    };
+
+    static Plan createPlan(unsigned int length);
+    static Plan createInversePlan(unsigned int length);
+    static void destroyPlan(Plan& plan);
+    static void execute(const Plan& plan, Workspace& workspace, const T* input, T* real, T* imag);
+    static void executeInverse(const Plan& plan, Workspace& workspace, T* real, T* imag, T* output);
+};
+
+
+#ifdef FFTSPECTRUM_USE_FFTW
+
+/**
+ * @brief The planner of FFTW is not thread safe, it has to be locked when a plan
+ *        is created or destroyed.
+ */
+std::mutex& fftwPlannerMutex();
+
+/**
+ * @brief FFTWFunctions maps the functions of the FFTW library for a given precision.
+ */
+template <typename T>
+struct FFTWFunctions;
+
+template <>
+struct FFTWFunctions<float>
+{
+    typedef fftwf_plan  Plan;
+    typedef fftwf_iodim IODim;
+    static Plan plan(const IODim* dim, float* input, float* real, float* imag)  { return fftwf_plan_guru_split_dft_r2c(1, dim, 0, NULL, input, real, imag, FFTW_ESTIMATE); }
+    static void execute(Plan plan, float* input, float* real, float* imag)      { fftwf_execute_split_dft_r2c(plan, input, real, imag); }
+    static Plan inversePlan(const IODim* dim, float* real, float* imag, float* output)  { return fftwf_plan_guru_split_dft_c2r(1, dim, 0, NULL, real, imag, output, FFTW_ESTIMATE); }
+    static void executeInverse(Plan plan, float* real, float* imag, float* output)      { fftwf_execute_split_dft_c2r(plan, real, imag, output); }
+    static void destroy(Plan plan)                                              { fftwf_destroy_plan(plan); }
+};
+
+template <>
+struct FFTWFunctions<double>
+{
+    typedef fftw_plan   Plan;
+    typedef fftw_iodim  IODim;
+    static Plan plan(const IODim* dim, double* input, double* real, double* imag)   { return fftw_plan_guru_split_dft_r2c(1, dim, 0, NULL, input, real, imag, FFTW_ESTIMATE); }
+    static void execute(Plan plan, double* input, double* real, double* imag)       { fftw_execute_split_dft_r2c(plan, input, real, imag); }
+    static Plan inversePlan(const IODim* dim, double* real, double* imag, double* output)   { return fftw_plan_guru_split_dft_c2r(1, dim, 0, NULL, real, imag, output, FFTW_ESTIMATE); }
+    static void executeInverse(Plan plan, double* real, double* imag, double* output)       { fftw_execute_split_dft_c2r(plan, real, imag, output); }
+    static void destroy(Plan plan)                                                  { fftw_destroy_plan(plan); }
+};
+
+template <>
+struct FFTWFunctions<long double>
+{
+    typedef fftwl_plan  Plan;
+    typedef fftwl_iodim IODim;
+    static Plan plan(const IODim* dim, long double* input, long double* real, long double* imag)    { return fftwl_plan_guru_split_dft_r2c(1, dim, 0, NULL, input, real, imag, FFTW_ESTIMATE); }
+    static void execute(Plan plan, long double* input, long double* real, long double* imag)        { fftwl_execute_split_dft_r2c(plan, input, real, imag); }
+    static Plan inversePlan(const IODim* dim, long double* real, long double* imag, long double* output)    { return fftwl_plan_guru_split_dft_c2r(1, dim, 0, NULL, real, imag, output, FFTW_ESTIMATE); }
+    static void executeInverse(Plan plan, long double* real, long double* imag, long double* output)        { fftwl_execute_split_dft_c2r(plan, real, imag, output); }
+    static void destroy(Plan plan)                                                                  { fftwl_destroy_plan(plan); }
+};
+
+
+/**
+ * @brief The FFTWBackend uses the split real to complex guru interface of FFTW.
+ *        Every precision needs its own FFTW library (fftw3f, fftw3 or fftw3l).
+ */
+template <typename T>
+struct FFTWBackend
+{
+    typedef T Scalar;
+    typedef typename FFTWFunctions<T>::Plan Plan;
+
+    struct Workspace
+    {
+        explicit Workspace(const Plan&) {}
+    };
+
+    static Plan createPlan(unsigned int length);
+    static Plan createInversePlan(unsigned int length);
+    static void destroyPlan(Plan& plan);
+    static void execute(const Plan& plan, Workspace& workspace, const T* input, T* real, T* imag);
+    static void executeInverse(const Plan& plan, Workspace& workspace, T* real, T* imag, T* output);
+};
+
+#endif // FFTSPECTRUM_USE_FFTW
+
+
+template <typename Backend>
+class BasicFFT;
+
+template <typename Backend>
+class BasicInverseFFT;
+
+/**
+ * @brief The BasicFFTPlan class owns a plan for a real to complex transform of a given
+ *        length, or for the inverse. Creating a plan is expensive, but it can be shared by
+ *        any number of FFT objects (even on different threads), because they execute it
+ *        on their own arrays.
+ */
+template <typename Backend>
+class BasicFFTPlan
+{
+public:
+    enum Direction
+    {
+        Forward,
+        Inverse
+    };
+
+    BasicFFTPlan(unsigned int FFTLength, Direction direction = Forward);
+
+    ~BasicFFTPlan();
+
+    unsigned int    getLength() const;
+
+    Direction       getDirection() const;
+
+private:
+    friend class BasicFFT<Backend>;
+    friend class BasicInverseFFT<Backend>;
+
+    BasicFFTPlan(const BasicFFTPlan&);
+    BasicFFTPlan& operator=(const BasicFFTPlan&);
+
+    typename Backend::Plan  m_plan;
+    const unsigned int      m_length;
+    const Direction         m_direction;
+};
+
+
+template <typename Backend>
+class BasicFFT
 {
 public:
-    FFT(unsigned int FFTLength);
+    typedef typename Backend::Scalar Scalar;
+    typedef BasicFFTPlan<Backend>    Plan;
+
+    BasicFFT(unsigned int FFTLength);
+
+    BasicFFT(std::shared_ptr<const Plan> plan);
 
-    ~FFT();
+    void                        process(const Scalar* input);
+    const std::vector<Scalar>&  realPart();
+    const std::vector<Scalar>&  imagPart();
+    const std::vector<Scalar>&  magnitudeVector();
 
-    void                        process(const float* input);
-    const std::vector<float>&   realPart();
-    const std::vector<float>&   imagPart();
-    const std::vector<float>&   magnitudeVector();
+    /**
+     * @brief Returns log10(magnitude / 100). This is only used for display and storage,
+     *        so it is always single precision.
+     */
     const std::vector<float>&   logarithmicMagnitudeVector();
 
 private:
-    fftwf_plan         m_plan;
-    std::vector<float> m_realPart;
-    std::vector<float> m_imagPart;
-    std::vector<float> m_magnitudeVector;
-    std::vector<float> m_logarithmicMagnitudeVector;
-    const unsigned int m_outputSize;
+    std::shared_ptr<const Plan> m_plan;
+    typename Backend::Workspace m_workspace;
+    std::vector<Scalar> m_realPart;
+    std::vector<Scalar> m_imagPart;
+    std::vector<Scalar> m_magnitudeVector;
+    std::vector<float>  m_logarithmicMagnitudeVector;
+    const unsigned int  m_outputSize;
 };
 
+
+/**
+ * @brief The BasicInverseFFT class turns N/2+1 bins back into N real samples. The bins
+ *        are written into realPart() and imagPart(), process() may overwrite them.
+ *        Like FFTW, the output is not normalized, it is N times the original samples.
+ */
+template <typename Backend>
+class BasicInverseFFT
+{
+public:
+    typedef typename Backend::Scalar Scalar;
+    typedef BasicFFTPlan<Backend>    Plan;
+
+    /**
+     * @param plan A plan with the Inverse direction
+     */
+    BasicInverseFFT(std::shared_ptr<const Plan> plan);
+
+    std::vector<Scalar>&    realPart();
+    std::vector<Scalar>&    imagPart();
+
+    /**
+     * @param output Receives the N samples
+     */
+    void                    process(Scalar* output);
+
+private:
+    std::shared_ptr<const Plan> m_plan;
+    typename Backend::Workspace m_workspace;
+    std::vector<Scalar> m_realPart;
+    std::vector<Scalar> m_imagPart;
+};
+
+
+// The backend is chosen with the FFT_BACKEND CMake option
+#ifdef FFTSPECTRUM_USE_FFTW
+typedef FFTWBackend<FFTScalar>  FFTBackend;
+#else
+typedef RadixBackend<FFTScalar> FFTBackend;
+#endif
+
+typedef BasicFFTPlan<FFTBackend> FFTPlan;
+typedef BasicFFT<FFTBackend>     FFT;
+typedef BasicInverseFFT<FFTBackend> InverseFFT;
+
+
+#include "FFT.inl"
+
 #endif // FFT_H
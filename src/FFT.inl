@@ -0,0 +1,233 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+#ifdef FFTSPECTRUM_USE_FFTW
+
+template <typename T>
+typename FFTWBackend<T>::Plan FFTWBackend<T>::createPlan(unsigned int length)
+{
+    std::vector<T> tempInput(length);
+    std::vector<T> tempReal(length / 2 + 1);
+    std::vector<T> tempImag(length / 2 + 1);
+
+    typename FFTWFunctions<T>::IODim dim;
+    dim.n  = length;
+    dim.is = 1;
+    dim.os = 1;
+
+    std::lock_guard<std::mutex> lock(fftwPlannerMutex());
+    return FFTWFunctions<T>::plan(&dim, &tempInput[0], &tempReal[0], &tempImag[0]);
+}
+
+
+template <typename T>
+typename FFTWBackend<T>::Plan FFTWBackend<T>::createInversePlan(unsigned int length)
+{
+    std::vector<T> tempReal(length / 2 + 1);
+    std::vector<T> tempImag(length / 2 + 1);
+    std::vector<T> tempOutput(length);
+
+    typename FFTWFunctions<T>::IODim dim;
+    dim.n  = length;
+    dim.is = 1;
+    dim.os = 1;
+
+    std::lock_guard<std::mutex> lock(fftwPlannerMutex());
+    return FFTWFunctions<T>::inversePlan(&dim, &tempReal[0], &tempImag[0], &tempOutput[0]);
+}
+
+
+template <typename T>
+void FFTWBackend<T>::destroyPlan(Plan& plan)
+{
+    std::lock_guard<std::mutex> lock(fftwPlannerMutex());
+    FFTWFunctions<T>::destroy(plan);
+}
+
+
+template <typename T>
+void FFTWBackend<T>::execute(const Plan& plan, Workspace&, const T* input, T* real, T* imag)
+{
+    T* nonConstInput = const_cast<T*>(input);   // fftw does not take const input even though the data not be manipulated!
+    FFTWFunctions<T>::execute(plan, nonConstInput, real, imag);
+}
+
+
+template <typename T>
+void FFTWBackend<T>::executeInverse(const Plan& plan, Workspace&, T* real, T* imag, T* output)
+{
+    FFTWFunctions<T>::executeInverse(plan, real, imag, output);
+}
+
+#endif // FFTSPECTRUM_USE_FFTW
+
+
+template <typename Backend>
+BasicFFTPlan<Backend>::BasicFFTPlan(unsigned int FFTLength, Direction direction) :
+    m_plan((direction == Forward) ? Backend::createPlan(FFTLength) : Backend::createInversePlan(FFTLength)),
+    m_length(FFTLength),
+    m_direction(direction)
+{
+
+}
+
+
+template <typename Backend>
+BasicFFTPlan<Backend>::~BasicFFTPlan()
+{
+    Backend::destroyPlan(m_plan);
+}
+
+
+template <typename Backend>
+unsigned int BasicFFTPlan<Backend>::getLength() const
+{
+    return m_length;
+}
+
+
+template <typename Backend>
+typename BasicFFTPlan<Backend>::Direction BasicFFTPlan<Backend>::getDirection() const
+{
+    return m_direction;
+}
+
+
+template <typename Backend>
+BasicFFT<Backend>::BasicFFT(unsigned int FFTLength) :
+    BasicFFT(std::make_shared<const Plan>(FFTLength))
+{
+
+}
+
+
+template <typename Backend>
+BasicFFT<Backend>::BasicFFT(std::shared_ptr<const Plan> plan) :
+    m_plan(plan),
+    m_workspace(plan->m_plan),
+    m_outputSize(plan->getLength() / 2 + 1) // a real FFT returns N/2+1
+{
+    m_realPart.resize(m_outputSize);
+    m_imagPart.resize(m_outputSize);
+
+    // make the initial state meaningful
+    std::fill(m_realPart.begin(), m_realPart.end(), Scalar(0));
+    std::fill(m_imagPart.begin(), m_imagPart.end(), Scalar(0));
+
+    m_magnitudeVector.reserve(m_outputSize);
+}
+
+
+template <typename Backend>
+void BasicFFT<Backend>::process(const Scalar* input)
+{
+    Backend::execute(m_plan->m_plan, m_workspace, input, &m_realPart[0], &m_imagPart[0]);
+    m_magnitudeVector.clear();
+    m_logarithmicMagnitudeVector.clear();
+}
+
+
+template <typename Backend>
+const std::vector<typename BasicFFT<Backend>::Scalar>& BasicFFT<Backend>::realPart()
+{
+    return m_realPart;
+}
+
+
+template <typename Backend>
+const std::vector<typename BasicFFT<Backend>::Scalar>& BasicFFT<Backend>::imagPart()
+{
+  return m_imagPart;
+}
+
+
+template <typename Backend>
+const std::vector<typename BasicFFT<Backend>::Scalar>& BasicFFT<Backend>::magnitudeVector()
+{
+    if (m_magnitudeVector.size() == 0)
+    {
+        for (std::size_t i = 0; i < m_outputSize; ++i)
+        {
+            m_magnitudeVector.push_back(std::sqrt(m_realPart[i] * m_realPart[i] + m_imagPart[i] * m_imagPart[i]));
+        }
+    }
+
+    return m_magnitudeVector;
+}
+
+
+template <typename Backend>
+const std::vector<float>& BasicFFT<Backend>::logarithmicMagnitudeVector()
+{
+    // update the magnitude vector
+    magnitudeVector();
+
+    if (m_logarithmicMagnitudeVector.size() == 0)
+    {
+        // the floor stays at the single precision epsilon, so the display looks the same for every precision
+        const Scalar epsilon = std::numeric_limits<float>::epsilon();
+
+        m_logarithmicMagnitudeVector.resize(m_magnitudeVector.size(), 0.f);
+        std::transform(m_magnitudeVector.begin(), m_magnitudeVector.end(), m_logarithmicMagnitudeVector.begin(),
+                       [epsilon] (Scalar magnitude)
+                       {
+                           return static_cast<float>(std::log10(magnitude / 100 + epsilon)); // log of 0 is undefined
+                       });
+    }
+
+    return m_logarithmicMagnitudeVector;
+}
+
+
+template <typename Backend>
+BasicInverseFFT<Backend>::BasicInverseFFT(std::shared_ptr<const Plan> plan) :
+    m_plan(plan),
+    m_workspace(plan->m_plan),
+    m_realPart(plan->getLength() / 2 + 1, Scalar(0)),
+    m_imagPart(plan->getLength() / 2 + 1, Scalar(0))
+{
+
+}
+
+
+template <typename Backend>
+std::vector<typename BasicInverseFFT<Backend>::Scalar>& BasicInverseFFT<Backend>::realPart()
+{
+    return m_realPart;
+}
+
+
+template <typename Backend>
+std::vector<typename BasicInverseFFT<Backend>::Scalar>& BasicInverseFFT<Backend>::imagPart()
+{
+    return m_imagPart;
+}
+
+
+template <typename Backend>
+void BasicInverseFFT<Backend>::process(Scalar* output)
+{
+    Backend::executeInverse(m_plan->m_plan, m_workspace, &m_realPart[0], &m_imagPart[0], output);
+}
@@ -0,0 +1,169 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "FeatureExtractor.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace
+{
+    const float pi = 3.14159265358979f;
+
+    // the share of the power below the rolloff frequency
+    const float rolloffShare = 0.85f;
+
+    // added to the band energies before the logarithm, about the floor of the levels
+    const float powerFloor = 1e-14f;
+
+    // the chroma takes the bins from A0 to C8
+    const float lowestPitch = 27.5f;
+    const float highestPitch = 4186.f;
+
+    // the HTK mel scale
+    float toMel(float frequency)
+    {
+        return 2595.f * std::log10(1.f + frequency / 700.f);
+    }
+
+    float fromMel(float mel)
+    {
+        return 700.f * (std::pow(10.f, mel / 2595.f) - 1.f);
+    }
+}
+
+
+FeatureExtractor::FeatureExtractor(unsigned int binCount, float binWidth) :
+    m_binCount(binCount),
+    m_binWidth(binWidth),
+    m_segments(binCount, -1),
+    m_weights(binCount, 0.f),
+    m_pitchClasses(binCount, -1),
+    m_dct(coefficientCount * melBandCount),
+    m_powers(binCount)
+{
+    // the bands are spaced evenly on the mel scale from 0 Hz to the highest bin, band b peaks at point b + 1
+    const float highestMel = toMel(binWidth * (binCount > 0 ? binCount - 1 : 0));
+    float points[melBandCount + 2];
+    for (unsigned int point = 0; point < melBandCount + 2; ++point)
+        points[point] = fromMel(highestMel * point / (melBandCount + 1));
+
+    for (unsigned int bin = 0, segment = 0; bin < binCount; ++bin)
+    {
+        const float frequency = bin * binWidth;
+        while (segment < melBandCount + 1 && frequency > points[segment + 1])
+            ++segment;
+        if (segment < melBandCount + 1 && points[segment + 1] > points[segment])
+        {
+            m_segments[bin] = static_cast<int>(segment);
+            m_weights[bin] = (frequency - points[segment]) / (points[segment + 1] - points[segment]);
+        }
+
+        // pitch class 0 is C, MIDI note 60
+        if (lowestPitch <= frequency && frequency <= highestPitch)
+        {
+            const int note = static_cast<int>(std::floor(12.f * std::log2(frequency / 440.f) + 69.5f));
+            m_pitchClasses[bin] = note % 12;
+        }
+    }
+
+    for (unsigned int coefficient = 0; coefficient < coefficientCount; ++coefficient)
+    {
+        const float scale = std::sqrt((coefficient == 0 ? 1.f : 2.f) / melBandCount);
+        for (unsigned int band = 0; band < melBandCount; ++band)
+            m_dct[coefficient * melBandCount + band] = scale * std::cos(pi * coefficient * (band + 0.5f) / melBandCount);
+    }
+}
+
+
+void FeatureExtractor::extract(const float* levels, float* features)
+{
+    float* bands = features;
+    float* coefficients = bands + melBandCount;
+    float* chroma = coefficients + coefficientCount;
+    float* statistics = chroma + pitchClassCount;
+
+    std::fill(bands, bands + melBandCount, 0.f);
+    std::fill(chroma, chroma + pitchClassCount, 0.f);
+
+    double total = 0.0, weighted = 0.0, squared = 0.0, logarithmic = 0.0;
+    for (unsigned int bin = 0; bin < m_binCount; ++bin)
+    {
+        // the levels are log10 magnitudes, the power is the square
+        const float power = std::pow(10.f, 2.f * levels[bin]);
+        m_powers[bin] = power;
+
+        const int segment = m_segments[bin];
+        if (segment >= 0)
+        {
+            if (segment < static_cast<int>(melBandCount))
+                bands[segment] += m_weights[bin] * power;
+            if (segment > 0)
+                bands[segment - 1] += (1.f - m_weights[bin]) * power;
+        }
+        if (m_pitchClasses[bin] >= 0)
+            chroma[m_pitchClasses[bin]] += power;
+
+        const double frequency = bin * m_binWidth;
+        total += power;
+        weighted += frequency * power;
+        squared += frequency * frequency * power;
+        logarithmic += 2.0 * levels[bin];
+    }
+
+    for (unsigned int band = 0; band < melBandCount; ++band)
+        bands[band] = 10.f * std::log10(bands[band] + powerFloor);
+
+    for (unsigned int coefficient = 0; coefficient < coefficientCount; ++coefficient)
+    {
+        const float* row = &m_dct[coefficient * melBandCount];
+        float sum = 0.f;
+        for (unsigned int band = 0; band < melBandCount; ++band)
+            sum += row[band] * bands[band];
+        coefficients[coefficient] = sum;
+    }
+
+    const float loudestClass = *std::max_element(chroma, chroma + pitchClassCount);
+    if (loudestClass > 0.f)
+    {
+        for (unsigned int pitchClass = 0; pitchClass < pitchClassCount; ++pitchClass)
+            chroma[pitchClass] /= loudestClass;
+    }
+
+    if (total <= 0.0 || m_binCount == 0)
+    {
+        std::fill(statistics, statistics + statisticCount, 0.f);
+        return;
+    }
+
+    const double centroid = weighted / total;
+    statistics[0] = static_cast<float>(centroid);
+    statistics[1] = static_cast<float>(std::sqrt(std::max(0.0, squared / total - centroid * centroid)));
+
+    unsigned int rolloff = 0;
+    double below = m_powers[0];
+    while (rolloff + 1 < m_binCount && below < rolloffShare * total)
+        below += m_powers[++rolloff];
+    statistics[2] = rolloff * m_binWidth;
+
+    // the geometric mean of the power over its arithmetic mean
+    statistics[3] = static_cast<float>(std::pow(10.0, logarithmic / m_binCount) / (total / m_binCount));
+}
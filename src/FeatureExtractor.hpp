@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_FEATUREEXTRACTOR_HPP
+#define FFTSPECTRUM_FEATUREEXTRACTOR_HPP
+
+#include <vector>
+
+/**
+ * @brief The FeatureExtractor class computes the features that audio models are usually
+ *        trained on from a frame of the spectrogram: the energies of triangular mel bands,
+ *        the MFCCs (the DCT of the band energies in dB), the chroma (the energy of the 12
+ *        pitch classes) and spectral statistics. The band of every bin, its weight, its pitch
+ *        class and the DCT matrix are computed once for the bins of the spectrogram, so a
+ *        frame costs one pass over its bins and a small matrix product.
+ */
+class FeatureExtractor
+{
+public:
+    static const unsigned int melBandCount = 40;
+    static const unsigned int coefficientCount = 13;
+    static const unsigned int pitchClassCount = 12;
+    static const unsigned int statisticCount = 4;
+    static const unsigned int featureCount = melBandCount + coefficientCount + pitchClassCount + statisticCount;
+
+    /**
+     * @param binCount  The values per frame
+     * @param binWidth  In Hz, bin k is at k * binWidth
+     */
+    FeatureExtractor(unsigned int binCount, float binWidth);
+
+    /**
+     * @brief Computes the features of a frame.
+     *
+     * @param levels    binCount log10 magnitudes
+     * @param features  Receives featureCount values: the mel bands in dB, the MFCCs, the chroma
+     *                  from C to B (the loudest pitch class is 1), then the spectral centroid,
+     *                  spread and 85 % rolloff in Hz and the flatness (0 to 1)
+     */
+    void                extract(const float* levels, float* features);
+
+private:
+
+    const unsigned int          m_binCount;
+    const float                 m_binWidth;
+    std::vector<int>            m_segments;     // bin k lies between the peaks of band m_segments[k] - 1 and band m_segments[k], -1 outside of all bands
+    std::vector<float>          m_weights;      // of bin k in band m_segments[k], the band below gets 1 minus it
+    std::vector<int>            m_pitchClasses; // of bin k, -1 outside of the piano range
+    std::vector<float>          m_dct;          // coefficientCount rows of melBandCount values, orthonormal DCT-II
+    std::vector<float>          m_powers;       // of the frame, for the rolloff
+};
+
+#endif //FFTSPECTRUM_FEATUREEXTRACTOR_HPP
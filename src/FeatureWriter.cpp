@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "FeatureWriter.hpp"
+#include "NpyWriter.hpp"
+
+#include <iostream>
+
+
+FeatureWriter::FeatureWriter(const std::string& filename, std::unique_ptr<FrameSink> next) :
+    m_filename(filename),
+    m_next(std::move(next)),
+    m_frameCount(0),
+    m_binCount(0),
+    m_frame(0)
+{
+
+}
+
+
+bool FeatureWriter::begin(const Description& description)
+{
+    m_file.open(m_filename, std::ios::binary | std::ios::trunc);
+    if (!m_file)
+    {
+        std::cout << "Could not open " << m_filename << " for writing." << std::endl;
+        return false;
+    }
+
+    m_frameCount = description.frameCount;
+    m_binCount = description.binCount;
+    m_frame = 0;
+    m_extractor.reset(new FeatureExtractor(description.binCount, description.binWidth));
+    m_levels.resize(m_binCount);
+    m_features.resize(FeatureExtractor::featureCount);
+    m_columns.assign(static_cast<std::size_t>(FeatureExtractor::featureCount) * m_frameCount, 0.f);
+
+    return !m_next || m_next->begin(description);
+}
+
+
+bool FeatureWriter::write(const float* frame)
+{
+    // the frames are in dB, the extractor takes log10 magnitudes
+    for (unsigned int bin = 0; bin < m_binCount; ++bin)
+        m_levels[bin] = frame[bin] / 20.f;
+    m_extractor->extract(&m_levels[0], &m_features[0]);
+
+    if (m_frame < m_frameCount)
+    {
+        for (unsigned int feature = 0; feature < FeatureExtractor::featureCount; ++feature)
+            m_columns[static_cast<std::size_t>(feature) * m_frameCount + m_frame] = m_features[feature];
+        ++m_frame;
+    }
+
+    return !m_next || m_next->write(frame);
+}
+
+
+bool FeatureWriter::finish()
+{
+    // the values are written as they are, this assumes a little endian machine like x86 and ARM
+    NpyWriter::writeHeader(m_file, m_frameCount, FeatureExtractor::featureCount, true);
+    m_file.write(reinterpret_cast<const char*>(m_columns.data()), m_columns.size() * sizeof(float));
+    m_file.close();
+
+    const bool isWritten = !m_file.fail();
+    if (isWritten)
+        std::cout << "Extracted " << FeatureExtractor::featureCount << " features of " << m_frameCount << " frames to " << m_filename << "." << std::endl;
+
+    const bool isFinished = !m_next || m_next->finish();
+    return isWritten && isFinished;
+}
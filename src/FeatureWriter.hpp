@@ -0,0 +1,66 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_FEATUREWRITER_HPP
+#define FFTSPECTRUM_FEATUREWRITER_HPP
+
+#include "FeatureExtractor.hpp"
+#include "FrameSink.hpp"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The FeatureWriter class extracts the features of the frames while they are exported
+ *        and writes them as a NumPy .npy file of shape (frames, features) in column-major
+ *        (Fortran) order, so the values of one feature follow each other. The features are
+ *        kept until the last frame, they are much smaller than the frames. The frames are
+ *        passed on to another sink, so the export and the features come from the same pass.
+ */
+class FeatureWriter : public FrameSink
+{
+public:
+    /**
+     * @param next Receives the frames as well, may be null
+     */
+    FeatureWriter(const std::string& filename, std::unique_ptr<FrameSink> next);
+
+    virtual bool    begin(const Description& description);
+
+    virtual bool    write(const float* frame);
+
+    virtual bool    finish();
+
+private:
+    const std::string                   m_filename;
+    std::unique_ptr<FrameSink>          m_next;
+    std::unique_ptr<FeatureExtractor>   m_extractor;
+    std::ofstream                       m_file;
+    std::vector<float>                  m_levels;       // of the frame
+    std::vector<float>                  m_features;     // of the frame
+    std::vector<float>                  m_columns;      // of all frames, one feature after the other
+    unsigned int                        m_frameCount;
+    unsigned int                        m_binCount;
+    unsigned int                        m_frame;
+};
+
+#endif //FFTSPECTRUM_FEATUREWRITER_HPP
@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "FileWatcher.hpp"
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+    std::time_t modificationTime(const std::string& filename)
+    {
+        struct stat status;
+        if (stat(filename.c_str(), &status) != 0)
+            return 0;
+        return status.st_mtime;
+    }
+}
+
+
+FileWatcher::FileWatcher(const std::string& filename) :
+    m_filename(filename),
+    m_inotifyDescriptor(-1),
+    m_modificationTime(modificationTime(filename))
+{
+    std::string directory = ".";
+    m_basename = filename;
+    const std::size_t slash = filename.find_last_of("/\\");
+    if (slash != std::string::npos)
+    {
+        directory = filename.substr(0, slash);
+        m_basename = filename.substr(slash + 1);
+    }
+
+#ifdef __linux__
+    m_inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyDescriptor >= 0)
+    {
+        if (inotify_add_watch(m_inotifyDescriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+        {
+            // fall back to polling
+            close(m_inotifyDescriptor);
+            m_inotifyDescriptor = -1;
+        }
+    }
+#endif
+}
+
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (m_inotifyDescriptor >= 0)
+        close(m_inotifyDescriptor);
+#endif
+}
+
+
+bool FileWatcher::hasChanged()
+{
+#ifdef __linux__
+    if (m_inotifyDescriptor >= 0)
+    {
+        bool changed = false;
+        alignas(struct inotify_event) char buffer[4096];
+        ssize_t length;
+        // drain all pending events, the descriptor is non blocking
+        while ((length = read(m_inotifyDescriptor, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* pointer = buffer; pointer < buffer + length; )
+            {
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(pointer);
+                if (event->len > 0 && m_basename == event->name)
+                    changed = true;
+                pointer += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        return changed;
+    }
+#endif
+
+    // polling the file system every frame would be wasteful
+    if (m_pollClock.getElapsedTime() < sf::seconds(1.f))
+        return false;
+    m_pollClock.restart();
+
+    const std::time_t time = modificationTime(m_filename);
+    if (time != m_modificationTime)
+    {
+        m_modificationTime = time;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_FILEWATCHER_HPP
+#define FFTSPECTRUM_FILEWATCHER_HPP
+
+#include <SFML/System/Clock.hpp>
+
+#include <ctime>
+#include <string>
+
+/**
+ * @brief The FileWatcher class notices when a file was written. On Linux inotify
+ *        is used, so polling it is just a non blocking read. On other systems the
+ *        modification time of the file is compared once per second.
+ *        The parent directory is watched, so files that are replaced by an
+ *        editor (written to a temporary file and renamed) are noticed as well.
+ */
+class FileWatcher
+{
+public:
+    FileWatcher(const std::string& filename);
+
+    ~FileWatcher();
+
+    /**
+     * @brief Checks if the file was written since the last call. Never blocks.
+     */
+    bool hasChanged();
+
+private:
+
+    FileWatcher(const FileWatcher&);
+    FileWatcher& operator=(const FileWatcher&);
+
+    std::string     m_filename;
+    std::string     m_basename;
+    int             m_inotifyDescriptor;
+    std::time_t     m_modificationTime;
+    sf::Clock       m_pollClock;
+};
+
+#endif //FFTSPECTRUM_FILEWATCHER_HPP
@@ -0,0 +1,270 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "FingerprintIndex.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+
+namespace
+{
+    // fewer landmarks on one offset happen by chance
+    const unsigned int minimumScore = 5;
+
+    template <typename T>
+    bool readValue(std::ifstream& file, T& value)
+    {
+        file.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return static_cast<bool>(file);
+    }
+
+    // the votes of a file and an offset in frames
+    std::uint64_t voteKey(std::uint32_t file, std::int32_t offset)
+    {
+        return (static_cast<std::uint64_t>(file) << 32) | static_cast<std::uint32_t>(offset);
+    }
+}
+
+
+FingerprintIndex::FingerprintIndex() :
+    m_postingsOffset(0),
+    m_FFTSize(0),
+    m_maxFrequency(0.f),
+    m_sampleRate(0.f),
+    m_magnitudeFormat(MagnitudeStorage::Format::Float32),
+    m_magnitudeRange(MagnitudeStorage::Range::Fixed)
+{
+
+}
+
+
+bool FingerprintIndex::open(const std::string& filename)
+{
+    m_file.close();
+    m_file.clear();
+    m_files.clear();
+    m_directory.clear();
+
+    m_file.open(filename, std::ios::binary);
+    if (!m_file)
+    {
+        std::cout << "Could not open the index " << filename << "." << std::endl;
+        return false;
+    }
+
+    char magic[4];
+    std::uint32_t fileVersion = 0;
+    std::uint32_t format = 0;
+    std::uint32_t range = 0;
+    std::uint32_t bits = 0;
+    m_file.read(magic, 4);
+    if (!m_file || !std::equal(magic, magic + 4, "FSPF") || !readValue(m_file, fileVersion) || fileVersion != version
+        || !readValue(m_file, m_FFTSize) || !readValue(m_file, m_maxFrequency) || !readValue(m_file, m_sampleRate)
+        || !readValue(m_file, format) || format > static_cast<std::uint32_t>(MagnitudeStorage::Format::Code8)
+        || !readValue(m_file, range) || range > static_cast<std::uint32_t>(MagnitudeStorage::Range::Adaptive)
+        || !readValue(m_file, bits) || bits != directoryBits)
+    {
+        std::cout << filename << " is not a fingerprint index of this version." << std::endl;
+        return false;
+    }
+    m_magnitudeFormat = static_cast<MagnitudeStorage::Format>(format);
+    m_magnitudeRange = static_cast<MagnitudeStorage::Range>(range);
+
+    // the counts and lengths are checked against the rest of the file before anything is allocated for them
+    const std::streamoff headerEnd = m_file.tellg();
+    m_file.seekg(0, std::ios::end);
+    const std::uint64_t fileSize = static_cast<std::uint64_t>(m_file.tellg());
+    m_file.seekg(headerEnd);
+    const auto remaining = [this, fileSize] { return fileSize - static_cast<std::uint64_t>(m_file.tellg()); };
+
+    // a file takes at least its name length, the frames per second and the frame count
+    const std::uint64_t minimumFileSize = 3 * sizeof(std::uint32_t);
+    std::uint32_t fileCount = 0;
+    bool isValid = readValue(m_file, fileCount) && fileCount <= remaining() / minimumFileSize;
+    for (std::uint32_t i = 0; i < fileCount && isValid; ++i)
+    {
+        std::uint32_t nameLength = 0;
+        isValid = readValue(m_file, nameLength) && nameLength <= remaining();
+        if (!isValid)
+            break;
+
+        File file;
+        file.name.resize(nameLength);
+        if (nameLength > 0)
+            m_file.read(&file.name[0], nameLength);
+        isValid = m_file && readValue(m_file, file.framesPerSecond) && readValue(m_file, file.frameCount);
+        m_files.push_back(file);
+    }
+
+    std::uint64_t postingCount = 0;
+    const std::uint64_t directorySize = ((std::uint64_t(1) << directoryBits) + 1) * sizeof(std::uint64_t);
+    isValid = isValid && readValue(m_file, postingCount) && remaining() >= directorySize
+              && postingCount <= (remaining() - directorySize) / sizeof(Posting);
+    if (isValid)
+    {
+        m_directory.resize((std::size_t(1) << directoryBits) + 1);
+        m_file.read(reinterpret_cast<char*>(&m_directory[0]), m_directory.size() * sizeof(std::uint64_t));
+    }
+    // the buckets of a query are read from the directory, they must lie within the postings
+    if (!isValid || !m_file || m_directory.back() != postingCount || !std::is_sorted(m_directory.begin(), m_directory.end()))
+    {
+        std::cout << "The index " << filename << " is damaged." << std::endl;
+        m_files.clear();
+        m_directory.clear();
+        return false;
+    }
+
+    m_postingsOffset = static_cast<std::uint64_t>(m_file.tellg());
+    return true;
+}
+
+
+std::vector<FingerprintIndex::Match> FingerprintIndex::query(const std::vector<Fingerprinter::Landmark>& landmarks, unsigned int maxMatches)
+{
+    if (m_directory.empty())
+        return std::vector<Match>();
+
+    // the landmarks of a bucket are looked up together, so every bucket is read once
+    std::vector<Fingerprinter::Landmark> sorted(landmarks);
+    std::sort(sorted.begin(), sorted.end(), [] (const Fingerprinter::Landmark& a, const Fingerprinter::Landmark& b)
+    {
+        return a.hash < b.hash;
+    });
+
+    std::unordered_map<std::uint64_t, unsigned int> votes;
+    for (std::size_t i = 0; i < sorted.size();)
+    {
+        const std::uint32_t bucket = sorted[i].hash >> (32 - directoryBits);
+        std::size_t end = i;
+        while (end < sorted.size() && (sorted[end].hash >> (32 - directoryBits)) == bucket)
+            ++end;
+
+        const std::uint64_t first = m_directory[bucket];
+        const std::uint64_t last = m_directory[bucket + 1];
+        if (last > first)
+        {
+            m_bucket.resize(static_cast<std::size_t>(last - first));
+            m_file.seekg(static_cast<std::streamoff>(m_postingsOffset + first * sizeof(Posting)));
+            m_file.read(reinterpret_cast<char*>(&m_bucket[0]), m_bucket.size() * sizeof(Posting));
+            if (!m_file)
+            {
+                std::cout << "Could not read the index." << std::endl;
+                m_file.clear();
+                return std::vector<Match>();
+            }
+
+            for (; i < end; ++i)
+            {
+                Posting key;
+                key.hash = sorted[i].hash;
+                auto postings = std::equal_range(m_bucket.begin(), m_bucket.end(), key,
+                                                 [] (const Posting& a, const Posting& b) { return a.hash < b.hash; });
+                for (auto posting = postings.first; posting != postings.second; ++posting)
+                    ++votes[voteKey(posting->file, static_cast<std::int32_t>(posting->frame - sorted[i].frame))];
+            }
+        }
+        i = end;
+    }
+
+    // the frames of the clip fall between the frames of the file, so its landmarks are split between two neighbouring offsets
+    std::unordered_map<std::uint32_t, Match> best;
+    for (const auto& vote : votes)
+    {
+        const auto next = votes.find(vote.first + 1);
+        const unsigned int score = vote.second + ((next != votes.end() && static_cast<std::uint32_t>(vote.first) != 0xFFFFFFFF) ? next->second : 0);
+        const std::uint32_t file = static_cast<std::uint32_t>(vote.first >> 32);
+        if (score < minimumScore || file >= m_files.size())
+            continue;
+
+        // the earlier offset wins a tie, so the result doesn't depend on the order of the map
+        const std::int32_t offset = static_cast<std::int32_t>(vote.first);
+        const sf::Time time = sf::seconds(offset / m_files[file].framesPerSecond);
+        const auto found = best.find(file);
+        if (found == best.end() || score > found->second.score || (score == found->second.score && time < found->second.offset))
+        {
+            Match match;
+            match.file = file;
+            match.offset = time;
+            match.score = score;
+            best[file] = match;
+        }
+    }
+
+    std::vector<Match> matches;
+    for (const auto& match : best)
+        matches.push_back(match.second);
+    std::sort(matches.begin(), matches.end(), [] (const Match& a, const Match& b)
+    {
+        return a.score > b.score || (a.score == b.score && a.file < b.file);
+    });
+    if (matches.size() > maxMatches)
+        matches.resize(maxMatches);
+    return matches;
+}
+
+
+const FingerprintIndex::File& FingerprintIndex::getFile(unsigned int file) const
+{
+    return m_files[file];
+}
+
+
+unsigned int FingerprintIndex::getFileCount() const
+{
+    return static_cast<unsigned int>(m_files.size());
+}
+
+
+unsigned int FingerprintIndex::getFFTSize() const
+{
+    return m_FFTSize;
+}
+
+
+float FingerprintIndex::getMaxFrequency() const
+{
+    return m_maxFrequency;
+}
+
+
+float FingerprintIndex::getSampleRate() const
+{
+    return m_sampleRate;
+}
+
+
+MagnitudeStorage::Format FingerprintIndex::getMagnitudeFormat() const
+{
+    return m_magnitudeFormat;
+}
+
+
+MagnitudeStorage::Range FingerprintIndex::getMagnitudeRange() const
+{
+    return m_magnitudeRange;
+}
+
+
+std::uint64_t FingerprintIndex::getPostingCount() const
+{
+    return m_directory.empty() ? 0 : m_directory.back();
+}
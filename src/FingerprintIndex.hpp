@@ -0,0 +1,130 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_FINGERPRINTINDEX_HPP
+#define FFTSPECTRUM_FINGERPRINTINDEX_HPP
+
+#include "Fingerprinter.hpp"
+#include "MagnitudeStorage.hpp"
+
+#include <SFML/System/Time.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The FingerprintIndex class reads an inverted index from the landmark hashes of the
+ *        Fingerprinter to the files and frames where they occur, as the FingerprintIndexer
+ *        writes it. Only the header, the file table and the directory are read into memory,
+ *        a query reads just the buckets of its hashes from the disk. The files of a clip are
+ *        the ones where many of its landmarks agree on the same offset.
+ *
+ *        The file starts with "FSPF", the version, the FFT size, the highest frequency, the
+ *        sample rate after the decimation, the magnitude format and range of the storage and
+ *        the directory bits as 32 bit values. The file table follows: the count, then per
+ *        file the length of the name, the name, the frames per second and the frame count.
+ *        After the count of the postings, the directory holds the index of the first posting
+ *        of every bucket and one past the last. A bucket takes the hashes with the same top
+ *        bits. The postings are the hash, the file and the frame, sorted by hash. The values
+ *        are little endian.
+ */
+class FingerprintIndex
+{
+public:
+    struct Posting
+    {
+        std::uint32_t   hash;
+        std::uint32_t   file;
+        std::uint32_t   frame;
+    };
+
+    struct File
+    {
+        std::string     name;
+        float           framesPerSecond;
+        std::uint32_t   frameCount;
+    };
+
+    struct Match
+    {
+        unsigned int    file;
+        sf::Time        offset;     ///< where the clip starts in the file
+        unsigned int    score;      ///< the landmarks that agree on the offset
+    };
+
+    static const std::uint32_t  version = 2;
+    static const unsigned int   directoryBits = 20;
+
+    FingerprintIndex();
+
+    /**
+     * @brief Reads the header, the file table and the directory, the file stays open for the queries.
+     *
+     * @return false if the file can't be read or isn't an index
+     */
+    bool                open(const std::string& filename);
+
+    /**
+     * @brief Finds the files that contain the sound of the landmarks. Not thread safe, it
+     *        reads from the open file.
+     *
+     * @param landmarks     Of a clip, fingerprinted with the settings and at the sample rate of the index
+     * @param maxMatches    The best matches that are returned
+     *
+     * @return The matches with the highest score first, at most one per file
+     */
+    std::vector<Match>  query(const std::vector<Fingerprinter::Landmark>& landmarks, unsigned int maxMatches);
+
+    const File&         getFile(unsigned int file) const;
+
+    unsigned int        getFileCount() const;
+
+    unsigned int        getFFTSize() const;
+
+    float               getMaxFrequency() const;
+
+    /**
+     * @brief Returns the sample rate of the transformed samples of every file, after the decimation.
+     */
+    float               getSampleRate() const;
+
+    MagnitudeStorage::Format getMagnitudeFormat() const;
+
+    MagnitudeStorage::Range getMagnitudeRange() const;
+
+    std::uint64_t       getPostingCount() const;
+
+private:
+
+    std::ifstream               m_file;
+    std::vector<File>           m_files;
+    std::vector<std::uint64_t>  m_directory;
+    std::vector<Posting>        m_bucket;       // of the query, kept to not allocate it again
+    std::uint64_t               m_postingsOffset;
+    unsigned int                m_FFTSize;
+    float                       m_maxFrequency;
+    float                       m_sampleRate;
+    MagnitudeStorage::Format    m_magnitudeFormat;
+    MagnitudeStorage::Range     m_magnitudeRange;
+};
+
+#endif //FFTSPECTRUM_FINGERPRINTINDEX_HPP
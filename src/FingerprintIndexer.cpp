@@ -0,0 +1,300 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "FingerprintIndexer.hpp"
+#include "ScratchFile.hpp"
+#include "Spectrogram.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+
+namespace
+{
+    // all values are little endian, like the machines this runs on
+    template <typename T>
+    void writeValue(std::ofstream& file, T value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    std::uint32_t bucketOf(std::uint32_t hash)
+    {
+        return hash >> (32 - FingerprintIndex::directoryBits);
+    }
+
+    Settings fingerprintSettings(Settings settings)
+    {
+        // the landmarks are taken from the plain magnitudes, the clips of the queries aren't drawn either
+        settings.mode = Settings::Mode::STFT;
+        settings.isHeadless = true;
+        return settings;
+    }
+}
+
+
+FingerprintIndexer::FingerprintIndexer(const Settings& settings, ThreadPool& pool, float sampleRate) :
+    m_settings(fingerprintSettings(settings)),
+    m_pool(pool),
+    m_bucketSizes(std::size_t(1) << FingerprintIndex::directoryBits, 0),
+    m_postings(std::tmpfile(), &std::fclose),
+    m_postingCount(0),
+    m_sampleRate(sampleRate),
+    m_hasFailed(false),
+    m_batch(m_settings, pool, m_cache)
+{
+    if (!m_postings)
+    {
+        std::cout << "Could not create a temporary file for the postings." << std::endl;
+        m_hasFailed = true;
+    }
+}
+
+
+bool FingerprintIndexer::addFile(const std::string& filename)
+{
+    return m_batch.addFile(filename, [this, filename] (const Spectrogram& spectrogram)
+    {
+        return createSink(filename, spectrogram);
+    });
+}
+
+
+void FingerprintIndexer::addSound(const std::string& name, std::shared_ptr<const sf::SoundBuffer> soundBuffer)
+{
+    m_batch.addSound(soundBuffer, [this, name] (const Spectrogram& spectrogram)
+    {
+        return createSink(name, spectrogram);
+    });
+}
+
+
+bool FingerprintIndexer::write(const std::string& filename)
+{
+    m_batch.wait();
+
+    if (m_hasFailed)
+    {
+        std::cout << "Could not write the postings to the temporary file." << std::endl;
+        return false;
+    }
+
+    std::vector<std::uint64_t> directory(m_bucketSizes.size() + 1, 0);
+    for (std::size_t bucket = 0; bucket < m_bucketSizes.size(); ++bucket)
+        directory[bucket + 1] = directory[bucket] + m_bucketSizes[bucket];
+
+    // the postings are scattered into their buckets, the scratch file pages them out if the library is large
+    typedef FingerprintIndex::Posting Posting;
+    ScratchFile scratch(static_cast<std::size_t>(std::max<std::uint64_t>(m_postingCount, 1) * sizeof(Posting)));
+    Posting* postings = static_cast<Posting*>(scratch.getData());
+    std::vector<std::uint64_t> next(directory.begin(), directory.end() - 1);
+
+    std::vector<Posting> block(1 << 16);
+    std::fflush(m_postings.get());
+    std::rewind(m_postings.get());
+    for (std::uint64_t read = 0; read < m_postingCount;)
+    {
+        const std::size_t count = std::fread(&block[0], sizeof(Posting), static_cast<std::size_t>(std::min<std::uint64_t>(block.size(), m_postingCount - read)), m_postings.get());
+        if (count == 0)
+        {
+            std::cout << "Could not read the postings back from the temporary file." << std::endl;
+            return false;
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+            postings[next[bucketOf(block[i].hash)]++] = block[i];
+        read += count;
+    }
+    std::fseek(m_postings.get(), 0, SEEK_END);
+
+    for (std::size_t bucket = 0; bucket < m_bucketSizes.size(); ++bucket)
+    {
+        std::sort(postings + directory[bucket], postings + directory[bucket + 1], [] (const Posting& a, const Posting& b)
+        {
+            return a.hash < b.hash || (a.hash == b.hash && (a.file < b.file || (a.file == b.file && a.frame < b.frame)));
+        });
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "Could not open " << filename << " for writing." << std::endl;
+        return false;
+    }
+
+    file.write("FSPF", 4);
+    writeValue<std::uint32_t>(file, FingerprintIndex::version);
+    writeValue<std::uint32_t>(file, m_settings.FFTSize);
+    writeValue<float>(file, m_settings.maxFrequency);
+    writeValue<float>(file, m_sampleRate);
+    writeValue<std::uint32_t>(file, static_cast<std::uint32_t>(m_settings.magnitudeFormat));
+    writeValue<std::uint32_t>(file, static_cast<std::uint32_t>(m_settings.magnitudeRange));
+    writeValue<std::uint32_t>(file, FingerprintIndex::directoryBits);
+
+    writeValue<std::uint32_t>(file, static_cast<std::uint32_t>(m_files.size()));
+    for (const FingerprintIndex::File& indexed : m_files)
+    {
+        writeValue<std::uint32_t>(file, static_cast<std::uint32_t>(indexed.name.size()));
+        file.write(indexed.name.data(), indexed.name.size());
+        writeValue<float>(file, indexed.framesPerSecond);
+        writeValue<std::uint32_t>(file, indexed.frameCount);
+    }
+
+    writeValue<std::uint64_t>(file, m_postingCount);
+    file.write(reinterpret_cast<const char*>(&directory[0]), directory.size() * sizeof(std::uint64_t));
+    file.write(reinterpret_cast<const char*>(postings), static_cast<std::streamsize>(m_postingCount * sizeof(Posting)));
+
+    file.close();
+    if (file.fail())
+    {
+        std::cout << "Could not write the index " << filename << "." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool FingerprintIndexer::fingerprint(std::shared_ptr<const sf::SoundBuffer> soundBuffer, std::vector<Fingerprinter::Landmark>& landmarks)
+{
+    landmarks.clear();
+    float sampleRate = 0.f;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        sampleRate = m_sampleRate;
+    }
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    unsigned int finishedCount = 0;
+
+    std::vector<std::unique_ptr<Spectrogram>> spectrograms;
+    const unsigned int channelCount = soundBuffer->getChannelCount();
+    for (unsigned int shift = 0; shift < queryShifts; ++shift)
+    {
+        std::shared_ptr<const sf::SoundBuffer> shifted = soundBuffer;
+        if (shift > 0)
+        {
+            // the frames are apart by a time, the decimation for the highest frequency changes their length in samples
+            const std::size_t offset = static_cast<std::size_t>(shift * soundBuffer->getSampleRate() / (queryShifts * spectrograms[0]->getFramesPerSecond())) * channelCount;
+            if (offset >= soundBuffer->getSampleCount())
+                break;
+
+            std::shared_ptr<sf::SoundBuffer> copy = std::make_shared<sf::SoundBuffer>();
+            copy->loadFromSamples(soundBuffer->getSamples() + offset, soundBuffer->getSampleCount() - offset, channelCount, soundBuffer->getSampleRate());
+            shifted = copy;
+        }
+
+        spectrograms.emplace_back(new Spectrogram(shifted, m_settings, m_cache));
+        if (shift == 0 && sampleRate > 0.f && spectrograms[0]->getSampleRate() != sampleRate)
+        {
+            std::cout << "The clip has a sample rate of " << spectrograms[0]->getSampleRate() << " Hz after the decimation, the index has "
+                      << sampleRate << " Hz." << std::endl;
+            return false;
+        }
+        spectrograms.back()->setFrameSink(std::unique_ptr<FrameSink>(new Fingerprinter([&] (std::vector<Fingerprinter::Landmark>& found)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            landmarks.insert(landmarks.end(), found.begin(), found.end());
+            ++finishedCount;
+            finished.notify_all();
+        })));
+
+        // a query is waited for, it goes before the files that are indexed
+        spectrograms.back()->setPriority(ThreadPool::Priority::High);
+        spectrograms.back()->generate(m_pool);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return finishedCount == spectrograms.size(); });
+    return true;
+}
+
+
+FingerprintIndexer::Statistics FingerprintIndexer::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Statistics statistics;
+    statistics.files = static_cast<unsigned int>(m_files.size());
+    statistics.duration = m_duration;
+    statistics.landmarks = m_postingCount;
+    statistics.elapsed = m_clock.getElapsedTime();
+    return statistics;
+}
+
+
+std::unique_ptr<FrameSink> FingerprintIndexer::createSink(const std::string& name, const Spectrogram& spectrogram)
+{
+    std::uint32_t file = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // the landmarks of another sample rate have other bins and frames, they would never match
+        if (m_sampleRate == 0.f)
+            m_sampleRate = spectrogram.getSampleRate();
+        if (spectrogram.getSampleRate() != m_sampleRate)
+        {
+            std::cout << name << " has a sample rate of " << spectrogram.getSampleRate() << " Hz after the decimation, the index has "
+                      << m_sampleRate << " Hz, it is not indexed." << std::endl;
+            return std::unique_ptr<FrameSink>();
+        }
+
+        file = static_cast<std::uint32_t>(m_files.size());
+
+        FingerprintIndex::File indexed;
+        indexed.name = name;
+        indexed.framesPerSecond = spectrogram.getFramesPerSecond();
+        indexed.frameCount = spectrogram.getFrameCount();
+        m_files.push_back(indexed);
+        m_duration += spectrogram.getDuration();
+    }
+
+    return std::unique_ptr<FrameSink>(new Fingerprinter([this, file] (std::vector<Fingerprinter::Landmark>& landmarks)
+    {
+        addPostings(file, landmarks);
+    }));
+}
+
+
+void FingerprintIndexer::addPostings(std::uint32_t file, const std::vector<Fingerprinter::Landmark>& landmarks)
+{
+    std::vector<FingerprintIndex::Posting> postings(landmarks.size());
+    for (std::size_t i = 0; i < landmarks.size(); ++i)
+    {
+        postings[i].hash = landmarks[i].hash;
+        postings[i].file = file;
+        postings[i].frame = landmarks[i].frame;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_hasFailed || postings.empty())
+        return;
+
+    if (std::fwrite(&postings[0], sizeof(FingerprintIndex::Posting), postings.size(), m_postings.get()) != postings.size())
+    {
+        m_hasFailed = true;
+        return;
+    }
+
+    for (const FingerprintIndex::Posting& posting : postings)
+        ++m_bucketSizes[bucketOf(posting.hash)];
+    m_postingCount += postings.size();
+}
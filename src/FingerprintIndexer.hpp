@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_FINGERPRINTINDEXER_HPP
+#define FFTSPECTRUM_FINGERPRINTINDEXER_HPP
+
+#include "BatchGenerator.hpp"
+#include "FingerprintIndex.hpp"
+#include "ResourceCache.hpp"
+#include "Settings.hpp"
+#include "ThreadPool.hpp"
+
+#include <SFML/Audio/SoundBuffer.hpp>
+#include <SFML/System/Clock.hpp>
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+class Spectrogram;
+
+/**
+ * @brief The FingerprintIndexer class fingerprints a library of sounds and writes the
+ *        FingerprintIndex of them. The sounds are generated by a BatchGenerator with a
+ *        Fingerprinter as their sink.
+ *
+ *        The landmarks of a finished file are appended to a temporary file as postings and
+ *        counted per bucket. write() sorts them into their buckets in a ScratchFile, so the
+ *        library can have more postings than fit into the memory.
+ */
+class FingerprintIndexer
+{
+public:
+    struct Statistics
+    {
+        unsigned int    files;
+        sf::Time        duration;   ///< of the sounds that were fingerprinted
+        std::uint64_t   landmarks;
+        sf::Time        elapsed;    ///< since the indexer was created
+    };
+
+    static const unsigned int queryShifts = 4;
+
+    /**
+     * @param settings      The FFT size, the highest frequency, the storage and the memory limit, the mode is always STFT
+     * @param sampleRate    The sample rate after the decimation that every sound must have, the bins and
+     *                      frames of the landmarks depend on it. 0 takes the one of the first file.
+     */
+    FingerprintIndexer(const Settings& settings, ThreadPool& pool, float sampleRate = 0.f);
+
+    /**
+     * @brief Starts to fingerprint a file. Blocks while too many files are in flight.
+     *
+     * @return false if the file can't be opened
+     */
+    bool                addFile(const std::string& filename);
+
+    /**
+     * @brief Starts to fingerprint a sound that is loaded already. Blocks while too many files are in flight.
+     */
+    void                addSound(const std::string& name, std::shared_ptr<const sf::SoundBuffer> soundBuffer);
+
+    /**
+     * @brief Waits for all files and writes the index.
+     *
+     * @return false if the index could not be written
+     */
+    bool                write(const std::string& filename);
+
+    /**
+     * @brief Fingerprints a clip with the settings of the index and waits for it. A clip doesn't
+     *        start on a frame of the file it was cut from, and frames that are half a frame off
+     *        don't have the same peaks, so the clip is transformed from queryShifts starts within
+     *        the first frame. The landmarks of all of them are returned together.
+     *
+     * @return false if the clip has another sample rate after the decimation than the sounds
+     */
+    bool                fingerprint(std::shared_ptr<const sf::SoundBuffer> soundBuffer, std::vector<Fingerprinter::Landmark>& landmarks);
+
+    Statistics          getStatistics() const;
+
+private:
+    FingerprintIndexer(const FingerprintIndexer&);
+    FingerprintIndexer& operator=(const FingerprintIndexer&);
+
+    /**
+     * @brief Adds the file to the index and creates the Fingerprinter of its spectrogram.
+     */
+    std::unique_ptr<FrameSink> createSink(const std::string& name, const Spectrogram& spectrogram);
+
+    /**
+     * @brief Appends the landmarks of a file to the postings, is called from the thread pool.
+     */
+    void                addPostings(std::uint32_t file, const std::vector<Fingerprinter::Landmark>& landmarks);
+
+    Settings                        m_settings;
+    ThreadPool&                     m_pool;
+    ResourceCache                   m_cache;
+    std::vector<FingerprintIndex::File> m_files;
+    std::vector<std::uint64_t>      m_bucketSizes;
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> m_postings;  // the temporary file of the unsorted postings
+    std::uint64_t                   m_postingCount;
+    float                           m_sampleRate;   // of every sound after the decimation, 0 until the first file
+    bool                            m_hasFailed;    // the postings could not be written
+    sf::Time                        m_duration;
+    sf::Clock                       m_clock;
+    mutable std::mutex              m_mutex;
+    BatchGenerator                  m_batch;        // last, the files in flight are cancelled before the rest is destroyed
+};
+
+#endif //FFTSPECTRUM_FINGERPRINTINDEXER_HPP
@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "Fingerprinter.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+
+namespace
+{
+    // the landmarks that were seen last, by hash
+    const std::size_t recentSize = 4096;
+}
+
+
+// std::min takes it by reference, so it needs a definition
+const unsigned int Fingerprinter::peaksPerFrame;
+
+
+Fingerprinter::Fingerprinter(Listener listener) :
+    m_listener(listener),
+    m_binCount(0),
+    m_binShift(0),
+    m_frameCount(0),
+    m_pairedFrames(0)
+{
+
+}
+
+
+bool Fingerprinter::begin(const Description& description)
+{
+    reset(description.binCount);
+    return true;
+}
+
+
+bool Fingerprinter::write(const float* frame)
+{
+    // the sink gets dB, the peaks are found in log10 magnitudes like everywhere else
+    for (unsigned int k = 0; k < m_binCount; ++k)
+        m_levels[k] = frame[k] / 20.f;
+    addFrame(&m_levels[0]);
+    return true;
+}
+
+
+bool Fingerprinter::finish()
+{
+    flush();
+    if (m_listener)
+        m_listener(m_landmarks);
+    return true;
+}
+
+
+void Fingerprinter::reset(unsigned int binCount)
+{
+    m_binCount = binCount;
+    m_binShift = 0;
+    while (m_binCount > 0 && ((m_binCount - 1) >> m_binShift) >= 4096)
+        ++m_binShift;
+
+    m_frames.assign(zoneFrames + 1, FramePeaks());
+    m_levels.assign(binCount, 0.f);
+    m_recent.assign(recentSize, Landmark());
+    m_landmarks.clear();
+    m_frameCount = 0;
+    m_pairedFrames = 0;
+}
+
+
+void Fingerprinter::addFrame(const float* levels)
+{
+    PeakTracker::Peak peaks[PeakTracker::maxPeaksPerFrame];
+    const unsigned int peakCount = PeakTracker::findPeaks(levels, m_binCount, peaks);
+
+    FramePeaks& frame = m_frames[m_frameCount % m_frames.size()];
+    frame.count = std::min(peakCount, peaksPerFrame);
+    for (unsigned int i = 0; i < frame.count; ++i)
+        frame.bins[i] = static_cast<int>(peaks[i].bin + 0.5f);
+    ++m_frameCount;
+
+    // the zone of a frame is complete zoneFrames frames later
+    for (; m_pairedFrames + zoneFrames < m_frameCount; ++m_pairedFrames)
+        pairPeaks(m_pairedFrames);
+}
+
+
+void Fingerprinter::flush()
+{
+    for (; m_pairedFrames < m_frameCount; ++m_pairedFrames)
+        pairPeaks(m_pairedFrames);
+}
+
+
+const std::vector<Fingerprinter::Landmark>& Fingerprinter::getLandmarks() const
+{
+    return m_landmarks;
+}
+
+
+void Fingerprinter::pairPeaks(unsigned int frame)
+{
+    const FramePeaks& anchors = m_frames[frame % m_frames.size()];
+    for (unsigned int i = 0; i < anchors.count; ++i)
+    {
+        const int bin = anchors.bins[i];
+        unsigned int pairs = 0;
+        for (unsigned int distance = 1; distance <= zoneFrames && frame + distance < m_frameCount && pairs < fanOut; ++distance)
+        {
+            // the peaks of a frame are sorted from the strongest on
+            const FramePeaks& targets = m_frames[(frame + distance) % m_frames.size()];
+            for (unsigned int j = 0; j < targets.count && pairs < fanOut; ++j)
+            {
+                const int binDistance = targets.bins[j] - bin;
+                if (std::abs(binDistance) > zoneBins)
+                    continue;
+
+                // a steady tone gives the same landmark in every frame, it would match at every offset
+                const std::uint32_t landmarkHash = hash(bin, binDistance, distance);
+                Landmark& recent = m_recent[landmarkHash % m_recent.size()];
+                const bool isRepeated = recent.frame > 0 && recent.hash == landmarkHash && frame < recent.frame + zoneFrames;
+                recent.hash = landmarkHash;
+                recent.frame = frame + 1;
+                ++pairs;
+                if (isRepeated)
+                    continue;
+
+                Landmark landmark;
+                landmark.hash = landmarkHash;
+                landmark.frame = frame;
+                m_landmarks.push_back(landmark);
+            }
+        }
+    }
+}
+
+
+std::uint32_t Fingerprinter::hash(int bin, int binDistance, unsigned int frameDistance) const
+{
+    // 12 bits of the bin, 7 bits of the bin distance and 5 bits of the frame distance
+    std::uint32_t key = (static_cast<std::uint32_t>(bin) >> m_binShift) << 12;
+    key |= static_cast<std::uint32_t>(binDistance + zoneBins + 1) << 5;
+    key |= frameDistance - 1;
+
+    // spread the keys over all bits, the index is bucketed by the top ones (both steps can be undone, so keys don't collide)
+    key *= 0x9E3779B1u;
+    return key ^ (key >> 16);
+}
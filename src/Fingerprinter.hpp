@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_FINGERPRINTER_HPP
+#define FFTSPECTRUM_FINGERPRINTER_HPP
+
+#include "FrameSink.hpp"
+#include "PeakTracker.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief The Fingerprinter class turns the frames of a spectrogram into landmarks. A landmark
+ *        is a pair of spectral peaks that are close in time and frequency: the strongest peaks
+ *        of a frame are paired with the first peaks in a zone of the following frames. Its hash
+ *        holds the bin of the first peak and the distance to the second one in bins and frames,
+ *        which neither the level of the sound nor other sounds on top of it change as long as
+ *        the two peaks survive. A clip is found again by the landmarks that agree on the offset.
+ *        A steady tone gives the same landmarks in every frame, they would agree on any offset,
+ *        so a landmark that was seen in the last zoneFrames frames is left out.
+ *
+ *        It is a FrameSink, so the landmarks are extracted in the export pass while the
+ *        spectrogram is generated. The peaks of a frame are paired once the frames of their
+ *        zone have arrived, the pairs of the last frames are made by finish().
+ */
+class Fingerprinter : public FrameSink
+{
+public:
+    struct Landmark
+    {
+        std::uint32_t   hash;
+        std::uint32_t   frame;      ///< of the first peak
+    };
+
+    typedef std::function<void(std::vector<Landmark>& landmarks)> Listener;
+
+    static const unsigned int peaksPerFrame = 3;    ///< the strongest peaks of a frame are paired
+    static const unsigned int fanOut = 4;           ///< pairs per peak
+    static const unsigned int zoneFrames = 32;      ///< the pairs are at most this many frames apart
+    static const int          zoneBins = 63;        ///< and at most this many bins
+
+    /**
+     * @param listener Receives the landmarks of the whole sound in finish(), may be empty
+     */
+    explicit Fingerprinter(Listener listener = Listener());
+
+    virtual bool    begin(const Description& description);
+
+    virtual bool    write(const float* frame);
+
+    virtual bool    finish();
+
+    /**
+     * @brief Adds the next frame of log10 magnitudes, after begin() or reset().
+     */
+    void            addFrame(const float* levels);
+
+    /**
+     * @brief Starts over with frames of binCount bins.
+     */
+    void            reset(unsigned int binCount);
+
+    /**
+     * @brief Pairs the peaks of the last frames, nothing can be added after it.
+     */
+    void            flush();
+
+    const std::vector<Landmark>& getLandmarks() const;
+
+private:
+    struct FramePeaks
+    {
+        unsigned int    count;
+        int             bins[peaksPerFrame];
+    };
+
+    /**
+     * @brief Pairs the peaks of a frame with the peaks of the frames after it, up to the last one added.
+     */
+    void            pairPeaks(unsigned int frame);
+
+    std::uint32_t   hash(int bin, int binDistance, unsigned int frameDistance) const;
+
+    Listener                    m_listener;
+    std::vector<FramePeaks>     m_frames;       // ring of the last zoneFrames + 1 frames
+    std::vector<float>          m_levels;       // of the frame being added
+    std::vector<Landmark>       m_landmarks;
+    std::vector<Landmark>       m_recent;       // the frame after the one where a hash was seen last, 0 if none
+    unsigned int                m_binCount;
+    unsigned int                m_binShift;     // the bin of the first peak is kept in 12 bits
+    unsigned int                m_frameCount;
+    unsigned int                m_pairedFrames;
+};
+
+#endif //FFTSPECTRUM_FINGERPRINTER_HPP
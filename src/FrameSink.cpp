@@ -0,0 +1,39 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "FrameSink.hpp"
+#include "NpyWriter.hpp"
+#include "ChunkedWriter.hpp"
+
+
+std::unique_ptr<FrameSink> FrameSink::create(const std::string& format, const std::string& filename)
+{
+    if (format == "npy")
+        return std::unique_ptr<FrameSink>(new NpyWriter(filename + ".npy"));
+    if (format == "chunked")
+        return std::unique_ptr<FrameSink>(new ChunkedWriter(filename + ".fspc"));
+    return nullptr;
+}
+
+
+bool FrameSink::isKnownFormat(const std::string& format)
+{
+    return format == "none" || format == "npy" || format == "chunked";
+}
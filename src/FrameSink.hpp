@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_FRAMESINK_HPP
+#define FFTSPECTRUM_FRAMESINK_HPP
+
+#include <memory>
+#include <string>
+
+/**
+ * @brief A FrameSink receives the magnitudes of a spectrogram frame by frame, in order,
+ *        while it is generated. It is used to export the data without keeping a second
+ *        copy of it. The frames are in dB (20 * log10(magnitude / 100), the floor is about -138 dB).
+ */
+class FrameSink
+{
+public:
+    struct Description
+    {
+        unsigned int    frameCount;
+        unsigned int    binCount;
+        unsigned int    FFTSize;
+        float           sampleRate;     ///< of the transformed samples
+        unsigned int    hopSize;        ///< the frames are this many samples apart, FFTSize / 2 unless the window is shorter
+        float           binWidth;       ///< in Hz, bin k is at k * binWidth
+    };
+
+    virtual ~FrameSink() {}
+
+    /**
+     * @brief Is called once before the first frame.
+     *
+     * @return false if the sink can't be written, no further calls will be made
+     */
+    virtual bool    begin(const Description& description) = 0;
+
+    /**
+     * @brief Is called for every frame in order.
+     *
+     * @param frame binCount values in dB
+     *
+     * @return false on a write error, no further calls will be made
+     */
+    virtual bool    write(const float* frame) = 0;
+
+    /**
+     * @brief Is called after the last frame.
+     *
+     * @return false on a write error
+     */
+    virtual bool    finish() = 0;
+
+    /**
+     * @brief Creates the sink for an export format of the settings file.
+     *
+     * @param format    "npy" or "chunked"
+     * @param filename  The name of the sound, the extension of the format is appended
+     *
+     * @return null for "none" or an unknown format
+     */
+    static std::unique_ptr<FrameSink> create(const std::string& format, const std::string& filename);
+
+    /**
+     * @brief Returns true if the format can be passed to create(), or is "none".
+     */
+    static bool     isKnownFormat(const std::string& format);
+};
+
+#endif //FFTSPECTRUM_FRAMESINK_HPP
@@ -0,0 +1,217 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+// Measures how fast the fingerprint index of a library is built and how long it takes to
+// find a clip in it. The library is made of random segments of the bundled sounds, played
+// at random speeds, so run it from the rundirectory. Build it with -D BUILD_BENCHMARK=ON,
+// the argument is the number of files (100 by default). It returns 1 if less than 80 percent
+// of the noisy clips are found at the right place. The files share their material, so some
+// clips are found in a file that has the same segment.
+
+#include "FingerprintIndexer.hpp"
+
+#include <SFML/Audio/InputSoundFile.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    const unsigned int sampleRate = 44100;
+    const float fileSeconds = 30.f;
+    const float clipSeconds = 5.f;
+    const unsigned int queryCount = 50;
+    const float signalToNoise = 15.f;   // in dB, of the clips
+    const char* const indexFilename = "IndexBenchmark.fpi";
+
+
+    // the sound mixed down to mono, in -1 to 1
+    bool loadSource(const std::string& filename, std::vector<float>& samples)
+    {
+        sf::InputSoundFile file;
+        if (!file.openFromFile(filename))
+            return false;
+
+        std::vector<sf::Int16> interleaved(static_cast<std::size_t>(file.getSampleCount()));
+        interleaved.resize(static_cast<std::size_t>(file.read(interleaved.data(), interleaved.size())));
+
+        const unsigned int channelCount = std::max(file.getChannelCount(), 1u);
+        samples.assign(interleaved.size() / channelCount, 0.f);
+        for (std::size_t i = 0; i < samples.size(); ++i)
+        {
+            for (unsigned int channel = 0; channel < channelCount; ++channel)
+                samples[i] += interleaved[i * channelCount + channel];
+            samples[i] /= 32768.f * channelCount;
+        }
+        return !samples.empty();
+    }
+
+
+    // segments of 1 to 4 seconds, from anywhere in a random source, 0.8 to 1.25 times as fast
+    std::vector<float> makeFile(const std::vector<std::vector<float>>& sources, std::mt19937& generator)
+    {
+        std::uniform_int_distribution<std::size_t> sourceDistribution(0, sources.size() - 1);
+        std::uniform_real_distribution<float> lengthDistribution(1.f, 4.f);
+        std::uniform_real_distribution<float> speedDistribution(std::log(0.8f), std::log(1.25f));
+        std::uniform_real_distribution<float> gainDistribution(0.3f, 1.f);
+        std::normal_distribution<float> noise(0.f, 0.003f);
+
+        std::vector<float> file(static_cast<std::size_t>(fileSeconds * sampleRate));
+        for (std::size_t first = 0; first < file.size();)
+        {
+            const std::vector<float>& source = sources[sourceDistribution(generator)];
+            const std::size_t last = std::min(file.size(), first + static_cast<std::size_t>(lengthDistribution(generator) * sampleRate));
+            const double speed = std::exp(speedDistribution(generator));
+            const float gain = gainDistribution(generator);
+
+            double position = std::uniform_real_distribution<double>(0.0, static_cast<double>(source.size()))(generator);
+            for (std::size_t i = first; i < last; ++i, position += speed)
+            {
+                // short sources are repeated
+                const std::size_t index = static_cast<std::size_t>(position) % source.size();
+                const float fraction = static_cast<float>(position - std::floor(position));
+                const float sample = source[index] + fraction * (source[(index + 1) % source.size()] - source[index]);
+                file[i] = gain * sample + noise(generator);
+            }
+            first = last;
+        }
+        return file;
+    }
+
+
+    std::shared_ptr<const sf::SoundBuffer> toSoundBuffer(const std::vector<float>& samples)
+    {
+        std::vector<sf::Int16> converted(samples.size());
+        for (std::size_t i = 0; i < samples.size(); ++i)
+            converted[i] = static_cast<sf::Int16>(std::max(-32767.f, std::min(32767.f, samples[i] * 32767.f)));
+
+        std::shared_ptr<sf::SoundBuffer> soundBuffer = std::make_shared<sf::SoundBuffer>();
+        soundBuffer->loadFromSamples(converted.data(), converted.size(), 1, sampleRate);
+        return soundBuffer;
+    }
+
+
+    double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    const unsigned int fileCount = (argc > 1) ? std::max(std::atoi(argv[1]), 1) : 100;
+
+    std::vector<std::vector<float>> sources;
+    for (const char* name : {"Mandelbrot.wav", "wobbly-sweep.flac", "440Hz.wav", "1000Hz.wav"})
+    {
+        std::vector<float> samples;
+        if (loadSource(name, samples))
+            sources.push_back(samples);
+    }
+    if (sources.empty())
+    {
+        std::cout << "None of the bundled sounds was found, run the benchmark from the rundirectory." << std::endl;
+        return 1;
+    }
+
+    std::mt19937 generator(1);
+    std::vector<std::vector<float>> files;
+    for (unsigned int i = 0; i < fileCount; ++i)
+        files.push_back(makeFile(sources, generator));
+
+    // the index is built with the default settings
+    Settings settings;
+    ThreadPool pool(settings.threads);
+    FingerprintIndexer indexer(settings, pool);
+
+    const auto buildStart = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < fileCount; ++i)
+        indexer.addSound("file" + std::to_string(i), toSoundBuffer(files[i]));
+    if (!indexer.write(indexFilename))
+        return 1;
+    const double buildSeconds = secondsSince(buildStart);
+
+    const FingerprintIndexer::Statistics statistics = indexer.getStatistics();
+    std::ifstream written(indexFilename, std::ios::binary | std::ios::ate);
+    const double indexMegabytes = static_cast<double>(written.tellg()) / (1024 * 1024);
+    written.close();
+
+    std::cout << "Indexed " << statistics.files << " files (" << std::fixed << std::setprecision(1)
+              << statistics.duration.asSeconds() / 60 << " min) on " << pool.getThreadCount() << " threads in "
+              << buildSeconds << " s, " << std::setprecision(0) << statistics.duration.asSeconds() / buildSeconds
+              << " x real time" << std::endl;
+    std::cout << statistics.landmarks << " landmarks, " << statistics.landmarks / statistics.duration.asSeconds()
+              << " per second of sound, the index has " << std::setprecision(1) << indexMegabytes << " MB" << std::endl;
+
+    FingerprintIndex index;
+    if (!index.open(indexFilename))
+        return 1;
+
+    // the clips are taken from a random place of a random file, with noise on top
+    std::uniform_int_distribution<unsigned int> fileDistribution(0, fileCount - 1);
+    std::uniform_real_distribution<float> startDistribution(0.f, fileSeconds - clipSeconds);
+    std::vector<double> latencies;
+    unsigned int found = 0;
+    for (unsigned int query = 0; query < queryCount; ++query)
+    {
+        const unsigned int file = fileDistribution(generator);
+        const std::size_t first = static_cast<std::size_t>(startDistribution(generator) * sampleRate);
+        std::vector<float> clip(files[file].begin() + first, files[file].begin() + first + static_cast<std::size_t>(clipSeconds * sampleRate));
+
+        double power = 0;
+        for (float sample : clip)
+            power += sample * sample;
+        std::normal_distribution<float> noise(0.f, static_cast<float>(std::sqrt(power / clip.size() / std::pow(10.0, signalToNoise / 10))));
+        for (float& sample : clip)
+            sample = 0.5f * sample + 0.5f * noise(generator);
+        const std::shared_ptr<const sf::SoundBuffer> soundBuffer = toSoundBuffer(clip);
+
+        const auto queryStart = std::chrono::steady_clock::now();
+        std::vector<Fingerprinter::Landmark> landmarks;
+        if (!indexer.fingerprint(soundBuffer, landmarks))
+            return 1;
+        const std::vector<FingerprintIndex::Match> matches = index.query(landmarks, 1);
+        latencies.push_back(secondsSince(queryStart) * 1000);
+
+        // the frames are 11.6 ms apart, the offset can be one off
+        if (!matches.empty() && matches[0].file == file && std::abs(matches[0].offset.asSeconds() - static_cast<float>(first) / sampleRate) < 0.03f)
+            ++found;
+    }
+    std::remove(indexFilename);
+
+    std::sort(latencies.begin(), latencies.end());
+    const float hitRate = 100.f * found / queryCount;
+    std::cout << "Found " << found << " of " << queryCount << " clips of " << std::setprecision(0) << clipSeconds << " s at "
+              << signalToNoise << " dB SNR (" << hitRate << " %), the query took " << std::setprecision(1)
+              << latencies[latencies.size() / 2] << " ms (median), " << latencies[latencies.size() * 95 / 100]
+              << " ms (95 %), " << latencies.back() << " ms (max)" << std::endl;
+
+    return (hitRate >= 80.f) ? 0 : 1;
+}
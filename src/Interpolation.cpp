@@ -91,3 +91,10 @@ float linearInterpolation(float start, float end, float amount)
 }
 
 
+sf::Color magnitudeColor(float amount)
+{
+    const float hue = std::fmod(linearInterpolation(210.f, 460.f, amount), 360.f);
+    return HSLtoRGB(hue, 1.f, amount);
+}
+
+
@@ -63,4 +63,13 @@ sf::Color HSLtoRGB (float hue, float saturation, float lightness);
  */
 float linearInterpolation(float start, float end, float amount);
 
+/**
+ * @brief The colors of the spectrogram, sunset (white-yellow-red-pink-blue-black).
+ *        It interpolates the hue in range 210 (blue) to 100 (yellow/greenish) with a
+ *        wrap around, and the lightness with the magnitude.
+ *
+ * @param amount The normalized magnitude in range [0, 1]
+ */
+sf::Color magnitudeColor(float amount);
+
 #endif //FFTSPECTRUM_INTERPOLATION_HPP
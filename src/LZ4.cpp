@@ -0,0 +1,202 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "LZ4.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+
+namespace
+{
+    const std::size_t minimumMatch   = 4;
+    const std::size_t lastLiterals   = 5;   // the last bytes of a block are always literals
+    const std::size_t matchStartLimit = 12; // the last match has to start this far before the end
+    const std::size_t maximumOffset  = 65535;
+    const unsigned int hashBits      = 12;
+
+    std::uint32_t read32(const std::uint8_t* data)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    std::uint32_t hash(std::uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - hashBits);
+    }
+
+    // lengths of 15 and more continue in bytes of 255
+    std::uint8_t* writeLength(std::uint8_t* output, std::size_t length)
+    {
+        while (length >= 255)
+        {
+            *output++ = 255;
+            length -= 255;
+        }
+        *output++ = static_cast<std::uint8_t>(length);
+        return output;
+    }
+
+    std::uint8_t* writeSequence(std::uint8_t* output, const std::uint8_t* literals, std::size_t literalLength,
+                                std::size_t offset, std::size_t matchLength)
+    {
+        std::uint8_t* token = output++;
+        *token = static_cast<std::uint8_t>(std::min<std::size_t>(literalLength, 15) << 4);
+        if (literalLength >= 15)
+            output = writeLength(output, literalLength - 15);
+        if (literalLength > 0)
+            std::memcpy(output, literals, literalLength);
+        output += literalLength;
+
+        // the last sequence has no match
+        if (matchLength == 0)
+            return output;
+
+        *output++ = static_cast<std::uint8_t>(offset & 0xFF);
+        *output++ = static_cast<std::uint8_t>(offset >> 8);
+
+        const std::size_t length = matchLength - minimumMatch;
+        *token |= static_cast<std::uint8_t>(std::min<std::size_t>(length, 15));
+        if (length >= 15)
+            output = writeLength(output, length - 15);
+        return output;
+    }
+
+    bool readLength(const std::uint8_t*& input, const std::uint8_t* end, std::size_t& length)
+    {
+        std::uint8_t byte;
+        do
+        {
+            if (input >= end)
+                return false;
+            byte = *input++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+}
+
+
+namespace lz4
+{
+    std::size_t compressBound(std::size_t size)
+    {
+        return size + size / 255 + 16;
+    }
+
+
+    std::size_t compress(const std::uint8_t* input, std::size_t size, std::uint8_t* output)
+    {
+        std::uint8_t* out = output;
+        std::size_t anchor = 0;   // the first literal that isn't written yet
+
+        if (size > matchStartLimit)
+        {
+            // positions + 1, so 0 means empty
+            std::vector<std::uint32_t> table(std::size_t(1) << hashBits, 0);
+            const std::size_t matchEndLimit = size - lastLiterals;
+            const std::size_t searchLimit = size - matchStartLimit;
+
+            std::size_t position = 0;
+            while (position <= searchLimit)
+            {
+                const std::uint32_t sequence = read32(input + position);
+                const std::uint32_t h = hash(sequence);
+                const std::size_t candidate = table[h];
+                table[h] = static_cast<std::uint32_t>(position + 1);
+
+                if (candidate == 0 || position - (candidate - 1) > maximumOffset || read32(input + candidate - 1) != sequence)
+                {
+                    ++position;
+                    continue;
+                }
+
+                std::size_t reference = candidate - 1;
+
+                // extend the match backwards into the literals and forwards as far as allowed
+                while (position > anchor && reference > 0 && input[position - 1] == input[reference - 1])
+                {
+                    --position;
+                    --reference;
+                }
+                std::size_t length = minimumMatch;
+                while (position + length < matchEndLimit && input[position + length] == input[reference + length])
+                    ++length;
+
+                out = writeSequence(out, input + anchor, position - anchor, position - reference, length);
+                position += length;
+                anchor = position;
+            }
+        }
+
+        out = writeSequence(out, input + anchor, size - anchor, 0, 0);
+        return static_cast<std::size_t>(out - output);
+    }
+
+
+    bool decompress(const std::uint8_t* input, std::size_t size, std::uint8_t* output, std::size_t outputSize)
+    {
+        const std::uint8_t* in = input;
+        const std::uint8_t* inEnd = input + size;
+        std::size_t written = 0;
+
+        while (in < inEnd)
+        {
+            const std::uint8_t token = *in++;
+
+            std::size_t literalLength = token >> 4;
+            if (literalLength == 15 && !readLength(in, inEnd, literalLength))
+                return false;
+            if (literalLength > static_cast<std::size_t>(inEnd - in) || literalLength > outputSize - written)
+                return false;
+            if (literalLength > 0)
+                std::memcpy(output + written, in, literalLength);
+            in += literalLength;
+            written += literalLength;
+
+            // the last sequence ends after the literals
+            if (in == inEnd)
+                break;
+
+            if (inEnd - in < 2)
+                return false;
+            const std::size_t offset = in[0] | (in[1] << 8);
+            in += 2;
+            if (offset == 0 || offset > written)
+                return false;
+
+            std::size_t matchLength = token & 0x0F;
+            if (matchLength == 15 && !readLength(in, inEnd, matchLength))
+                return false;
+            matchLength += minimumMatch;
+            if (matchLength > outputSize - written)
+                return false;
+
+            // the match can overlap the output, so copy byte by byte
+            for (std::size_t i = 0; i < matchLength; ++i, ++written)
+                output[written] = output[written - offset];
+        }
+
+        return written == outputSize;
+    }
+}
@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_LZ4_HPP
+#define FFTSPECTRUM_LZ4_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief A compressor and decompressor for the LZ4 block format
+ *        (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md).
+ *        The output can be read by any LZ4 implementation (LZ4_decompress_safe).
+ *        The compressor is a simple greedy one with a hash table of 4096 entries.
+ */
+namespace lz4
+{
+    /**
+     * @brief Returns the largest possible size of the compressed data.
+     */
+    std::size_t compressBound(std::size_t size);
+
+    /**
+     * @brief Compresses a block.
+     *
+     * @param input     The data
+     * @param size      The size of the data in bytes
+     * @param output    Space for at least compressBound(size) bytes
+     *
+     * @return The size of the compressed block
+     */
+    std::size_t compress(const std::uint8_t* input, std::size_t size, std::uint8_t* output);
+
+    /**
+     * @brief Decompresses a block.
+     *
+     * @param input         The compressed block
+     * @param size          The size of the compressed block
+     * @param output        Receives the data
+     * @param outputSize    The size of the data
+     *
+     * @return false if the block is corrupt or doesn't decompress to exactly outputSize bytes
+     */
+    bool        decompress(const std::uint8_t* input, std::size_t size, std::uint8_t* output, std::size_t outputSize);
+}
+
+#endif //FFTSPECTRUM_LZ4_HPP
@@ -0,0 +1,382 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "LargeFFT.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+
+
+namespace
+{
+    const long double pi = 3.141592653589793238462643383279502884L;
+
+    // a block of a pass holds about this many complex values, with its two arrays a few hundred KB
+    const unsigned int blockValues = 1 << 14;
+
+    // but at least this many neighbouring columns, so every gathered piece fills a cache line
+    const unsigned int minimumBlockWidth = 8;
+
+    unsigned int log2(unsigned int powerOf2)
+    {
+        unsigned int bits = 0;
+        while ((1u << bits) < powerOf2)
+            ++bits;
+        return bits;
+    }
+
+
+    /**
+     * @brief Computes a complex transform from the real transforms of the real and the imaginary part.
+     *        The bins above length / 2 follow from the symmetry of a real transform. The output may
+     *        be the input.
+     */
+    void transformComplex(FFT& realFFT, FFT& imagFFT, const FFT::Scalar* real, const FFT::Scalar* imag,
+                          FFT::Scalar* outputReal, FFT::Scalar* outputImag, unsigned int length)
+    {
+        realFFT.process(real);
+        imagFFT.process(imag);
+
+        const std::vector<FFT::Scalar>& realOfReal = realFFT.realPart();
+        const std::vector<FFT::Scalar>& imagOfReal = realFFT.imagPart();
+        const std::vector<FFT::Scalar>& realOfImag = imagFFT.realPart();
+        const std::vector<FFT::Scalar>& imagOfImag = imagFFT.imagPart();
+
+        const unsigned int half = length / 2;
+        for (unsigned int k = 0; k <= half; ++k)
+        {
+            outputReal[k] = realOfReal[k] - imagOfImag[k];
+            outputImag[k] = imagOfReal[k] + realOfImag[k];
+        }
+        for (unsigned int k = half + 1; k < length; ++k)
+        {
+            // the conjugates of the mirrored bins
+            const unsigned int mirrored = length - k;
+            outputReal[k] = realOfReal[mirrored] + imagOfImag[mirrored];
+            outputImag[k] = realOfImag[mirrored] - imagOfReal[mirrored];
+        }
+    }
+}
+
+
+/**
+ * @brief Hands out the blocks of a pass and counts the finished ones.
+ */
+class LargeFFT::BlockQueue
+{
+public:
+    explicit BlockQueue(unsigned int blockCount) :
+        m_nextBlock(0),
+        m_blockCount(blockCount),
+        m_finishedBlocks(0)
+    {
+
+    }
+
+    bool take(unsigned int& block)
+    {
+        block = m_nextBlock++;
+        return block < m_blockCount;
+    }
+
+    void finish()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (++m_finishedBlocks == m_blockCount)
+            m_allFinished.notify_all();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_allFinished.wait(lock, [this] { return m_finishedBlocks == m_blockCount; });
+    }
+
+private:
+    std::atomic<unsigned int>   m_nextBlock;
+    const unsigned int          m_blockCount;
+    unsigned int                m_finishedBlocks;   // guarded by m_mutex
+    std::mutex                  m_mutex;
+    std::condition_variable     m_allFinished;
+};
+
+
+LargeFFT::Twiddles::Twiddles(unsigned int length) :
+    m_lowBits(log2(length) / 2)
+{
+    // exp(-2 pi i e / length) = exp(-2 pi i low / length) * exp(-2 pi i high * 2^lowBits / length)
+    const unsigned int lowCount = 1u << m_lowBits;
+    const unsigned int highCount = std::max(length >> m_lowBits, 1u);
+
+    m_lowReal.resize(lowCount);
+    m_lowImag.resize(lowCount);
+    for (unsigned int low = 0; low < lowCount; ++low)
+    {
+        const long double angle = 2 * pi * low / length;
+        m_lowReal[low] = static_cast<Scalar>(std::cos(angle));
+        m_lowImag[low] = static_cast<Scalar>(-std::sin(angle));
+    }
+
+    m_highReal.resize(highCount);
+    m_highImag.resize(highCount);
+    for (unsigned int high = 0; high < highCount; ++high)
+    {
+        const long double angle = 2 * pi * (static_cast<long double>(high) * lowCount) / length;
+        m_highReal[high] = static_cast<Scalar>(std::cos(angle));
+        m_highImag[high] = static_cast<Scalar>(-std::sin(angle));
+    }
+}
+
+
+void LargeFFT::Twiddles::get(std::size_t exponent, Scalar& real, Scalar& imag) const
+{
+    const std::size_t low = exponent & ((std::size_t(1) << m_lowBits) - 1);
+    const std::size_t high = exponent >> m_lowBits;
+    real = m_lowReal[low] * m_highReal[high] - m_lowImag[low] * m_highImag[high];
+    imag = m_lowReal[low] * m_highImag[high] + m_lowImag[low] * m_highReal[high];
+}
+
+
+LargeFFT::LargeFFT(unsigned int length, ResourceCache& cache) :
+    m_length(length),
+    m_complexLength(length / 2),
+    m_rowCount(1u << (log2(m_complexLength) / 2)),
+    m_columnCount(m_complexLength / m_rowCount),
+    m_columnsPerBlock(std::min(std::max(blockValues / m_rowCount, minimumBlockWidth), m_columnCount)),
+    m_rowsPerBlock(std::min(std::max(blockValues / m_columnCount, minimumBlockWidth), m_rowCount)),
+    m_columnPlan(cache.getFFTPlan(m_rowCount)),
+    m_rowPlan(cache.getFFTPlan(m_columnCount)),
+    m_input(static_cast<std::size_t>(length) * sizeof(Scalar)),
+    m_columns(static_cast<std::size_t>(length) * sizeof(Scalar)),
+    m_twiddles(m_complexLength),
+    m_splitTwiddles(m_length)
+{
+
+}
+
+
+unsigned int LargeFFT::getLength() const
+{
+    return m_length;
+}
+
+
+LargeFFT::Scalar* LargeFFT::getInput() const
+{
+    return static_cast<Scalar*>(m_input.getData());
+}
+
+
+void LargeFFT::process(ThreadPool& pool, ThreadPool::Priority priority)
+{
+    runPass(m_columnCount / m_columnsPerBlock, pool, priority,
+            [this] (BlockQueue& queue, unsigned int block) { transformColumns(queue, block); });
+    runPass(m_rowCount / m_rowsPerBlock, pool, priority,
+            [this] (BlockQueue& queue, unsigned int block) { transformRows(queue, block); });
+}
+
+
+void LargeFFT::getPeakPowers(unsigned int binsPerValue, unsigned int count, float* powers, ThreadPool& pool, ThreadPool::Priority priority)
+{
+    // a block reads about as many bins as a block of the passes, from both ends of the transform
+    const unsigned int valuesPerBlock = std::max(blockValues / std::max(binsPerValue, 1u), 1u);
+    runPass((count + valuesPerBlock - 1) / valuesPerBlock, pool, priority,
+            [=] (BlockQueue& queue, unsigned int block) { findPeakPowers(queue, block, valuesPerBlock, binsPerValue, count, powers); });
+}
+
+
+template <typename Work>
+void LargeFFT::runPass(unsigned int blockCount, ThreadPool& pool, ThreadPool::Priority priority, Work work)
+{
+    if (blockCount == 0)
+        return;
+
+    // a helper that starts after the pass is done doesn't get a block, it only touches the queue
+    std::shared_ptr<BlockQueue> queue = std::make_shared<BlockQueue>(blockCount);
+    const unsigned int helperCount = std::min(pool.getThreadCount(), blockCount) - 1;
+    for (unsigned int i = 0; i < helperCount; ++i)
+    {
+        pool.submit([queue, work]
+                    {
+                        unsigned int block;
+                        if (queue->take(block))
+                            work(*queue, block);
+                    }, priority);
+    }
+
+    unsigned int block;
+    if (queue->take(block))
+        work(*queue, block);
+    queue->wait();
+}
+
+
+void LargeFFT::transformColumns(BlockQueue& queue, unsigned int block)
+{
+    const unsigned int rowCount = m_rowCount;
+    const unsigned int columnCount = m_columnCount;
+    const unsigned int width = m_columnsPerBlock;
+
+    Arena::Scope scratch(m_arena);
+    Scalar* real = scratch.allocate<Scalar>(static_cast<std::size_t>(rowCount) * width);
+    Scalar* imag = scratch.allocate<Scalar>(static_cast<std::size_t>(rowCount) * width);
+    FFT realFFT(m_columnPlan);
+    FFT imagFFT(m_columnPlan);
+
+    const Scalar* input = static_cast<const Scalar*>(m_input.getData());
+    Scalar* output = static_cast<Scalar*>(m_columns.getData());
+    do
+    {
+        const unsigned int firstColumn = block * width;
+
+        // every row adds a piece of the neighbouring columns of the block
+        for (unsigned int row = 0; row < rowCount; ++row)
+        {
+            const Scalar* piece = input + 2 * (static_cast<std::size_t>(row) * columnCount + firstColumn);
+            for (unsigned int i = 0; i < width; ++i)
+            {
+                real[i * rowCount + row] = piece[2 * i];
+                imag[i * rowCount + row] = piece[2 * i + 1];
+            }
+        }
+
+        // bin k of column c is multiplied with exp(-2 pi i c k / (N/2))
+        for (unsigned int i = 0; i < width; ++i)
+        {
+            Scalar* columnReal = real + i * rowCount;
+            Scalar* columnImag = imag + i * rowCount;
+            transformComplex(realFFT, imagFFT, columnReal, columnImag, columnReal, columnImag, rowCount);
+
+            const std::size_t column = firstColumn + i;
+            for (unsigned int k = 0; k < rowCount; ++k)
+            {
+                Scalar twiddleReal, twiddleImag;
+                m_twiddles.get(column * k, twiddleReal, twiddleImag);
+                const Scalar binReal = columnReal[k];
+                columnReal[k] = binReal * twiddleReal - columnImag[k] * twiddleImag;
+                columnImag[k] = binReal * twiddleImag + columnImag[k] * twiddleReal;
+            }
+        }
+
+        for (unsigned int row = 0; row < rowCount; ++row)
+        {
+            Scalar* piece = output + 2 * (static_cast<std::size_t>(row) * columnCount + firstColumn);
+            for (unsigned int i = 0; i < width; ++i)
+            {
+                piece[2 * i]     = real[i * rowCount + row];
+                piece[2 * i + 1] = imag[i * rowCount + row];
+            }
+        }
+
+        queue.finish();
+    }
+    while (queue.take(block));
+}
+
+
+void LargeFFT::transformRows(BlockQueue& queue, unsigned int block)
+{
+    const unsigned int rowCount = m_rowCount;
+    const unsigned int columnCount = m_columnCount;
+    const unsigned int height = m_rowsPerBlock;
+
+    Arena::Scope scratch(m_arena);
+    Scalar* real = scratch.allocate<Scalar>(static_cast<std::size_t>(columnCount) * height);
+    Scalar* imag = scratch.allocate<Scalar>(static_cast<std::size_t>(columnCount) * height);
+    FFT realFFT(m_rowPlan);
+    FFT imagFFT(m_rowPlan);
+
+    const Scalar* input = static_cast<const Scalar*>(m_columns.getData());
+    Scalar* output = static_cast<Scalar*>(m_input.getData());
+    do
+    {
+        const unsigned int firstRow = block * height;
+
+        for (unsigned int i = 0; i < height; ++i)
+        {
+            const Scalar* row = input + 2 * (static_cast<std::size_t>(firstRow + i) * columnCount);
+            Scalar* rowReal = real + i * columnCount;
+            Scalar* rowImag = imag + i * columnCount;
+            for (unsigned int column = 0; column < columnCount; ++column)
+            {
+                rowReal[column] = row[2 * column];
+                rowImag[column] = row[2 * column + 1];
+            }
+            transformComplex(realFFT, imagFFT, rowReal, rowImag, rowReal, rowImag, columnCount);
+        }
+
+        // bin k2 of row k1 is bin k1 + R * k2 of the transform, the rows of the block are neighbours in it
+        for (unsigned int k = 0; k < columnCount; ++k)
+        {
+            Scalar* piece = output + 2 * (static_cast<std::size_t>(k) * rowCount + firstRow);
+            for (unsigned int i = 0; i < height; ++i)
+            {
+                piece[2 * i]     = real[i * columnCount + k];
+                piece[2 * i + 1] = imag[i * columnCount + k];
+            }
+        }
+
+        queue.finish();
+    }
+    while (queue.take(block));
+}
+
+
+void LargeFFT::findPeakPowers(BlockQueue& queue, unsigned int block, unsigned int valuesPerBlock, unsigned int binsPerValue, unsigned int count, float* powers)
+{
+    const std::size_t complexLength = m_complexLength;
+    const Scalar* transform = static_cast<const Scalar*>(m_input.getData());
+    do
+    {
+        const unsigned int first = block * valuesPerBlock;
+        const unsigned int last = std::min(first + valuesPerBlock, count);
+        for (unsigned int value = first; value < last; ++value)
+        {
+            const std::size_t firstBin = static_cast<std::size_t>(value) * binsPerValue;
+            const std::size_t lastBin = std::min(firstBin + binsPerValue, complexLength + 1);
+
+            // split the complex transform into the transforms of the even and odd samples and combine them
+            Scalar peak = Scalar(0);
+            for (std::size_t k = firstBin; k < lastBin; ++k)
+            {
+                const std::size_t index = k % complexLength;
+                const std::size_t mirrored = (complexLength - k) % complexLength;
+
+                const Scalar evenReal = (transform[2 * index] + transform[2 * mirrored]) / 2;
+                const Scalar evenImag = (transform[2 * index + 1] - transform[2 * mirrored + 1]) / 2;
+                const Scalar oddReal  = (transform[2 * index + 1] + transform[2 * mirrored + 1]) / 2;
+                const Scalar oddImag  = (transform[2 * mirrored] - transform[2 * index]) / 2;
+
+                Scalar twiddleReal, twiddleImag;
+                m_splitTwiddles.get(k, twiddleReal, twiddleImag);
+                const Scalar real = evenReal + oddReal * twiddleReal - oddImag * twiddleImag;
+                const Scalar imag = evenImag + oddReal * twiddleImag + oddImag * twiddleReal;
+                peak = std::max(peak, real * real + imag * imag);
+            }
+            powers[value] = static_cast<float>(peak);
+        }
+
+        queue.finish();
+    }
+    while (queue.take(block));
+}
@@ -0,0 +1,136 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_LARGEFFT_HPP
+#define FFTSPECTRUM_LARGEFFT_HPP
+
+#include "Arena.hpp"
+#include "FFT.hpp"
+#include "ResourceCache.hpp"
+#include "ScratchFile.hpp"
+#include "ThreadPool.hpp"
+
+#include <memory>
+#include <vector>
+
+/**
+ * @brief The LargeFFT class computes real transforms of millions of points, which don't fit
+ *        into the cache and maybe not into the memory, with the six-step algorithm. The N real
+ *        samples are taken as N/2 complex values in a matrix of R rows and C columns (R * C = N/2,
+ *        both about sqrt(N/2)). The first pass transforms the columns and multiplies them with
+ *        the twiddles, the second pass transforms the rows and writes them as columns, which puts
+ *        the complex transform in order. The columns are gathered and scattered in blocks of a few
+ *        neighbours, which are transformed while they are in the cache, so every pass streams
+ *        through its input and its output once. Both buffers are scratch files.
+ *
+ *        The blocks of a pass are shared between the calling thread and helpers on the thread
+ *        pool. The caller only waits for blocks that other threads took already, so it can be a
+ *        task of the same pool. The short transforms run on the FFT of the backend, a complex
+ *        transform as two real ones.
+ */
+class LargeFFT
+{
+public:
+    typedef FFT::Scalar Scalar;
+
+    /**
+     * @param length    A power of 2, at least 16
+     * @param cache     Provides the plans of the short transforms
+     */
+    LargeFFT(unsigned int length, ResourceCache& cache);
+
+    unsigned int    getLength() const;
+
+    /**
+     * @brief Returns the buffer for the samples of the next transform, process() overwrites them.
+     */
+    Scalar*         getInput() const;
+
+    /**
+     * @brief Transforms the samples of the input buffer, the calling thread works on the passes as well.
+     *
+     * @param priority Of the helpers that are submitted to the pool
+     */
+    void            process(ThreadPool& pool, ThreadPool::Priority priority);
+
+    /**
+     * @brief Computes the powers of the bins 0 to length / 2 of the last transform and keeps the
+     *        largest one of every group of binsPerValue bins, so narrow peaks aren't averaged away.
+     *
+     * @param binsPerValue  The bins of a group
+     * @param count         The number of groups from bin 0 on, groups past the last bin are 0
+     * @param powers        Receives the count values
+     */
+    void            getPeakPowers(unsigned int binsPerValue, unsigned int count, float* powers, ThreadPool& pool, ThreadPool::Priority priority);
+
+private:
+
+    LargeFFT(const LargeFFT&);
+    LargeFFT& operator=(const LargeFFT&);
+
+    class BlockQueue;
+
+    /**
+     * @brief exp(-2 pi i e / length) from two tables of about sqrt(length) values, for e < length.
+     */
+    class Twiddles
+    {
+    public:
+        explicit Twiddles(unsigned int length);
+
+        void            get(std::size_t exponent, Scalar& real, Scalar& imag) const;
+
+    private:
+        unsigned int        m_lowBits;
+        std::vector<Scalar> m_lowReal;
+        std::vector<Scalar> m_lowImag;
+        std::vector<Scalar> m_highReal;
+        std::vector<Scalar> m_highImag;
+    };
+
+    /**
+     * @brief Runs work for the blocks of a pass on the calling thread and on the pool. A participant
+     *        gets the first block it took and takes the next ones from the queue until none is left.
+     */
+    template <typename Work>
+    void            runPass(unsigned int blockCount, ThreadPool& pool, ThreadPool::Priority priority, Work work);
+
+    void            transformColumns(BlockQueue& queue, unsigned int block);
+
+    void            transformRows(BlockQueue& queue, unsigned int block);
+
+    void            findPeakPowers(BlockQueue& queue, unsigned int block, unsigned int valuesPerBlock, unsigned int binsPerValue, unsigned int count, float* powers);
+
+    const unsigned int                  m_length;
+    const unsigned int                  m_complexLength;    // N/2
+    const unsigned int                  m_rowCount;         // R, the length of the column transforms
+    const unsigned int                  m_columnCount;      // C, the length of the row transforms
+    const unsigned int                  m_columnsPerBlock;  // of the first pass
+    const unsigned int                  m_rowsPerBlock;     // of the second pass
+    std::shared_ptr<const FFTPlan>      m_columnPlan;
+    std::shared_ptr<const FFTPlan>      m_rowPlan;
+    ScratchFile                         m_input;            // the samples, and the transform after the second pass
+    ScratchFile                         m_columns;          // the transformed columns after the first pass
+    Twiddles                            m_twiddles;         // of the N/2 complex transform
+    Twiddles                            m_splitTwiddles;    // of the N real transform
+    Arena                               m_arena;            // the blocks of the passes
+};
+
+#endif //FFTSPECTRUM_LARGEFFT_HPP
@@ -0,0 +1,318 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "MagnitudeStorage.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+namespace
+{
+    // The fixed range covers the epsilon floor of FFT::logarithmicMagnitudeVector() (about -6.9)
+    // up to a full scale sine at the largest FFT sizes. In dB (20 * log10) this is -140 dB to +80 dB.
+    const float fixedMinimum = -7.f;
+    const float fixedMaximum = 4.f;
+
+    std::size_t bytesPerFrame(MagnitudeStorage::Format format, std::size_t binCount)
+    {
+        switch (format)
+        {
+            case MagnitudeStorage::Format::Float32: return binCount * 4;
+            case MagnitudeStorage::Format::Float16: return binCount * 2;
+            case MagnitudeStorage::Format::Code12:  return (binCount * 3 + 1) / 2;
+            case MagnitudeStorage::Format::Code8:   return binCount;
+        }
+        return 0;
+    }
+
+    unsigned int maximumCode(MagnitudeStorage::Format format)
+    {
+        return format == MagnitudeStorage::Format::Code12 ? 4095 : 255;
+    }
+
+
+    // IEEE 754 half precision conversion, rounds to nearest
+    std::uint16_t floatToHalf(float value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        const std::uint32_t sign     = (bits >> 16) & 0x8000;
+        const std::int32_t  exponent = static_cast<std::int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+        std::uint32_t       mantissa = bits & 0x7FFFFF;
+
+        if (exponent <= 0)
+        {
+            // too small for a normalized half, flush tiny values to zero
+            if (exponent < -10)
+                return static_cast<std::uint16_t>(sign);
+            mantissa |= 0x800000;
+            const int shift = 14 - exponent;
+            std::uint32_t halfMantissa = mantissa >> shift;
+            if ((mantissa >> (shift - 1)) & 1)
+                ++halfMantissa;
+            return static_cast<std::uint16_t>(sign | halfMantissa);
+        }
+        if (exponent >= 31)
+            return static_cast<std::uint16_t>(sign | 0x7C00); // infinity
+
+        std::uint32_t half = sign | (static_cast<std::uint32_t>(exponent) << 10) | (mantissa >> 13);
+        if (mantissa & 0x1000)
+            ++half; // a carry into the exponent is still the correctly rounded value
+        return static_cast<std::uint16_t>(half);
+    }
+
+
+    float halfToFloat(std::uint16_t half)
+    {
+        const std::uint32_t sign     = static_cast<std::uint32_t>(half & 0x8000) << 16;
+        std::int32_t        exponent = (half >> 10) & 0x1F;
+        std::uint32_t       mantissa = half & 0x3FF;
+
+        std::uint32_t bits;
+        if (exponent == 0)
+        {
+            if (mantissa == 0)
+            {
+                bits = sign;
+            }
+            else
+            {
+                // denormalized half, normalize it
+                exponent = 1;
+                while (!(mantissa & 0x400))
+                {
+                    mantissa <<= 1;
+                    --exponent;
+                }
+                mantissa &= 0x3FF;
+                bits = sign | (static_cast<std::uint32_t>(exponent - 15 + 127) << 23) | (mantissa << 13);
+            }
+        }
+        else if (exponent == 31)
+        {
+            bits = sign | 0x7F800000 | (mantissa << 13);
+        }
+        else
+        {
+            bits = sign | (static_cast<std::uint32_t>(exponent - 15 + 127) << 23) | (mantissa << 13);
+        }
+
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+
+MagnitudeStorage::MagnitudeStorage(Format format, Range range, unsigned int frameCount, unsigned int binCount) :
+    m_format(format),
+    m_range(range),
+    m_frameCount(frameCount),
+    m_binCount(binCount),
+    m_bytesPerFrame(bytesPerFrame(format, binCount))
+{
+    m_data.resize(m_bytesPerFrame * m_frameCount, 0);
+
+    // floats don't need a range
+    if (m_range == Range::Adaptive && (m_format == Format::Code12 || m_format == Format::Code8))
+    {
+        m_frameMinimum.resize(m_frameCount, 0.f);
+        m_frameStep.resize(m_frameCount, 0.f);
+    }
+}
+
+
+void MagnitudeStorage::setFrame(unsigned int frame, const float* values)
+{
+    std::uint8_t* data = &m_data[frame * m_bytesPerFrame];
+
+    if (m_format == Format::Float32)
+    {
+        std::memcpy(data, values, m_bytesPerFrame);
+        return;
+    }
+
+    if (m_format == Format::Float16)
+    {
+        for (unsigned int i = 0; i < m_binCount; ++i)
+        {
+            const std::uint16_t half = floatToHalf(values[i]);
+            std::memcpy(data + i * 2, &half, 2);
+        }
+        return;
+    }
+
+    // integer codes
+    float minimum = fixedMinimum;
+    float maximum = fixedMaximum;
+    if (!m_frameMinimum.empty())
+    {
+        auto minmax = std::minmax_element(values, values + m_binCount);
+        minimum = *minmax.first;
+        maximum = *minmax.second;
+    }
+
+    const float maxCode = static_cast<float>(maximumCode(m_format));
+    const float step = (maximum > minimum) ? (maximum - minimum) / maxCode : 1.f;
+    if (!m_frameMinimum.empty())
+    {
+        m_frameMinimum[frame] = minimum;
+        m_frameStep[frame] = step;
+    }
+
+    auto encode = [=] (float value) -> unsigned int
+                  {
+                      const float code = std::round((value - minimum) / step);
+                      return static_cast<unsigned int>(std::min(std::max(code, 0.f), maxCode));
+                  };
+
+    if (m_format == Format::Code8)
+    {
+        for (unsigned int i = 0; i < m_binCount; ++i)
+            data[i] = static_cast<std::uint8_t>(encode(values[i]));
+    }
+    else
+    {
+        // pack two 12 bit codes into three bytes
+        for (unsigned int i = 0; i < m_binCount; i += 2)
+        {
+            const unsigned int first  = encode(values[i]);
+            const unsigned int second = (i + 1 < m_binCount) ? encode(values[i + 1]) : 0;
+            std::uint8_t* packed = data + (i / 2) * 3;
+            packed[0] = static_cast<std::uint8_t>(first & 0xFF);
+            packed[1] = static_cast<std::uint8_t>((first >> 8) | ((second & 0x0F) << 4));
+            if (i + 1 < m_binCount)
+                packed[2] = static_cast<std::uint8_t>(second >> 4);
+        }
+    }
+}
+
+
+void MagnitudeStorage::getFrame(unsigned int frame, float* values) const
+{
+    const std::uint8_t* data = &m_data[frame * m_bytesPerFrame];
+
+    if (m_format == Format::Float32)
+    {
+        std::memcpy(values, data, m_bytesPerFrame);
+        return;
+    }
+
+    if (m_format == Format::Float16)
+    {
+        for (unsigned int i = 0; i < m_binCount; ++i)
+        {
+            std::uint16_t half;
+            std::memcpy(&half, data + i * 2, 2);
+            values[i] = halfToFloat(half);
+        }
+        return;
+    }
+
+    float minimum = fixedMinimum;
+    float step = (fixedMaximum - fixedMinimum) / static_cast<float>(maximumCode(m_format));
+    if (!m_frameMinimum.empty())
+    {
+        minimum = m_frameMinimum[frame];
+        step = m_frameStep[frame];
+    }
+
+    if (m_format == Format::Code8)
+    {
+        for (unsigned int i = 0; i < m_binCount; ++i)
+            values[i] = minimum + data[i] * step;
+    }
+    else
+    {
+        for (unsigned int i = 0; i < m_binCount; i += 2)
+        {
+            const std::uint8_t* packed = data + (i / 2) * 3;
+            values[i] = minimum + (packed[0] | ((packed[1] & 0x0F) << 8)) * step;
+            if (i + 1 < m_binCount)
+                values[i + 1] = minimum + ((packed[1] >> 4) | (packed[2] << 4)) * step;
+        }
+    }
+}
+
+
+unsigned int MagnitudeStorage::getFrameCount() const
+{
+    return m_frameCount;
+}
+
+
+unsigned int MagnitudeStorage::getBinCount() const
+{
+    return m_binCount;
+}
+
+
+MagnitudeStorage::Format MagnitudeStorage::getFormat() const
+{
+    return m_format;
+}
+
+
+std::size_t MagnitudeStorage::getMemoryUsage() const
+{
+    return m_data.size() + (m_frameMinimum.size() + m_frameStep.size()) * sizeof(float);
+}
+
+
+std::size_t MagnitudeStorage::estimateMemoryUsage(Format format, Range range, std::size_t frameCount, std::size_t binCount)
+{
+    std::size_t bytes = bytesPerFrame(format, binCount) * frameCount;
+    if (range == Range::Adaptive && (format == Format::Code12 || format == Format::Code8))
+        bytes += frameCount * 2 * sizeof(float);
+    return bytes;
+}
+
+
+bool MagnitudeStorage::parseFormat(const std::string& name, Format& format)
+{
+    if (name == "float32")
+        format = Format::Float32;
+    else if (name == "float16")
+        format = Format::Float16;
+    else if (name == "12bit")
+        format = Format::Code12;
+    else if (name == "8bit")
+        format = Format::Code8;
+    else
+        return false;
+
+    return true;
+}
+
+
+bool MagnitudeStorage::parseRange(const std::string& name, Range& range)
+{
+    if (name == "fixed")
+        range = Range::Fixed;
+    else if (name == "adaptive")
+        range = Range::Adaptive;
+    else
+        return false;
+
+    return true;
+}
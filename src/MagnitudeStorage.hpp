@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_MAGNITUDESTORAGE_HPP
+#define FFTSPECTRUM_MAGNITUDESTORAGE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The MagnitudeStorage class holds the logarithmic magnitudes of every
+ *        frame of a spectrogram. The values can be kept as plain floats or be
+ *        quantized to 16, 12 or 8 bit to save memory. Frames are stored and
+ *        decoded as a whole, the memory for all frames is allocated up front.
+ *        See the README for the precision of the different formats.
+ */
+class MagnitudeStorage
+{
+public:
+    enum class Format
+    {
+        Float32,    ///< 32 bit float, lossless
+        Float16,    ///< 16 bit half precision float
+        Code12,     ///< 12 bit code, two values are packed into three bytes
+        Code8       ///< 8 bit code
+    };
+
+    enum class Range
+    {
+        Fixed,      ///< the codes span a fixed range of log magnitudes
+        Adaptive    ///< the codes span the range of each individual frame
+    };
+
+    MagnitudeStorage(Format format, Range range, unsigned int frameCount, unsigned int binCount);
+
+    /**
+     * @brief Quantizes and stores a frame.
+     *
+     * @param frame   The index of the frame
+     * @param values  binCount logarithmic magnitudes
+     */
+    void            setFrame(unsigned int frame, const float* values);
+
+    /**
+     * @brief Decodes a frame.
+     *
+     * @param frame   The index of the frame
+     * @param values  Output array with space for binCount values
+     */
+    void            getFrame(unsigned int frame, float* values) const;
+
+    unsigned int    getFrameCount() const;
+    unsigned int    getBinCount() const;
+    Format          getFormat() const;
+
+    /**
+     * @brief Returns the number of bytes occupied by the stored magnitudes.
+     */
+    std::size_t     getMemoryUsage() const;
+
+    /**
+     * @brief Returns the number of bytes a storage with the given parameters would occupy.
+     */
+    static std::size_t estimateMemoryUsage(Format format, Range range, std::size_t frameCount, std::size_t binCount);
+
+    /**
+     * @brief Converts a format name like "float16" or "8bit" from the settings file.
+     *
+     * @return true if the name was known
+     */
+    static bool     parseFormat(const std::string& name, Format& format);
+
+    /**
+     * @brief Converts a range name ("fixed" or "adaptive") from the settings file.
+     *
+     * @return true if the name was known
+     */
+    static bool     parseRange(const std::string& name, Range& range);
+
+private:
+
+    const Format                m_format;
+    const Range                 m_range;
+    const unsigned int          m_frameCount;
+    const unsigned int          m_binCount;
+    const std::size_t           m_bytesPerFrame;
+    std::vector<std::uint8_t>   m_data;
+    std::vector<float>          m_frameMinimum;     // only used for the adaptive range
+    std::vector<float>          m_frameStep;        // only used for the adaptive range
+};
+
+#endif //FFTSPECTRUM_MAGNITUDESTORAGE_HPP
@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "NoiseFloor.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(FFTSPECTRUM_NO_SIMD)
+#define FFTSPECTRUM_SSE
+#include <emmintrin.h>
+#endif
+
+
+namespace
+{
+    // the recursive average of the levels lasts about 1 / (1 - smoothing) frames
+    const float smoothing = 0.7f;
+
+    // output[i] = min(first[i], second[i]), output may be one of the inputs
+    void minimum(const float* first, const float* second, float* output, unsigned int count)
+    {
+        unsigned int i = 0;
+#ifdef FFTSPECTRUM_SSE
+        for (; i + 4 <= count; i += 4)
+            _mm_storeu_ps(output + i, _mm_min_ps(_mm_loadu_ps(first + i), _mm_loadu_ps(second + i)));
+#endif
+        for (; i < count; ++i)
+            output[i] = std::min(first[i], second[i]);
+    }
+}
+
+
+NoiseFloor::NoiseFloor(unsigned int binCount, unsigned int windowLength) :
+    m_binCount(binCount),
+    m_windowLength(std::max(windowLength, 1u)),
+    m_smoothed(binCount, 0.f),
+    m_block(static_cast<std::size_t>(m_windowLength) * binCount, 0.f),
+    // before the first block is complete, the window only reaches back to the first frame
+    m_suffixMinima(static_cast<std::size_t>(m_windowLength) * binCount, std::numeric_limits<float>::max()),
+    m_prefixMinimum(binCount, 0.f),
+    m_floor(binCount, 0.f),
+    m_position(0),
+    m_frameCount(0)
+{
+
+}
+
+
+void NoiseFloor::addFrame(const float* levels)
+{
+    // the smoothing lowers the variance of the noise, so the minimum doesn't follow single dips
+    if (m_frameCount == 0)
+    {
+        std::copy(levels, levels + m_binCount, m_smoothed.begin());
+    }
+    else
+    {
+        for (unsigned int bin = 0; bin < m_binCount; ++bin)
+            m_smoothed[bin] = smoothing * m_smoothed[bin] + (1.f - smoothing) * levels[bin];
+    }
+
+    float* row = &m_block[static_cast<std::size_t>(m_position) * m_binCount];
+    std::copy(m_smoothed.begin(), m_smoothed.end(), row);
+    if (m_position == 0)
+        std::copy(m_smoothed.begin(), m_smoothed.end(), m_prefixMinimum.begin());
+    else
+        minimum(&m_prefixMinimum[0], row, &m_prefixMinimum[0], m_binCount);
+
+    // the window holds the rest of the previous block and the current block up to this frame
+    if (m_position + 1 < m_windowLength)
+        minimum(&m_prefixMinimum[0], &m_suffixMinima[static_cast<std::size_t>(m_position + 1) * m_binCount], &m_floor[0], m_binCount);
+    else
+        std::copy(m_prefixMinimum.begin(), m_prefixMinimum.end(), m_floor.begin());
+
+    ++m_frameCount;
+    if (++m_position == m_windowLength)
+    {
+        // the block is complete, its minima towards the end serve the next block
+        for (unsigned int k = m_windowLength - 1; k > 0; --k)
+        {
+            float* previous = &m_block[static_cast<std::size_t>(k - 1) * m_binCount];
+            minimum(previous, previous + m_binCount, previous, m_binCount);
+        }
+        m_block.swap(m_suffixMinima);
+        m_position = 0;
+    }
+}
+
+
+const float* NoiseFloor::getFloor() const
+{
+    return &m_floor[0];
+}
+
+
+unsigned int NoiseFloor::getFrameCount() const
+{
+    return m_frameCount;
+}
+
+
+unsigned int NoiseFloor::getWindowLength() const
+{
+    return m_windowLength;
+}
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_NOISEFLOOR_HPP
+#define FFTSPECTRUM_NOISEFLOOR_HPP
+
+#include <vector>
+
+/**
+ * @brief The NoiseFloor class tracks the noise floor of every bin with minimum statistics:
+ *        the levels are smoothed over a few frames and the floor is their minimum over the
+ *        last windowLength frames. Like the OnsetDetector it takes one frame of log10
+ *        magnitudes at a time and never looks ahead, so it works on a growing spectrogram
+ *        or a live stream as well.
+ *
+ *        The sliding minimum splits the frames into blocks of the window length (van Herk /
+ *        Gil-Werman). The minima of the current block from its start and of the previous
+ *        block towards its end together cover any window, so a frame costs three
+ *        comparisons per bin, however long the window is. All bins take the same steps,
+ *        so the comparisons run across the bins with SSE (unless FFTSPECTRUM_NO_SIMD is defined).
+ *        The minimum lies a few dB below the mean of the noise.
+ */
+class NoiseFloor
+{
+public:
+    /**
+     * @param binCount      The values per frame
+     * @param windowLength  The frames the minimum is taken over
+     */
+    NoiseFloor(unsigned int binCount, unsigned int windowLength);
+
+    /**
+     * @brief Adds the next frame and updates the floor.
+     */
+    void            addFrame(const float* levels);
+
+    /**
+     * @brief Returns the floor of every bin after the last frame, in log10 magnitudes.
+     */
+    const float*    getFloor() const;
+
+    unsigned int    getFrameCount() const;
+
+    unsigned int    getWindowLength() const;
+
+private:
+
+    const unsigned int  m_binCount;
+    const unsigned int  m_windowLength;
+    std::vector<float>  m_smoothed;
+    std::vector<float>  m_block;        // the smoothed frames of the current block
+    std::vector<float>  m_suffixMinima; // row k holds the minimum of rows k to the end of the previous block
+    std::vector<float>  m_prefixMinimum; // of the current block so far
+    std::vector<float>  m_floor;
+    unsigned int        m_position;     // in the current block
+    unsigned int        m_frameCount;
+};
+
+#endif //FFTSPECTRUM_NOISEFLOOR_HPP
@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "NpyWriter.hpp"
+
+#include <iostream>
+#include <sstream>
+
+
+NpyWriter::NpyWriter(const std::string& filename) :
+    m_filename(filename),
+    m_frameCount(0),
+    m_binCount(0),
+    m_framesPerSecond(0.f),
+    m_binWidth(0.f)
+{
+
+}
+
+
+bool NpyWriter::begin(const Description& description)
+{
+    m_file.open(m_filename, std::ios::binary | std::ios::trunc);
+    if (!m_file)
+    {
+        std::cout << "Could not open " << m_filename << " for writing." << std::endl;
+        return false;
+    }
+    m_frameCount = description.frameCount;
+    m_binCount = description.binCount;
+    m_framesPerSecond = description.sampleRate / description.hopSize;
+    m_binWidth = description.binWidth;
+
+    return writeHeader(m_file, description.frameCount, description.binCount, false);
+}
+
+
+bool NpyWriter::writeHeader(std::ofstream& file, unsigned int rowCount, unsigned int columnCount, bool isColumnMajor)
+{
+    // the header is a Python dict, padded with spaces so the data starts at a multiple of 64 bytes
+    std::ostringstream header;
+    header << "{'descr': '<f4', 'fortran_order': " << (isColumnMajor ? "True" : "False")
+           << ", 'shape': (" << rowCount << ", " << columnCount << "), }";
+    std::string dict = header.str();
+    const std::size_t prefixSize = 10; // magic, version and header length
+    const std::size_t padding = 64 - (prefixSize + dict.size() + 1) % 64;
+    dict.append(padding % 64, ' ');
+    dict.push_back('\n');
+
+    const unsigned short headerLength = static_cast<unsigned short>(dict.size());
+    const char prefix[prefixSize] = {'\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0,
+                                     static_cast<char>(headerLength & 0xFF), static_cast<char>(headerLength >> 8)};
+    file.write(prefix, prefixSize);
+    file.write(dict.data(), dict.size());
+
+    return static_cast<bool>(file);
+}
+
+
+bool NpyWriter::write(const float* frame)
+{
+    // the float arrays are written as they are, this assumes a little endian machine like x86 and ARM
+    m_file.write(reinterpret_cast<const char*>(frame), m_binCount * sizeof(float));
+    return static_cast<bool>(m_file);
+}
+
+
+bool NpyWriter::finish()
+{
+    m_file.close();
+    if (m_file.fail())
+        return false;
+
+    std::cout << "Exported " << m_frameCount << " frames of " << m_binCount << " bins (" << m_framesPerSecond
+              << " frames per second, " << m_binWidth << " Hz per bin) to " << m_filename << "." << std::endl;
+    return true;
+}
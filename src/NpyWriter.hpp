@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_NPYWRITER_HPP
+#define FFTSPECTRUM_NPYWRITER_HPP
+
+#include "FrameSink.hpp"
+
+#include <fstream>
+#include <string>
+
+/**
+ * @brief The NpyWriter class writes the frames as a NumPy .npy file (version 1.0) with a
+ *        little endian float32 array of shape (frames, bins), which numpy.load() or
+ *        numpy.load(mmap_mode='r') can read directly.
+ */
+class NpyWriter : public FrameSink
+{
+public:
+    NpyWriter(const std::string& filename);
+
+    virtual bool    begin(const Description& description);
+
+    virtual bool    write(const float* frame);
+
+    virtual bool    finish();
+
+    /**
+     * @brief Writes the header of a float32 array, the values follow it.
+     *
+     * @param isColumnMajor The values of a column follow each other (Fortran order), not those of a row
+     */
+    static bool     writeHeader(std::ofstream& file, unsigned int rowCount, unsigned int columnCount, bool isColumnMajor);
+
+private:
+
+    const std::string   m_filename;
+    std::ofstream       m_file;
+    unsigned int        m_frameCount;
+    unsigned int        m_binCount;
+    float               m_framesPerSecond;  // the file has no room for it, it is printed
+    float               m_binWidth;         // in Hz, printed as well
+};
+
+#endif //FFTSPECTRUM_NPYWRITER_HPP
@@ -0,0 +1,173 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "OnsetDetector.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(FFTSPECTRUM_NO_SIMD)
+#define FFTSPECTRUM_SSE
+#include <emmintrin.h>
+#endif
+
+
+namespace
+{
+    // the threshold adapts to the flux of about a quarter second (at 44.1 kHz and FFTSize 1024)
+    const unsigned int historyLength = 24;
+
+    // how many standard deviations and dB an onset has to be above the mean of the history
+    const float deviationFactor = 2.f;
+    const float thresholdOffset = 0.5f;
+
+    // the flux of an onset is at least this many dB per bin, quiet changes are ignored
+    const float minimumFlux = 0.5f;
+
+    // onsets closer than this are one event
+    const unsigned int minimumDistance = 4;
+}
+
+
+OnsetDetector::OnsetDetector(unsigned int binCount) :
+    m_binCount(binCount),
+    m_previousFrame(binCount, 0.f),
+    m_history(historyLength, 0.f),
+    m_historySum(0.0),
+    m_historySquareSum(0.0),
+    m_previousFlux(0.f),
+    m_flux(0.f),
+    m_frameCount(0)
+{
+
+}
+
+
+void OnsetDetector::addFrame(const float* magnitudes)
+{
+    // the first frame has nothing to rise from
+    const float flux = (m_frameCount > 0) ? spectralFlux(magnitudes) : 0.f;
+    std::copy(magnitudes, magnitudes + m_binCount, m_previousFrame.begin());
+
+    // the last frame is an onset if it is a maximum and above the threshold of the frames before it
+    if (m_frameCount >= 3)
+    {
+        const unsigned int frame = m_frameCount - 1;
+        const unsigned int count = std::min(frame - 1, historyLength);
+        const double mean = m_historySum / count;
+        const double deviation = std::sqrt(std::max(m_historySquareSum / count - mean * mean, 0.0));
+        const float threshold = std::max(static_cast<float>(mean + deviationFactor * deviation) + thresholdOffset, minimumFlux);
+
+        const bool isMaximum = m_flux > m_previousFlux && m_flux >= flux;
+        const bool isSeparate = m_events.empty() || frame - m_events.back().frame >= minimumDistance;
+        if (isMaximum && isSeparate && m_flux > threshold)
+        {
+            Event event;
+            event.frame = frame;
+            event.strength = m_flux - threshold;
+            m_events.push_back(event);
+        }
+    }
+
+    // the flux of the last frame moves into the history, the one of the first frame is meaningless
+    if (m_frameCount >= 2)
+    {
+        float& oldest = m_history[(m_frameCount - 2) % historyLength];
+        m_historySum += m_flux - oldest;
+        m_historySquareSum += static_cast<double>(m_flux) * m_flux - static_cast<double>(oldest) * oldest;
+        oldest = m_flux;
+    }
+
+    m_previousFlux = m_flux;
+    m_flux = flux;
+    ++m_frameCount;
+}
+
+
+unsigned int OnsetDetector::getFrameCount() const
+{
+    return m_frameCount;
+}
+
+
+const std::vector<OnsetDetector::Event>& OnsetDetector::getEvents() const
+{
+    return m_events;
+}
+
+
+const OnsetDetector::Event* OnsetDetector::findNext(unsigned int frame) const
+{
+    auto next = std::upper_bound(m_events.begin(), m_events.end(), frame,
+                                 [] (unsigned int value, const Event& event) { return value < event.frame; });
+    return (next != m_events.end()) ? &*next : nullptr;
+}
+
+
+const OnsetDetector::Event* OnsetDetector::findPrevious(unsigned int frame) const
+{
+    auto next = std::lower_bound(m_events.begin(), m_events.end(), frame,
+                                 [] (const Event& event, unsigned int value) { return event.frame < value; });
+    return (next != m_events.begin()) ? &*(next - 1) : nullptr;
+}
+
+
+bool OnsetDetector::saveToFile(const std::string& filename, float framesPerSecond) const
+{
+    std::ofstream file(filename);
+    if (!file)
+    {
+        std::cout << "Could not open " << filename << " for writing." << std::endl;
+        return false;
+    }
+
+    file << "frame,seconds,strength\n";
+    for (const Event& event : m_events)
+        file << event.frame << ',' << event.frame / framesPerSecond << ',' << event.strength << '\n';
+
+    return static_cast<bool>(file);
+}
+
+
+float OnsetDetector::spectralFlux(const float* magnitudes) const
+{
+    const float* previous = &m_previousFrame[0];
+    float sum = 0.f;
+    unsigned int k = 0;
+#ifdef FFTSPECTRUM_SSE
+    const __m128 zero = _mm_setzero_ps();
+    __m128 sums = zero;
+    for (; k + 4 <= m_binCount; k += 4)
+    {
+        const __m128 rise = _mm_sub_ps(_mm_loadu_ps(magnitudes + k), _mm_loadu_ps(previous + k));
+        sums = _mm_add_ps(sums, _mm_max_ps(rise, zero));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, sums);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+    for (; k < m_binCount; ++k)
+        sum += std::max(magnitudes[k] - previous[k], 0.f);
+
+    // the magnitudes are log10, 20 * log10 is dB
+    return 20.f * sum / m_binCount;
+}
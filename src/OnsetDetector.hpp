@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_ONSETDETECTOR_HPP
+#define FFTSPECTRUM_ONSETDETECTOR_HPP
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief The OnsetDetector class finds the frames where a new sound starts. It takes
+ *        one frame of log10 magnitudes at a time, so it works on a growing spectrogram
+ *        or a live stream as well. The spectral flux of a frame is the mean rise in dB
+ *        of its bins against the frame before. An onset is a maximum of the flux that
+ *        is well above the flux of the frames before it. It is decided one frame late,
+ *        when the next frame shows that the flux went down again.
+ */
+class OnsetDetector
+{
+public:
+    struct Event
+    {
+        unsigned int    frame;
+        float           strength;   ///< the flux above the threshold, in dB
+    };
+
+    explicit OnsetDetector(unsigned int binCount);
+
+    /**
+     * @brief Adds the next frame.
+     */
+    void                        addFrame(const float* magnitudes);
+
+    unsigned int                getFrameCount() const;
+
+    /**
+     * @brief Returns the events found so far, sorted by frame.
+     */
+    const std::vector<Event>&   getEvents() const;
+
+    /**
+     * @brief Returns the first event after the frame, or null.
+     */
+    const Event*                findNext(unsigned int frame) const;
+
+    /**
+     * @brief Returns the last event before the frame, or null.
+     */
+    const Event*                findPrevious(unsigned int frame) const;
+
+    /**
+     * @brief Writes the events as comma separated values: frame, seconds and strength.
+     *
+     * @param framesPerSecond Converts the frames to seconds
+     *
+     * @return false if the file could not be written
+     */
+    bool                        saveToFile(const std::string& filename, float framesPerSecond) const;
+
+private:
+
+    /**
+     * @brief Returns the mean of the positive differences between the frames, in dB.
+     */
+    float                       spectralFlux(const float* magnitudes) const;
+
+    const unsigned int  m_binCount;
+    std::vector<float>  m_previousFrame;
+    std::vector<float>  m_history;          // the flux of the last frames, as a ring buffer
+    double              m_historySum;
+    double              m_historySquareSum;
+    float               m_previousFlux;     // of the frame that is decided next
+    float               m_flux;
+    unsigned int        m_frameCount;
+    std::vector<Event>  m_events;
+};
+
+#endif //FFTSPECTRUM_ONSETDETECTOR_HPP
@@ -0,0 +1,196 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "PeakIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace
+{
+    // the mono samples summarized by a block of the finest level
+    const std::size_t blockSize = 64;
+}
+
+
+PeakIndex::PeakIndex() :
+    m_samples(nullptr),
+    m_sampleCount(0),
+    m_channelCount(1)
+{
+
+}
+
+
+void PeakIndex::build(const sf::Int16* samples, std::size_t sampleCount, unsigned int channelCount, std::vector<float>* mono)
+{
+    m_samples = samples;
+    m_channelCount = std::max(channelCount, 1u);
+    m_sampleCount = sampleCount / m_channelCount;
+    m_levels.clear();
+
+    if (mono)
+        mono->resize(m_sampleCount);
+
+    // the finest level, mixing down the channels on the way
+    const float scale = 1.f / (32767.f * m_channelCount);
+    std::vector<Block> blocks((m_sampleCount + blockSize - 1) / blockSize);
+    for (std::size_t block = 0; block < blocks.size(); ++block)
+    {
+        const std::size_t first = block * blockSize;
+        const std::size_t last = std::min(first + blockSize, m_sampleCount);
+
+        int minimum = 32767, maximum = -32768;
+        double sumOfSquares = 0.0;
+        for (std::size_t i = first; i < last; ++i)
+        {
+            int sum = 0;
+            for (unsigned int channel = 0; channel < m_channelCount; ++channel)
+                sum += samples[i * m_channelCount + channel];
+
+            if (mono)
+                (*mono)[i] = sum * scale;
+
+            const int sample = sum / static_cast<int>(m_channelCount);
+            minimum = std::min(minimum, sample);
+            maximum = std::max(maximum, sample);
+            sumOfSquares += static_cast<double>(sample) * sample;
+        }
+
+        const double rms = std::sqrt(sumOfSquares / (last - first)) / 32768.0;
+        blocks[block].minimum = static_cast<sf::Int16>(minimum);
+        blocks[block].maximum = static_cast<sf::Int16>(maximum);
+        blocks[block].rms = static_cast<sf::Uint16>(std::min(std::round(rms * 65535.0), 65535.0));
+    }
+    m_levels.push_back(std::move(blocks));
+
+    // every level combines two blocks of the level below
+    while (m_levels.back().size() > 1)
+    {
+        const std::vector<Block>& below = m_levels.back();
+        std::vector<Block> level((below.size() + 1) / 2);
+        for (std::size_t block = 0; block < level.size(); ++block)
+        {
+            const Block& left = below[2 * block];
+            const Block& right = (2 * block + 1 < below.size()) ? below[2 * block + 1] : left;
+            level[block].minimum = std::min(left.minimum, right.minimum);
+            level[block].maximum = std::max(left.maximum, right.maximum);
+            const double meanSquare = (static_cast<double>(left.rms) * left.rms + static_cast<double>(right.rms) * right.rms) / 2.0;
+            level[block].rms = static_cast<sf::Uint16>(std::round(std::sqrt(meanSquare)));
+        }
+        m_levels.push_back(std::move(level));
+    }
+}
+
+
+void PeakIndex::getPeaks(double firstSample, double samplesPerPixel, std::vector<Peak>& peaks) const
+{
+    // the coarsest level whose blocks are not wider than a pixel
+    std::size_t level = 0;
+    while (level + 1 < m_levels.size() && static_cast<double>(blockSize << (level + 1)) <= samplesPerPixel)
+        ++level;
+
+    for (std::size_t pixel = 0; pixel < peaks.size(); ++pixel)
+    {
+        const double start = std::max(firstSample + pixel * samplesPerPixel, 0.0);
+        const double end = std::min(firstSample + (pixel + 1) * samplesPerPixel, static_cast<double>(m_sampleCount));
+        if (end <= start)
+        {
+            peaks[pixel] = Peak{0.f, 0.f, 0.f};
+            continue;
+        }
+
+        // at least one sample per pixel
+        const std::size_t first = static_cast<std::size_t>(start);
+        const std::size_t last = std::max(static_cast<std::size_t>(std::ceil(end)), first + 1);
+
+        if (samplesPerPixel < blockSize || m_levels.empty())
+        {
+            peaks[pixel] = summarizeSamples(first, last);
+        }
+        else
+        {
+            const std::size_t size = blockSize << level;
+            peaks[pixel] = summarizeBlocks(level, first / size, (last + size - 1) / size);
+        }
+    }
+}
+
+
+std::size_t PeakIndex::getSampleCount() const
+{
+    return m_sampleCount;
+}
+
+
+std::size_t PeakIndex::getMemoryUsage() const
+{
+    std::size_t bytes = 0;
+    for (const std::vector<Block>& level : m_levels)
+        bytes += level.size() * sizeof(Block);
+    return bytes;
+}
+
+
+PeakIndex::Peak PeakIndex::summarizeSamples(std::size_t first, std::size_t last) const
+{
+    int minimum = 32767, maximum = -32768;
+    double sumOfSquares = 0.0;
+    for (std::size_t i = first; i < last; ++i)
+    {
+        int sum = 0;
+        for (unsigned int channel = 0; channel < m_channelCount; ++channel)
+            sum += m_samples[i * m_channelCount + channel];
+
+        const int sample = sum / static_cast<int>(m_channelCount);
+        minimum = std::min(minimum, sample);
+        maximum = std::max(maximum, sample);
+        sumOfSquares += static_cast<double>(sample) * sample;
+    }
+
+    Peak peak;
+    peak.minimum = minimum / 32768.f;
+    peak.maximum = maximum / 32768.f;
+    peak.rms = static_cast<float>(std::sqrt(sumOfSquares / (last - first)) / 32768.0);
+    return peak;
+}
+
+
+PeakIndex::Peak PeakIndex::summarizeBlocks(std::size_t level, std::size_t first, std::size_t last) const
+{
+    const std::vector<Block>& blocks = m_levels[level];
+    last = std::min(last, blocks.size());
+
+    int minimum = 32767, maximum = -32768;
+    double sumOfSquares = 0.0;
+    for (std::size_t block = first; block < last; ++block)
+    {
+        minimum = std::min(minimum, static_cast<int>(blocks[block].minimum));
+        maximum = std::max(maximum, static_cast<int>(blocks[block].maximum));
+        sumOfSquares += static_cast<double>(blocks[block].rms) * blocks[block].rms;
+    }
+
+    Peak peak;
+    peak.minimum = minimum / 32768.f;
+    peak.maximum = maximum / 32768.f;
+    peak.rms = static_cast<float>(std::sqrt(sumOfSquares / std::max<std::size_t>(last - first, 1)) / 65535.0);
+    return peak;
+}
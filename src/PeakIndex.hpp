@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_PEAKINDEX_HPP
+#define FFTSPECTRUM_PEAKINDEX_HPP
+
+#include <SFML/Config.hpp>
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief The PeakIndex class summarizes a sound for drawing its waveform at any zoom level,
+ *        like the peak files of audio editors. The mono samples are split into blocks of
+ *        64 samples and the minimum, maximum and RMS of every block is kept. Every further
+ *        level combines two blocks of the level below. A range of samples is then summarized
+ *        from at most a few blocks of the matching level, so drawing costs O(pixels)
+ *        independent of the zoom. Each block takes 6 bytes, all levels together about
+ *        0.2 bytes per sample.
+ */
+class PeakIndex
+{
+public:
+    struct Peak
+    {
+        float minimum;  ///< in [-1, 1]
+        float maximum;  ///< in [-1, 1]
+        float rms;      ///< in [0, 1]
+    };
+
+    PeakIndex();
+
+    /**
+     * @brief Mixes the interleaved channels down to mono and builds the index from them.
+     *
+     * @param samples       The interleaved samples, they have to outlive the index (for the finest zoom)
+     * @param sampleCount   The number of samples (of all channels)
+     * @param channelCount  The number of channels
+     * @param mono          If not null, the scaled mono samples are stored there in the same pass
+     */
+    void            build(const sf::Int16* samples, std::size_t sampleCount, unsigned int channelCount, std::vector<float>* mono = nullptr);
+
+    /**
+     * @brief Summarizes consecutive ranges of mono samples, one per pixel.
+     *
+     * @param firstSample       The mono sample at the left border of the first pixel, can be fractional or negative
+     * @param samplesPerPixel   The number of samples per pixel
+     * @param peaks             Receives one Peak per pixel, pixels outside of the sound are all 0
+     */
+    void            getPeaks(double firstSample, double samplesPerPixel, std::vector<Peak>& peaks) const;
+
+    /**
+     * @brief Returns the number of mono samples.
+     */
+    std::size_t     getSampleCount() const;
+
+    /**
+     * @brief Returns the number of bytes occupied by the blocks.
+     */
+    std::size_t     getMemoryUsage() const;
+
+private:
+
+    struct Block
+    {
+        sf::Int16   minimum;
+        sf::Int16   maximum;
+        sf::Uint16  rms;        // scaled to 65535 for full scale
+    };
+
+    Peak            summarizeSamples(std::size_t first, std::size_t last) const;
+
+    Peak            summarizeBlocks(std::size_t level, std::size_t first, std::size_t last) const;
+
+    const sf::Int16*                    m_samples;
+    std::size_t                         m_sampleCount;   // mono samples
+    unsigned int                        m_channelCount;
+    std::vector<std::vector<Block>>     m_levels;
+};
+
+#endif //FFTSPECTRUM_PEAKINDEX_HPP
@@ -0,0 +1,244 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "PeakTracker.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(FFTSPECTRUM_NO_SIMD)
+#define FFTSPECTRUM_SSE
+#include <emmintrin.h>
+#endif
+
+
+namespace
+{
+    // 40 dB below the loudest bin, in log10 magnitudes
+    const float peakRange = 2.f;
+
+    // quieter peaks are noise, -5 is 100 dB below a full scale sine
+    const float peakFloor = -5.f;
+
+    // how far a track can move from one frame to the next, in bins
+    const float maximumJump = 3.f;
+
+    // shorter tracks are not kept
+    const std::size_t minimumTrackLength = 5;
+
+    float loudestMagnitude(const float* magnitudes, unsigned int binCount)
+    {
+        unsigned int k = 0;
+        float loudest = magnitudes[0];
+#ifdef FFTSPECTRUM_SSE
+        if (binCount >= 4)
+        {
+            __m128 maximum = _mm_loadu_ps(magnitudes);
+            for (k = 4; k + 4 <= binCount; k += 4)
+                maximum = _mm_max_ps(maximum, _mm_loadu_ps(magnitudes + k));
+
+            float lanes[4];
+            _mm_storeu_ps(lanes, maximum);
+            loudest = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+        }
+#endif
+        for (; k < binCount; ++k)
+            loudest = std::max(loudest, magnitudes[k]);
+        return loudest;
+    }
+
+    // keeps the loudest maxima, sorted from the loudest on
+    void insertMaximum(const float* magnitudes, unsigned int bin, unsigned int* maxima, unsigned int& count)
+    {
+        unsigned int i = count;
+        if (count < PeakTracker::maxPeaksPerFrame)
+            ++count;
+        else if (magnitudes[bin] <= magnitudes[maxima[count - 1]])
+            return;
+        else
+            --i;
+
+        for (; i > 0 && magnitudes[maxima[i - 1]] < magnitudes[bin]; --i)
+            maxima[i] = maxima[i - 1];
+        maxima[i] = bin;
+    }
+}
+
+
+PeakTracker::PeakTracker(unsigned int frameCount, unsigned int binCount) :
+    m_frameCount(frameCount),
+    m_binCount(binCount),
+    m_peaks(static_cast<std::size_t>(frameCount) * maxPeaksPerFrame),
+    m_peakCounts(frameCount, 0),
+    m_linkedFrames(0),
+    m_trackCount(0)
+{
+
+}
+
+
+unsigned int PeakTracker::findPeaks(const float* magnitudes, unsigned int binCount, Peak* peaks)
+{
+    if (binCount < 5)
+        return 0;
+
+    const float threshold = std::max(loudestMagnitude(magnitudes, binCount) - peakRange, peakFloor);
+
+    // a peak is the largest of 5 bins, this skips the side lobes of the window next to it
+    unsigned int maxima[maxPeaksPerFrame];
+    unsigned int maximumCount = 0;
+    unsigned int k = 2;
+#ifdef FFTSPECTRUM_SSE
+    const __m128 thresholds = _mm_set1_ps(threshold);
+    for (; k + 2 + 4 <= binCount; k += 4)
+    {
+        const __m128 center = _mm_loadu_ps(magnitudes + k);
+        __m128 isPeak = _mm_cmpgt_ps(center, thresholds);
+        isPeak = _mm_and_ps(isPeak, _mm_cmpgt_ps(center, _mm_loadu_ps(magnitudes + k - 1)));
+        isPeak = _mm_and_ps(isPeak, _mm_cmpge_ps(center, _mm_loadu_ps(magnitudes + k + 1)));
+        isPeak = _mm_and_ps(isPeak, _mm_cmpge_ps(center, _mm_loadu_ps(magnitudes + k - 2)));
+        isPeak = _mm_and_ps(isPeak, _mm_cmpge_ps(center, _mm_loadu_ps(magnitudes + k + 2)));
+
+        // almost all bins are below the threshold
+        int mask = _mm_movemask_ps(isPeak);
+        for (unsigned int lane = 0; mask != 0; ++lane, mask >>= 1)
+        {
+            if (mask & 1)
+                insertMaximum(magnitudes, k + lane, maxima, maximumCount);
+        }
+    }
+#endif
+    for (; k + 2 < binCount; ++k)
+    {
+        const float center = magnitudes[k];
+        if (center > threshold && center > magnitudes[k - 1] && center >= magnitudes[k + 1] && center >= magnitudes[k - 2] && center >= magnitudes[k + 2])
+            insertMaximum(magnitudes, k, maxima, maximumCount);
+    }
+
+    // the vertex of the parabola through the maximum and its neighbours
+    for (unsigned int i = 0; i < maximumCount; ++i)
+    {
+        const unsigned int bin = maxima[i];
+        const float left = magnitudes[bin - 1], center = magnitudes[bin], right = magnitudes[bin + 1];
+        const float curvature = left - 2.f * center + right;
+        const float offset = (curvature < 0.f) ? 0.5f * (left - right) / curvature : 0.f;
+
+        peaks[i].bin = bin + offset;
+        peaks[i].magnitude = center - 0.25f * (left - right) * offset;
+    }
+
+    return maximumCount;
+}
+
+
+void PeakTracker::setFrame(unsigned int frame, const float* magnitudes)
+{
+    m_peakCounts[frame] = static_cast<unsigned char>(findPeaks(magnitudes, m_binCount, &m_peaks[static_cast<std::size_t>(frame) * maxPeaksPerFrame]));
+}
+
+
+void PeakTracker::link(unsigned int availableFrames)
+{
+    std::lock_guard<std::mutex> lock(m_linkMutex);
+
+    for (; m_linkedFrames < availableFrames; ++m_linkedFrames)
+    {
+        const Peak* peaks = &m_peaks[static_cast<std::size_t>(m_linkedFrames) * maxPeaksPerFrame];
+        const unsigned int peakCount = m_peakCounts[m_linkedFrames];
+        const std::size_t previousTrackCount = m_activeTracks.size();
+
+        for (ActiveTrack& active : m_activeTracks)
+            active.isExtended = false;
+
+        // the strongest peaks choose first, they continue the closest track of the last frame
+        for (unsigned int i = 0; i < peakCount; ++i)
+        {
+            ActiveTrack* closest = nullptr;
+            float closestDistance = maximumJump;
+            for (std::size_t t = 0; t < previousTrackCount; ++t)
+            {
+                ActiveTrack& active = m_activeTracks[t];
+                const float distance = std::abs(active.track.bins.back() - peaks[i].bin);
+                if (!active.isExtended && distance <= closestDistance)
+                {
+                    closest = &active;
+                    closestDistance = distance;
+                }
+            }
+
+            if (closest)
+            {
+                closest->track.bins.push_back(peaks[i].bin);
+                closest->isExtended = true;
+            }
+            else
+            {
+                ActiveTrack active;
+                active.track.firstFrame = m_linkedFrames;
+                active.track.bins.push_back(peaks[i].bin);
+                active.isExtended = true;
+                m_activeTracks.push_back(std::move(active));
+            }
+        }
+
+        // the tracks that were not continued are done
+        for (ActiveTrack& active : m_activeTracks)
+        {
+            if (!active.isExtended)
+                finishTrack(active.track);
+        }
+        m_activeTracks.erase(std::remove_if(m_activeTracks.begin(), m_activeTracks.end(),
+                                            [] (const ActiveTrack& active) { return !active.isExtended; }),
+                             m_activeTracks.end());
+    }
+
+    // the sound is over
+    if (m_linkedFrames == m_frameCount)
+    {
+        for (ActiveTrack& active : m_activeTracks)
+            finishTrack(active.track);
+        m_activeTracks.clear();
+    }
+}
+
+
+std::size_t PeakTracker::getTrackCount() const
+{
+    return m_trackCount;
+}
+
+
+void PeakTracker::getTracks(std::size_t first, std::vector<Track>& tracks) const
+{
+    std::lock_guard<std::mutex> lock(m_tracksMutex);
+    if (first < m_tracks.size())
+        tracks.insert(tracks.end(), m_tracks.begin() + first, m_tracks.end());
+}
+
+
+void PeakTracker::finishTrack(Track& track)
+{
+    if (track.bins.size() < minimumTrackLength)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_tracksMutex);
+    m_tracks.push_back(std::move(track));
+    m_trackCount = m_tracks.size();
+}
@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_PEAKTRACKER_HPP
+#define FFTSPECTRUM_PEAKTRACKER_HPP
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief The PeakTracker class finds the strongest peaks of every frame and links
+ *        them into tracks of partials. The peaks are found by the thread that computes
+ *        the frame, right after its magnitudes. The linking has to go through the
+ *        frames in order, so it follows the frames that are completely generated.
+ */
+class PeakTracker
+{
+public:
+    struct Peak
+    {
+        float bin;          ///< with the sub-bin offset of the parabola through the maximum
+        float magnitude;    ///< the log10 magnitude at the top of the parabola
+    };
+
+    struct Track
+    {
+        unsigned int        firstFrame;
+        std::vector<float>  bins;       ///< one per frame
+    };
+
+    static const unsigned int maxPeaksPerFrame = 8;
+
+    PeakTracker(unsigned int frameCount, unsigned int binCount);
+
+    /**
+     * @brief Finds the bins of a frame of log10 magnitudes that are larger than two bins
+     *        on both sides and within 40 dB of the loudest bin. The comparisons use SSE.
+     *        The position and height of every peak are refined with a parabola.
+     *
+     * @param peaks Receives at most maxPeaksPerFrame peaks, the strongest first
+     *
+     * @return The number of peaks
+     */
+    static unsigned int findPeaks(const float* magnitudes, unsigned int binCount, Peak* peaks);
+
+    /**
+     * @brief Finds and keeps the peaks of a frame. Different frames can be set from different threads.
+     */
+    void                setFrame(unsigned int frame, const float* magnitudes);
+
+    /**
+     * @brief Links the peaks of the frames before availableFrames into tracks,
+     *        starting where the last call stopped. Thread safe.
+     */
+    void                link(unsigned int availableFrames);
+
+    /**
+     * @brief Returns the number of tracks that are finished.
+     */
+    std::size_t         getTrackCount() const;
+
+    /**
+     * @brief Appends the finished tracks from the given index on to tracks.
+     */
+    void                getTracks(std::size_t first, std::vector<Track>& tracks) const;
+
+private:
+
+    struct ActiveTrack
+    {
+        Track   track;
+        bool    isExtended;
+    };
+
+    void                finishTrack(Track& track);
+
+    const unsigned int          m_frameCount;
+    const unsigned int          m_binCount;
+    std::vector<Peak>           m_peaks;            // maxPeaksPerFrame per frame
+    std::vector<unsigned char>  m_peakCounts;
+    unsigned int                m_linkedFrames;     // guarded by m_linkMutex, like the active tracks
+    std::vector<ActiveTrack>    m_activeTracks;
+    std::mutex                  m_linkMutex;
+    std::vector<Track>          m_tracks;           // guarded by m_tracksMutex
+    std::atomic<std::size_t>    m_trackCount;
+    mutable std::mutex          m_tracksMutex;
+};
+
+#endif //FFTSPECTRUM_PEAKTRACKER_HPP
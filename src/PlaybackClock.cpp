@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "PlaybackClock.hpp"
+
+
+namespace
+{
+    // larger differences are seeks or dropouts, the prediction jumps to them
+    const sf::Time maximumDrift = sf::milliseconds(200);
+
+    // the fraction of the difference that is corrected per new offset
+    const sf::Int64 correctionDivisor = 8;
+}
+
+
+PlaybackClock::PlaybackClock() :
+    m_isRunning(false)
+{
+
+}
+
+
+void PlaybackClock::setLatency(sf::Time latency)
+{
+    m_latency = latency;
+}
+
+
+void PlaybackClock::update(sf::SoundSource::Status status, sf::Time reportedOffset)
+{
+    const sf::Time elapsed = m_clock.restart();
+
+    // paused or stopped, the offset of the sound is exact
+    if (status != sf::SoundSource::Playing || !m_isRunning)
+    {
+        m_offset = reportedOffset;
+        m_reportedOffset = reportedOffset;
+        m_isRunning = (status == sf::SoundSource::Playing);
+        return;
+    }
+
+    m_offset += elapsed;
+
+    // only a new offset tells something about the drift, in between it is stale
+    if (reportedOffset != m_reportedOffset)
+    {
+        m_reportedOffset = reportedOffset;
+
+        const sf::Time drift = reportedOffset - m_offset;
+        if (drift > maximumDrift || drift < -maximumDrift)
+            m_offset = reportedOffset;
+        else
+            m_offset += sf::microseconds(drift.asMicroseconds() / correctionDivisor);
+    }
+}
+
+
+sf::Time PlaybackClock::getOffset() const
+{
+    // while playing, the last samples are still on their way to the speakers
+    if (!m_isRunning)
+        return m_offset;
+    return (m_offset > m_latency) ? m_offset - m_latency : sf::Time::Zero;
+}
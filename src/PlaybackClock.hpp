@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_PLAYBACKCLOCK_HPP
+#define FFTSPECTRUM_PLAYBACKCLOCK_HPP
+
+#include <SFML/Audio/SoundSource.hpp>
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Time.hpp>
+
+/**
+ * @brief The PlaybackClock class predicts the position that is currently heard.
+ *        The playing offset of a sound only advances when the audio device takes
+ *        the next buffer, so reading it once per frame makes the cursor stutter.
+ *        Between those steps the position is advanced with a monotonic clock and
+ *        every new offset only nudges the prediction. The output latency of the
+ *        device is subtracted, so the cursor doesn't run ahead of the sound.
+ */
+class PlaybackClock
+{
+public:
+    PlaybackClock();
+
+    /**
+     * @brief Sets how long it takes until a mixed sample is heard.
+     */
+    void        setLatency(sf::Time latency);
+
+    /**
+     * @brief Takes the state of the sound into account, has to be called once per frame.
+     *
+     * @param status         The status of the sound
+     * @param reportedOffset The playing offset of the sound
+     */
+    void        update(sf::SoundSource::Status status, sf::Time reportedOffset);
+
+    /**
+     * @brief Returns the offset in the sound that is heard right now.
+     */
+    sf::Time    getOffset() const;
+
+private:
+    sf::Clock   m_clock;            // time since the last update
+    sf::Time    m_offset;           // predicted playing offset
+    sf::Time    m_reportedOffset;   // the last offset of the sound
+    sf::Time    m_latency;
+    bool        m_isRunning;
+};
+
+#endif //FFTSPECTRUM_PLAYBACKCLOCK_HPP
@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "Png.hpp"
+
+#include <algorithm>
+
+
+namespace
+{
+    // the largest stored deflate block
+    const std::size_t maximumBlockSize = 65535;
+
+    std::vector<std::uint32_t> createCrcTable()
+    {
+        std::vector<std::uint32_t> table(256);
+        for (std::uint32_t n = 0; n < 256; ++n)
+        {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        return table;
+    }
+
+    void appendBigEndian(std::vector<std::uint8_t>& output, std::uint32_t value)
+    {
+        output.push_back(static_cast<std::uint8_t>(value >> 24));
+        output.push_back(static_cast<std::uint8_t>(value >> 16));
+        output.push_back(static_cast<std::uint8_t>(value >> 8));
+        output.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    void appendChunk(std::vector<std::uint8_t>& output, const char* type, const std::vector<std::uint8_t>& data)
+    {
+        appendBigEndian(output, static_cast<std::uint32_t>(data.size()));
+        const std::size_t start = output.size();
+        output.insert(output.end(), type, type + 4);
+        output.insert(output.end(), data.begin(), data.end());
+
+        // the CRC covers the type and the data
+        // the table is initialized once, also if several threads encode
+        static const std::vector<std::uint32_t> table = createCrcTable();
+        std::uint32_t crc = 0xFFFFFFFFu;
+        for (std::size_t i = start; i < output.size(); ++i)
+            crc = table[(crc ^ output[i]) & 0xFF] ^ (crc >> 8);
+        appendBigEndian(output, crc ^ 0xFFFFFFFFu);
+    }
+}
+
+
+namespace png
+{
+    void encode(const std::uint8_t* pixels, unsigned int width, unsigned int height, std::vector<std::uint8_t>& output)
+    {
+        // the scanlines start with the filter type, 0 leaves them as they are
+        const std::size_t lineSize = static_cast<std::size_t>(width) * 3 + 1;
+        std::vector<std::uint8_t> scanlines(lineSize * height);
+        for (unsigned int y = 0; y < height; ++y)
+        {
+            std::uint8_t* line = &scanlines[y * lineSize];
+            line[0] = 0;
+            const std::uint8_t* pixel = pixels + static_cast<std::size_t>(y) * width * 4;
+            for (unsigned int x = 0; x < width; ++x, pixel += 4)
+            {
+                line[1 + x * 3]     = pixel[0];
+                line[1 + x * 3 + 1] = pixel[1];
+                line[1 + x * 3 + 2] = pixel[2];
+            }
+        }
+
+        std::vector<std::uint8_t> header;
+        appendBigEndian(header, width);
+        appendBigEndian(header, height);
+        header.push_back(8); // bits per channel
+        header.push_back(2); // RGB
+        header.push_back(0); // deflate
+        header.push_back(0); // adaptive filtering
+        header.push_back(0); // not interlaced
+
+        // a zlib stream of stored blocks, followed by the Adler-32 of the scanlines
+        std::vector<std::uint8_t> data;
+        data.reserve(scanlines.size() + scanlines.size() / maximumBlockSize * 5 + 16);
+        data.push_back(0x78);
+        data.push_back(0x01);
+        std::size_t position = 0;
+        do
+        {
+            const std::size_t size = std::min(scanlines.size() - position, maximumBlockSize);
+            const bool isLast = (position + size == scanlines.size());
+            data.push_back(isLast ? 1 : 0);
+            data.push_back(static_cast<std::uint8_t>(size));
+            data.push_back(static_cast<std::uint8_t>(size >> 8));
+            data.push_back(static_cast<std::uint8_t>(~size));
+            data.push_back(static_cast<std::uint8_t>(~size >> 8));
+            data.insert(data.end(), scanlines.begin() + position, scanlines.begin() + position + size);
+            position += size;
+        }
+        while (position < scanlines.size());
+
+        std::uint32_t a = 1;
+        std::uint32_t b = 0;
+        for (std::uint8_t byte : scanlines)
+        {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        appendBigEndian(data, (b << 16) | a);
+
+        static const std::uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        output.assign(signature, signature + sizeof(signature));
+        appendChunk(output, "IHDR", header);
+        appendChunk(output, "IDAT", data);
+        appendChunk(output, "IEND", std::vector<std::uint8_t>());
+    }
+}
@@ -0,0 +1,45 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_PNG_HPP
+#define FFTSPECTRUM_PNG_HPP
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief An encoder for PNG images in memory (SFML can only save them to a file).
+ *        The image data is written as uncompressed deflate blocks, so encoding costs
+ *        little more than a copy and the CRC, at the price of the file size.
+ */
+namespace png
+{
+    /**
+     * @brief Encodes an 8 bit RGB image, the alpha channel of the pixels is dropped.
+     *
+     * @param pixels    The RGBA pixels, row by row from the top
+     * @param width     The number of columns
+     * @param height    The number of rows
+     * @param output    Receives the PNG file
+     */
+    void encode(const std::uint8_t* pixels, unsigned int width, unsigned int height, std::vector<std::uint8_t>& output);
+}
+
+#endif //FFTSPECTRUM_PNG_HPP
@@ -0,0 +1,146 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "PowerSpectrum.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace
+{
+    // log10 magnitudes, -8 to 5 in steps of 0.05, which is 1 dB of power
+    const float histogramMinimum = -8.f;
+    const float histogramMaximum = 5.f;
+    const float classWidth       = 0.05f;
+    const std::size_t classCount = static_cast<std::size_t>((histogramMaximum - histogramMinimum) / classWidth + 0.5f);
+}
+
+
+PowerSpectrum::PowerSpectrum(unsigned int binCount) :
+    m_binCount(binCount),
+    m_frameCount(0),
+    m_sums(binCount, 0.0),
+    m_maxima(binCount, 0.f),
+    m_histograms(binCount * classCount, 0)
+{
+
+}
+
+
+void PowerSpectrum::add(const float* powers, const float* levels)
+{
+    for (unsigned int bin = 0; bin < m_binCount; ++bin)
+    {
+        m_sums[bin] += powers[bin];
+        m_maxima[bin] = std::max(m_maxima[bin], powers[bin]);
+
+        const float position = (levels[bin] - histogramMinimum) / classWidth;
+        std::size_t level = 0;
+        if (position >= static_cast<float>(classCount))
+            level = classCount - 1;
+        else if (position > 0.f)
+            level = static_cast<std::size_t>(position);
+        ++m_histograms[bin * classCount + level];
+    }
+    ++m_frameCount;
+}
+
+
+void PowerSpectrum::merge(const PowerSpectrum& other)
+{
+    for (unsigned int bin = 0; bin < m_binCount; ++bin)
+    {
+        m_sums[bin] += other.m_sums[bin];
+        m_maxima[bin] = std::max(m_maxima[bin], other.m_maxima[bin]);
+    }
+    for (std::size_t i = 0; i < m_histograms.size(); ++i)
+        m_histograms[i] += other.m_histograms[i];
+
+    m_frameCount += other.m_frameCount;
+}
+
+
+void PowerSpectrum::clear()
+{
+    std::fill(m_sums.begin(), m_sums.end(), 0.0);
+    std::fill(m_maxima.begin(), m_maxima.end(), 0.f);
+    std::fill(m_histograms.begin(), m_histograms.end(), 0);
+    m_frameCount = 0;
+}
+
+
+unsigned int PowerSpectrum::getFrameCount() const
+{
+    return m_frameCount;
+}
+
+
+unsigned int PowerSpectrum::getBinCount() const
+{
+    return m_binCount;
+}
+
+
+void PowerSpectrum::getTraces(float percent, Traces& traces) const
+{
+    traces.mean.assign(m_binCount, 0.f);
+    traces.maximum.assign(m_maxima.begin(), m_maxima.end());
+    traces.percentile.assign(m_binCount, 0.f);
+    if (m_frameCount == 0)
+        return;
+
+    const double rank = std::min(std::max(percent, 0.f), 100.f) / 100.0 * m_frameCount;
+    for (unsigned int bin = 0; bin < m_binCount; ++bin)
+    {
+        traces.mean[bin] = static_cast<float>(m_sums[bin] / m_frameCount);
+
+        // walk the cumulative distribution of the bin until the rank is reached and interpolate inside the class
+        const std::uint32_t* histogram = &m_histograms[bin * classCount];
+        double cumulative = 0.0;
+        for (std::size_t i = 0; i < classCount; ++i)
+        {
+            const double next = cumulative + histogram[i];
+            if (next >= rank && histogram[i] > 0)
+            {
+                const double fraction = (rank - cumulative) / histogram[i];
+                const float level = histogramMinimum + (static_cast<float>(i) + static_cast<float>(fraction)) * classWidth;
+                traces.percentile[bin] = std::min(levelToPower(level), m_maxima[bin]);
+                break;
+            }
+            cumulative = next;
+        }
+    }
+}
+
+
+float PowerSpectrum::levelToPower(float level)
+{
+    // the inverse of log10(magnitude / 100 + epsilon)
+    const float magnitude = std::max(100.f * (std::pow(10.f, level) - std::numeric_limits<float>::epsilon()), 0.f);
+    return magnitude * magnitude;
+}
+
+
+std::size_t PowerSpectrum::estimateMemoryUsage(unsigned int binCount)
+{
+    return binCount * (sizeof(double) + sizeof(float) + classCount * sizeof(std::uint32_t));
+}
@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_POWERSPECTRUM_HPP
+#define FFTSPECTRUM_POWERSPECTRUM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The PowerSpectrum class accumulates the frames of a spectrogram into the
+ *        long-term statistics of every bin: the sum of the linear powers (for the Welch
+ *        average), their maximum and a histogram of the levels with 1 dB steps (for the
+ *        percentiles). Like the RangeEstimator, partial spectra of different threads
+ *        can be merged by adding them up.
+ */
+class PowerSpectrum
+{
+public:
+    /**
+     * @brief The statistics of every bin, as linear powers.
+     */
+    struct Traces
+    {
+        std::vector<float>  mean;
+        std::vector<float>  maximum;
+        std::vector<float>  percentile;
+    };
+
+    explicit PowerSpectrum(unsigned int binCount);
+
+    /**
+     * @brief Adds a frame.
+     *
+     * @param powers    The squared magnitudes of the bins
+     * @param levels    The same bins on the scale of FFT::logarithmicMagnitudeVector(),
+     *                  they are counted in the histogram without taking the logarithm again
+     */
+    void            add(const float* powers, const float* levels);
+
+    /**
+     * @brief Adds the frames of another spectrum with the same number of bins to this one.
+     */
+    void            merge(const PowerSpectrum& other);
+
+    void            clear();
+
+    unsigned int    getFrameCount() const;
+
+    unsigned int    getBinCount() const;
+
+    /**
+     * @brief Computes the mean, the maximum and the given percentile of every bin.
+     *        The percentiles are accurate to 1 dB.
+     *
+     * @param percent A value in range [0, 100]
+     */
+    void            getTraces(float percent, Traces& traces) const;
+
+    /**
+     * @brief Converts a value of FFT::logarithmicMagnitudeVector() back to the power of the bin.
+     */
+    static float    levelToPower(float level);
+
+    /**
+     * @brief Returns the bytes of a spectrum, mostly the histograms.
+     */
+    static std::size_t estimateMemoryUsage(unsigned int binCount);
+
+private:
+
+    unsigned int                m_binCount;
+    unsigned int                m_frameCount;
+    std::vector<double>         m_sums;
+    std::vector<float>          m_maxima;
+    std::vector<std::uint32_t>  m_histograms;   // one after the other for every bin
+};
+
+#endif //FFTSPECTRUM_POWERSPECTRUM_HPP
@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "RangeEstimator.hpp"
+
+#include <algorithm>
+#include <limits>
+
+
+namespace
+{
+    // log10 magnitudes, -8 (-160 dB) to 5 (+100 dB) in steps of 0.005 (0.1 dB)
+    const float histogramMinimum = -8.f;
+    const float histogramMaximum = 5.f;
+    const float binWidth         = 0.005f;
+    const std::size_t binCount   = static_cast<std::size_t>((histogramMaximum - histogramMinimum) / binWidth);
+}
+
+
+RangeEstimator::RangeEstimator() :
+    m_histogram(binCount, 0)
+{
+    clear();
+}
+
+
+void RangeEstimator::add(const float* values, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const float value = values[i];
+        m_minimum = std::min(m_minimum, value);
+        m_maximum = std::max(m_maximum, value);
+
+        const float position = (value - histogramMinimum) / binWidth;
+        std::size_t bin = 0;
+        if (position >= static_cast<float>(binCount))
+            bin = binCount - 1;
+        else if (position > 0.f)
+            bin = static_cast<std::size_t>(position);
+        ++m_histogram[bin];
+    }
+    m_count += count;
+}
+
+
+void RangeEstimator::merge(const RangeEstimator& other)
+{
+    for (std::size_t i = 0; i < binCount; ++i)
+        m_histogram[i] += other.m_histogram[i];
+
+    m_count += other.m_count;
+    m_minimum = std::min(m_minimum, other.m_minimum);
+    m_maximum = std::max(m_maximum, other.m_maximum);
+}
+
+
+void RangeEstimator::clear()
+{
+    std::fill(m_histogram.begin(), m_histogram.end(), 0);
+    m_count = 0;
+    m_minimum = std::numeric_limits<float>::max();
+    m_maximum = std::numeric_limits<float>::lowest();
+}
+
+
+bool RangeEstimator::isEmpty() const
+{
+    return m_count == 0;
+}
+
+
+float RangeEstimator::getPercentile(float percent) const
+{
+    if (m_count == 0)
+        return 0.f;
+    if (percent <= 0.f)
+        return m_minimum;
+    if (percent >= 100.f)
+        return m_maximum;
+
+    // walk the cumulative distribution until the rank is reached and interpolate inside the bin
+    const double rank = percent / 100.0 * static_cast<double>(m_count);
+    double cumulative = 0.0;
+    for (std::size_t i = 0; i < binCount; ++i)
+    {
+        const double next = cumulative + static_cast<double>(m_histogram[i]);
+        if (next >= rank && m_histogram[i] > 0)
+        {
+            const double fraction = (rank - cumulative) / static_cast<double>(m_histogram[i]);
+            const float value = histogramMinimum + (static_cast<float>(i) + static_cast<float>(fraction)) * binWidth;
+            return std::min(std::max(value, m_minimum), m_maximum);
+        }
+        cumulative = next;
+    }
+
+    return m_maximum;
+}
+
+
+float RangeEstimator::getMinimum() const
+{
+    return m_minimum;
+}
+
+
+float RangeEstimator::getMaximum() const
+{
+    return m_maximum;
+}
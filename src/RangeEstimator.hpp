@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_RANGEESTIMATOR_HPP
+#define FFTSPECTRUM_RANGEESTIMATOR_HPP
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The RangeEstimator class estimates the distribution of logarithmic
+ *        magnitudes while they are being generated. The values are counted in a
+ *        fixed-bin histogram (0.1 dB per bin), so adding a frame is cheap and two
+ *        estimators (e.g. from different threads) can be merged by adding their counts.
+ *        Percentiles are accurate to the width of one bin, the minimum and maximum are exact.
+ */
+class RangeEstimator
+{
+public:
+    RangeEstimator();
+
+    /**
+     * @brief Adds logarithmic magnitudes to the histogram.
+     *
+     * @param values  The values
+     * @param count   The number of values
+     */
+    void            add(const float* values, std::size_t count);
+
+    /**
+     * @brief Adds the counts of another estimator to this one.
+     */
+    void            merge(const RangeEstimator& other);
+
+    void            clear();
+
+    bool            isEmpty() const;
+
+    /**
+     * @brief Returns the value below which the given percentage of all values lie.
+     *
+     * @param percent A value in range [0, 100], 0 returns the minimum and 100 the maximum
+     */
+    float           getPercentile(float percent) const;
+
+    float           getMinimum() const;
+    float           getMaximum() const;
+
+private:
+
+    std::vector<std::uint64_t>  m_histogram;
+    std::uint64_t               m_count;
+    float                       m_minimum;
+    float                       m_maximum;
+};
+
+#endif //FFTSPECTRUM_RANGEESTIMATOR_HPP
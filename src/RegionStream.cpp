@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "RegionStream.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+RegionStream::RegionStream(std::shared_ptr<const sf::SoundBuffer> soundBuffer,
+                           std::shared_ptr<const FFTPlan> forwardPlan, std::shared_ptr<const FFTPlan> inversePlan) :
+    m_soundBuffer(soundBuffer),
+    m_resynthesizer(forwardPlan, inversePlan, soundBuffer->getSamples(),
+                    static_cast<std::size_t>(soundBuffer->getSampleCount() / soundBuffer->getChannelCount()),
+                    soundBuffer->getChannelCount(), soundBuffer->getSampleRate()),
+    m_rendered(std::max(soundBuffer->getSampleRate() / 50, 1u)),
+    m_chunk(m_rendered.size())
+{
+    initialize(1, soundBuffer->getSampleRate());
+}
+
+
+RegionStream::~RegionStream()
+{
+    // the streaming thread must not render into a destroyed resynthesizer
+    stop();
+}
+
+
+void RegionStream::setRegion(sf::Time start, sf::Time end, float lowFrequency, float highFrequency)
+{
+    stop();
+    m_start = start;
+    m_resynthesizer.setRegion(toSample(start), toSample(end), lowFrequency, highFrequency);
+}
+
+
+sf::Time RegionStream::getStart() const
+{
+    return m_start;
+}
+
+
+bool RegionStream::onGetData(Chunk& data)
+{
+    const std::size_t count = m_resynthesizer.render(&m_rendered[0], m_rendered.size());
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const float sample = std::min(std::max(m_rendered[i] * 32767.f, -32768.f), 32767.f);
+        m_chunk[i] = static_cast<sf::Int16>(std::lrint(sample));
+    }
+
+    data.samples = &m_chunk[0];
+    data.sampleCount = count;
+    return count == m_rendered.size();
+}
+
+
+void RegionStream::onSeek(sf::Time timeOffset)
+{
+    m_resynthesizer.seek(toSample(m_start + timeOffset));
+}
+
+
+std::size_t RegionStream::toSample(sf::Time time) const
+{
+    const sf::Int64 sample = time.asMicroseconds() * m_resynthesizer.getSampleRate() / 1000000;
+    return static_cast<std::size_t>(std::max<sf::Int64>(sample, 0));
+}
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_REGIONSTREAM_HPP
+#define FFTSPECTRUM_REGIONSTREAM_HPP
+
+#include "Resynthesizer.hpp"
+
+#include <SFML/Audio/SoundBuffer.hpp>
+#include <SFML/Audio/SoundStream.hpp>
+#include <SFML/System/Time.hpp>
+
+#include <memory>
+#include <vector>
+
+/**
+ * @brief The RegionStream class plays a time and frequency region of a sound. The
+ *        samples are resynthesized while they are played, in chunks of 20 ms, so a
+ *        new selection is heard right away instead of after filtering the whole region.
+ */
+class RegionStream : public sf::SoundStream
+{
+public:
+    /**
+     * @param soundBuffer   The sound the regions are taken from, mixed down to mono
+     * @param forwardPlan   A plan for the FFT length of the spectrogram
+     * @param inversePlan   A plan for the inverse FFT of the same length
+     */
+    RegionStream(std::shared_ptr<const sf::SoundBuffer> soundBuffer,
+                 std::shared_ptr<const FFTPlan> forwardPlan, std::shared_ptr<const FFTPlan> inversePlan);
+
+    ~RegionStream();
+
+    /**
+     * @brief Stops the stream and selects the region that is played next.
+     *
+     * @param start         The start of the region in the sound
+     * @param end           The end of the region in the sound
+     * @param lowFrequency  The lowest frequency that passes, in Hz
+     * @param highFrequency The highest frequency that passes, in Hz
+     */
+    void                setRegion(sf::Time start, sf::Time end, float lowFrequency, float highFrequency);
+
+    /**
+     * @brief Returns the start of the region in the sound. The playing offset of the
+     *        stream is relative to it.
+     */
+    sf::Time            getStart() const;
+
+private:
+
+    virtual bool        onGetData(Chunk& data);
+
+    virtual void        onSeek(sf::Time timeOffset);
+
+    std::size_t         toSample(sf::Time time) const;
+
+    std::shared_ptr<const sf::SoundBuffer>  m_soundBuffer;
+    Resynthesizer                           m_resynthesizer;
+    sf::Time                                m_start;
+    std::vector<float>                      m_rendered;
+    std::vector<sf::Int16>                  m_chunk;
+};
+
+#endif //FFTSPECTRUM_REGIONSTREAM_HPP
@@ -0,0 +1,200 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "ResourceCache.hpp"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+
+
+namespace
+{
+    // decoded sounds can be large, only keep a few of them
+    const std::size_t maximumSoundCount = 4;
+
+    std::time_t modificationTime(const std::string& filename)
+    {
+        struct stat status;
+        if (stat(filename.c_str(), &status) != 0)
+            return 0;
+        return status.st_mtime;
+    }
+}
+
+
+ResourceCache::ResourceCache()
+{
+
+}
+
+
+std::shared_ptr<const sf::SoundBuffer> ResourceCache::getSoundBuffer(const std::string& filename)
+{
+    std::shared_ptr<const sf::SoundBuffer> cached = findSoundBuffer(filename);
+    if (cached)
+        return cached;
+
+    std::shared_ptr<sf::SoundBuffer> soundBuffer = std::make_shared<sf::SoundBuffer>();
+    if (!soundBuffer->loadFromFile(filename))
+        return nullptr;
+
+    addSoundBuffer(filename, soundBuffer);
+    return soundBuffer;
+}
+
+
+std::shared_ptr<const sf::SoundBuffer> ResourceCache::findSoundBuffer(const std::string& filename)
+{
+    auto entry = std::find_if(m_sounds.begin(), m_sounds.end(),
+                              [&filename] (const SoundEntry& sound)
+                              {
+                                  return sound.filename == filename;
+                              });
+    if (entry == m_sounds.end())
+        return nullptr;
+
+    if (entry->modificationTime != modificationTime(filename))
+    {
+        // the file was modified, the cached sound is outdated
+        m_sounds.erase(entry);
+        return nullptr;
+    }
+
+    // move it to the front
+    m_sounds.splice(m_sounds.begin(), m_sounds, entry);
+    return m_sounds.front().soundBuffer;
+}
+
+
+void ResourceCache::addSoundBuffer(const std::string& filename, std::shared_ptr<const sf::SoundBuffer> soundBuffer)
+{
+    // an outdated entry of the same file is replaced
+    m_sounds.remove_if([&filename] (const SoundEntry& sound)
+                       {
+                           return sound.filename == filename;
+                       });
+
+    SoundEntry sound;
+    sound.filename = filename;
+    sound.modificationTime = modificationTime(filename);
+    sound.soundBuffer = soundBuffer;
+    m_sounds.push_front(sound);
+
+    if (m_sounds.size() > maximumSoundCount)
+        m_sounds.pop_back();
+}
+
+
+std::shared_ptr<const FFTPlan> ResourceCache::getFFTPlan(unsigned int FFTLength)
+{
+    std::shared_ptr<const FFTPlan>& plan = m_plans[FFTLength];
+    if (!plan)
+        plan = std::make_shared<const FFTPlan>(FFTLength);
+
+    return plan;
+}
+
+
+std::shared_ptr<const FFTPlan> ResourceCache::getInverseFFTPlan(unsigned int FFTLength)
+{
+    std::shared_ptr<const FFTPlan>& plan = m_inversePlans[FFTLength];
+    if (!plan)
+        plan = std::make_shared<const FFTPlan>(FFTLength, FFTPlan::Inverse);
+
+    return plan;
+}
+
+
+std::unique_ptr<sf::Texture> ResourceCache::acquireTexture(unsigned int width, unsigned int height)
+{
+    std::unique_ptr<sf::Texture> texture;
+
+    auto sameSize = std::find_if(m_textures.begin(), m_textures.end(),
+                                 [=] (const std::unique_ptr<sf::Texture>& recycled)
+                                 {
+                                     return recycled->getSize() == sf::Vector2u(width, height);
+                                 });
+    if (sameSize != m_textures.end())
+    {
+        texture = std::move(*sameSize);
+        m_textures.erase(sameSize);
+        return texture;
+    }
+
+    if (!m_textures.empty())
+    {
+        // create() reuses the OpenGL texture of a recycled one
+        texture = std::move(m_textures.back());
+        m_textures.pop_back();
+    }
+    else
+    {
+        texture = std::unique_ptr<sf::Texture>(new sf::Texture);
+    }
+
+    if (!texture->create(width, height))
+        return nullptr;
+
+    return texture;
+}
+
+
+std::unique_ptr<sf::Image> ResourceCache::acquireImage(unsigned int width, unsigned int height)
+{
+    std::unique_ptr<sf::Image> image;
+
+    if (!m_images.empty())
+    {
+        // the pixel memory of an image with the same size is reused by create()
+        auto sameSize = std::find_if(m_images.begin(), m_images.end(),
+                                     [=] (const std::unique_ptr<sf::Image>& recycled)
+                                     {
+                                         return recycled->getSize() == sf::Vector2u(width, height);
+                                     });
+        if (sameSize == m_images.end())
+            sameSize = m_images.end() - 1;
+
+        image = std::move(*sameSize);
+        m_images.erase(sameSize);
+    }
+    else
+    {
+        image = std::unique_ptr<sf::Image>(new sf::Image);
+    }
+
+    image->create(width, height, sf::Color::Black);
+
+    return image;
+}
+
+
+void ResourceCache::recycle(std::unique_ptr<sf::Texture> texture)
+{
+    if (texture)
+        m_textures.push_back(std::move(texture));
+}
+
+
+void ResourceCache::recycle(std::unique_ptr<sf::Image> image)
+{
+    if (image)
+        m_images.push_back(std::move(image));
+}
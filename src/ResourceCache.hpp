@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_RESOURCECACHE_HPP
+#define FFTSPECTRUM_RESOURCECACHE_HPP
+
+#include "FFT.hpp"
+
+#include <SFML/Audio/SoundBuffer.hpp>
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Texture.hpp>
+
+#include <ctime>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The ResourceCache class keeps expensive resources alive for the whole session,
+ *        so a spectrogram can be rebuilt with different parameters without starting from scratch:
+ *          - decoded sounds, keyed by path and modification time (the least recently used are dropped)
+ *          - FFT plans, keyed by length and direction
+ *          - textures and images of replaced spectrograms, which are handed out again
+ */
+class ResourceCache
+{
+public:
+    ResourceCache();
+
+    /**
+     * @brief Returns the decoded sound. It is only loaded from disk if it is not
+     *        in the cache or the file was modified since.
+     *
+     * @return The sound or nullptr if it could not be loaded
+     */
+    std::shared_ptr<const sf::SoundBuffer>  getSoundBuffer(const std::string& filename);
+
+    /**
+     * @brief Returns the decoded sound if it is in the cache and the file wasn't modified since.
+     *
+     * @return The sound or nullptr if it has to be decoded
+     */
+    std::shared_ptr<const sf::SoundBuffer>  findSoundBuffer(const std::string& filename);
+
+    /**
+     * @brief Adds a sound that was decoded elsewhere, for example by a SoundLoader.
+     */
+    void                                    addSoundBuffer(const std::string& filename, std::shared_ptr<const sf::SoundBuffer> soundBuffer);
+
+    /**
+     * @brief Returns a plan for a FFT of the given length, it is created on the first request.
+     */
+    std::shared_ptr<const FFTPlan>          getFFTPlan(unsigned int FFTLength);
+
+    /**
+     * @brief Returns a plan for an inverse FFT of the given length, it is created on the first request.
+     */
+    std::shared_ptr<const FFTPlan>          getInverseFFTPlan(unsigned int FFTLength);
+
+    /**
+     * @brief Returns a texture of the given size. A recycled texture with the same size
+     *        is preferred, otherwise a recycled one is resized or a new one is created.
+     *
+     * @return The texture or nullptr if it could not be created
+     */
+    std::unique_ptr<sf::Texture>            acquireTexture(unsigned int width, unsigned int height);
+
+    /**
+     * @brief Returns an image of the given size, filled with black.
+     */
+    std::unique_ptr<sf::Image>              acquireImage(unsigned int width, unsigned int height);
+
+    void                                    recycle(std::unique_ptr<sf::Texture> texture);
+    void                                    recycle(std::unique_ptr<sf::Image> image);
+
+private:
+
+    struct SoundEntry
+    {
+        std::string                             filename;
+        std::time_t                             modificationTime;
+        std::shared_ptr<const sf::SoundBuffer>  soundBuffer;
+    };
+
+    std::list<SoundEntry>                                   m_sounds;   // most recently used first
+    std::map<unsigned int, std::shared_ptr<const FFTPlan>>  m_plans;
+    std::map<unsigned int, std::shared_ptr<const FFTPlan>>  m_inversePlans;
+    std::vector<std::unique_ptr<sf::Texture>>               m_textures;
+    std::vector<std::unique_ptr<sf::Image>>                 m_images;
+};
+
+#endif //FFTSPECTRUM_RESOURCECACHE_HPP
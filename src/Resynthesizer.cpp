@@ -0,0 +1,163 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "Resynthesizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+Resynthesizer::Resynthesizer(std::shared_ptr<const FFTPlan> forwardPlan, std::shared_ptr<const FFTPlan> inversePlan,
+                             const sf::Int16* samples, std::size_t frameCount, unsigned int channelCount, unsigned int sampleRate) :
+    m_samples(samples),
+    m_frameCount(frameCount),
+    m_channelCount(channelCount),
+    m_sampleRate(sampleRate),
+    m_FFTSize(forwardPlan->getLength()),
+    m_hopSize(m_FFTSize / 2),
+    m_fft(forwardPlan),
+    m_inverseFFT(inversePlan),
+    m_window(m_FFTSize),
+    m_mask(m_FFTSize / 2 + 1, FFT::Scalar(0)),
+    m_input(m_FFTSize),
+    m_output(m_FFTSize),
+    m_tail(m_hopSize, 0.f),
+    m_hop(m_hopSize, 0.f),
+    m_firstSample(0),
+    m_lastSample(0),
+    m_nextFrame(0),
+    m_hopStart(0),
+    m_position(0)
+{
+    // periodic, so the windows of overlapping frames add up to exactly 1
+    const double pi = 3.141592653589793;
+    for (unsigned int j = 0; j < m_FFTSize; ++j)
+        m_window[j] = static_cast<FFT::Scalar>(0.5 - 0.5 * std::cos(2 * pi * j / m_FFTSize));
+}
+
+
+void Resynthesizer::setRegion(std::size_t firstSample, std::size_t lastSample, float lowFrequency, float highFrequency)
+{
+    m_firstSample = std::min(firstSample, m_frameCount);
+    m_lastSample = std::min(std::max(lastSample, m_firstSample), m_frameCount);
+
+    // the bins that touch the frequency range pass, the 1/N of the inverse is folded into the mask
+    const float binWidth = static_cast<float>(m_sampleRate) / m_FFTSize;
+    const unsigned int lastBin = m_FFTSize / 2;
+    const unsigned int lowBin = static_cast<unsigned int>(std::min(std::max(std::floor(lowFrequency / binWidth), 0.f), static_cast<float>(lastBin)));
+    const unsigned int highBin = static_cast<unsigned int>(std::min(std::max(std::ceil(highFrequency / binWidth), 0.f), static_cast<float>(lastBin)));
+    for (unsigned int k = 0; k <= lastBin; ++k)
+        m_mask[k] = (k >= lowBin && k <= highBin) ? FFT::Scalar(1) / m_FFTSize : FFT::Scalar(0);
+
+    seek(m_firstSample);
+}
+
+
+void Resynthesizer::seek(std::size_t sample)
+{
+    m_position = std::min(std::max(sample, m_firstSample), m_lastSample);
+
+    // the frames stay aligned to the start of the region, the frame before the hop of
+    // the position only provides the first half of that hop
+    const std::size_t hopIndex = (m_position - m_firstSample) / m_hopSize;
+    m_nextFrame = static_cast<std::ptrdiff_t>(m_firstSample + hopIndex * m_hopSize) - m_hopSize;
+    std::fill(m_tail.begin(), m_tail.end(), 0.f);
+    processFrame();
+}
+
+
+std::size_t Resynthesizer::render(float* output, std::size_t count)
+{
+    std::size_t written = 0;
+    while (written < count && m_position < m_lastSample)
+    {
+        // the hop of the seek can start before the sound, it is never rendered
+        const std::ptrdiff_t position = static_cast<std::ptrdiff_t>(m_position);
+        if (position >= m_hopStart + static_cast<std::ptrdiff_t>(m_hopSize))
+        {
+            processFrame();
+            continue;
+        }
+
+        const std::size_t hopEnd = static_cast<std::size_t>(m_hopStart) + m_hopSize;
+        const std::size_t length = std::min(std::min(count - written, hopEnd - m_position), m_lastSample - m_position);
+        const float* hop = &m_hop[m_position - static_cast<std::size_t>(m_hopStart)];
+        std::copy(hop, hop + length, output + written);
+        written += length;
+        m_position += length;
+    }
+
+    return written;
+}
+
+
+std::size_t Resynthesizer::getPosition() const
+{
+    return m_position;
+}
+
+
+unsigned int Resynthesizer::getSampleRate() const
+{
+    return m_sampleRate;
+}
+
+
+void Resynthesizer::processFrame()
+{
+    // mix down and scale like the spectrogram, the input outside of the region is silent
+    const float scale = 1.f / (32767.f * m_channelCount);
+    for (unsigned int j = 0; j < m_FFTSize; ++j)
+    {
+        const std::ptrdiff_t sample = m_nextFrame + j;
+        float sum = 0.f;
+        if (sample >= static_cast<std::ptrdiff_t>(m_firstSample) && sample < static_cast<std::ptrdiff_t>(m_lastSample))
+        {
+            const sf::Int16* frame = m_samples + static_cast<std::size_t>(sample) * m_channelCount;
+            for (unsigned int channel = 0; channel < m_channelCount; ++channel)
+                sum += frame[channel];
+        }
+        m_input[j] = sum * scale * m_window[j];
+    }
+
+    m_fft.process(&m_input[0]);
+
+    const std::vector<FFT::Scalar>& real = m_fft.realPart();
+    const std::vector<FFT::Scalar>& imag = m_fft.imagPart();
+    std::vector<FFT::Scalar>& maskedReal = m_inverseFFT.realPart();
+    std::vector<FFT::Scalar>& maskedImag = m_inverseFFT.imagPart();
+    for (std::size_t k = 0; k < m_mask.size(); ++k)
+    {
+        maskedReal[k] = real[k] * m_mask[k];
+        maskedImag[k] = imag[k] * m_mask[k];
+    }
+
+    m_inverseFFT.process(&m_output[0]);
+
+    // the first half completes the hop that starts at this frame, the second half waits for the next frame
+    for (unsigned int j = 0; j < m_hopSize; ++j)
+    {
+        m_hop[j] = m_tail[j] + static_cast<float>(m_output[j]);
+        m_tail[j] = static_cast<float>(m_output[m_hopSize + j]);
+    }
+
+    m_hopStart = m_nextFrame;
+    m_nextFrame += m_hopSize;
+}
@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_RESYNTHESIZER_HPP
+#define FFTSPECTRUM_RESYNTHESIZER_HPP
+
+#include "FFT.hpp"
+
+#include <SFML/Config.hpp>
+
+#include <memory>
+#include <vector>
+
+/**
+ * @brief The Resynthesizer class turns a time and frequency region of a sound back
+ *        into samples. It uses the framing of the spectrogram: a periodic Hann window
+ *        with a hop of half the FFT length. The bins outside the frequency range are
+ *        cleared, then the frames are transformed back and overlap-added. Hann windows
+ *        at that hop add up to 1, so an unmasked region comes out unchanged.
+ *
+ *        The samples are rendered on demand, one hop at a time, so a stream only has
+ *        to stay a few frames ahead of the playback.
+ */
+class Resynthesizer
+{
+public:
+    /**
+     * @param forwardPlan   A plan for the FFT length
+     * @param inversePlan   A plan for the inverse FFT of the same length
+     * @param samples       The interleaved samples, they have to outlive the resynthesizer
+     * @param frameCount    The number of samples per channel
+     * @param channelCount  The channels are mixed down to mono
+     * @param sampleRate    Converts the frequencies to bins
+     */
+    Resynthesizer(std::shared_ptr<const FFTPlan> forwardPlan, std::shared_ptr<const FFTPlan> inversePlan,
+                  const sf::Int16* samples, std::size_t frameCount, unsigned int channelCount, unsigned int sampleRate);
+
+    /**
+     * @brief Selects the region and seeks to its start. The input outside of it is
+     *        treated as silence.
+     *
+     * @param firstSample   The first sample of the region
+     * @param lastSample    One past the last sample of the region
+     * @param lowFrequency  The lowest frequency that passes, in Hz
+     * @param highFrequency The highest frequency that passes, in Hz
+     */
+    void            setRegion(std::size_t firstSample, std::size_t lastSample, float lowFrequency, float highFrequency);
+
+    /**
+     * @brief Continues the rendering at a sample, it is clamped to the region.
+     */
+    void            seek(std::size_t sample);
+
+    /**
+     * @brief Renders the next samples of the region.
+     *
+     * @return The number of samples written, less than count only at the end of the region
+     */
+    std::size_t     render(float* output, std::size_t count);
+
+    std::size_t     getPosition() const;
+
+    unsigned int    getSampleRate() const;
+
+private:
+
+    /**
+     * @brief Transforms the frame at m_nextFrame and completes the hop that starts there.
+     */
+    void            processFrame();
+
+    const sf::Int16*            m_samples;
+    const std::size_t           m_frameCount;
+    const unsigned int          m_channelCount;
+    const unsigned int          m_sampleRate;
+    const unsigned int          m_FFTSize;
+    const unsigned int          m_hopSize;
+    FFT                         m_fft;
+    InverseFFT                  m_inverseFFT;
+    std::vector<FFT::Scalar>    m_window;
+    std::vector<FFT::Scalar>    m_mask;     // 1/N inside the frequency range, 0 outside
+    std::vector<FFT::Scalar>    m_input;
+    std::vector<FFT::Scalar>    m_output;
+    std::vector<float>          m_tail;     // the second half of the last frame, waiting for the next one
+    std::vector<float>          m_hop;      // the completed samples from m_hopStart on
+    std::size_t                 m_firstSample;
+    std::size_t                 m_lastSample;
+    std::ptrdiff_t              m_nextFrame;
+    std::ptrdiff_t              m_hopStart;
+    std::size_t                 m_position;
+};
+
+#endif //FFTSPECTRUM_RESYNTHESIZER_HPP
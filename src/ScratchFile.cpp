@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "ScratchFile.hpp"
+
+#include <cstdio>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+ScratchFile::ScratchFile(std::size_t size) :
+    m_size(size),
+    m_data(nullptr),
+    m_handle(nullptr)
+{
+    map();
+
+    if (!m_data)
+    {
+        std::cout << "Could not map a scratch file of " << m_size / (1024 * 1024) << " MB, the buffer is kept in memory." << std::endl;
+        m_memory.reset(new unsigned char[m_size]);
+        m_data = m_memory.get();
+    }
+}
+
+
+ScratchFile::~ScratchFile()
+{
+    if (!m_memory)
+        unmap();
+}
+
+
+void* ScratchFile::getData() const
+{
+    return m_data;
+}
+
+
+std::size_t ScratchFile::getSize() const
+{
+    return m_size;
+}
+
+
+bool ScratchFile::isMapped() const
+{
+    return !m_memory;
+}
+
+
+#ifdef _WIN32
+
+void ScratchFile::map()
+{
+    const unsigned long long size = m_size;
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                        static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFFull), NULL);
+    if (!mapping)
+        return;
+
+    m_data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, m_size);
+    if (!m_data)
+    {
+        CloseHandle(mapping);
+        return;
+    }
+    m_handle = mapping;
+}
+
+
+void ScratchFile::unmap()
+{
+    UnmapViewOfFile(m_data);
+    CloseHandle(static_cast<HANDLE>(m_handle));
+}
+
+#else
+
+void ScratchFile::map()
+{
+    // the file of tmpfile() is removed when it is closed, even if the program crashes
+    std::FILE* file = std::tmpfile();
+    if (!file)
+        return;
+
+    const int descriptor = fileno(file);
+    if (ftruncate(descriptor, static_cast<off_t>(m_size)) != 0)
+    {
+        std::fclose(file);
+        return;
+    }
+
+    void* data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    if (data == MAP_FAILED)
+    {
+        std::fclose(file);
+        return;
+    }
+    m_data = data;
+    m_handle = file;
+}
+
+
+void ScratchFile::unmap()
+{
+    munmap(m_data, m_size);
+    std::fclose(static_cast<std::FILE*>(m_handle));
+}
+
+#endif
@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_SCRATCHFILE_HPP
+#define FFTSPECTRUM_SCRATCHFILE_HPP
+
+#include <cstddef>
+#include <memory>
+
+/**
+ * @brief The ScratchFile class maps a temporary file into memory, for buffers that can
+ *        be larger than the memory. The system writes the pages that weren't used for a
+ *        while back to the file instead of swapping, so the buffer should be walked
+ *        through in large blocks. The file is deleted when the object is destroyed.
+ *        On Windows the mapping is backed by the paging file. If nothing can be mapped,
+ *        the buffer is taken from the heap instead.
+ */
+class ScratchFile
+{
+public:
+    /**
+     * @param size The size of the buffer in bytes
+     */
+    explicit ScratchFile(std::size_t size);
+
+    ~ScratchFile();
+
+    /**
+     * @brief Returns the buffer, its contents are undefined until written.
+     */
+    void*           getData() const;
+
+    std::size_t     getSize() const;
+
+    /**
+     * @brief Returns false if the buffer is on the heap.
+     */
+    bool            isMapped() const;
+
+private:
+
+    ScratchFile(const ScratchFile&);
+    ScratchFile& operator=(const ScratchFile&);
+
+    void                                map();
+
+    void                                unmap();
+
+    const std::size_t                   m_size;
+    void*                               m_data;
+    void*                               m_handle;   // the FILE of the temporary file, or the HANDLE of the mapping on Windows
+    std::unique_ptr<unsigned char[]>    m_memory;   // only if nothing could be mapped
+};
+
+#endif //FFTSPECTRUM_SCRATCHFILE_HPP
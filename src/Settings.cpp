@@ -0,0 +1,253 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "Settings.hpp"
+#include "SettingsParser.hpp"
+#include "FrameSink.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+
+
+namespace
+{
+    bool isPowerOf2(int x)
+    {
+        // check if number is bigger than 1 and exactly on bit is set
+        return (x > 1) && !(x & (x - 1));
+    }
+
+    std::string trim(const std::string& text)
+    {
+        auto isSpace = [] (char character) { return std::isspace(static_cast<unsigned char>(character)) != 0; };
+        auto begin = std::find_if_not(text.begin(), text.end(), isSpace);
+        auto end = std::find_if_not(text.rbegin(), text.rend(), isSpace).base();
+        return (begin < end) ? std::string(begin, end) : std::string();
+    }
+
+    bool parseMode(const std::string& text, Settings::Mode& mode)
+    {
+        if (text == "stft")
+            mode = Settings::Mode::STFT;
+        else if (text == "reassigned")
+            mode = Settings::Mode::Reassigned;
+        else if (text == "transfer")
+            mode = Settings::Mode::Transfer;
+        else if (text == "multiresolution")
+            mode = Settings::Mode::MultiResolution;
+        else
+            return false;
+        return true;
+    }
+
+    // a missing key keeps the value from before, like an invalid one
+    template <typename T>
+    bool read(const SettingsParser& settings, const std::string& key, T& value)
+    {
+        if (settings.get(key, value))
+            return true;
+        std::cout << "The settings file has no " << key << ", the value from before is kept." << std::endl;
+        return false;
+    }
+}
+
+
+Settings::Settings() :
+    filenames(1, "1000Hz.wav"),
+    FFTSize(1024),
+    magnitudeFormat(MagnitudeStorage::Format::Float32),
+    magnitudeRange(MagnitudeStorage::Range::Fixed),
+    floorPercentile(0.f),
+    ceilingPercentile(100.f),
+    maxFrequency(0.f),
+    mode(Mode::STFT),
+    resolutionBands(3),
+    threads(0),
+    memoryLimit(0),
+    exportFormat("none"),
+    isExportingFeatures(false),
+    audioLatency(0),
+    isDecodingPipelined(true),
+    spectrumPercentile(90.f),
+    noiseFloorWindow(1.5f),
+    isHeadless(false)
+{
+
+}
+
+
+bool Settings::loadFromFile(const std::string& settingsFilename)
+{
+    SettingsParser settings;
+    if (!settings.loadFromFile(settingsFilename))
+    {
+        std::cout << "Could not load settings file!" << std::endl;
+        return false;
+    }
+
+    // several files can be compared, they are seperated by comma
+    std::vector<std::string> names;
+    settings.get("filename", names);
+    std::vector<std::string> newFilenames;
+    for (const std::string& name : names)
+    {
+        const std::string trimmed = trim(name);
+        if (!trimmed.empty())
+            newFilenames.push_back(trimmed);
+    }
+    if (newFilenames.empty())
+    {
+        std::cout << "There was no filename specified in the settings file!" << std::endl;
+        return false;
+    }
+    filenames = newFilenames;
+
+    int newFFTSize = static_cast<int>(FFTSize);
+    read(settings, "FFTSize", newFFTSize);
+    if (isPowerOf2(newFFTSize))
+        FFTSize = newFFTSize;
+    else
+        std::cout << "The FFTSize has to be a power of 2." << std::endl;
+
+    std::string format;
+    if (read(settings, "magnitudeFormat", format) && !MagnitudeStorage::parseFormat(format, magnitudeFormat))
+        std::cout << "Unknown magnitudeFormat: " << format << std::endl;
+
+    std::string range;
+    if (read(settings, "magnitudeRange", range) && !MagnitudeStorage::parseRange(range, magnitudeRange))
+        std::cout << "Unknown magnitudeRange: " << range << std::endl;
+
+    float newFloorPercentile = floorPercentile;
+    float newCeilingPercentile = ceilingPercentile;
+    read(settings, "floorPercentile", newFloorPercentile);
+    read(settings, "ceilingPercentile", newCeilingPercentile);
+    if (0.f <= newFloorPercentile && newFloorPercentile < newCeilingPercentile && newCeilingPercentile <= 100.f)
+    {
+        floorPercentile = newFloorPercentile;
+        ceilingPercentile = newCeilingPercentile;
+    }
+    else
+    {
+        std::cout << "The percentiles have to be in range [0, 100] and the floor has to be below the ceiling." << std::endl;
+    }
+
+    float newMaxFrequency = maxFrequency;
+    read(settings, "maxFrequency", newMaxFrequency);
+    if (newMaxFrequency >= 0.f)
+        maxFrequency = newMaxFrequency;
+    else
+        std::cout << "The maxFrequency can't be negative." << std::endl;
+
+    std::string newMode;
+    if (read(settings, "mode", newMode) && !parseMode(newMode, mode))
+        std::cout << "Unknown mode: " << newMode << std::endl;
+
+    int newResolutionBands = static_cast<int>(resolutionBands);
+    read(settings, "resolutionBands", newResolutionBands);
+    if (1 <= newResolutionBands && newResolutionBands <= 8)
+        resolutionBands = newResolutionBands;
+    else
+        std::cout << "The resolutionBands have to be in range [1, 8]." << std::endl;
+
+    int newThreads = static_cast<int>(threads);
+    read(settings, "threads", newThreads);
+    if (newThreads >= 0)
+        threads = newThreads;
+    else
+        std::cout << "The number of threads can't be negative." << std::endl;
+
+    int newMemoryLimit = static_cast<int>(memoryLimit);
+    read(settings, "memoryLimit", newMemoryLimit);
+    if (newMemoryLimit >= 0)
+        memoryLimit = newMemoryLimit;
+    else
+        std::cout << "The memoryLimit can't be negative." << std::endl;
+
+    std::string newExportFormat = exportFormat;
+    read(settings, "exportFormat", newExportFormat);
+    if (FrameSink::isKnownFormat(newExportFormat))
+        exportFormat = newExportFormat;
+    else
+        std::cout << "Unknown exportFormat: " << newExportFormat << std::endl;
+
+    std::string features = isExportingFeatures ? "npy" : "none";
+    read(settings, "features", features);
+    if (features == "none" || features == "npy")
+        isExportingFeatures = (features == "npy");
+    else
+        std::cout << "Unknown features: " << features << std::endl;
+
+    int newAudioLatency = static_cast<int>(audioLatency);
+    read(settings, "audioLatency", newAudioLatency);
+    if (newAudioLatency >= 0)
+        audioLatency = newAudioLatency;
+    else
+        std::cout << "The audioLatency can't be negative." << std::endl;
+
+    std::string decoding = isDecodingPipelined ? "pipelined" : "whole";
+    read(settings, "decoding", decoding);
+    if (decoding == "pipelined" || decoding == "whole")
+        isDecodingPipelined = (decoding == "pipelined");
+    else
+        std::cout << "Unknown decoding: " << decoding << std::endl;
+
+    float newSpectrumPercentile = spectrumPercentile;
+    read(settings, "spectrumPercentile", newSpectrumPercentile);
+    if (0.f <= newSpectrumPercentile && newSpectrumPercentile <= 100.f)
+        spectrumPercentile = newSpectrumPercentile;
+    else
+        std::cout << "The spectrumPercentile has to be in range [0, 100]." << std::endl;
+
+    float newNoiseFloorWindow = noiseFloorWindow;
+    read(settings, "noiseFloorWindow", newNoiseFloorWindow);
+    if (newNoiseFloorWindow > 0.f)
+        noiseFloorWindow = newNoiseFloorWindow;
+    else
+        std::cout << "The noiseFloorWindow has to be positive." << std::endl;
+
+    return true;
+}
+
+
+unsigned int Settings::compare(const Settings& other) const
+{
+    unsigned int changes = None;
+
+    if (filenames != other.filenames || isDecodingPipelined != other.isDecodingPipelined)
+        changes |= Sound;
+    if (FFTSize != other.FFTSize || maxFrequency != other.maxFrequency || mode != other.mode || resolutionBands != other.resolutionBands
+        || noiseFloorWindow != other.noiseFloorWindow)
+        changes |= Transform;
+    if (magnitudeFormat != other.magnitudeFormat || magnitudeRange != other.magnitudeRange)
+        changes |= Storage;
+    if (floorPercentile != other.floorPercentile || ceilingPercentile != other.ceilingPercentile)
+        changes |= Colors;
+    if (threads != other.threads || memoryLimit != other.memoryLimit)
+        changes |= Resources;
+    if (exportFormat != other.exportFormat || isExportingFeatures != other.isExportingFeatures)
+        changes |= Export;
+    if (audioLatency != other.audioLatency)
+        changes |= Playback;
+    if (spectrumPercentile != other.spectrumPercentile)
+        changes |= Spectrum;
+
+    return changes;
+}
@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_SETTINGS_HPP
+#define FFTSPECTRUM_SETTINGS_HPP
+
+#include "MagnitudeStorage.hpp"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief The Settings struct is a validated snapshot of the settings file.
+ *        It is parsed once, after that the values can be read directly.
+ */
+struct Settings
+{
+    /**
+     * @brief Flags describing which part of the pipeline is affected by a change.
+     */
+    enum Change
+    {
+        None      = 0,
+        Sound     = 1 << 0,   ///< a different file has to be loaded, or the files are decoded differently
+        Transform = 1 << 1,   ///< the FFT has to be redone
+        Storage   = 1 << 2,   ///< the magnitudes have to be stored differently
+        Colors    = 1 << 3,   ///< only the image has to be recolorized
+        Resources = 1 << 4,   ///< the thread pool or the memory limit changed
+        Export    = 1 << 5,   ///< the spectrograms have to be generated again to be exported
+        Playback  = 1 << 6,   ///< only the playback cursor is affected
+        Spectrum  = 1 << 7    ///< only the average spectrum has to be drawn again
+    };
+
+    /**
+     * @brief How the magnitudes of a frame are computed.
+     */
+    enum class Mode
+    {
+        STFT,       ///< the plain short-time Fourier transform
+        Reassigned, ///< the energy is moved to the instantaneous frequency and the group delay
+        Transfer,   ///< the second channel is the response to the first, the gain of every frame is shown
+        MultiResolution ///< the window gets shorter from band to band towards the high frequencies
+    };
+
+    Settings();
+
+    /**
+     * @brief Reads and validates the settings file. Values that are missing
+     *        or invalid keep the value they had before and a message is printed.
+     *
+     * @param filename The path to the settings file
+     *
+     * @return false if the file could not be read or contains no filename
+     */
+    bool            loadFromFile(const std::string& filename);
+
+    /**
+     * @brief Compares two snapshots.
+     *
+     * @return A combination of Change flags
+     */
+    unsigned int    compare(const Settings& other) const;
+
+    std::vector<std::string>    filenames;          ///< one pane is shown per file
+    unsigned int                FFTSize;
+    MagnitudeStorage::Format    magnitudeFormat;
+    MagnitudeStorage::Range     magnitudeRange;
+    float                       floorPercentile;
+    float                       ceilingPercentile;
+    float                       maxFrequency;       ///< in Hz, higher frequencies are discarded (0 keeps all)
+    Mode                        mode;
+    unsigned int                resolutionBands;    ///< of the multi-resolution mode, FFTSize is the window of the lowest band
+    unsigned int                threads;            ///< 0 uses one thread per core
+    unsigned int                memoryLimit;        ///< in megabytes, 0 means unlimited
+    std::string                 exportFormat;       ///< none, npy or chunked
+    bool                        isExportingFeatures; ///< the FeatureExtractor features are written to <filename>.features.npy
+    unsigned int                audioLatency;       ///< in milliseconds, the playback cursor is delayed by it
+    bool                        isDecodingPipelined; ///< the frames are transformed while the sound is decoded, only affects sounds that are not cached
+    float                       spectrumPercentile; ///< drawn in the average spectrum besides the mean and the maximum
+    float                       noiseFloorWindow;   ///< in seconds, the whitened image subtracts the minimum of every bin over this time
+    bool                        isHeadless;         ///< no image is kept, for the tools that never draw, not read from the file
+};
+
+#endif //FFTSPECTRUM_SETTINGS_HPP
@@ -39,10 +39,11 @@ public:
 
     bool isChanged() const;
     
+    // the value is left as it is if the key is missing, then false is returned
     template<typename T>
-    void get(const std::string& key, T & value) const;
+    bool get(const std::string& key, T & value) const;
     template<typename T>
-    void get(const std::string& key, std::vector<T> &value) const;
+    bool get(const std::string& key, std::vector<T> &value) const;
     
     template<typename T>
     void set(const std::string &key, const T value);
@@ -183,12 +184,14 @@ inline std::string SettingsParser::convertToType<std::string>(const std::string
 }
 
 template<typename T>
-inline void SettingsParser::get(const std::string& key, T &value) const {
+inline bool SettingsParser::get(const std::string& key, T &value) const {
     auto it = m_data.find(key);
     
     if (it != m_data.end()){
         value = convertToType<T>(it->second);
+        return true;
     }
+    return false;
 }
 
 /**
@@ -196,20 +199,22 @@ inline void SettingsParser::get(const std::string& key, T &value) const {
  * seperated by comma. The vector is cleared before it is filled.
  */
 template<typename T>
-inline void SettingsParser::get(const std::string& key, std::vector<T> &value) const {
+inline bool SettingsParser::get(const std::string& key, std::vector<T> &value) const {
     auto it = m_data.find(key);
-    if (it != m_data.end()){
+    if (it == m_data.end()){
+        return false;
+    }
         
-        std::string output;
-        std::istringstream parser(it->second);
+    std::string output;
+    std::istringstream parser(it->second);
         
-        value.clear();
+    value.clear();
         
-        //split by comma
-        while (getline(parser, output, ',')){
-            value.push_back(convertToType<T>(output));
-        }
+    //split by comma
+    while (getline(parser, output, ',')){
+        value.push_back(convertToType<T>(output));
     }
+    return true;
 }
 
 template<typename T>
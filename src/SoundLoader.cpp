@@ -0,0 +1,353 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "SoundLoader.hpp"
+
+#include <algorithm>
+
+
+namespace
+{
+    // about 6 seconds at 44.1 kHz, long enough that the seek at the start doesn't matter
+    const std::size_t segmentLength = 1 << 18;
+
+    // a job decodes this many samples per channel, a few milliseconds for FLAC
+    const std::size_t blockLength = 1 << 14;
+
+    // a segment may only start this many segments (times the active ones) after the first unfinished one
+    const std::size_t lookahead = 2;
+}
+
+
+SoundLoader::SoundLoader() :
+    m_channelCount(0),
+    m_sampleRate(0),
+    m_pool(nullptr),
+    m_priority(ThreadPool::Priority::Low),
+    m_notifiedSamples(0),
+    m_isNotifiedDone(false),
+    m_cancelled(false),
+    m_hasFailed(false),
+    m_decodedSamples(0),
+    m_nextSegment(0),
+    m_prefixSegment(0),
+    m_activeSegments(0),
+    m_maximumActiveSegments(1),
+    m_pendingJobs(0)
+{
+
+}
+
+
+SoundLoader::~SoundLoader()
+{
+    stop();
+}
+
+
+bool SoundLoader::openFromFile(const std::string& filename)
+{
+    sf::InputSoundFile file;
+    if (!file.openFromFile(filename))
+        return false;
+
+    m_filename = filename;
+    m_channelCount = file.getChannelCount();
+    m_sampleRate = file.getSampleRate();
+    m_samples.assign(static_cast<std::size_t>(file.getSampleCount()), 0);
+
+    // the segments start at the first channel of a sample
+    const std::size_t segmentSamples = segmentLength * m_channelCount;
+    for (std::size_t first = 0; first < m_samples.size(); first += segmentSamples)
+    {
+        Segment segment;
+        segment.first = first;
+        segment.last = std::min(first + segmentSamples, m_samples.size());
+        segment.decoded = 0;
+        m_segments.push_back(std::move(segment));
+    }
+
+    return true;
+}
+
+
+void SoundLoader::start(ThreadPool& pool, ThreadPool::Priority priority, Listener listener)
+{
+    m_pool = &pool;
+    m_priority = priority;
+    {
+        std::lock_guard<std::mutex> lock(m_listenerMutex);
+        m_listener = listener;
+    }
+    m_clock.restart();
+
+    // half of the threads decode, the others transform what is decoded
+    m_maximumActiveSegments = std::max(pool.getThreadCount() / 2, 1u);
+
+    std::size_t started;
+    std::size_t nextSegment;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        started = startSegments();
+        nextSegment = m_nextSegment;
+    }
+    for (std::size_t segment = nextSegment - started; segment < nextSegment; ++segment)
+        submitSegment(segment);
+
+    // an empty sound is done right away
+    if (m_segments.empty())
+        publish();
+}
+
+
+void SoundLoader::stop()
+{
+    m_cancelled = true;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_jobsDone.wait(lock, [this] { return m_pendingJobs == 0; });
+    }
+
+    std::lock_guard<std::mutex> lock(m_listenerMutex);
+    m_listener = nullptr;
+}
+
+
+void SoundLoader::setPriority(ThreadPool::Priority priority)
+{
+    m_priority = priority;
+}
+
+
+const std::string& SoundLoader::getFilename() const
+{
+    return m_filename;
+}
+
+
+const sf::Int16* SoundLoader::getSamples() const
+{
+    return m_samples.empty() ? nullptr : &m_samples[0];
+}
+
+
+std::size_t SoundLoader::getSampleCount() const
+{
+    return m_samples.size();
+}
+
+
+unsigned int SoundLoader::getChannelCount() const
+{
+    return m_channelCount;
+}
+
+
+unsigned int SoundLoader::getSampleRate() const
+{
+    return m_sampleRate;
+}
+
+
+sf::Time SoundLoader::getDuration() const
+{
+    if (m_channelCount == 0 || m_sampleRate == 0)
+        return sf::Time::Zero;
+    return sf::seconds(static_cast<float>(m_samples.size()) / m_channelCount / m_sampleRate);
+}
+
+
+std::size_t SoundLoader::getDecodedSampleCount() const
+{
+    return m_decodedSamples;
+}
+
+
+bool SoundLoader::isDone() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_soundBuffer != nullptr;
+}
+
+
+bool SoundLoader::hasFailed() const
+{
+    return m_hasFailed;
+}
+
+
+std::shared_ptr<const sf::SoundBuffer> SoundLoader::getSoundBuffer() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_soundBuffer;
+}
+
+
+sf::Time SoundLoader::getDecodeTime() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_decodeTime;
+}
+
+
+void SoundLoader::releaseSamples()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_soundBuffer)
+        std::vector<sf::Int16>().swap(m_samples);
+}
+
+
+std::size_t SoundLoader::startSegments()
+{
+    std::size_t started = 0;
+    const std::size_t end = std::min(m_prefixSegment + lookahead * m_maximumActiveSegments, m_segments.size());
+    while (m_activeSegments < m_maximumActiveSegments && m_nextSegment < end)
+    {
+        ++m_activeSegments;
+        ++m_nextSegment;
+        ++started;
+    }
+    return started;
+}
+
+
+void SoundLoader::advancePrefix()
+{
+    while (m_prefixSegment < m_segments.size() && m_segments[m_prefixSegment].first + m_segments[m_prefixSegment].decoded == m_segments[m_prefixSegment].last)
+        ++m_prefixSegment;
+}
+
+
+void SoundLoader::submitSegment(std::size_t segment)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_pendingJobs;
+    }
+    m_pool->submit([this, segment]
+                   {
+                       decodeBlock(segment);
+                       finishJob();
+                   }, m_priority);
+}
+
+
+void SoundLoader::decodeBlock(std::size_t index)
+{
+    if (m_cancelled)
+        return;
+
+    // only one job at a time works on a segment, the others only read its progress under the lock
+    Segment& segment = m_segments[index];
+    std::size_t position = segment.first + segment.decoded;
+    if (!segment.file)
+    {
+        segment.file.reset(new sf::InputSoundFile);
+        if (segment.file->openFromFile(m_filename))
+            segment.file->seek(static_cast<sf::Uint64>(position));
+        else
+            segment.file.reset();
+    }
+
+    const std::size_t count = std::min(blockLength * m_channelCount, segment.last - position);
+    const std::size_t read = segment.file ? static_cast<std::size_t>(segment.file->read(&m_samples[position], count)) : 0;
+    position += read;
+    if (read < count)
+    {
+        // the rest of the segment stays silent, so the spectrogram can still be finished
+        m_hasFailed = true;
+        position = segment.last;
+    }
+
+    const bool isFinished = (position == segment.last);
+    if (isFinished)
+        segment.file.reset();
+
+    std::size_t started = 0;
+    std::size_t nextSegment;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        segment.decoded = position - segment.first;
+        if (isFinished)
+        {
+            --m_activeSegments;
+
+            // the first unfinished segment may have moved, which allows more segments to start
+            advancePrefix();
+            started = startSegments();
+        }
+        nextSegment = m_nextSegment;
+    }
+
+    if (!isFinished)
+        submitSegment(index);
+    for (std::size_t next = nextSegment - started; next < nextSegment; ++next)
+        submitSegment(next);
+
+    // the chunks that the listener submits are newer, so a thread runs them before the next block
+    publish();
+}
+
+
+void SoundLoader::publish()
+{
+    // the listener sees the prefix grow in order
+    std::lock_guard<std::mutex> listenerLock(m_listenerMutex);
+
+    std::size_t decodedSamples;
+    bool needsSoundBuffer;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        advancePrefix();
+        decodedSamples = (m_prefixSegment < m_segments.size()) ? m_segments[m_prefixSegment].first + m_segments[m_prefixSegment].decoded : m_samples.size();
+        needsSoundBuffer = (m_prefixSegment == m_segments.size() && !m_soundBuffer);
+    }
+    m_decodedSamples = decodedSamples;
+
+    // the sound buffer is complete before anybody is told, so the samples can be released after
+    if (needsSoundBuffer && !m_cancelled)
+    {
+        std::shared_ptr<sf::SoundBuffer> soundBuffer = std::make_shared<sf::SoundBuffer>();
+        if (!m_samples.empty())
+            soundBuffer->loadFromSamples(&m_samples[0], m_samples.size(), m_channelCount, m_sampleRate);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_soundBuffer = soundBuffer;
+        m_decodeTime = m_clock.getElapsedTime();
+    }
+
+    const bool isDone = m_isNotifiedDone || (needsSoundBuffer && !m_cancelled);
+    if (m_listener && !m_cancelled && (decodedSamples > m_notifiedSamples || isDone != m_isNotifiedDone))
+    {
+        m_notifiedSamples = decodedSamples;
+        m_isNotifiedDone = isDone;
+        m_listener(decodedSamples, isDone);
+    }
+}
+
+
+void SoundLoader::finishJob()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    --m_pendingJobs;
+    if (m_pendingJobs == 0)
+        m_jobsDone.notify_all();
+}
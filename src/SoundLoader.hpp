@@ -0,0 +1,200 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_SOUNDLOADER_HPP
+#define FFTSPECTRUM_SOUNDLOADER_HPP
+
+#include "ThreadPool.hpp"
+
+#include <SFML/Audio/InputSoundFile.hpp>
+#include <SFML/Audio/SoundBuffer.hpp>
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Time.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The SoundLoader class decodes a sound on the thread pool while its spectrogram
+ *        is generated, instead of decoding all of it before the first FFT. The file is
+ *        split into segments of a few seconds. Every segment opens the file on its own
+ *        and seeks to its start, so compressed formats like FLAC are decoded on several
+ *        threads at once. A job decodes one block of a segment and submits the next one,
+ *        so the jobs stay short like the chunks of the spectrogram.
+ *
+ *        The samples are decoded straight into their final place. The listener is told
+ *        whenever the decoded prefix grows, so the frames can be transformed as soon as
+ *        their samples are there. Only a few segments are decoded at a time and they may
+ *        only run a few segments ahead of the prefix, so the pool keeps threads for the
+ *        FFT and the prefix grows steadily.
+ *
+ *        When all samples are decoded they are copied into a sf::SoundBuffer for the
+ *        playback. After that the decoded samples can be released.
+ */
+class SoundLoader
+{
+public:
+    /**
+     * @brief Is called from the jobs when the decoded prefix grows.
+     *
+     * @param decodedSamples The number of samples (of all channels) that are decoded from the start on
+     * @param isDone         Whether the sound buffer is available
+     */
+    typedef std::function<void(std::size_t decodedSamples, bool isDone)> Listener;
+
+    SoundLoader();
+
+    /**
+     * @brief Stops the decoding.
+     */
+    ~SoundLoader();
+
+    /**
+     * @brief Reads the header of the file and allocates the samples.
+     *
+     * @return false if the file could not be opened
+     */
+    bool                openFromFile(const std::string& filename);
+
+    /**
+     * @brief Starts decoding the sound on the pool.
+     *
+     * @param listener Is told about the progress, also called from the jobs
+     */
+    void                start(ThreadPool& pool, ThreadPool::Priority priority, Listener listener);
+
+    /**
+     * @brief Cancels the decoding and waits for the running jobs. The listener isn't called after.
+     *        It has to be called before the pool is destroyed.
+     */
+    void                stop();
+
+    void                setPriority(ThreadPool::Priority priority);
+
+    const std::string&  getFilename() const;
+
+    /**
+     * @brief Returns the interleaved samples. Only the decoded prefix is valid.
+     */
+    const sf::Int16*    getSamples() const;
+
+    std::size_t         getSampleCount() const;
+
+    unsigned int        getChannelCount() const;
+
+    unsigned int        getSampleRate() const;
+
+    sf::Time            getDuration() const;
+
+    std::size_t         getDecodedSampleCount() const;
+
+    bool                isDone() const;
+
+    /**
+     * @brief Returns whether a segment could not be decoded, it is silent then.
+     */
+    bool                hasFailed() const;
+
+    /**
+     * @brief Returns the decoded sound, or null while it is being decoded.
+     */
+    std::shared_ptr<const sf::SoundBuffer>  getSoundBuffer() const;
+
+    /**
+     * @brief Returns how long it took from the start until the sound buffer was available.
+     */
+    sf::Time            getDecodeTime() const;
+
+    /**
+     * @brief Frees the decoded samples, once nobody reads them anymore. The sound buffer is kept.
+     */
+    void                releaseSamples();
+
+private:
+
+    SoundLoader(const SoundLoader&);
+    SoundLoader& operator=(const SoundLoader&);
+
+    struct Segment
+    {
+        std::unique_ptr<sf::InputSoundFile> file;   // open while the segment is decoded
+        std::size_t                         first;  // in samples of all channels
+        std::size_t                         last;
+        std::size_t                         decoded;
+    };
+
+    /**
+     * @brief Starts the segments that may be decoded now, m_mutex has to be locked.
+     *
+     * @return The number of started segments, they are m_nextSegment - count to m_nextSegment
+     */
+    std::size_t         startSegments();
+
+    /**
+     * @brief Skips the finished segments at the start of the prefix, m_mutex has to be locked.
+     */
+    void                advancePrefix();
+
+    void                submitSegment(std::size_t segment);
+
+    /**
+     * @brief Decodes the next block of a segment.
+     */
+    void                decodeBlock(std::size_t segment);
+
+    /**
+     * @brief Advances the decoded prefix and tells the listener about it.
+     */
+    void                publish();
+
+    void                finishJob();
+
+    std::string                             m_filename;
+    std::vector<sf::Int16>                  m_samples;
+    unsigned int                            m_channelCount;
+    unsigned int                            m_sampleRate;
+    std::vector<Segment>                    m_segments;
+    ThreadPool*                             m_pool;
+    std::atomic<ThreadPool::Priority>       m_priority;
+    Listener                                m_listener;         // guarded by m_listenerMutex
+    std::size_t                             m_notifiedSamples;  // guarded by m_listenerMutex
+    bool                                    m_isNotifiedDone;   // guarded by m_listenerMutex
+    std::mutex                              m_listenerMutex;    // also keeps the calls of the listener in order
+    std::atomic<bool>                       m_cancelled;
+    std::atomic<bool>                       m_hasFailed;
+    std::atomic<std::size_t>                m_decodedSamples;
+    std::size_t                             m_nextSegment;      // guarded by m_mutex
+    std::size_t                             m_prefixSegment;    // the first segment that isn't finished, guarded by m_mutex
+    std::size_t                             m_activeSegments;   // guarded by m_mutex
+    std::size_t                             m_maximumActiveSegments;
+    unsigned int                            m_pendingJobs;      // guarded by m_mutex
+    std::shared_ptr<const sf::SoundBuffer>  m_soundBuffer;      // guarded by m_mutex
+    sf::Clock                               m_clock;
+    sf::Time                                m_decodeTime;       // guarded by m_mutex
+    mutable std::mutex                      m_mutex;
+    std::condition_variable                 m_jobsDone;
+};
+
+#endif //FFTSPECTRUM_SOUNDLOADER_HPP
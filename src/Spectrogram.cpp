@@ -21,81 +21,1128 @@
 #include "Spectrogram.hpp"
 
 #include "Interpolation.hpp"
+#include "Decimator.hpp"
 
 #include <iostream>
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <limits>
+#include <thread>
 
-Spectrogram::Spectrogram(const sf::SoundBuffer &soundBuffer, unsigned int FFTSize) :
-    m_FFTSize(FFTSize),
+namespace
+{
+    // a chunk should take a few milliseconds, so priority changes take effect quickly
+    const unsigned int framesPerChunk = 32;
+
+    // a texture can't be much higher, the out-of-core transforms keep the loudest bin of every group of rows
+    const unsigned int maxRowCount = 16384;
+
+    bool isOutOfCore(const Settings& settings)
+    {
+        return settings.FFTSize > Spectrogram::largestInCoreSize;
+    }
+
+    unsigned int numberOfRepeats(std::size_t sampleCount, unsigned int FFTSize)
+    {
+        // the samples get padded with 0's until they can be devided through FFTSize without remainder
+        std::size_t paddedCount = sampleCount + FFTSize - (sampleCount % FFTSize);
+        // -1 to avoid out of bounds reading on last iteration because of our 50% sliding window
+        return static_cast<unsigned int>(paddedCount / (FFTSize / 2) - 1);
+    }
+
+    std::size_t decimatedSampleCount(std::size_t sampleCount, unsigned int channelCount, unsigned int decimationFactor, Settings::Mode mode)
+    {
+        // without decimation the interleaved channels are transformed as one stream, the bands are always mixed down
+        if (decimationFactor == 1 && mode != Settings::Mode::MultiResolution)
+            return sampleCount;
+
+        // the channels are mixed down and every stage keeps (n + 1) / 2 samples
+        std::size_t monoCount = sampleCount / channelCount;
+        for (unsigned int factor = decimationFactor; factor > 1; factor /= 2)
+            monoCount = (monoCount + 1) / 2;
+        return monoCount;
+    }
+
+    float effectiveSampleRate(unsigned int sampleRate, unsigned int channelCount, unsigned int decimationFactor, Settings::Mode mode)
+    {
+        if (decimationFactor == 1 && mode != Settings::Mode::MultiResolution)
+            return static_cast<float>(sampleRate * channelCount);
+        return static_cast<float>(sampleRate) / decimationFactor;
+    }
+
+    unsigned int displayedBinCount(const Settings& settings, float sampleRate)
+    {
+        // rows above the frequency of interest are not shown
+        const unsigned int outputSize = settings.FFTSize / 2 + 1;
+        if (settings.maxFrequency <= 0.f)
+            return outputSize;
+        const float binWidth = sampleRate / settings.FFTSize;
+        return std::min(static_cast<unsigned int>(std::ceil(settings.maxFrequency / binWidth)) + 1, outputSize);
+    }
+
+    unsigned int binsPerRow(const Settings& settings, float sampleRate)
+    {
+        // a power of 2, so a row covers the same bins in every frame
+        const unsigned int binCount = displayedBinCount(settings, sampleRate);
+        unsigned int bins = 1;
+        while (isOutOfCore(settings) && (binCount + bins - 1) / bins > maxRowCount)
+            bins *= 2;
+        return bins;
+    }
+
+    unsigned int rowCount(const Settings& settings, float sampleRate)
+    {
+        const unsigned int bins = binsPerRow(settings, sampleRate);
+        return (displayedBinCount(settings, sampleRate) + bins - 1) / bins;
+    }
+
+    unsigned int bandCount(const Settings& settings)
+    {
+        if (settings.mode != Settings::Mode::MultiResolution || isOutOfCore(settings))
+            return 1;
+
+        // the window of the highest band keeps at least 64 samples
+        unsigned int count = 1;
+        while (count < settings.resolutionBands && (settings.FFTSize >> count) >= 64)
+            ++count;
+        return count;
+    }
+
+    unsigned int transformSize(const Settings& settings)
+    {
+        // every band transforms samples that are decimated once more with the window of the highest band
+        return settings.FFTSize >> (bandCount(settings) - 1);
+    }
+
+    Settings::Mode chooseMode(Settings::Mode mode, unsigned int channelCount, unsigned int FFTSize)
+    {
+        // the out-of-core transform only computes the STFT
+        if (FFTSize > Spectrogram::largestInCoreSize && mode != Settings::Mode::STFT)
+        {
+            std::cout << "FFT sizes above " << Spectrogram::largestInCoreSize << " only support the STFT, it is used instead." << std::endl;
+            return Settings::Mode::STFT;
+        }
+
+        // the transfer function needs a reference and a response channel
+        if (mode == Settings::Mode::Transfer && channelCount < 2)
+        {
+            if (channelCount > 0)
+                std::cout << "The transfer mode needs two channels, the sound has " << channelCount << ". The STFT is used instead." << std::endl;
+            return Settings::Mode::STFT;
+        }
+        return mode;
+    }
+
+    const double pi = 3.141592653589793;
+
+    // the texture is split into tiles of this many columns
+    const unsigned int tileWidth = 1024;
+}
+
+
+Spectrogram::Spectrogram(std::shared_ptr<const sf::SoundBuffer> soundBuffer, const Settings& settings, ResourceCache& cache) :
+    Spectrogram(soundBuffer, nullptr, soundBuffer->getSamples(), static_cast<std::size_t>(soundBuffer->getSampleCount()),
+                soundBuffer->getChannelCount(), soundBuffer->getSampleRate(), settings, cache)
+{
+
+}
+
+
+Spectrogram::Spectrogram(std::shared_ptr<SoundLoader> loader, const Settings& settings, ResourceCache& cache) :
+    Spectrogram(nullptr, loader, loader->getSamples(), loader->getSampleCount(),
+                loader->getChannelCount(), loader->getSampleRate(), settings, cache)
+{
+
+}
+
+
+Spectrogram::Spectrogram(std::shared_ptr<const sf::SoundBuffer> soundBuffer, std::shared_ptr<SoundLoader> loader,
+                         const sf::Int16* samples, std::size_t sampleCount, unsigned int channelCount, unsigned int sampleRate,
+                         const Settings& settings, ResourceCache& cache) :
+    m_FFTSize(settings.FFTSize),
     m_outputSize(m_FFTSize / 2 + 1), // FFTW returns N/2+1
-    m_fft(m_FFTSize),
-    m_maxMagnitude(0.f),
-    m_minMagnitude(0.f)
+    m_bandCount(bandCount(settings)),
+    m_transformSize(transformSize(settings)),
+    m_cache(cache),
+    m_plan(isOutOfCore(settings) ? nullptr : cache.getFFTPlan(m_transformSize)),
+    m_largeFFT(isOutOfCore(settings) ? new LargeFFT(m_FFTSize, cache) : nullptr),
+    m_soundBuffer(soundBuffer),
+    m_loader(loader),
+    m_soundSamples(samples),
+    m_soundSampleCount(sampleCount),
+    m_duration((channelCount > 0 && sampleRate > 0) ? sf::seconds(static_cast<float>(sampleCount) / channelCount / sampleRate) : sf::Time::Zero),
+    m_mode(chooseMode(settings.mode, channelCount, m_FFTSize)),
+    m_channelStride((m_mode == Settings::Mode::Transfer) ? channelCount : 1),
+    // the channels of the transfer mode are transformed on their own, the decimation would mix them
+    m_decimationFactor((m_mode == Settings::Mode::Transfer) ? 1 : Decimator::chooseFactor(sampleRate, settings.maxFrequency)),
+    m_isMixedDown(m_decimationFactor > 1 || m_mode == Settings::Mode::MultiResolution),
+    m_sampleRate((m_mode == Settings::Mode::Transfer) ? static_cast<float>(sampleRate) : effectiveSampleRate(sampleRate, channelCount, m_decimationFactor, m_mode)),
+    m_binsPerRow(binsPerRow(settings, m_sampleRate)),
+    m_binCount(rowCount(settings, m_sampleRate)),
+    m_window(m_transformSize),
+    m_numberOfRepeats(numberOfRepeats(decimatedSampleCount(sampleCount, channelCount, m_decimationFactor, m_mode) / m_channelStride, m_transformSize)),
+    m_tiles(settings.isHeadless ? 0 : (m_numberOfRepeats + tileWidth - 1) / tileWidth),
+    m_columnPixels(m_binCount * 4),
+    m_floorPercentile(settings.floorPercentile),
+    m_ceilingPercentile(settings.ceilingPercentile),
+    m_magnitudes(settings.magnitudeFormat, settings.magnitudeRange, m_numberOfRepeats, m_binCount),
+    m_decodedFrame(m_binCount),
+    m_currentX(0),
+    m_pool(nullptr),
+    m_priority(ThreadPool::Priority::Low),
+    m_cancelled(false),
+    m_nextChunk(0),
+    m_chunkCount((m_numberOfRepeats + framesPerChunk - 1) / framesPerChunk),
+    m_chunkDone(m_chunkCount, false),
+    m_readyChunks(0),
+    m_submittedChunks(0),
+    m_chunksInFlight(0),
+    m_pendingJobs(0),
+    m_rangeRevision(0),
+    m_rangeParts(0),
+    m_densityScale(0.0),
+    m_availableFrames(0),
+    m_exportedFrames(0),
+    m_exportRequests(0),
+    m_isPeakIndexBuilt(false),
+    m_peakTracker(m_numberOfRepeats, m_binCount),
+    m_onsetDetector(m_binCount),
+    m_noiseFloor(m_binCount, static_cast<unsigned int>(settings.noiseFloorWindow * m_sampleRate / (m_transformSize / 2) + 0.5f)),
+    m_floors(static_cast<std::size_t>(m_chunkCount) * m_binCount),
+    m_flooredFrames(0),
+    m_isWhitened(false),
+    m_trackLines(sf::Lines),
+    m_drawnTracks(0),
+    m_isTrackOverlayVisible(false)
+{
+    if (m_mode == Settings::Mode::Reassigned)
+    {
+        // the reassignment needs the derivative of the window, so it uses a Hann window instead of the triangle
+        m_timeWindow.resize(m_FFTSize);
+        m_derivativeWindow.resize(m_FFTSize);
+        for (unsigned int j = 0; j < m_FFTSize; ++j)
+        {
+            const double phase = 2 * pi * j / m_FFTSize;
+            m_window[j]           = static_cast<FFT::Scalar>(0.5 - 0.5 * std::cos(phase));
+            m_timeWindow[j]       = static_cast<FFT::Scalar>((j - m_FFTSize / 2.0) * m_window[j]);  // in samples from the center
+            m_derivativeWindow[j] = static_cast<FFT::Scalar>(pi / m_FFTSize * std::sin(phase));     // per sample
+        }
+    }
+    else
+    {
+        for (unsigned int j = 0; j < m_transformSize; ++j)
+            m_window[j] = windowFunction(static_cast<float>(j) / m_transformSize);
+    }
+
+    // the power spectral density divides by the energy of the window, which makes it independent of the FFT size
+    double windowEnergy = 0.0;
+    for (unsigned int j = 0; j < m_transformSize; ++j)
+        windowEnergy += static_cast<double>(m_window[j]) * m_window[j];
+    if (windowEnergy > 0.0 && m_sampleRate > 0.f)
+        m_densityScale = 1.0 / (m_sampleRate * windowEnergy);
+
+    if (m_mode == Settings::Mode::MultiResolution)
+    {
+        // every band keeps the rows below 40 % of its sample rate, where the decimation filter is flat,
+        // the lowest band all rows below that
+        m_bandRows.resize(m_bandCount);
+        for (unsigned int band = 0; band < m_bandCount; ++band)
+        {
+            const unsigned int passband = static_cast<unsigned int>(0.4f * m_transformSize) << (m_bandCount - 1 - band);
+            m_bandRows[band] = (band == 0) ? m_binCount : std::min(passband, m_binCount);
+        }
+
+        // the decimated bands show a sine with the same level, but a bin of band b takes the noise of
+        // 2^b times the bandwidth, the density of its rows is that much higher (in log10 of the magnitude)
+        m_densityOffsets.resize(m_binCount);
+        for (unsigned int band = 0; band < m_bandCount; ++band)
+        {
+            const unsigned int firstRow = (band + 1 < m_bandCount) ? m_bandRows[band + 1] : 0;
+            for (unsigned int row = firstRow; row < m_bandRows[band]; ++row)
+                m_densityOffsets[row] = 0.5f * std::log10(static_cast<float>(1u << band));
+        }
+    }
+
+    // the tiles are loaded when they become visible, a headless spectrogram only keeps the magnitudes
+    if (!settings.isHeadless)
+        m_image = cache.acquireImage(m_numberOfRepeats, m_binCount);
+}
+
+
+Spectrogram::~Spectrogram()
+{
+    // the decoding tells us about its progress, it has to stop first
+    if (m_loader)
+        m_loader->stop();
+
+    // the chunks that were submitted already hold a pointer to us
+    m_cancelled = true;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_framesAvailable.notify_all();
+        m_jobsDone.wait(lock, [this] { return m_pendingJobs == 0; });
+    }
+
+    // hand the buffers back so the next spectrogram doesn't have to allocate them
+    m_cache.recycle(std::move(m_image));
+    for (std::unique_ptr<sf::Texture>& tile : m_tiles)
+        m_cache.recycle(std::move(tile));
+}
+
+
+void Spectrogram::setFrameSink(std::unique_ptr<FrameSink> sink)
+{
+    m_sink = std::move(sink);
+}
+
+
+void Spectrogram::generate(ThreadPool& pool)
+{
+    m_pool = &pool;
+    m_generationClock.restart();
+    m_arena.resetStatistics();
+
+    if (m_sink)
+    {
+        FrameSink::Description description;
+        description.frameCount = m_numberOfRepeats;
+        description.binCount = m_binCount;
+        description.FFTSize = m_FFTSize;
+        description.sampleRate = m_sampleRate;
+        description.hopSize = m_transformSize / 2;
+        description.binWidth = getBinWidth();
+        if (!m_sink->begin(description))
+            m_sink.reset();
+    }
+
+    // the frames whose samples are decoded are transformed while the rest is still decoded
+    if (m_loader)
+    {
+        m_loader->start(pool, m_priority, [this] (std::size_t decodedSamples, bool isDone)
+                                          {
+                                              onSamplesDecoded(decodedSamples, isDone);
+                                          });
+        return;
+    }
+
+    submitSoundJob();
+
+    // without decimation the frames don't have to wait
+    if (!m_isMixedDown)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_readyChunks = m_chunkCount;
+        }
+        submitReadyChunks();
+    }
+}
+
+
+void Spectrogram::setPriority(ThreadPool::Priority priority)
+{
+    m_priority = priority;
+    if (m_loader)
+        m_loader->setPriority(priority);
+}
+
+
+bool Spectrogram::isGenerated() const
+{
+    return m_availableFrames == m_numberOfRepeats;
+}
+
+
+void Spectrogram::submitSoundJob()
+{
+    // the peak index of the waveform is built in the same pass that mixes the channels down for the decimation
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_pendingJobs;
+    }
+    m_pool->submit([this]
+                   {
+                       if (!m_cancelled)
+                       {
+                           // the index keeps pointing to the samples, so it takes them from the sound buffer and not the loader
+                           std::vector<float> mono;
+                           m_peakIndex.build(m_soundBuffer->getSamples(), static_cast<std::size_t>(m_soundBuffer->getSampleCount()), m_soundBuffer->getChannelCount(),
+                                             m_isMixedDown ? &mono : nullptr);
+                           m_isPeakIndexBuilt = true;
+
+                           // then start with the frames
+                           if (m_isMixedDown)
+                           {
+                               Decimator decimator(m_decimationFactor);
+                               m_samples = decimator.process(std::move(mono));
+
+                               // every band has half the sample rate of the one above
+                               Decimator halving(2);
+                               for (unsigned int band = 1; band < m_bandCount && !m_cancelled; ++band)
+                                   m_bandSamples.push_back(halving.process((band == 1) ? m_samples : m_bandSamples.back()));
+
+                               {
+                                   std::lock_guard<std::mutex> lock(m_mutex);
+                                   m_readyChunks = m_chunkCount;
+                               }
+                               submitReadyChunks();
+                           }
+                       }
+                       finishJob();
+                   }, m_priority);
+}
+
+
+void Spectrogram::onSamplesDecoded(std::size_t decodedSamples, bool isDone)
+{
+    if (isDone)
+    {
+        m_soundBuffer = m_loader->getSoundBuffer();
+        submitSoundJob();
+    }
+
+    // the decimation needs all samples, without it a chunk can start once the samples of its last frame are there
+    if (m_isMixedDown)
+        return;
+
+    unsigned int readyChunks = m_chunkCount;
+    if (decodedSamples < m_soundSampleCount)
+    {
+        // the frames of the transfer mode advance through all channels
+        const std::size_t decodedFrameSamples = decodedSamples / m_channelStride;
+        const std::size_t readyFrames = (decodedFrameSamples >= m_FFTSize) ? (decodedFrameSamples - m_FFTSize) / (m_FFTSize / 2) + 1 : 0;
+        readyChunks = static_cast<unsigned int>(std::min<std::size_t>(readyFrames / framesPerChunk, m_chunkCount));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_readyChunks = std::max(m_readyChunks, readyChunks);
+    }
+    submitReadyChunks();
+}
+
+
+void Spectrogram::submitReadyChunks()
+{
+    if (m_cancelled)
+        return;
+
+    // keep one chunk per thread in flight, every finished chunk submits the next one that is ready
+    unsigned int jobCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // the out-of-core transform spreads every frame over the threads and has one set of scratch files
+        const unsigned int maxChunksInFlight = m_largeFFT ? 1 : m_pool->getThreadCount();
+        while (m_chunksInFlight < maxChunksInFlight && m_submittedChunks < m_readyChunks)
+        {
+            ++m_chunksInFlight;
+            ++m_submittedChunks;
+            ++m_pendingJobs;
+            ++jobCount;
+        }
+    }
+
+    for (unsigned int i = 0; i < jobCount; ++i)
+        m_pool->submit([this] { generateChunk(); }, m_priority);
+}
+
+
+void Spectrogram::generateChunk()
+{
+    const unsigned int chunk = m_nextChunk++;
+    if (!m_cancelled && chunk < m_chunkCount)
+    {
+        const unsigned int first = chunk * framesPerChunk;
+        const unsigned int last = std::min(first + framesPerChunk, m_numberOfRepeats);
+        if (m_mode == Settings::Mode::Reassigned)
+            generateReassignedFrames(first, last);
+        else if (m_mode == Settings::Mode::Transfer)
+            generateTransferFrames(first, last);
+        else if (m_mode == Settings::Mode::MultiResolution)
+            generateMultiResolutionFrames(first, last);
+        else if (m_largeFFT)
+            generateLargeFrames(first, last);
+        else
+            generateFrames(first, last);
+
+        {
+            // advance the number of frames that can be drawn
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_chunkDone[chunk] = true;
+            unsigned int doneChunks = m_availableFrames / framesPerChunk;
+            while (doneChunks < m_chunkCount && m_chunkDone[doneChunks])
+                ++doneChunks;
+            unsigned int availableFrames = std::min(doneChunks * framesPerChunk, m_numberOfRepeats);
+            // the next chunk still moves energy into the last frame
+            if (m_mode == Settings::Mode::Reassigned && doneChunks > 0 && doneChunks < m_chunkCount)
+                --availableFrames;
+            m_availableFrames = availableFrames;
+            m_framesAvailable.notify_all();
+            if (m_availableFrames > 0 && m_firstColumnTime == sf::Time::Zero)
+                m_firstColumnTime = m_generationClock.getElapsedTime();
+            if (m_availableFrames == m_numberOfRepeats)
+            {
+                m_generationTime = m_generationClock.getElapsedTime();
+
+                // every chunk handed its partial spectrum back before it was done, the first one takes the others
+                if (m_partialSpectra.empty())
+                    m_partialSpectra.emplace_back(new PowerSpectrum(m_binCount));
+                m_soundSpectrum = std::move(m_partialSpectra.front());
+                for (std::size_t i = 1; i < m_partialSpectra.size(); ++i)
+                    m_soundSpectrum->merge(*m_partialSpectra[i]);
+                m_partialSpectra.clear();
+                if (m_mode == Settings::Mode::Transfer)
+                {
+                    m_crossSpectrum.reset(new CrossSpectrum(m_binCount));
+                    for (const std::unique_ptr<CrossSpectrum>& partial : m_partialCrossSpectra)
+                        m_crossSpectrum->merge(*partial);
+                    m_partialCrossSpectra.clear();
+                }
+            }
+        }
+
+        exportFrames();
+        m_peakTracker.link(m_availableFrames);
+        detectEvents();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_chunksInFlight;
+    }
+    submitReadyChunks();
+
+    finishJob();
+}
+
+
+void Spectrogram::finishJob()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    --m_pendingJobs;
+    if (m_pendingJobs == 0)
+    {
+        // nothing reads the decoded samples anymore, the sound buffer has a copy of them
+        if (m_loader && isGenerated() && m_isPeakIndexBuilt)
+            m_loader->releaseSamples();
+        m_jobsDone.notify_all();
+    }
+}
+
+
+void Spectrogram::exportFrames()
+{
+    // the sink may write to a slow disk, so the other workers don't wait for it. The worker
+    // that writes serves their requests too, the frames of a request were available before it
+    if (m_exportRequests++ > 0)
+        return;
+
+    Arena::Scope scratch(m_arena);
+    float* frame = scratch.allocate<float>(m_binCount);
+    unsigned int requests = 0;
+    do
+    {
+        requests = m_exportRequests;
+        const unsigned int availableFrames = m_availableFrames;
+        for (; m_sink && m_exportedFrames < availableFrames && !m_cancelled; ++m_exportedFrames)
+        {
+            m_magnitudes.getFrame(m_exportedFrames, frame);
+            for (unsigned int bin = 0; bin < m_binCount; ++bin)
+                frame[bin] *= 20.f; // to dB
+
+            if (!m_sink->write(frame))
+            {
+                std::cout << "Could not write the exported frames, the export is stopped." << std::endl;
+                m_sink.reset();
+            }
+        }
+
+        if (m_sink && m_exportedFrames == m_numberOfRepeats)
+        {
+            if (!m_sink->finish())
+                std::cout << "Could not finish the export." << std::endl;
+            m_sink.reset();
+        }
+    }
+    while (m_exportRequests.fetch_sub(requests) != requests);
+}
+
+
+void Spectrogram::detectEvents()
+{
+    // the worker that gets the lock passes on everything that is available, unlike the export it
+    // doesn't touch the disk, so the others are only held up for the frames of a chunk
+    std::lock_guard<std::mutex> lock(m_eventMutex);
+
+    Arena::Scope scratch(m_arena);
+    float* frame = scratch.allocate<float>(m_binCount);
+    RangeEstimator whitenedRange;
+    const unsigned int availableFrames = m_availableFrames;
+    while (m_onsetDetector.getFrameCount() < availableFrames && !m_cancelled)
+    {
+        m_magnitudes.getFrame(m_onsetDetector.getFrameCount(), frame);
+        m_onsetDetector.addFrame(frame);
+
+        // the colors of the whitened image follow the levels above the floor
+        m_noiseFloor.addFrame(frame);
+        const float* floor = m_noiseFloor.getFloor();
+        for (unsigned int bin = 0; bin < m_binCount; ++bin)
+            frame[bin] -= floor[bin];
+        whitenedRange.add(frame, m_binCount);
+
+        const unsigned int flooredFrames = m_noiseFloor.getFrameCount();
+        if (flooredFrames % framesPerChunk == 0 || flooredFrames == m_numberOfRepeats)
+        {
+            std::copy(floor, floor + m_binCount, &m_floors[static_cast<std::size_t>((flooredFrames - 1) / framesPerChunk) * m_binCount]);
+            m_flooredFrames = flooredFrames;
+        }
+    }
+
+    std::lock_guard<std::mutex> rangeLock(m_mutex);
+    m_whitenedRange.merge(whitenedRange);
+}
+
+
+void Spectrogram::averageFrames(unsigned int first, unsigned int last, unsigned int revision)
+{
+    if (!m_cancelled)
+    {
+        PowerSpectrum spectrum(m_binCount);
+        Arena::Scope scratch(m_arena);
+        float* levels = scratch.allocate<float>(m_binCount);
+        float* powers = scratch.allocate<float>(m_binCount);
+        for (unsigned int i = first; i < last && !m_cancelled; ++i)
+        {
+            // the powers are as accurate as the storage format of the magnitudes
+            m_magnitudes.getFrame(i, levels);
+            if (!m_densityOffsets.empty())
+            {
+                for (unsigned int bin = 0; bin < m_binCount; ++bin)
+                    levels[bin] += m_densityOffsets[bin];
+            }
+            for (unsigned int bin = 0; bin < m_binCount; ++bin)
+                powers[bin] = PowerSpectrum::levelToPower(levels[bin]);
+            spectrum.add(powers, levels);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (revision == m_rangeRevision && m_rangeSpectrum)
+        {
+            m_rangeSpectrum->merge(spectrum);
+            --m_rangeParts;
+        }
+    }
+
+    finishJob();
+}
+
+
+void Spectrogram::generateFrames(unsigned int first, unsigned int last)
+{
+    // every chunk has its own output arrays, the plan is shared
+    std::unique_ptr<FFT> fft = acquireFFT();
+    std::unique_ptr<PowerSpectrum> spectrum = acquireSpectrum();
+    Arena::Scope scratch(m_arena);
+    RangeEstimator range;
+
+    FFT::Scalar* sampleChunck = scratch.allocate<FFT::Scalar>(m_FFTSize);
+    float* powers = scratch.allocate<float>(m_binCount);
+    for (unsigned int i = first; i < last; ++i)
+    {
+        readFrame(i, sampleChunck);
+        for (unsigned int j = 0; j < m_FFTSize; ++j)
+            sampleChunck[j] *= m_window[j];
+
+        fft->process(sampleChunck);
+
+
+        // the bins above the frequency of interest are dropped
+        const std::vector<float>& logarithmicMagnitudes = fft->logarithmicMagnitudeVector();
+        m_magnitudes.setFrame(i, &logarithmicMagnitudes[0]);
+        m_peakTracker.setFrame(i, &logarithmicMagnitudes[0]);
+
+        // update the distribution of the magnitudes
+        range.add(&logarithmicMagnitudes[0], m_binCount);
+
+        // the average spectrum sums up the linear powers, before the logarithm
+        const std::vector<FFT::Scalar>& real = fft->realPart();
+        const std::vector<FFT::Scalar>& imag = fft->imagPart();
+        for (unsigned int bin = 0; bin < m_binCount; ++bin)
+            powers[bin] = static_cast<float>(real[bin] * real[bin] + imag[bin] * imag[bin]);
+        spectrum->add(powers, &logarithmicMagnitudes[0]);
+    }
+
+    releaseFFT(std::move(fft));
+    releaseSpectrum(std::move(spectrum));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_range.merge(range);
+}
+
+
+void Spectrogram::generateLargeFrames(unsigned int first, unsigned int last)
+{
+    std::unique_ptr<PowerSpectrum> spectrum = acquireSpectrum();
+    Arena::Scope scratch(m_arena);
+    RangeEstimator range;
+
+    // the frame goes straight into the scratch file of the transform
+    FFT::Scalar* samples = m_largeFFT->getInput();
+    float* powers = scratch.allocate<float>(m_binCount);
+    float* levels = scratch.allocate<float>(m_binCount);
+    const float epsilon = std::numeric_limits<float>::epsilon();
+    for (unsigned int i = first; i < last && !m_cancelled; ++i)
+    {
+        readFrame(i, samples);
+        for (unsigned int j = 0; j < m_FFTSize; ++j)
+            samples[j] *= m_window[j];
+
+        // every row keeps the loudest of its bins, so a narrow line keeps its level
+        m_largeFFT->process(*m_pool, m_priority);
+        m_largeFFT->getPeakPowers(m_binsPerRow, m_binCount, powers, *m_pool, m_priority);
+        for (unsigned int row = 0; row < m_binCount; ++row)
+            levels[row] = std::log10(std::sqrt(powers[row]) / 100 + epsilon);
+
+        m_magnitudes.setFrame(i, levels);
+        m_peakTracker.setFrame(i, levels);
+        range.add(levels, m_binCount);
+        spectrum->add(powers, levels);
+    }
+
+    releaseSpectrum(std::move(spectrum));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_range.merge(range);
+}
+
+
+void Spectrogram::generateReassignedFrames(unsigned int first, unsigned int last)
+{
+    // the three transforms of a frame run back to back on the same plan
+    std::unique_ptr<FFT> fft = acquireFFT();
+    std::unique_ptr<FFT> timeFFT = acquireFFT();
+    std::unique_ptr<FFT> derivativeFFT = acquireFFT();
+    std::unique_ptr<PowerSpectrum> spectrum = acquireSpectrum();
+    Arena::Scope scratch(m_arena);
+    RangeEstimator range;
+
+    // the energy of the chunk can land one frame before and after it
+    const unsigned int firstRow = (first > 0) ? first - 1 : 0;
+    const unsigned int lastRow = std::min(last + 1, m_numberOfRepeats);
+    const std::size_t gridSize = static_cast<std::size_t>(lastRow - firstRow) * m_binCount;
+    float* grid = scratch.allocate<float>(gridSize);
+    std::fill(grid, grid + gridSize, 0.f);
+
+    FFT::Scalar* samples = scratch.allocate<FFT::Scalar>(m_FFTSize);
+    FFT::Scalar* windowed = scratch.allocate<FFT::Scalar>(m_FFTSize);
+    FFT::Scalar* timeWeighted = scratch.allocate<FFT::Scalar>(m_FFTSize);
+    FFT::Scalar* derivative = scratch.allocate<FFT::Scalar>(m_FFTSize);
+    const FFT::Scalar hopSize = static_cast<FFT::Scalar>(m_FFTSize / 2);
+    const FFT::Scalar binsPerRadian = static_cast<FFT::Scalar>(m_FFTSize / (2 * pi));
+    const FFT::Scalar silence = static_cast<FFT::Scalar>(1e-20);
+
+    for (unsigned int i = first; i < last; ++i)
+    {
+        readFrame(i, samples);
+        for (unsigned int j = 0; j < m_FFTSize; ++j)
+        {
+            windowed[j]     = samples[j] * m_window[j];
+            timeWeighted[j] = samples[j] * m_timeWindow[j];
+            derivative[j]   = samples[j] * m_derivativeWindow[j];
+        }
+
+        fft->process(windowed);
+        timeFFT->process(timeWeighted);
+        derivativeFFT->process(derivative);
+
+        const std::vector<FFT::Scalar>& real = fft->realPart();
+        const std::vector<FFT::Scalar>& imag = fft->imagPart();
+        const std::vector<FFT::Scalar>& timeReal = timeFFT->realPart();
+        const std::vector<FFT::Scalar>& timeImag = timeFFT->imagPart();
+        const std::vector<FFT::Scalar>& derivativeReal = derivativeFFT->realPart();
+        const std::vector<FFT::Scalar>& derivativeImag = derivativeFFT->imagPart();
+
+        const int firstFrame = static_cast<int>(std::max(i, firstRow + 1)) - 1;
+        const int lastFrame = static_cast<int>(std::min(i + 2, lastRow)) - 1;
+        for (unsigned int k = 0; k < m_outputSize; ++k)
+        {
+            const FFT::Scalar energy = real[k] * real[k] + imag[k] * imag[k];
+            if (energy < silence)
+                continue;
+
+            // instantaneous frequency: k - Im(X_dh * conj(X_h)) / |X_h|^2, group delay: Re(X_th * conj(X_h)) / |X_h|^2
+            const FFT::Scalar binOffset = -(derivativeImag[k] * real[k] - derivativeReal[k] * imag[k]) / energy * binsPerRadian;
+            const FFT::Scalar sampleOffset = (timeReal[k] * real[k] + timeImag[k] * imag[k]) / energy;
+
+            // the energy is split between the two closest bins, so the peaks keep their sub-bin position
+            const FFT::Scalar position = k + binOffset;
+            const long bin = static_cast<long>(std::floor(position));
+            if (bin < -1 || bin >= static_cast<long>(m_binCount))
+                continue;
+            const float upperShare = static_cast<float>(position - bin);
+            const int frame = std::min(std::max(static_cast<int>(i) + static_cast<int>(std::lround(sampleOffset / hopSize)), firstFrame), lastFrame);
+
+            float* row = grid + static_cast<std::size_t>(frame - firstRow) * m_binCount;
+            if (bin >= 0)
+                row[bin] += (1.f - upperShare) * static_cast<float>(energy);
+            if (bin + 1 < static_cast<long>(m_binCount))
+                row[bin + 1] += upperShare * static_cast<float>(energy);
+        }
+    }
+
+    releaseFFT(std::move(fft));
+    releaseFFT(std::move(timeFFT));
+    releaseFFT(std::move(derivativeFFT));
+
+    // the frames that only this chunk touches are stored right away, the others when their last chunk is done
+    float* levels = scratch.allocate<float>(m_binCount);
+    for (unsigned int frame = firstRow; frame < lastRow; ++frame)
+    {
+        const float* row = &grid[static_cast<std::size_t>(frame - firstRow) * m_binCount];
+        const unsigned int contributors = contributingChunks(frame);
+        if (contributors == 1)
+        {
+            storeEnergies(frame, row, levels, range, *spectrum);
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        SharedFrame& shared = m_sharedFrames[frame];
+        if (shared.energies.empty())
+        {
+            shared.energies.assign(row, row + m_binCount);
+            shared.contributions = 1;
+        }
+        else
+        {
+            for (unsigned int bin = 0; bin < m_binCount; ++bin)
+                shared.energies[bin] += row[bin];
+            ++shared.contributions;
+        }
+
+        if (shared.contributions == contributors)
+        {
+            storeEnergies(frame, &shared.energies[0], levels, range, *spectrum);
+            m_sharedFrames.erase(frame);
+        }
+    }
+
+    releaseSpectrum(std::move(spectrum));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_range.merge(range);
+}
+
+
+void Spectrogram::generateTransferFrames(unsigned int first, unsigned int last)
+{
+    std::unique_ptr<FFT> referenceFFT = acquireFFT();
+    std::unique_ptr<FFT> responseFFT = acquireFFT();
+    std::unique_ptr<CrossSpectrum> spectrum = acquireCrossSpectrum();
+    Arena::Scope scratch(m_arena);
+    RangeEstimator range;
+
+    FFT::Scalar* reference = scratch.allocate<FFT::Scalar>(m_FFTSize);
+    FFT::Scalar* response = scratch.allocate<FFT::Scalar>(m_FFTSize);
+    float* gains = scratch.allocate<float>(m_binCount);
+    for (unsigned int i = first; i < last; ++i)
+    {
+        readChannels(i, reference, response);
+        for (unsigned int j = 0; j < m_FFTSize; ++j)
+        {
+            reference[j] *= m_window[j];
+            response[j]  *= m_window[j];
+        }
+
+        referenceFFT->process(reference);
+        responseFFT->process(response);
+        spectrum->add(&referenceFFT->realPart()[0], &referenceFFT->imagPart()[0],
+                      &responseFFT->realPart()[0], &responseFFT->imagPart()[0]);
+
+        // the logarithms of the magnitudes give the gain without a division, silent bins have a gain of 0 dB
+        const std::vector<float>& referenceLevels = referenceFFT->logarithmicMagnitudeVector();
+        const std::vector<float>& responseLevels = responseFFT->logarithmicMagnitudeVector();
+        for (unsigned int bin = 0; bin < m_binCount; ++bin)
+            gains[bin] = responseLevels[bin] - referenceLevels[bin];
+
+        m_magnitudes.setFrame(i, gains);
+        m_peakTracker.setFrame(i, gains);
+        range.add(gains, m_binCount);
+    }
+
+    releaseFFT(std::move(referenceFFT));
+    releaseFFT(std::move(responseFFT));
+    releaseCrossSpectrum(std::move(spectrum));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_range.merge(range);
+}
+
+
+void Spectrogram::generateMultiResolutionFrames(unsigned int first, unsigned int last)
 {
-    // get the samples as ints
-    m_samples = std::vector<sf::Int16>(soundBuffer.getSamples(), soundBuffer.getSamples() + soundBuffer.getSampleCount());
-    // make sure it can always be devided through FFTSize without remainder, if necessary add 0's
-    auto remainder = FFTSize - (m_samples.size() % FFTSize);
-    m_samples.insert(m_samples.end(), remainder, 0);
+    std::unique_ptr<FFT> fft = acquireFFT();
+    std::unique_ptr<PowerSpectrum> spectrum = acquireSpectrum();
+    Arena::Scope scratch(m_arena);
+    RangeEstimator range;
 
-    // calculate how many times the FFT will be called
-    // -1 to avoid out of bounds reading on last iteration because of our 50% sliding window
-    m_numberOfRepeats = m_samples.size() / (FFTSize / 2) - 1;
+    // band b transforms samples decimated by 2^b, so its bins are 2^(bands - 1 - b) rows apart and a frame of it lasts 2^b columns
+    const unsigned int bandBins = m_transformSize / 2 + 1;
+    const std::vector<unsigned int>& lastRows = m_bandRows;
 
-    m_image.create(m_numberOfRepeats, m_outputSize);
+    FFT::Scalar* samples = scratch.allocate<FFT::Scalar>(m_transformSize);
+    float* bandLevels = scratch.allocate<float>(static_cast<std::size_t>(m_bandCount) * bandBins);
+    float* bandPowers = scratch.allocate<float>(static_cast<std::size_t>(m_bandCount) * bandBins);
+    float* levels = scratch.allocate<float>(m_binCount);
+    float* densityLevels = scratch.allocate<float>(m_binCount);
+    float* powers = scratch.allocate<float>(m_binCount);
+    std::vector<int> bandFrames(m_bandCount, -1);
 
-    if (!m_texture.loadFromImage(m_image))
+    for (unsigned int i = first; i < last; ++i)
     {
-        std::cout << "Could not create a texture!" << std::endl;
-        // possibly throw exception
+        for (unsigned int band = 0; band < m_bandCount; ++band)
+        {
+            const unsigned int firstRow = (band + 1 < m_bandCount) ? lastRows[band + 1] : 0;
+            if (firstRow >= lastRows[band])
+                continue;
+
+            // the frame of the band whose center is closest to the center of the column, the frames are
+            // only transformed again when the next column needs another one
+            const int frame = std::max(static_cast<int>((i + 1 + ((1u << band) >> 1)) >> band) - 1, 0);
+            float* bins = bandLevels + static_cast<std::size_t>(band) * bandBins;
+            float* binPowers = bandPowers + static_cast<std::size_t>(band) * bandBins;
+            if (frame != bandFrames[band])
+            {
+                readBandFrame(band, frame, samples);
+                for (unsigned int j = 0; j < m_transformSize; ++j)
+                    samples[j] *= m_window[j];
+
+                fft->process(samples);
+                const std::vector<float>& logarithmicMagnitudes = fft->logarithmicMagnitudeVector();
+                std::copy(logarithmicMagnitudes.begin(), logarithmicMagnitudes.end(), bins);
+
+                // a bin of band b takes the noise of 2^b times the bandwidth, so its density is that much higher
+                const std::vector<FFT::Scalar>& real = fft->realPart();
+                const std::vector<FFT::Scalar>& imag = fft->imagPart();
+                const float densityScale = static_cast<float>(1u << band);
+                for (unsigned int bin = 0; bin < bandBins; ++bin)
+                    binPowers[bin] = static_cast<float>(real[bin] * real[bin] + imag[bin] * imag[bin]) * densityScale;
+
+                bandFrames[band] = frame;
+            }
+
+            // a row takes the closest bin, so the average of a range read back from the storage matches
+            const unsigned int shift = m_bandCount - 1 - band;
+            const unsigned int rounding = (1u << shift) >> 1;
+            for (unsigned int row = firstRow; row < lastRows[band]; ++row)
+            {
+                const unsigned int bin = std::min((row + rounding) >> shift, bandBins - 1);
+                levels[row] = bins[bin];
+                powers[row] = binPowers[bin];
+                densityLevels[row] = levels[row] + m_densityOffsets[row];
+            }
+        }
+
+        m_magnitudes.setFrame(i, levels);
+        m_peakTracker.setFrame(i, levels);
+        range.add(levels, m_binCount);
+        spectrum->add(powers, densityLevels);
     }
-    m_sprite.setTexture(m_texture);
 
-    m_magnitudes.reserve(m_numberOfRepeats);
+    releaseFFT(std::move(fft));
+    releaseSpectrum(std::move(spectrum));
 
-    m_currentX = 0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_range.merge(range);
+}
+
+
+void Spectrogram::storeEnergies(unsigned int frame, const float* energies, float* levels, RangeEstimator& range, PowerSpectrum& spectrum)
+{
+    // the same scale as FFT::logarithmicMagnitudeVector()
+    const float epsilon = std::numeric_limits<float>::epsilon();
+    for (unsigned int bin = 0; bin < m_binCount; ++bin)
+        levels[bin] = std::log10(std::sqrt(energies[bin]) / 100 + epsilon);
+
+    m_magnitudes.setFrame(frame, levels);
+    m_peakTracker.setFrame(frame, levels);
+    range.add(levels, m_binCount);
+    spectrum.add(energies, levels);
 }
 
 
-void Spectrogram::generate()
+std::unique_ptr<FFT> Spectrogram::acquireFFT()
 {
-    auto sampleIterator = m_samples.cbegin();
-    for (unsigned int i = 0; i < m_numberOfRepeats; ++i)
     {
-        int currentSampleIndex = 0;
-        std::vector<float> sampleChunck(m_FFTSize);
-        std::transform(sampleIterator, sampleIterator + m_FFTSize, sampleChunck.begin(),
-                       [&currentSampleIndex, this] (sf::Int16 sample)
-                       {
-                           float scaledFloat = static_cast<float>(sample) / 32767.f;
-                           scaledFloat *= windowFunction(static_cast<float>(currentSampleIndex) / m_FFTSize);
-                           ++currentSampleIndex;
-                           return scaledFloat;
-                       } );
-        sampleIterator += m_FFTSize / 2; // 50% sliding window
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_idleFFTs.empty())
+        {
+            std::unique_ptr<FFT> fft = std::move(m_idleFFTs.back());
+            m_idleFFTs.pop_back();
+            return fft;
+        }
+    }
+
+    return std::unique_ptr<FFT>(new FFT(m_plan));
+}
+
+
+void Spectrogram::releaseFFT(std::unique_ptr<FFT> fft)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_idleFFTs.push_back(std::move(fft));
+}
+
+
+std::unique_ptr<PowerSpectrum> Spectrogram::acquireSpectrum()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_partialSpectra.empty())
+        {
+            std::unique_ptr<PowerSpectrum> spectrum = std::move(m_partialSpectra.back());
+            m_partialSpectra.pop_back();
+            return spectrum;
+        }
+    }
+
+    return std::unique_ptr<PowerSpectrum>(new PowerSpectrum(m_binCount));
+}
+
+
+void Spectrogram::releaseSpectrum(std::unique_ptr<PowerSpectrum> spectrum)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_partialSpectra.push_back(std::move(spectrum));
+}
+
+
+std::unique_ptr<CrossSpectrum> Spectrogram::acquireCrossSpectrum()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_partialCrossSpectra.empty())
+        {
+            std::unique_ptr<CrossSpectrum> spectrum = std::move(m_partialCrossSpectra.back());
+            m_partialCrossSpectra.pop_back();
+            return spectrum;
+        }
+    }
+
+    return std::unique_ptr<CrossSpectrum>(new CrossSpectrum(m_binCount));
+}
+
+
+void Spectrogram::releaseCrossSpectrum(std::unique_ptr<CrossSpectrum> spectrum)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_partialCrossSpectra.push_back(std::move(spectrum));
+}
+
+
+unsigned int Spectrogram::contributingChunks(unsigned int frame) const
+{
+    // a frame gets energy from its neighbours, which can belong to the chunks before and after
+    const unsigned int chunk = frame / framesPerChunk;
+    unsigned int count = 1;
+    if (frame > 0 && (frame - 1) / framesPerChunk != chunk)
+        ++count;
+    if (frame + 1 < m_numberOfRepeats && (frame + 1) / framesPerChunk != chunk)
+        ++count;
+    return count;
+}
 
-        m_fft.process(&sampleChunck[0]);
 
+void Spectrogram::readFrame(unsigned int frame, FFT::Scalar* output) const
+{
+    const std::size_t start = static_cast<std::size_t>(frame) * (m_FFTSize / 2); // 50% sliding window
+
+    if (m_isMixedDown)
+    {
+        // the decimated samples are already scaled
+        const std::size_t sampleCount = m_samples.size();
+        for (unsigned int j = 0; j < m_FFTSize; ++j)
+        {
+            // the last frames reach past the end of the sound, the missing samples are 0
+            output[j] = (start + j < sampleCount) ? m_samples[start + j] : 0.f;
+        }
+        return;
+    }
+
+    // the samples are read straight from the sound buffer or the loader
+    const sf::Int16* samples = m_soundSamples;
+    const std::size_t sampleCount = m_soundSampleCount;
+    for (unsigned int j = 0; j < m_FFTSize; ++j)
+    {
+        // the last frames reach past the end of the sound, the missing samples are 0
+        output[j] = (start + j < sampleCount) ? static_cast<float>(samples[start + j]) / 32767.f : 0.f;
+    }
+}
+
+
+void Spectrogram::readBandFrame(unsigned int band, unsigned int frame, FFT::Scalar* output) const
+{
+    const std::vector<float>& samples = (band == 0) ? m_samples : m_bandSamples[band - 1];
+    const std::size_t start = static_cast<std::size_t>(frame) * (m_transformSize / 2);
+    const std::size_t sampleCount = samples.size();
+    for (unsigned int j = 0; j < m_transformSize; ++j)
+    {
+        // the last frames reach past the end of the sound, the missing samples are 0
+        output[j] = (start + j < sampleCount) ? samples[start + j] : 0.f;
+    }
+}
 
-        m_magnitudes.push_back(m_fft.logarithmicMagnitudeVector());
 
-        // find the max element
-        auto minmax = std::minmax_element(m_magnitudes.back().begin(), m_magnitudes.back().end());
-        // check if it's bigger than any previous one
-        if (*minmax.second > m_maxMagnitude)
-            m_maxMagnitude = *minmax.second;
-        if (*minmax.first < m_minMagnitude)
-            m_minMagnitude = *minmax.first;
+void Spectrogram::readChannels(unsigned int frame, FFT::Scalar* reference, FFT::Scalar* response) const
+{
+    // the frames advance per channel, further channels are skipped
+    const std::size_t start = static_cast<std::size_t>(frame) * (m_FFTSize / 2) * m_channelStride;
+    const sf::Int16* samples = m_soundSamples;
+    const std::size_t sampleCount = m_soundSampleCount;
+    for (unsigned int j = 0; j < m_FFTSize; ++j)
+    {
+        // the last frames reach past the end of the sound, the missing samples are 0
+        const std::size_t index = start + static_cast<std::size_t>(j) * m_channelStride;
+        const bool isInside = index + 1 < sampleCount;
+        reference[j] = isInside ? static_cast<float>(samples[index]) / 32767.f : 0.f;
+        response[j]  = isInside ? static_cast<float>(samples[index + 1]) / 32767.f : 0.f;
     }
 }
 
 
 void Spectrogram::updateImage()
 {
-    if (m_currentX < m_magnitudes.size())
+    if (!m_image)
+        return;
+
+    updateTrackOverlay();
+
+    // the whitened columns wait for the floor of their chunk
+    const unsigned int drawableFrames = m_isWhitened ? m_flooredFrames : m_availableFrames;
+    if (m_currentX < drawableFrames)
     {
-        std::vector<float>& magnitudeVector = m_magnitudes[m_currentX];
+        m_magnitudes.getFrame(m_currentX, &m_decodedFrame[0]);
+        std::vector<float>& magnitudeVector = m_decodedFrame;
+
+        // the range is estimated from all frames generated so far
+        float lower, upper;
+        if (m_isWhitened)
+        {
+            const float* floor = &m_floors[static_cast<std::size_t>(m_currentX / framesPerChunk) * m_binCount];
+            for (unsigned int i = 0; i < magnitudeVector.size(); ++i)
+                magnitudeVector[i] -= floor[i];
+
+            // the floor itself is black
+            std::lock_guard<std::mutex> lock(m_mutex);
+            lower = std::max(m_whitenedRange.getPercentile(m_floorPercentile), 0.f);
+            upper = m_whitenedRange.getPercentile(m_ceilingPercentile);
+        }
+        else
+        {
+            getColorRange(lower, upper);
+        }
+        const float range = (upper > lower) ? upper - lower : 1.f;
 
         for (unsigned int i = 0; i < magnitudeVector.size(); ++i)
         {
@@ -105,31 +1152,393 @@ void Spectrogram::updateImage()
             // linear
             //float amount = magnitudeVector[i] / m_maxMagnitude;
             // logarithmic
-            float amount = (magnitudeVector[i] - m_minMagnitude) / (m_maxMagnitude - m_minMagnitude);
+            float amount = (magnitudeVector[i] - lower) / range;
+            amount = std::min(std::max(amount, 0.f), 1.f);
 
             // black and white
             //sf::Uint8 intensity = static_cast<sf::Uint8>(amount * 255);
             //sf::Color color = sf::Color(intensity, intensity, intensity);
 
             // sunset (white-yellow-red-pink-blue-black)
-            // interpolates the hue in range 210 (blue) to 100 (yellow/greenish) with a wrap around
-            float hue = std::fmod(linearInterpolation(210.f, 460.f, amount), 360.f);
-            sf::Color color = HSLtoRGB(hue, 1.f, amount);
+            sf::Color color = magnitudeColor(amount);
 
-            m_image.setPixel(m_currentX, magnitudeVector.size() - 1 - i, color);
+            m_image->setPixel(m_currentX, magnitudeVector.size() - 1 - i, color);
+
+            sf::Uint8* pixel = &m_columnPixels[(magnitudeVector.size() - 1 - i) * 4];
+            pixel[0] = color.r;
+            pixel[1] = color.g;
+            pixel[2] = color.b;
+            pixel[3] = color.a;
         }
         //std::cout << std::endl << std::endl;
 
-        m_texture.update(m_image);
+        // the image keeps the column for tiles that are loaded later
+        const unsigned int tile = m_currentX / tileWidth;
+        if (m_tiles[tile])
+            m_tiles[tile]->update(&m_columnPixels[0], 1, m_binCount, m_currentX - tile * tileWidth, 0);
 
         ++m_currentX;
     }
 }
 
 
+unsigned int Spectrogram::getAvailableFrameCount() const
+{
+    return m_availableFrames;
+}
+
+
+bool Spectrogram::waitForFrames(unsigned int count, sf::Time timeout) const
+{
+    count = std::min(count, m_numberOfRepeats);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_framesAvailable.wait_for(lock, std::chrono::microseconds(timeout.asMicroseconds()),
+                                      [this, count] { return m_availableFrames >= count || m_cancelled; })
+           && m_availableFrames >= count;
+}
+
+
+bool Spectrogram::getMagnitudes(unsigned int frame, float* values) const
+{
+    if (frame >= m_availableFrames)
+        return false;
+    m_magnitudes.getFrame(frame, values);
+    return true;
+}
+
+
+void Spectrogram::getColorRange(float& lower, float& upper) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    lower = m_range.getPercentile(m_floorPercentile);
+    upper = m_range.getPercentile(m_ceilingPercentile);
+}
+
+
+void Spectrogram::setTrackOverlayVisible(bool isVisible)
+{
+    m_isTrackOverlayVisible = isVisible;
+}
+
+
+void Spectrogram::setWhitened(bool isWhitened)
+{
+    if (m_isWhitened == isWhitened)
+        return;
+
+    m_isWhitened = isWhitened;
+    redraw();
+}
+
+
+void Spectrogram::updateTrackOverlay()
+{
+    if (m_peakTracker.getTrackCount() == m_drawnTracks)
+        return;
+
+    std::vector<PeakTracker::Track> tracks;
+    m_peakTracker.getTracks(m_drawnTracks, tracks);
+    m_drawnTracks += tracks.size();
+
+    // one line per pair of frames, through the centers of the pixels
+    const sf::Color color(80, 255, 80);
+    for (const PeakTracker::Track& track : tracks)
+    {
+        for (std::size_t i = 1; i < track.bins.size(); ++i)
+        {
+            const float x = static_cast<float>(track.firstFrame + i) - 0.5f;
+            m_trackLines.append(sf::Vertex(sf::Vector2f(x, m_binCount - track.bins[i - 1] - 0.5f), color));
+            m_trackLines.append(sf::Vertex(sf::Vector2f(x + 1.f, m_binCount - track.bins[i] - 0.5f), color));
+        }
+    }
+}
+
+
+void Spectrogram::setVisibleArea(const sf::FloatRect& area)
+{
+    // the visible columns, in the coordinates of the image
+    const sf::FloatRect localArea = getInverseTransform().transformRect(area);
+    const float firstColumn = std::max(localArea.left, 0.f);
+    const float lastColumn = std::min(localArea.left + localArea.width, static_cast<float>(m_numberOfRepeats));
+
+    // one tile on each side is kept, so scrolling doesn't show missing tiles
+    int firstTile = 0, lastTile = -1;
+    if (firstColumn < lastColumn)
+    {
+        firstTile = std::max(static_cast<int>(firstColumn / tileWidth) - 1, 0);
+        lastTile = std::min(static_cast<int>(lastColumn / tileWidth) + 1, static_cast<int>(m_tiles.size()) - 1);
+    }
+
+    for (int tile = 0; tile < static_cast<int>(m_tiles.size()); ++tile)
+    {
+        const bool isNeeded = (firstTile <= tile && tile <= lastTile);
+        if (isNeeded && !m_tiles[tile])
+            uploadTile(tile);
+        else if (!isNeeded && m_tiles[tile])
+            m_cache.recycle(std::move(m_tiles[tile]));
+    }
+}
+
+
+void Spectrogram::uploadTile(unsigned int tile)
+{
+    const unsigned int first = tile * tileWidth;
+    const unsigned int width = std::min(tileWidth, m_numberOfRepeats - first);
+
+    m_tiles[tile] = m_cache.acquireTexture(width, m_binCount);
+    if (!m_tiles[tile])
+    {
+        std::cout << "Could not create a texture!" << std::endl;
+        return;
+    }
+
+    // the image is stored row by row, the part of the tile has to be copied out
+    const sf::Uint8* pixels = m_image->getPixelsPtr();
+    std::vector<sf::Uint8> tilePixels(static_cast<std::size_t>(width) * m_binCount * 4);
+    for (unsigned int y = 0; y < m_binCount; ++y)
+        std::copy(pixels + (static_cast<std::size_t>(y) * m_numberOfRepeats + first) * 4,
+                  pixels + (static_cast<std::size_t>(y) * m_numberOfRepeats + first + width) * 4,
+                  tilePixels.begin() + static_cast<std::size_t>(y) * width * 4);
+    m_tiles[tile]->update(&tilePixels[0]);
+}
+
+
+void Spectrogram::redraw()
+{
+    m_currentX = 0;
+}
+
+
+void Spectrogram::setDynamicRange(float floorPercentile, float ceilingPercentile)
+{
+    m_floorPercentile   = floorPercentile;
+    m_ceilingPercentile = ceilingPercentile;
+}
+
+
 sf::FloatRect Spectrogram::getLocalBounds() const
 {
-  return getTransform().transformRect(m_sprite.getLocalBounds());
+  return getTransform().transformRect(sf::FloatRect(0.f, 0.f, static_cast<float>(m_numberOfRepeats), static_cast<float>(m_binCount)));
+}
+
+
+unsigned int Spectrogram::getFrameCount() const
+{
+    return m_numberOfRepeats;
+}
+
+
+unsigned int Spectrogram::getBinCount() const
+{
+    return m_binCount;
+}
+
+
+float Spectrogram::getSampleRate() const
+{
+    return m_sampleRate;
+}
+
+
+float Spectrogram::getBinWidth() const
+{
+    return m_sampleRate / m_FFTSize * m_binsPerRow;
+}
+
+
+float Spectrogram::getFramesPerSecond() const
+{
+    return m_sampleRate / (m_transformSize / 2);
+}
+
+
+const PeakIndex* Spectrogram::getPeakIndex() const
+{
+    return m_isPeakIndexBuilt ? &m_peakIndex : nullptr;
+}
+
+
+const PeakTracker& Spectrogram::getPeakTracker() const
+{
+    return m_peakTracker;
+}
+
+
+sf::Time Spectrogram::getFirstColumnTime() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_firstColumnTime;
+}
+
+
+sf::Time Spectrogram::getGenerationTime() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_generationTime;
+}
+
+
+bool Spectrogram::findNextEvent(sf::Time offset, sf::Time& event) const
+{
+    const float framesPerSecond = getFramesPerSecond();
+    const unsigned int frame = static_cast<unsigned int>(std::max(offset.asSeconds() * framesPerSecond + 0.5f, 0.f));
+
+    std::lock_guard<std::mutex> lock(m_eventMutex);
+    const OnsetDetector::Event* next = m_onsetDetector.findNext(frame);
+    if (!next)
+        return false;
+    event = sf::seconds(next->frame / framesPerSecond);
+    return true;
+}
+
+
+bool Spectrogram::findPreviousEvent(sf::Time offset, sf::Time& event) const
+{
+    const float framesPerSecond = getFramesPerSecond();
+    const unsigned int frame = static_cast<unsigned int>(std::max(offset.asSeconds() * framesPerSecond + 0.5f, 0.f));
+
+    std::lock_guard<std::mutex> lock(m_eventMutex);
+    const OnsetDetector::Event* previous = m_onsetDetector.findPrevious(frame);
+    if (!previous)
+        return false;
+    event = sf::seconds(previous->frame / framesPerSecond);
+    return true;
+}
+
+
+std::size_t Spectrogram::getEventCount() const
+{
+    std::lock_guard<std::mutex> lock(m_eventMutex);
+    return m_onsetDetector.getEvents().size();
+}
+
+
+bool Spectrogram::saveEvents(const std::string& filename) const
+{
+    std::lock_guard<std::mutex> lock(m_eventMutex);
+    return m_onsetDetector.saveToFile(filename, getFramesPerSecond());
+}
+
+
+void Spectrogram::setSpectrumRange(unsigned int first, unsigned int last)
+{
+    if (!m_pool || m_mode == Settings::Mode::Transfer)
+        return;
+
+    // only the frames that are stored can be read back
+    last = std::min(last, static_cast<unsigned int>(m_availableFrames));
+    first = std::min(first, last);
+
+    // every thread sums up a part of the range on its own
+    const unsigned int frameCount = last - first;
+    const unsigned int partCount = std::max(std::min(m_pool->getThreadCount(), (frameCount + framesPerChunk - 1) / framesPerChunk), 1u);
+    unsigned int revision = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        revision = ++m_rangeRevision;
+        m_rangeSpectrum.reset(new PowerSpectrum(m_binCount));
+        m_rangeParts = partCount;
+        m_pendingJobs += partCount;
+    }
+
+    for (unsigned int part = 0; part < partCount; ++part)
+    {
+        const unsigned int partFirst = first + static_cast<unsigned int>(static_cast<std::size_t>(frameCount) * part / partCount);
+        const unsigned int partLast = first + static_cast<unsigned int>(static_cast<std::size_t>(frameCount) * (part + 1) / partCount);
+        m_pool->submit([this, partFirst, partLast, revision] { averageFrames(partFirst, partLast, revision); }, ThreadPool::Priority::High);
+    }
+}
+
+
+void Spectrogram::clearSpectrumRange()
+{
+    // the parts that are still running are dropped
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_rangeRevision;
+    m_rangeSpectrum.reset();
+    m_rangeParts = 0;
+}
+
+
+bool Spectrogram::getAverageSpectrum(float percent, PowerSpectrum::Traces& traces) const
+{
+    // the spectrum isn't changed anymore once it is complete, so the traces are computed without holding up the chunks
+    std::shared_ptr<const PowerSpectrum> spectrum;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_rangeSpectrum && m_rangeParts > 0)
+            return false;
+        spectrum = m_rangeSpectrum ? m_rangeSpectrum : m_soundSpectrum;
+    }
+    if (!spectrum || spectrum->getFrameCount() == 0)
+        return false;
+    spectrum->getTraces(percent, traces);
+
+    // one-sided, the bins between DC and the Nyquist frequency also hold the negative frequencies
+    const float floor = 1e-30f;
+    for (unsigned int bin = 0; bin < m_binCount; ++bin)
+    {
+        const double scale = (bin == 0 || bin == m_FFTSize / 2) ? m_densityScale : 2.0 * m_densityScale;
+        traces.mean[bin]       = 10.f * std::log10(std::max(static_cast<float>(traces.mean[bin] * scale), floor));
+        traces.maximum[bin]    = 10.f * std::log10(std::max(static_cast<float>(traces.maximum[bin] * scale), floor));
+        traces.percentile[bin] = 10.f * std::log10(std::max(static_cast<float>(traces.percentile[bin] * scale), floor));
+    }
+    return true;
+}
+
+
+bool Spectrogram::getTransferFunction(CrossSpectrum::Traces& traces) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_crossSpectrum || m_crossSpectrum->getFrameCount() == 0)
+        return false;
+    m_crossSpectrum->getTraces(traces);
+    return true;
+}
+
+
+Settings::Mode Spectrogram::getMode() const
+{
+    return m_mode;
+}
+
+
+Arena::Statistics Spectrogram::getScratchStatistics() const
+{
+    return m_arena.getStatistics();
+}
+
+
+sf::Time Spectrogram::getDuration() const
+{
+    return m_duration;
+}
+
+
+std::size_t Spectrogram::estimateMemoryUsage(std::size_t sampleCount, unsigned int channelCount, unsigned int sampleRate, const Settings& settings)
+{
+    // the pairs of channels of the transfer mode make half as many frames, the out-of-core transforms only compute the STFT
+    const Settings::Mode mode = isOutOfCore(settings) ? Settings::Mode::STFT : settings.mode;
+    const bool isTransfer = (mode == Settings::Mode::Transfer && channelCount >= 2);
+    const unsigned int decimationFactor = isTransfer ? 1 : Decimator::chooseFactor(sampleRate, settings.maxFrequency);
+    const std::size_t transformedCount = decimatedSampleCount(sampleCount, channelCount, decimationFactor, mode);
+    const std::size_t frameCount = numberOfRepeats(transformedCount / (isTransfer ? channelCount : 1), transformSize(settings));
+    const float transformedRate = isTransfer ? static_cast<float>(sampleRate) : effectiveSampleRate(sampleRate, channelCount, decimationFactor, mode);
+    const std::size_t binCount = rowCount(settings, transformedRate);
+    // the noise floor keeps two windows of frames and the floor of every chunk
+    const std::size_t floorWindow = static_cast<std::size_t>(settings.noiseFloorWindow * transformedRate / (transformSize(settings) / 2) + 0.5f);
+    const std::size_t floorValues = (2 * floorWindow + frameCount / framesPerChunk + 1) * binCount;
+    // the multi-resolution mode keeps the mixed down samples and the bands below them, about twice as many
+    const std::size_t bandSamples = (bandCount(settings) > 1) ? 2 * transformedCount * sizeof(float) : 0;
+    // the window of the frames stays in memory, the buffers of the out-of-core transform are scratch files
+    const std::size_t windowBytes = static_cast<std::size_t>(settings.FFTSize) * sizeof(FFT::Scalar);
+    // a partial spectrum per chunk in flight, which become the spectrum of the sound, and the spectrum of a selection with a part per thread
+    const std::size_t threadCount = (settings.threads > 0) ? settings.threads : std::max(std::thread::hardware_concurrency(), 1u);
+    const std::size_t spectrumBytes = (2 * threadCount + 1) * PowerSpectrum::estimateMemoryUsage(static_cast<unsigned int>(binCount));
+    // the image takes 4 bytes per pixel and the loaded tiles at most as much again, the peak index about 0.2 bytes per sample
+    const std::size_t imageBytes = settings.isHeadless ? 0 : frameCount * binCount * 8;
+    return MagnitudeStorage::estimateMemoryUsage(settings.magnitudeFormat, settings.magnitudeRange, frameCount, binCount) + imageBytes
+           + sampleCount / std::max(channelCount, 1u) / 5 + bandSamples + floorValues * sizeof(float) + windowBytes + spectrumBytes;
 }
 
 
@@ -138,6 +1547,18 @@ void Spectrogram::draw(sf::RenderTarget& target, sf::RenderStates states) const
     // apply the entity's transform -- combine it with the one that was passed by the caller
     states.transform *= getTransform();
 
-    // draw the sprite
-    target.draw(m_sprite, states);
+    // draw the loaded tiles next to each other
+    for (std::size_t tile = 0; tile < m_tiles.size(); ++tile)
+    {
+        if (!m_tiles[tile])
+            continue;
+
+        sf::Sprite sprite;
+        sprite.setTexture(*m_tiles[tile], true);
+        sprite.setPosition(static_cast<float>(tile * tileWidth), 0.f);
+        target.draw(sprite, states);
+    }
+
+    if (m_isTrackOverlayVisible)
+        target.draw(m_trackLines, states);
 }
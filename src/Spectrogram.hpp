@@ -27,40 +27,491 @@
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/Graphics/Sprite.hpp>
 #include <SFML/Graphics/RectangleShape.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
 #include <SFML/Audio/SoundBuffer.hpp>
 
+#include "Arena.hpp"
 #include "FFT.hpp"
+#include "LargeFFT.hpp"
+#include "MagnitudeStorage.hpp"
+#include "RangeEstimator.hpp"
+#include "ResourceCache.hpp"
+#include "ThreadPool.hpp"
+#include "Settings.hpp"
+#include "PeakIndex.hpp"
+#include "PeakTracker.hpp"
+#include "OnsetDetector.hpp"
+#include "NoiseFloor.hpp"
+#include "PowerSpectrum.hpp"
+#include "CrossSpectrum.hpp"
+#include "FrameSink.hpp"
+#include "SoundLoader.hpp"
 
+#include <SFML/System/Time.hpp>
+#include <SFML/System/Clock.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 class Spectrogram : public sf::Drawable, public sf::Transformable
 {
 public:
-    Spectrogram(const sf::SoundBuffer& soundbuffer, unsigned int FFTSize);
+    // larger transforms don't fit into the cache, they are computed out of core by the LargeFFT
+    static const unsigned int largestInCoreSize = 65536;
+
+    /**
+     * @param soundbuffer The sound, it is shared and not copied
+     * @param settings    The parameters of the transform, the storage and the colors
+     * @param cache       Provides the FFT plan and recycled textures, must outlive the spectrogram
+     */
+    Spectrogram(std::shared_ptr<const sf::SoundBuffer> soundbuffer, const Settings& settings, ResourceCache& cache);
+
+    /**
+     * @brief Creates the spectrogram of a sound that is still to be decoded. generate() starts
+     *        the decoding and transforms the frames as soon as their samples are decoded.
+     *
+     * @param loader A loader that opened the file but wasn't started yet
+     */
+    Spectrogram(std::shared_ptr<SoundLoader> loader, const Settings& settings, ResourceCache& cache);
+
+    /**
+     * @brief Stops the generation and waits for the chunks that are in progress.
+     */
+    ~Spectrogram();
+
+    /**
+     * @brief Starts generating the spectrogram on the thread pool and returns immediately.
+     *        The frames are computed in chunks, each finished chunk submits the next one
+     *        with the current priority. If the settings limit the frequency range, the sound
+     *        is decimated first. The peak index for the waveform is built on the pool as well.
+     *        In the reassigned mode the last frame of a chunk is available once the next
+     *        chunk is done, because that chunk can move energy into it.
+     *        If the sound is still to be decoded, a chunk is submitted once the samples of
+     *        its frames are decoded. The decimation and the peak index wait for all of them.
+     */
+    void generate(ThreadPool& pool);
+
+    /**
+     * @brief Exports the frames to the sink while they are generated. The frames are written
+     *        in order as soon as all frames before them are done, so no copy of the data is
+     *        kept. Has to be called before generate().
+     */
+    void setFrameSink(std::unique_ptr<FrameSink> sink);
+
+    /**
+     * @brief Sets the priority of the chunks that are submitted from now on.
+     *        Spectrograms that are on screen should be generated first.
+     */
+    void setPriority(ThreadPool::Priority priority);
+
+    bool isGenerated() const;
+
+    /**
+     * @brief Returns how many frames from the first one on are generated.
+     */
+    unsigned int getAvailableFrameCount() const;
 
-    void generate();
+    /**
+     * @brief Blocks until the given number of frames is generated, can be called from any thread.
+     *
+     * @return false if the timeout elapsed or the generation was stopped before
+     */
+    bool waitForFrames(unsigned int count, sf::Time timeout) const;
 
+    /**
+     * @brief Copies the logarithmic magnitudes of a frame (getBinCount() values, the lowest bin first).
+     *
+     * @return false if the frame isn't generated yet
+     */
+    bool getMagnitudes(unsigned int frame, float* values) const;
+
+    /**
+     * @brief Returns the magnitudes that are mapped to the darkest and the brightest color,
+     *        from the frames generated so far.
+     */
+    void getColorRange(float& lower, float& upper) const;
+
+    /**
+     * @brief Colorizes the next column of the image, if it has been generated already.
+     *        Only that column is uploaded, and only if its tile is loaded.
+     *        The tracks that were finished since the last call are added to the overlay.
+     */
     void updateImage();
 
+    /**
+     * @brief Shows or hides the tracks of the spectral peaks over the image.
+     */
+    void setTrackOverlayVisible(bool isVisible);
+
+    /**
+     * @brief Shows the levels above the noise floor of every bin instead of the levels,
+     *        so weak tones stand out of loud noise. The image is colorized again.
+     */
+    void setWhitened(bool isWhitened);
+
+    /**
+     * @brief Loads the tiles of the texture that intersect the area and the ones next to
+     *        them, the others are handed back to the cache. Long sounds don't fit into one
+     *        texture, and following the playback this way only uploads the new tiles.
+     *
+     * @param area The visible area in the coordinates of the parent of the spectrogram
+     */
+    void setVisibleArea(const sf::FloatRect& area);
+
+    /**
+     * @brief Colorizes the image again from the first column on, without redoing the FFT.
+     */
+    void redraw();
+
+    /**
+     * @brief Sets the percentiles of all magnitudes that are mapped to the darkest
+     *        and the brightest color. Values outside are clamped.
+     *
+     * @param floorPercentile    Percentile in range [0, 100] mapped to black
+     * @param ceilingPercentile  Percentile in range [0, 100] mapped to white
+     */
+    void setDynamicRange(float floorPercentile, float ceilingPercentile);
+
     sf::FloatRect        getLocalBounds() const;
 
+    unsigned int         getFrameCount() const;
+
+    unsigned int         getBinCount() const;
+
+    /**
+     * @brief Returns the sample rate of the transformed samples, after the decimation.
+     */
+    float                getSampleRate() const;
+
+    /**
+     * @brief Returns the frequency range of a row of the image in Hz. A row is one bin of the FFT,
+     *        unless the transform is too large for the texture, then it keeps the loudest of 2^n bins.
+     */
+    float                getBinWidth() const;
+
+    /**
+     * @brief Returns how many columns of the image correspond to one second.
+     */
+    float                getFramesPerSecond() const;
+
+    /**
+     * @brief Returns the peak index of the waveform, or null while it is being built.
+     */
+    const PeakIndex*     getPeakIndex() const;
+
+    /**
+     * @brief Returns the peaks of the frames and the tracks linked from them so far.
+     */
+    const PeakTracker&   getPeakTracker() const;
+
+    /**
+     * @brief Finds the first onset after the given offset in the sound.
+     *
+     * @return false if there is none among the frames generated so far
+     */
+    bool                 findNextEvent(sf::Time offset, sf::Time& event) const;
+
+    /**
+     * @brief Finds the last onset before the given offset in the sound.
+     *
+     * @return false if there is none
+     */
+    bool                 findPreviousEvent(sf::Time offset, sf::Time& event) const;
+
+    std::size_t          getEventCount() const;
+
+    /**
+     * @brief Writes the onsets found so far as comma separated values.
+     */
+    bool                 saveEvents(const std::string& filename) const;
+
+    /**
+     * @brief Averages the frames in [first, last) on the thread pool. The stored frames are
+     *        read back, so no FFT is computed again. Frames that aren't generated yet are left out.
+     *        The transfer mode stores the gains, so it only averages the whole sound.
+     */
+    void                 setSpectrumRange(unsigned int first, unsigned int last);
+
+    /**
+     * @brief Goes back to the average of the whole sound.
+     */
+    void                 clearSpectrumRange();
+
+    /**
+     * @brief Returns the Welch estimate of the power spectral density of the range, or of the
+     *        whole sound, in dB relative to the squared full scale per Hz. The mean is the Welch
+     *        average, the maximum holds the peak of every bin. The whole sound is summed up
+     *        in the linear powers while it is generated, a range from the stored magnitudes.
+     *
+     * @param percent The percentile of the third trace, in range [0, 100]
+     *
+     * @return false while the average is computed
+     */
+    bool                 getAverageSpectrum(float percent, PowerSpectrum::Traces& traces) const;
+
+    /**
+     * @brief Returns the coherence and the transfer function from the first to the second
+     *        channel, averaged over the whole sound.
+     *
+     * @return false if the mode isn't Transfer or the sound is still generated
+     */
+    bool                 getTransferFunction(CrossSpectrum::Traces& traces) const;
+
+    /**
+     * @brief Returns the mode of the transform. The transfer mode falls back to the STFT
+     *        if the sound doesn't have two channels.
+     */
+    Settings::Mode       getMode() const;
+
+    /**
+     * @brief Returns how long it took until the first column was available, zero until then.
+     */
+    sf::Time             getFirstColumnTime() const;
+
+    /**
+     * @brief Returns how long the generation took, zero until it's done. If the sound was
+     *        decoded while generating, the decoding is included.
+     */
+    sf::Time             getGenerationTime() const;
+
+    /**
+     * @brief Returns how much scratch memory the generation used.
+     */
+    Arena::Statistics    getScratchStatistics() const;
+
+    sf::Time             getDuration() const;
+
+    /**
+     * @brief Estimates the memory a spectrogram of a sound would occupy, without creating it.
+     */
+    static std::size_t   estimateMemoryUsage(std::size_t sampleCount, unsigned int channelCount, unsigned int sampleRate, const Settings& settings);
+
 
 private:
 
+    Spectrogram(std::shared_ptr<const sf::SoundBuffer> soundBuffer, std::shared_ptr<SoundLoader> loader,
+                const sf::Int16* samples, std::size_t sampleCount, unsigned int channelCount, unsigned int sampleRate,
+                const Settings& settings, ResourceCache& cache);
+
     virtual void draw(sf::RenderTarget &target, sf::RenderStates states) const;
 
+    /**
+     * @brief Builds the peak index and decimates the sound if needed, once all samples are there.
+     */
+    void submitSoundJob();
+
+    /**
+     * @brief Is called by the loader when more samples are decoded.
+     */
+    void onSamplesDecoded(std::size_t decodedSamples, bool isDone);
+
+    /**
+     * @brief Submits the chunks whose samples are ready, as long as there are idle threads.
+     */
+    void submitReadyChunks();
+
+    void generateChunk();
+
+    void finishJob();
+
+    /**
+     * @brief Writes the frames that became available to the sink, in order. Only one worker
+     *        writes at a time, the others leave a request and go on with their chunks.
+     */
+    void exportFrames();
+
+    /**
+     * @brief Passes the frames that became available to the onset detector and the noise
+     *        floor, in order. The floor after every chunk of frames is kept for the image.
+     */
+    void detectEvents();
+
+    /**
+     * @brief Fills output with the samples of a frame, the window is applied by the caller.
+     */
+    void readFrame(unsigned int frame, FFT::Scalar* output) const;
+
+    void generateFrames(unsigned int first, unsigned int last);
+
+    /**
+     * @brief Computes the frames of the FFT sizes that don't fit into the cache. A frame is read into
+     *        the scratch file of the LargeFFT and transformed by all threads of the pool, so only one
+     *        chunk is generated at a time. Every row of the image keeps the loudest of its bins.
+     */
+    void generateLargeFrames(unsigned int first, unsigned int last);
+
+    /**
+     * @brief Uploads the colorized columns of the image to the texture of a tile.
+     */
+    void uploadTile(unsigned int tile);
+
+    /**
+     * @brief Computes the frames of the reassigned spectrogram. Every frame takes three FFTs,
+     *        with the window, the time weighted window and the derivative of the window.
+     *        They give the instantaneous frequency and the group delay of every bin, where
+     *        its energy is added. The energy can move by one frame at most, so the chunk
+     *        accumulates into its own grid and only the frames at its borders are shared.
+     */
+    void generateReassignedFrames(unsigned int first, unsigned int last);
+
+    /**
+     * @brief Computes the frames of the transfer mode. The two channels of a frame are read
+     *        in one pass and transformed back to back on the same plan. Their cross- and
+     *        auto-spectra are added to the partial sums of the chunk, the image shows the
+     *        gain of the frame, the level of the response minus the level of the reference.
+     */
+    void generateTransferFrames(unsigned int first, unsigned int last);
+
+    /**
+     * @brief Fills the outputs with the samples of the first and the second channel of a frame.
+     */
+    void readChannels(unsigned int frame, FFT::Scalar* reference, FFT::Scalar* response) const;
+
+    /**
+     * @brief Computes the columns of the multi-resolution mode. Every band transforms the samples
+     *        decimated to its octave with the same plan, so a band twice as low gets a window twice
+     *        as long for half the cost. The rows keep the bins of FFTSize, a band fills its rows by
+     *        interpolating its own bins, the columns are as far apart as the frames of the highest band.
+     */
+    void generateMultiResolutionFrames(unsigned int first, unsigned int last);
+
+    /**
+     * @brief Fills the output with the samples of a frame of a band, band 0 are the mixed down samples.
+     */
+    void readBandFrame(unsigned int band, unsigned int frame, FFT::Scalar* output) const;
+
+    /**
+     * @brief Converts the accumulated energies of a frame to logarithmic magnitudes and stores them.
+     */
+    void storeEnergies(unsigned int frame, const float* energies, float* levels, RangeEstimator& range, PowerSpectrum& spectrum);
+
+    /**
+     * @brief Adds the stored frames to a spectrum of its own and merges it into the one of the
+     *        range, unless another range was set in the meantime.
+     */
+    void averageFrames(unsigned int first, unsigned int last, unsigned int revision);
+
+    /**
+     * @brief Appends the lines of the tracks that were finished since the last call.
+     */
+    void updateTrackOverlay();
+
+    /**
+     * @brief Returns how many chunks add energy to a frame of the reassigned spectrogram.
+     */
+    unsigned int contributingChunks(unsigned int frame) const;
+
+    /**
+     * @brief Takes an idle FFT of the spectrogram or creates one, its arrays are reused by the next chunk.
+     */
+    std::unique_ptr<FFT> acquireFFT();
+
+    void releaseFFT(std::unique_ptr<FFT> fft);
+
+    /**
+     * @brief Takes the partial spectrum of an idle chunk or creates one. The chunks in flight
+     *        are bounded by the threads, so there is one partial sum per thread.
+     */
+    std::unique_ptr<PowerSpectrum> acquireSpectrum();
+
+    void releaseSpectrum(std::unique_ptr<PowerSpectrum> spectrum);
+
+    std::unique_ptr<CrossSpectrum> acquireCrossSpectrum();
+
+    void releaseCrossSpectrum(std::unique_ptr<CrossSpectrum> spectrum);
+
+    struct SharedFrame
+    {
+        std::vector<float>  energies;
+        unsigned int        contributions;
+    };
+
     const unsigned int                      m_FFTSize;
     const unsigned int                      m_outputSize;
-    FFT                                     m_fft;
-    std::vector<sf::Int16>                  m_samples;
+    const unsigned int                      m_bandCount;        // of the multi-resolution mode, 1 otherwise
+    const unsigned int                      m_transformSize;    // of the FFTs, FFTSize unless the bands transform decimated samples
+    ResourceCache&                          m_cache;
+    std::shared_ptr<const FFTPlan>          m_plan;             // null if the transform is out of core
+    std::unique_ptr<LargeFFT>               m_largeFFT;         // null unless the FFTSize is too large for the cache
+    std::shared_ptr<const sf::SoundBuffer>  m_soundBuffer;      // null until a loaded sound is decoded
+    std::shared_ptr<SoundLoader>            m_loader;           // null if the sound was decoded already
+    const sf::Int16*                        m_soundSamples;     // of the sound buffer or the loader
+    const std::size_t                       m_soundSampleCount;
+    const sf::Time                          m_duration;
+    const Settings::Mode                    m_mode;
+    const unsigned int                      m_channelStride;    // between the samples of a frame, the channels are transformed as one stream unless they are a pair
+    const unsigned int                      m_decimationFactor;
+    const bool                              m_isMixedDown;      // the frames read the mixed down samples, which need the whole sound
+    const float                             m_sampleRate;
+    const unsigned int                      m_binsPerRow;       // of the FFT in a row of the image, more than 1 only out of core
+    const unsigned int                      m_binCount;         // the rows of the image
+    std::vector<FFT::Scalar>                m_window;
+    std::vector<FFT::Scalar>                m_timeWindow;       // only used when reassigning
+    std::vector<FFT::Scalar>                m_derivativeWindow; // only used when reassigning
+    std::vector<float>                      m_samples;          // only used when mixing down
+    std::vector<std::vector<float>>         m_bandSamples;      // the bands below the highest one, each decimated by 2 more
+    std::vector<unsigned int>               m_bandRows;         // the row after the last one of every band, only in the multi-resolution mode
+    std::vector<float>                      m_densityOffsets;   // added to the level of a row for the average spectrum, only in the multi-resolution mode
     unsigned int                            m_numberOfRepeats;
-    sf::Image                               m_image;
-    sf::Sprite                              m_sprite;
-    sf::Texture                             m_texture;
-    float                                   m_maxMagnitude;
-    float                                   m_minMagnitude;
-    std::vector<std::vector<float>>         m_magnitudes;
+    std::unique_ptr<sf::Image>              m_image;
+    std::vector<std::unique_ptr<sf::Texture>> m_tiles;          // null while the tile is not loaded
+    std::vector<sf::Uint8>                  m_columnPixels;
+    RangeEstimator                          m_range;
+    float                                   m_floorPercentile;
+    float                                   m_ceilingPercentile;
+    MagnitudeStorage                        m_magnitudes;
+    std::vector<float>                      m_decodedFrame;
     unsigned int                            m_currentX;
+
+    // generation state, shared with the thread pool
+    ThreadPool*                             m_pool;
+    std::atomic<ThreadPool::Priority>       m_priority;
+    std::atomic<bool>                       m_cancelled;
+    std::atomic<unsigned int>               m_nextChunk;
+    unsigned int                            m_chunkCount;
+    std::vector<bool>                       m_chunkDone;        // guarded by m_mutex
+    unsigned int                            m_readyChunks;      // the chunks whose samples are there, guarded by m_mutex
+    unsigned int                            m_submittedChunks;  // guarded by m_mutex
+    unsigned int                            m_chunksInFlight;   // guarded by m_mutex
+    unsigned int                            m_pendingJobs;      // guarded by m_mutex
+    std::map<unsigned int, SharedFrame>     m_sharedFrames;     // border frames of the reassigned chunks, guarded by m_mutex
+    std::vector<std::unique_ptr<FFT>>       m_idleFFTs;         // guarded by m_mutex
+    std::vector<std::unique_ptr<PowerSpectrum>> m_partialSpectra; // of the chunks, merged once all frames are there, guarded by m_mutex
+    std::shared_ptr<PowerSpectrum>          m_soundSpectrum;    // null until the sound is generated, guarded by m_mutex
+    std::shared_ptr<PowerSpectrum>          m_rangeSpectrum;    // null without a range, guarded by m_mutex, not changed once all parts are merged
+    std::vector<std::unique_ptr<CrossSpectrum>> m_partialCrossSpectra; // only in the transfer mode, guarded by m_mutex
+    std::unique_ptr<CrossSpectrum>          m_crossSpectrum;    // null until the sound is generated, guarded by m_mutex
+    unsigned int                            m_rangeRevision;    // guarded by m_mutex
+    unsigned int                            m_rangeParts;       // still to be merged, guarded by m_mutex
+    double                                  m_densityScale;     // turns the power of a bin into a density per Hz
+    Arena                                   m_arena;            // scratch of the chunks
+    std::atomic<unsigned int>               m_availableFrames;  // all frames before it are generated
+    mutable std::mutex                      m_mutex;            // also guards m_range
+    std::condition_variable                 m_jobsDone;
+    mutable std::condition_variable         m_framesAvailable;
+    std::unique_ptr<FrameSink>              m_sink;
+    unsigned int                            m_exportedFrames;   // only touched by the worker that writes
+    std::atomic<unsigned int>               m_exportRequests;   // the worker that raises it from 0 writes
+    PeakIndex                               m_peakIndex;
+    std::atomic<bool>                       m_isPeakIndexBuilt;
+    PeakTracker                             m_peakTracker;
+    OnsetDetector                           m_onsetDetector;    // guarded by m_eventMutex
+    NoiseFloor                              m_noiseFloor;       // guarded by m_eventMutex
+    std::vector<float>                      m_floors;           // of every chunk of frames, a chunk is written before m_flooredFrames passes it
+    std::atomic<unsigned int>               m_flooredFrames;    // the frames whose floor is stored
+    RangeEstimator                          m_whitenedRange;    // of the levels above the floor, guarded by m_mutex
+    bool                                    m_isWhitened;
+    mutable std::mutex                      m_eventMutex;
+    sf::VertexArray                         m_trackLines;
+    std::size_t                             m_drawnTracks;
+    bool                                    m_isTrackOverlayVisible;
+    sf::Clock                               m_generationClock;
+    sf::Time                                m_firstColumnTime;  // guarded by m_mutex
+    sf::Time                                m_generationTime;   // guarded by m_mutex
 };
 
 #endif // SPECTROGRAM_H
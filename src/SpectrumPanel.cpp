@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "SpectrumPanel.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace
+{
+    // the levels shown below the loudest maximum
+    const float displayedRange = 120.f;
+    const float gridStep       = 20.f;
+
+    // the gains shown below the largest one
+    const float displayedGainRange = 60.f;
+    const float gainGridStep       = 10.f;
+}
+
+
+SpectrumPanel::SpectrumPanel() :
+    m_grid(sf::Lines)
+{
+    m_background.setFillColor(sf::Color(30, 30, 30, 220));
+    for (sf::VertexArray& lines : m_traceLines)
+        lines.setPrimitiveType(sf::LinesStrip);
+}
+
+
+void SpectrumPanel::setArea(const sf::FloatRect& area)
+{
+    m_area = area;
+    m_background.setPosition(area.left, area.top);
+    m_background.setSize(sf::Vector2f(area.width, area.height));
+    rebuild();
+}
+
+
+void SpectrumPanel::update(const PowerSpectrum::Traces& traces)
+{
+    m_traces = traces;
+    m_transferTraces = CrossSpectrum::Traces();
+    rebuild();
+}
+
+
+void SpectrumPanel::update(const CrossSpectrum::Traces& traces)
+{
+    m_traces = PowerSpectrum::Traces();
+    m_transferTraces = traces;
+    rebuild();
+}
+
+
+void SpectrumPanel::clear()
+{
+    m_traces = PowerSpectrum::Traces();
+    m_transferTraces = CrossSpectrum::Traces();
+    rebuild();
+}
+
+
+void SpectrumPanel::rebuild()
+{
+    m_grid.clear();
+    for (sf::VertexArray& lines : m_traceLines)
+        lines.clear();
+
+    const bool isTransfer = !m_transferTraces.gain.empty();
+    const std::vector<float>& reference = isTransfer ? m_transferTraces.gain : m_traces.maximum;
+    if (reference.empty() || m_area.width <= 0.f || m_area.height <= 0.f)
+        return;
+
+    // the top of the scale is the loudest maximum or the largest gain, rounded up to the grid
+    const float range = isTransfer ? displayedGainRange : displayedRange;
+    const float step = isTransfer ? gainGridStep : gridStep;
+    const float loudest = *std::max_element(reference.begin(), reference.end());
+    const float top = std::ceil(loudest / step) * step;
+    const float bottom = top - range;
+
+    const sf::Color gridColor(70, 70, 70);
+    for (float level = bottom + step; level < top; level += step)
+    {
+        const float x = m_area.left + (level - bottom) / range * m_area.width;
+        m_grid.append(sf::Vertex(sf::Vector2f(x, m_area.top), gridColor));
+        m_grid.append(sf::Vertex(sf::Vector2f(x, m_area.top + m_area.height), gridColor));
+    }
+
+    if (isTransfer)
+    {
+        appendTrace(m_traceLines[0], m_transferTraces.phase, -180.f, 180.f, sf::Color(70, 110, 170));
+        appendTrace(m_traceLines[1], m_transferTraces.coherence, 0.f, 1.f, sf::Color(200, 170, 60));
+        appendTrace(m_traceLines[2], m_transferTraces.gain, bottom, top, sf::Color(220, 220, 220));
+    }
+    else
+    {
+        appendTrace(m_traceLines[0], m_traces.maximum, bottom, top, sf::Color(133, 40, 40));
+        appendTrace(m_traceLines[1], m_traces.percentile, bottom, top, sf::Color(200, 170, 60));
+        appendTrace(m_traceLines[2], m_traces.mean, bottom, top, sf::Color(220, 220, 220));
+    }
+}
+
+
+void SpectrumPanel::appendTrace(sf::VertexArray& lines, const std::vector<float>& values, float minimum, float maximum, const sf::Color& color) const
+{
+    const float binHeight = m_area.height / values.size();
+    for (std::size_t bin = 0; bin < values.size(); ++bin)
+    {
+        const float value = std::min(std::max(values[bin], minimum), maximum);
+        const float x = m_area.left + (value - minimum) / (maximum - minimum) * m_area.width;
+        const float y = m_area.top + m_area.height - (bin + 0.5f) * binHeight;
+        lines.append(sf::Vertex(sf::Vector2f(x, y), color));
+    }
+}
+
+
+void SpectrumPanel::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+    target.draw(m_background, states);
+    target.draw(m_grid, states);
+    for (const sf::VertexArray& lines : m_traceLines)
+        target.draw(lines, states);
+}
@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_SPECTRUMPANEL_HPP
+#define FFTSPECTRUM_SPECTRUMPANEL_HPP
+
+#include "PowerSpectrum.hpp"
+#include "CrossSpectrum.hpp"
+
+#include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/RectangleShape.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
+
+/**
+ * @brief The SpectrumPanel class draws the average spectrum of a sound next to the
+ *        spectrograms. The frequency goes up like in the image and the level to the
+ *        right. The maximum, the percentile and the mean are drawn over each other, the
+ *        lines every 20 dB are counted from the loudest maximum.
+ *        For the transfer mode it shows the gain over 60 dB with lines every 10 dB, and
+ *        over the whole width the coherence from 0 to 1 and the phase from -180 to 180 degrees.
+ */
+class SpectrumPanel : public sf::Drawable
+{
+public:
+    SpectrumPanel();
+
+    /**
+     * @brief Sets the rectangle of the panel in window coordinates.
+     */
+    void setArea(const sf::FloatRect& area);
+
+    /**
+     * @brief Draws the traces, in dB.
+     */
+    void update(const PowerSpectrum::Traces& traces);
+
+    /**
+     * @brief Draws the traces of a transfer function instead.
+     */
+    void update(const CrossSpectrum::Traces& traces);
+
+    /**
+     * @brief Removes the traces, e.g. while a new average is computed.
+     */
+    void clear();
+
+private:
+
+    void rebuild();
+
+    /**
+     * @brief Appends a point per bin, the bins go up from the bottom like the rows of the spectrogram.
+     *
+     * @param minimum The value at the left border
+     * @param maximum The value at the right border
+     */
+    void appendTrace(sf::VertexArray& lines, const std::vector<float>& values, float minimum, float maximum, const sf::Color& color) const;
+
+    virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const;
+
+    sf::FloatRect           m_area;
+    sf::RectangleShape      m_background;
+    sf::VertexArray         m_grid;
+    sf::VertexArray         m_traceLines[3];
+    PowerSpectrum::Traces   m_traces;
+    CrossSpectrum::Traces   m_transferTraces;   // drawn if they aren't empty
+};
+
+#endif //FFTSPECTRUM_SPECTRUMPANEL_HPP
@@ -0,0 +1,185 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+
+namespace
+{
+    // the pool and the thread of the running task, so the tasks it submits stay on its queue
+    thread_local const ThreadPool* currentPool = nullptr;
+    thread_local unsigned int currentWorker = 0;
+}
+
+
+ThreadPool::ThreadPool(unsigned int threadCount) :
+    m_nextWorker(0),
+    m_sleepingWorkers(0),
+    m_wakeups(0),
+    m_unfinishedTasks(0),
+    m_stop(false)
+{
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (unsigned int i = 0; i < threadCount; ++i)
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker));
+
+    for (unsigned int i = 0; i < threadCount; ++i)
+        m_threads.push_back(std::thread(&ThreadPool::run, this, i));
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_workAvailable.notify_all();
+
+    for (std::thread& thread : m_threads)
+        thread.join();
+
+    // the tasks that didn't start are dropped, so a wait() doesn't wait for them
+    unsigned int droppedTasks = 0;
+    for (std::unique_ptr<Worker>& worker : m_workers)
+    {
+        for (std::deque<std::function<void()>>& queue : worker->queues)
+        {
+            droppedTasks += static_cast<unsigned int>(queue.size());
+            queue.clear();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_unfinishedTasks -= droppedTasks;
+    m_allDone.notify_all();
+}
+
+
+void ThreadPool::submit(std::function<void()> task, Priority priority)
+{
+    // count it before it can be run
+    ++m_unfinishedTasks;
+
+    const unsigned int index = (currentPool == this) ? currentWorker : m_nextWorker++ % m_workers.size();
+    {
+        std::lock_guard<std::mutex> lock(m_workers[index]->mutex);
+        m_workers[index]->queues[static_cast<int>(priority)].push_front(std::move(task));
+    }
+
+    // a thread that announced its sleep after the push finds the task when it looks again
+    if (m_sleepingWorkers > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_wakeups < m_workers.size())
+            ++m_wakeups;
+        m_workAvailable.notify_one();
+    }
+}
+
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_allDone.wait(lock, [this] { return m_unfinishedTasks == 0; });
+}
+
+
+unsigned int ThreadPool::getThreadCount() const
+{
+    return static_cast<unsigned int>(m_threads.size());
+}
+
+
+void ThreadPool::run(unsigned int index)
+{
+    currentPool = this;
+    currentWorker = index;
+
+    while (!m_stop)
+    {
+        std::function<void()> task;
+        if (!popTask(index, task))
+        {
+            // announce the sleep before looking again, so a task submitted meanwhile either is found or wakes a thread
+            ++m_sleepingWorkers;
+            if (!popTask(index, task))
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_workAvailable.wait(lock, [this] { return m_stop || m_wakeups > 0; });
+                if (m_wakeups > 0)
+                    --m_wakeups;
+            }
+            --m_sleepingWorkers;
+            if (!task)
+                continue;
+        }
+
+        task();
+        // the captures of the task go before it counts as done
+        task = nullptr;
+
+        if (--m_unfinishedTasks == 0)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_allDone.notify_all();
+        }
+    }
+}
+
+
+bool ThreadPool::popTask(unsigned int index, std::function<void()>& task)
+{
+    const std::size_t workerCount = m_workers.size();
+
+    for (int priority = 0; priority < 2; ++priority)
+    {
+        // newest task from the own queue first, it's the most likely to have its data in the cache
+        {
+            Worker& worker = *m_workers[index];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if (!worker.queues[priority].empty())
+            {
+                task = std::move(worker.queues[priority].front());
+                worker.queues[priority].pop_front();
+                return true;
+            }
+        }
+
+        // steal the oldest task from another queue
+        for (std::size_t i = 1; i < workerCount; ++i)
+        {
+            Worker& victim = *m_workers[(index + i) % workerCount];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.queues[priority].empty())
+            {
+                task = std::move(victim.queues[priority].back());
+                victim.queues[priority].pop_back();
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
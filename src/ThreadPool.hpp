@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_THREADPOOL_HPP
+#define FFTSPECTRUM_THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief The ThreadPool class runs tasks on a fixed number of threads. Every thread
+ *        has its own queue, the tasks that a task submits go to the queue of its thread,
+ *        the others are distributed round robin. A thread that runs out of work steals
+ *        from the back of the other queues, only the queues are locked for that. Tasks
+ *        with high priority are always taken before tasks with low priority.
+ *        The tasks should be short (a few milliseconds), so a change of priority
+ *        takes effect quickly.
+ */
+class ThreadPool
+{
+public:
+    enum class Priority
+    {
+        High,
+        Low
+    };
+
+    /**
+     * @param threadCount The number of threads, 0 uses one thread per core
+     */
+    ThreadPool(unsigned int threadCount = 0);
+
+    /**
+     * @brief Waits for the running tasks to finish. Tasks that didn't start yet are dropped,
+     *        they count as done for wait().
+     */
+    ~ThreadPool();
+
+    void            submit(std::function<void()> task, Priority priority = Priority::Low);
+
+    /**
+     * @brief Blocks until all submitted tasks (including the ones they submit) are done.
+     *        Must not be called from a task.
+     */
+    void            wait();
+
+    unsigned int    getThreadCount() const;
+
+private:
+
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    struct Worker
+    {
+        std::mutex                          mutex;
+        std::deque<std::function<void()>>   queues[2]; // one per priority
+    };
+
+    void            run(unsigned int index);
+    bool            popTask(unsigned int index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Worker>>    m_workers;
+    std::vector<std::thread>                m_threads;
+    std::mutex                              m_mutex;            // only for sleeping and waiting, not for the queues
+    std::condition_variable                 m_workAvailable;
+    std::condition_variable                 m_allDone;
+    std::atomic<unsigned int>               m_nextWorker;
+    std::atomic<unsigned int>               m_sleepingWorkers;  // a submit only wakes a thread if there are any
+    unsigned int                            m_wakeups;          // guarded by m_mutex
+    std::atomic<unsigned int>               m_unfinishedTasks;
+    std::atomic<bool>                       m_stop;
+};
+
+#endif //FFTSPECTRUM_THREADPOOL_HPP
@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "TileCache.hpp"
+
+#include <tuple>
+
+
+bool TileCache::Key::operator<(const Key& other) const
+{
+    return std::tie(filename, format, level, x, y) < std::tie(other.filename, other.format, other.level, other.x, other.y);
+}
+
+
+TileCache::TileCache(std::size_t capacity) :
+    m_capacity(capacity),
+    m_size(0)
+{
+
+}
+
+
+TileCache::Tile TileCache::find(const Key& key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto entry = m_index.find(key);
+    if (entry == m_index.end())
+        return nullptr;
+
+    // move it to the front
+    m_tiles.splice(m_tiles.begin(), m_tiles, entry->second);
+    return m_tiles.front().second;
+}
+
+
+void TileCache::add(const Key& key, Tile tile)
+{
+    if (!tile || tile->size() > m_capacity)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto entry = m_index.find(key);
+    if (entry != m_index.end())
+    {
+        // another thread rendered the same tile in the meantime
+        m_size -= entry->second->second->size();
+        m_tiles.erase(entry->second);
+        m_index.erase(entry);
+    }
+
+    while (!m_tiles.empty() && m_size + tile->size() > m_capacity)
+    {
+        m_size -= m_tiles.back().second->size();
+        m_index.erase(m_tiles.back().first);
+        m_tiles.pop_back();
+    }
+
+    m_tiles.emplace_front(key, tile);
+    m_index[key] = m_tiles.begin();
+    m_size += tile->size();
+}
+
+
+std::size_t TileCache::getSize() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_size;
+}
+
+
+std::size_t TileCache::getTileCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tiles.size();
+}
@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_TILECACHE_HPP
+#define FFTSPECTRUM_TILECACHE_HPP
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The TileCache class keeps encoded tiles up to a number of bytes. When a new tile
+ *        doesn't fit, the least recently used ones are dropped. It can be used from several
+ *        threads, the tiles are shared and never modified.
+ */
+class TileCache
+{
+public:
+    typedef std::shared_ptr<const std::vector<std::uint8_t>> Tile;
+
+    struct Key
+    {
+        std::string     filename;
+        std::string     format;
+        unsigned int    level;
+        unsigned int    x;
+        unsigned int    y;
+
+        bool operator<(const Key& other) const;
+    };
+
+    /**
+     * @param capacity The maximum size of all tiles in bytes
+     */
+    explicit TileCache(std::size_t capacity);
+
+    /**
+     * @brief Returns the tile and marks it as the most recently used one.
+     *
+     * @return The tile or nullptr if it isn't cached
+     */
+    Tile            find(const Key& key);
+
+    /**
+     * @brief Adds a tile or replaces the one with the same key. Tiles larger than the
+     *        capacity are not kept.
+     */
+    void            add(const Key& key, Tile tile);
+
+    std::size_t     getSize() const;
+
+    std::size_t     getTileCount() const;
+
+private:
+
+    typedef std::list<std::pair<Key, Tile>> TileList;
+
+    const std::size_t                       m_capacity;
+    std::size_t                             m_size;     // guarded by m_mutex
+    TileList                                m_tiles;    // most recently used first, guarded by m_mutex
+    std::map<Key, TileList::iterator>       m_index;    // guarded by m_mutex
+    mutable std::mutex                      m_mutex;
+};
+
+#endif //FFTSPECTRUM_TILECACHE_HPP
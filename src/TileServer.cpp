@@ -0,0 +1,580 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "TileServer.hpp"
+#include "Interpolation.hpp"
+#include "Png.hpp"
+
+#include <SFML/Network/IpAddress.hpp>
+#include <SFML/Network/SocketSelector.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+namespace
+{
+    const std::size_t   maximumRequestLength = 4096;
+    const sf::Time      pollInterval = sf::milliseconds(100);   // how fast the threads notice stop()
+    const sf::Time      frameTimeout = sf::seconds(30);
+
+    // the latency histogram has 20 buckets per decade from 10 us to 100 s
+    const unsigned int  bucketsPerDecade = 20;
+    const unsigned int  latencyBuckets = 7 * bucketsPerDecade;
+    const float         smallestLatency = 10.f; // in microseconds
+
+
+    Settings headlessSettings(Settings settings)
+    {
+        // the tiles are rendered from the magnitudes, the image of a window is never needed
+        settings.isHeadless = true;
+        return settings;
+    }
+
+
+    unsigned int levelCount(unsigned int frameCount, unsigned int binCount)
+    {
+        if (frameCount == 0 || binCount == 0)
+            return 1;
+
+        unsigned int levels = 1;
+        while (((frameCount - 1) >> (levels - 1)) >= TileServer::tileSize ||
+               ((binCount - 1) >> (levels - 1)) >= TileServer::tileSize)
+        {
+            ++levels;
+        }
+        return levels;
+    }
+
+
+    unsigned int latencyBucket(sf::Time latency)
+    {
+        const float microseconds = std::max(static_cast<float>(latency.asMicroseconds()), smallestLatency);
+        const float bucket = std::floor(bucketsPerDecade * std::log10(microseconds / smallestLatency));
+        return std::min(static_cast<unsigned int>(bucket), latencyBuckets - 1);
+    }
+
+
+    sf::Time latencyPercentile(const std::vector<std::uint64_t>& histogram, std::uint64_t count, sf::Time maximum, float percent)
+    {
+        if (count == 0)
+            return sf::Time::Zero;
+
+        // the upper edge of the bucket that contains the percentile
+        const std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(percent / 100.f * count));
+        std::uint64_t sum = 0;
+        unsigned int bucket = 0;
+        while (bucket + 1 < histogram.size() && (sum += histogram[bucket]) < rank)
+            ++bucket;
+
+        const float microseconds = smallestLatency * std::pow(10.f, static_cast<float>(bucket + 1) / bucketsPerDecade);
+        return std::min(sf::microseconds(static_cast<sf::Int64>(microseconds)), maximum);
+    }
+
+
+    bool sendAll(sf::TcpSocket& socket, const void* data, std::size_t size)
+    {
+        return size == 0 || socket.send(data, size) == sf::Socket::Done;
+    }
+
+
+    bool sendLine(sf::TcpSocket& socket, const std::string& line)
+    {
+        const std::string text = line + '\n';
+        return sendAll(socket, text.data(), text.size());
+    }
+}
+
+
+// std::min takes it by reference, so it needs a definition
+const unsigned int TileServer::tileSize;
+
+
+TileServer::TileServer(const Settings& settings, std::size_t cacheSize) :
+    m_settings(headlessSettings(settings)),
+    m_pool(settings.threads),
+    m_tiles(cacheSize),
+    m_memoryUsage(0),
+    m_isRunning(false),
+    m_requestCount(0),
+    m_cacheHits(0),
+    m_errorCount(0),
+    m_sentBytes(0),
+    m_latencies(latencyBuckets, 0),
+    m_maximumLatency(sf::Time::Zero)
+{
+
+}
+
+
+TileServer::~TileServer()
+{
+    stop();
+}
+
+
+bool TileServer::start(unsigned short port)
+{
+    if (m_acceptThread.joinable())
+        return false;
+
+    if (m_listener.listen(port) != sf::Socket::Done)
+    {
+        std::cout << "Could not listen on port " << port << "." << std::endl;
+        return false;
+    }
+
+    m_uptime.restart();
+    m_isRunning = true;
+    m_acceptThread = std::thread(&TileServer::acceptConnections, this);
+    return true;
+}
+
+
+void TileServer::wait()
+{
+    std::unique_lock<std::mutex> lock(m_stopMutex);
+    m_stopped.wait(lock, [this] { return !m_isRunning; });
+}
+
+
+void TileServer::stop()
+{
+    requestStop();
+
+    if (m_acceptThread.joinable())
+        m_acceptThread.join();
+
+    m_listener.close();
+}
+
+
+unsigned short TileServer::getPort() const
+{
+    return m_listener.getLocalPort();
+}
+
+
+TileServer::Statistics TileServer::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_statisticsMutex);
+
+    Statistics statistics;
+    statistics.requests = m_requestCount;
+    statistics.cacheHits = m_cacheHits;
+    statistics.errors = m_errorCount;
+    statistics.sentBytes = m_sentBytes;
+    statistics.uptime = m_uptime.getElapsedTime();
+    statistics.medianLatency = latencyPercentile(m_latencies, m_requestCount, m_maximumLatency, 50.f);
+    statistics.slowLatency = latencyPercentile(m_latencies, m_requestCount, m_maximumLatency, 95.f);
+    statistics.slowestLatency = latencyPercentile(m_latencies, m_requestCount, m_maximumLatency, 99.f);
+    statistics.maximumLatency = m_maximumLatency;
+    return statistics;
+}
+
+
+void TileServer::acceptConnections()
+{
+    sf::SocketSelector selector;
+    selector.add(m_listener);
+
+    while (m_isRunning)
+    {
+        // a client may open a connection per tile, their threads must not pile up
+        joinFinishedConnections();
+
+        if (!selector.wait(pollInterval))
+            continue;
+
+        std::shared_ptr<sf::TcpSocket> socket = std::make_shared<sf::TcpSocket>();
+        if (m_listener.accept(*socket) != sf::Socket::Done)
+            continue;
+
+        // SFML can't bind to the loopback address, so the other ones are turned away here
+        if (socket->getRemoteAddress() != sf::IpAddress::LocalHost)
+        {
+            std::cout << "Refused a connection from " << socket->getRemoteAddress() << "." << std::endl;
+            continue;
+        }
+
+        m_connections.emplace_back();
+        Connection& connection = m_connections.back();
+        connection.isFinished = false;
+        connection.thread = std::thread([this, socket, &connection]
+        {
+            serveConnection(socket);
+            connection.isFinished = true;
+        });
+    }
+
+    for (Connection& connection : m_connections)
+        connection.thread.join();
+    m_connections.clear();
+}
+
+
+void TileServer::joinFinishedConnections()
+{
+    for (auto connection = m_connections.begin(); connection != m_connections.end();)
+    {
+        if (connection->isFinished)
+        {
+            connection->thread.join();
+            connection = m_connections.erase(connection);
+        }
+        else
+        {
+            ++connection;
+        }
+    }
+}
+
+
+void TileServer::serveConnection(std::shared_ptr<sf::TcpSocket> socket)
+{
+    sf::SocketSelector selector;
+    selector.add(*socket);
+
+    std::string buffer;
+    char data[1024];
+
+    while (m_isRunning)
+    {
+        if (!selector.wait(pollInterval))
+            continue;
+
+        std::size_t received = 0;
+        if (socket->receive(data, sizeof(data), received) != sf::Socket::Done)
+            return; // disconnected
+
+        buffer.append(data, received);
+
+        std::size_t end;
+        while ((end = buffer.find('\n')) != std::string::npos)
+        {
+            std::string request = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            if (!request.empty() && request.back() == '\r')
+                request.pop_back();
+
+            if (!handleRequest(request, *socket))
+                return;
+        }
+
+        if (buffer.size() > maximumRequestLength)
+        {
+            sendLine(*socket, "ERROR The request is too long.");
+            return;
+        }
+    }
+}
+
+
+bool TileServer::handleRequest(const std::string& request, sf::TcpSocket& socket)
+{
+    sf::Clock latency;
+
+    std::istringstream stream(request);
+    std::string command;
+    stream >> command;
+
+    // the filename is the rest of the line, so it may contain spaces
+    auto readFilename = [&stream] ()
+    {
+        std::string filename;
+        std::getline(stream >> std::ws, filename);
+        return filename;
+    };
+
+    if (command == "INFO")
+    {
+        std::string error;
+        const Spectrogram* spectrogram = openDocument(readFilename(), error);
+        if (!spectrogram)
+        {
+            recordRequest(latency.getElapsedTime(), false, true, 0);
+            return sendLine(socket, "ERROR " + error);
+        }
+
+        std::ostringstream reply;
+        reply << "OK " << spectrogram->getFrameCount()
+              << " " << spectrogram->getBinCount()
+              << " " << spectrogram->getFramesPerSecond()
+              << " " << spectrogram->getBinWidth()
+              << " " << tileSize
+              << " " << levelCount(spectrogram->getFrameCount(), spectrogram->getBinCount());
+
+        const bool isSent = sendLine(socket, reply.str());
+        recordRequest(latency.getElapsedTime(), false, false, reply.str().size() + 1);
+        return isSent;
+    }
+    else if (command == "TILE")
+    {
+        TileCache::Key key;
+        const bool isValid = static_cast<bool>(stream >> key.format >> key.level >> key.x >> key.y);
+        key.filename = readFilename();
+
+        std::string error;
+        if (!isValid || key.filename.empty())
+            error = "Expected TILE <png|raw> <level> <x> <y> <filename>.";
+        else if (key.format != "png" && key.format != "raw")
+            error = "Unknown tile format " + key.format + ", expected png or raw.";
+
+        const Spectrogram* spectrogram = error.empty() ? openDocument(key.filename, error) : nullptr;
+
+        unsigned int width = 0;
+        unsigned int height = 0;
+        bool isCacheHit = false;
+        TileCache::Tile tile;
+        if (spectrogram)
+        {
+            tile = m_tiles.find(key);
+            if (tile)
+            {
+                isCacheHit = true;
+
+                // the size isn't stored with a tile, but it only depends on the position
+                const unsigned int factor = 1u << key.level;
+                width = std::min(tileSize, (spectrogram->getFrameCount() + factor - 1) / factor - key.x * tileSize);
+                height = std::min(tileSize, (spectrogram->getBinCount() + factor - 1) / factor - key.y * tileSize);
+            }
+            else
+            {
+                bool isComplete = false;
+                tile = renderTile(*spectrogram, key, width, height, isComplete, error);
+                if (tile && isComplete)
+                    m_tiles.add(key, tile);
+            }
+        }
+
+        if (!tile)
+        {
+            recordRequest(latency.getElapsedTime(), false, true, 0);
+            return sendLine(socket, "ERROR " + error);
+        }
+
+        std::ostringstream reply;
+        reply << "OK " << width << " " << height << " " << tile->size();
+
+        const bool isSent = sendLine(socket, reply.str()) && sendAll(socket, tile->data(), tile->size());
+        recordRequest(latency.getElapsedTime(), isCacheHit, false, reply.str().size() + 1 + tile->size());
+        return isSent;
+    }
+    else if (command == "STATS")
+    {
+        const Statistics statistics = getStatistics();
+        const float seconds = statistics.uptime.asSeconds();
+
+        std::ostringstream reply;
+        reply << "OK requests=" << statistics.requests
+              << " hits=" << statistics.cacheHits
+              << " errors=" << statistics.errors
+              << " bytes=" << statistics.sentBytes
+              << " tiles=" << m_tiles.getTileCount()
+              << " cached=" << m_tiles.getSize()
+              << " seconds=" << seconds
+              << " rate=" << (seconds > 0.f ? statistics.requests / seconds : 0.f)
+              << " p50=" << statistics.medianLatency.asMicroseconds() / 1000.f
+              << " p95=" << statistics.slowLatency.asMicroseconds() / 1000.f
+              << " p99=" << statistics.slowestLatency.asMicroseconds() / 1000.f
+              << " max=" << statistics.maximumLatency.asMicroseconds() / 1000.f;
+        return sendLine(socket, reply.str());
+    }
+    else if (command == "SHUTDOWN")
+    {
+        sendLine(socket, "OK");
+        requestStop();
+        return false;
+    }
+    else if (command.empty())
+    {
+        return true;
+    }
+
+    recordRequest(latency.getElapsedTime(), false, true, 0);
+    return sendLine(socket, "ERROR Unknown request " + command + ", expected INFO, TILE, STATS or SHUTDOWN.");
+}
+
+
+const Spectrogram* TileServer::openDocument(const std::string& filename, std::string& error)
+{
+    std::lock_guard<std::mutex> lock(m_documentsMutex);
+
+    auto document = m_documents.find(filename);
+    if (document != m_documents.end())
+        return document->second.spectrogram.get();
+
+    // only the files of the settings are served, not everything the server can read
+    if (std::find(m_settings.filenames.begin(), m_settings.filenames.end(), filename) == m_settings.filenames.end())
+    {
+        error = "The file " + filename + " is not in the settings.";
+        return nullptr;
+    }
+
+    std::shared_ptr<const sf::SoundBuffer> soundBuffer = m_cache.getSoundBuffer(filename);
+    if (!soundBuffer)
+    {
+        error = "Could not load soundfile with name: " + filename;
+        return nullptr;
+    }
+
+    const std::size_t memoryUsage = Spectrogram::estimateMemoryUsage(static_cast<std::size_t>(soundBuffer->getSampleCount()),
+                                                                     soundBuffer->getChannelCount(),
+                                                                     soundBuffer->getSampleRate(), m_settings);
+    if (m_settings.memoryLimit > 0 && m_memoryUsage + memoryUsage > m_settings.memoryLimit * std::size_t(1024 * 1024))
+    {
+        std::ostringstream message;
+        message << "The spectrograms would use more than " << m_settings.memoryLimit << " MB.";
+        error = message.str();
+        return nullptr;
+    }
+
+    Document& added = m_documents[filename];
+    added.soundBuffer = soundBuffer;
+    added.spectrogram.reset(new Spectrogram(soundBuffer, m_settings, m_cache));
+    added.spectrogram->setPriority(ThreadPool::Priority::High);
+    added.spectrogram->generate(m_pool);
+    m_memoryUsage += memoryUsage;
+
+    std::cout << "Generating the spectrogram of " << filename << "." << std::endl;
+
+    return added.spectrogram.get();
+}
+
+
+TileCache::Tile TileServer::renderTile(const Spectrogram& spectrogram, const TileCache::Key& key,
+                                       unsigned int& width, unsigned int& height, bool& isComplete, std::string& error) const
+{
+    const unsigned int frameCount = spectrogram.getFrameCount();
+    const unsigned int binCount = spectrogram.getBinCount();
+    if (frameCount == 0 || binCount == 0 || key.level >= levelCount(frameCount, binCount))
+    {
+        error = "The level is outside of the spectrogram.";
+        return nullptr;
+    }
+
+    const unsigned int factor = 1u << key.level;
+    const unsigned int columns = (frameCount + factor - 1) / factor;
+    const unsigned int rows = (binCount + factor - 1) / factor;
+    if (key.x >= (columns + tileSize - 1) / tileSize || key.y >= (rows + tileSize - 1) / tileSize)
+    {
+        error = "The tile is outside of the spectrogram.";
+        return nullptr;
+    }
+
+    // the tiles at the end and the bottom are cropped
+    const unsigned int firstColumn = key.x * tileSize;
+    const unsigned int firstRow = key.y * tileSize;
+    width = std::min(tileSize, columns - firstColumn);
+    height = std::min(tileSize, rows - firstRow);
+
+    const unsigned int firstFrame = firstColumn * factor;
+    const unsigned int lastFrame = std::min((firstColumn + width) * factor, frameCount);
+
+    // the colors depend on the range of the whole sound, so a png is final only once everything is generated
+    isComplete = (key.format == "raw") || spectrogram.isGenerated();
+
+    if (!spectrogram.waitForFrames(lastFrame, frameTimeout))
+    {
+        error = "The frames of the tile were not generated in time.";
+        return nullptr;
+    }
+
+    // every pixel keeps the loudest of its frames and bins, so short events stay visible
+    std::vector<float> values(width * height, std::numeric_limits<float>::lowest());
+    std::vector<float> magnitudes(binCount);
+    for (unsigned int frame = firstFrame; frame < lastFrame; ++frame)
+    {
+        spectrogram.getMagnitudes(frame, &magnitudes[0]);
+        float* column = &values[(frame - firstFrame) / factor];
+
+        for (unsigned int row = 0; row < height; ++row)
+        {
+            // row 0 is the highest frequency
+            const unsigned int firstBin = (rows - 1 - (firstRow + row)) * factor;
+            const unsigned int lastBin = std::min(firstBin + factor, binCount);
+            const float loudest = *std::max_element(&magnitudes[firstBin], &magnitudes[0] + lastBin);
+
+            float& value = column[row * width];
+            value = std::max(value, loudest);
+        }
+    }
+
+    std::shared_ptr<std::vector<std::uint8_t>> tile = std::make_shared<std::vector<std::uint8_t>>();
+    if (key.format == "raw")
+    {
+        for (float& value : values)
+            value *= 20.f; // in dB, like the exported frames
+
+        tile->resize(values.size() * sizeof(float));
+        std::memcpy(&(*tile)[0], &values[0], tile->size());
+    }
+    else
+    {
+        float lower, upper;
+        spectrogram.getColorRange(lower, upper);
+        const float range = (upper > lower) ? upper - lower : 1.f;
+
+        std::vector<std::uint8_t> pixels(values.size() * 4);
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            const float amount = std::min(std::max((values[i] - lower) / range, 0.f), 1.f);
+            const sf::Color color = magnitudeColor(amount);
+            pixels[4 * i + 0] = color.r;
+            pixels[4 * i + 1] = color.g;
+            pixels[4 * i + 2] = color.b;
+            pixels[4 * i + 3] = color.a;
+        }
+
+        png::encode(&pixels[0], width, height, *tile);
+    }
+
+    return tile;
+}
+
+
+void TileServer::requestStop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_stopMutex);
+        m_isRunning = false;
+    }
+    m_stopped.notify_all();
+}
+
+
+void TileServer::recordRequest(sf::Time latency, bool isCacheHit, bool isError, std::size_t sentBytes)
+{
+    std::lock_guard<std::mutex> lock(m_statisticsMutex);
+
+    ++m_requestCount;
+    if (isCacheHit)
+        ++m_cacheHits;
+    if (isError)
+        ++m_errorCount;
+    m_sentBytes += sentBytes;
+
+    ++m_latencies[latencyBucket(latency)];
+    m_maximumLatency = std::max(m_maximumLatency, latency);
+}
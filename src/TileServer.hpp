@@ -0,0 +1,198 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_TILESERVER_HPP
+#define FFTSPECTRUM_TILESERVER_HPP
+
+#include "Spectrogram.hpp"
+#include "Settings.hpp"
+#include "ResourceCache.hpp"
+#include "ThreadPool.hpp"
+#include "TileCache.hpp"
+
+#include <SFML/Network/TcpListener.hpp>
+#include <SFML/Network/TcpSocket.hpp>
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Time.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief The TileServer class serves the spectrograms of the files in the settings to
+ *        other programs on the same computer, without a window. Every connection is served
+ *        on a thread of its own and sends requests as lines of text:
+ *
+ *          INFO <filename>                         OK <frames> <bins> <frames per second> <Hz per bin> <tile size> <levels>
+ *          TILE <png|raw> <level> <x> <y> <filename>   OK <width> <height> <bytes>, followed by the tile
+ *          STATS                                   OK and the counters, the throughput and the latencies
+ *          SHUTDOWN                                OK, then the server stops
+ *
+ *        Errors are answered with ERROR and a message. A spectrogram is generated when its
+ *        file is requested for the first time. Level 0 has a pixel per frame and bin, every
+ *        level above halves both and keeps the loudest value. Tile x counts the columns from
+ *        the start of the sound, tile y the rows from the highest frequency, like the image.
+ *        A raw tile holds the float32 values in dB row by row, a png tile has the colors of
+ *        the window. The encoded tiles are kept in a TileCache, png tiles only once the
+ *        spectrogram is complete, because the colors depend on the range of all frames.
+ *        Connections from other computers are closed right away.
+ */
+class TileServer
+{
+public:
+    static const unsigned int   tileSize = 256;
+    static const unsigned short defaultPort = 8765;
+
+    struct Statistics
+    {
+        std::uint64_t   requests;
+        std::uint64_t   cacheHits;
+        std::uint64_t   errors;
+        std::uint64_t   sentBytes;
+        sf::Time        uptime;
+        sf::Time        medianLatency;  ///< the latencies are accurate to 12 %
+        sf::Time        slowLatency;    ///< the 95th percentile
+        sf::Time        slowestLatency; ///< the 99th percentile
+        sf::Time        maximumLatency;
+    };
+
+    /**
+     * @param settings  The files that are served and the parameters of their spectrograms
+     * @param cacheSize The memory of the encoded tiles in bytes
+     */
+    TileServer(const Settings& settings, std::size_t cacheSize = 256 * 1024 * 1024);
+
+    /**
+     * @brief Stops the server and waits for the connections.
+     */
+    ~TileServer();
+
+    /**
+     * @brief Starts accepting connections on a thread of its own and returns immediately.
+     *
+     * @param port The port, 0 picks a free one
+     *
+     * @return false if the port could not be opened
+     */
+    bool            start(unsigned short port);
+
+    /**
+     * @brief Blocks until a client sends SHUTDOWN or stop() is called.
+     */
+    void            wait();
+
+    /**
+     * @brief Closes the connections and stops accepting new ones.
+     */
+    void            stop();
+
+    unsigned short  getPort() const;
+
+    Statistics      getStatistics() const;
+
+private:
+
+    TileServer(const TileServer&);
+    TileServer& operator=(const TileServer&);
+
+    struct Document
+    {
+        std::shared_ptr<const sf::SoundBuffer>  soundBuffer;
+        std::unique_ptr<Spectrogram>            spectrogram;
+    };
+
+    struct Connection
+    {
+        std::thread         thread;
+        std::atomic<bool>   isFinished;
+    };
+
+    void            acceptConnections();
+
+    /**
+     * @brief Joins the threads of the connections that were closed.
+     */
+    void            joinFinishedConnections();
+
+    void            serveConnection(std::shared_ptr<sf::TcpSocket> socket);
+
+    /**
+     * @brief Answers a request.
+     *
+     * @return false if the connection has to be closed
+     */
+    bool            handleRequest(const std::string& request, sf::TcpSocket& socket);
+
+    /**
+     * @brief Returns the spectrogram of a file in the settings, it is created and generated
+     *        on the first request.
+     *
+     * @return nullptr and a message if the file is not served or could not be loaded
+     */
+    const Spectrogram* openDocument(const std::string& filename, std::string& error);
+
+    /**
+     * @brief Computes and encodes a tile, waiting for its frames if they are not generated yet.
+     *
+     * @param isComplete Is set to whether the tile won't change anymore and can be cached
+     *
+     * @return nullptr and a message if the tile doesn't exist or its frames take too long
+     */
+    TileCache::Tile renderTile(const Spectrogram& spectrogram, const TileCache::Key& key,
+                               unsigned int& width, unsigned int& height, bool& isComplete, std::string& error) const;
+
+    void            requestStop();
+
+    void            recordRequest(sf::Time latency, bool isCacheHit, bool isError, std::size_t sentBytes);
+
+    const Settings                          m_settings;
+    ResourceCache                           m_cache;            // guarded by m_documentsMutex
+    ThreadPool                              m_pool;
+    TileCache                               m_tiles;
+    std::map<std::string, Document>         m_documents;        // guarded by m_documentsMutex
+    std::size_t                             m_memoryUsage;      // of the spectrograms, guarded by m_documentsMutex
+    std::mutex                              m_documentsMutex;
+
+    sf::TcpListener                         m_listener;
+    std::thread                             m_acceptThread;
+    std::list<Connection>                   m_connections;      // only used by the accept thread
+    std::atomic<bool>                       m_isRunning;
+    std::mutex                              m_stopMutex;
+    std::condition_variable                 m_stopped;
+
+    sf::Clock                               m_uptime;
+    std::uint64_t                           m_requestCount;     // guarded by m_statisticsMutex
+    std::uint64_t                           m_cacheHits;        // guarded by m_statisticsMutex
+    std::uint64_t                           m_errorCount;       // guarded by m_statisticsMutex
+    std::uint64_t                           m_sentBytes;        // guarded by m_statisticsMutex
+    std::vector<std::uint64_t>              m_latencies;        // a histogram, guarded by m_statisticsMutex
+    sf::Time                                m_maximumLatency;   // guarded by m_statisticsMutex
+    mutable std::mutex                      m_statisticsMutex;
+};
+
+#endif //FFTSPECTRUM_TILESERVER_HPP
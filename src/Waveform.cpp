@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#include "Waveform.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+Waveform::Waveform() :
+    m_lines(sf::Lines)
+{
+    m_background.setFillColor(sf::Color(30, 30, 30));
+    m_cursor.setFillColor(sf::Color(133, 15, 15)); // dark red, like the play progress bar
+}
+
+
+void Waveform::setArea(const sf::FloatRect& area)
+{
+    m_area = area;
+    m_background.setPosition(area.left, area.top);
+    m_background.setSize(sf::Vector2f(area.width, area.height));
+    m_cursor.setSize(sf::Vector2f(2.f, area.height));
+    m_cursor.setPosition(m_cursor.getPosition().x, area.top);
+}
+
+
+void Waveform::update(const PeakIndex* peakIndex, float sampleRate, float origin, float pixelsPerSecond)
+{
+    m_lines.clear();
+    if (!peakIndex || sampleRate <= 0.f || pixelsPerSecond <= 0.f)
+        return;
+
+    // one peak per pixel column of the strip
+    const unsigned int width = static_cast<unsigned int>(std::max(m_area.width, 0.f));
+    m_peaks.resize(width);
+    const double samplesPerPixel = sampleRate / pixelsPerSecond;
+    const double firstSample = (m_area.left - origin) * samplesPerPixel;
+    peakIndex->getPeaks(firstSample, samplesPerPixel, m_peaks);
+
+    const float center = m_area.top + m_area.height / 2.f;
+    const float halfHeight = m_area.height / 2.f;
+    const sf::Color peakColor(110, 110, 110);
+    const sf::Color rmsColor(200, 200, 200);
+    for (unsigned int x = 0; x < width; ++x)
+    {
+        const PeakIndex::Peak& peak = m_peaks[x];
+        if (peak.maximum <= peak.minimum && peak.rms <= 0.f)
+            continue; // outside of the sound or silence
+
+        const float left = m_area.left + x + 0.5f;
+
+        // make sure even quiet columns cover a pixel
+        const float top = std::min(center - peak.maximum * halfHeight, center - 0.5f);
+        const float bottom = std::max(center - peak.minimum * halfHeight, center + 0.5f);
+        m_lines.append(sf::Vertex(sf::Vector2f(left, top), peakColor));
+        m_lines.append(sf::Vertex(sf::Vector2f(left, bottom), peakColor));
+
+        const float rms = std::min(peak.rms, 1.f) * halfHeight;
+        m_lines.append(sf::Vertex(sf::Vector2f(left, center - rms), rmsColor));
+        m_lines.append(sf::Vertex(sf::Vector2f(left, center + rms), rmsColor));
+    }
+}
+
+
+void Waveform::setPlayPosition(float x)
+{
+    m_cursor.setPosition(x, m_area.top);
+}
+
+
+void Waveform::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+    target.draw(m_background, states);
+    target.draw(m_lines, states);
+
+    if (m_cursor.getPosition().x >= m_area.left && m_cursor.getPosition().x < m_area.left + m_area.width)
+        target.draw(m_cursor, states);
+}
@@ -0,0 +1,75 @@
+////////////////////////////////////////////////////////////
+//
+// FFTSpectrum - draw a FFT spectrogram of a sound
+// Copyright (C) 2016  Maximilian Wagenbach
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FFTSPECTRUM_WAVEFORM_HPP
+#define FFTSPECTRUM_WAVEFORM_HPP
+
+#include "PeakIndex.hpp"
+
+#include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/RectangleShape.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
+
+#include <vector>
+
+/**
+ * @brief The Waveform class draws a strip with the waveform of a sound from its PeakIndex.
+ *        Every pixel column shows the minimum and maximum and, brighter, the RMS of the
+ *        samples below it. The strip is rebuilt for the visible pixels only, so it can be
+ *        updated every frame while panning and zooming.
+ */
+class Waveform : public sf::Drawable
+{
+public:
+    Waveform();
+
+    /**
+     * @brief Sets the rectangle of the strip in window coordinates.
+     */
+    void setArea(const sf::FloatRect& area);
+
+    /**
+     * @brief Rebuilds the strip.
+     *
+     * @param peakIndex         The index of the sound, nothing is drawn if it is null
+     * @param sampleRate        The number of mono samples per second
+     * @param origin            The x coordinate where the sound starts
+     * @param pixelsPerSecond   The horizontal zoom
+     */
+    void update(const PeakIndex* peakIndex, float sampleRate, float origin, float pixelsPerSecond);
+
+    /**
+     * @brief Moves the cursor that shows the playing position to the given x coordinate.
+     */
+    void setPlayPosition(float x);
+
+private:
+
+    virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const;
+
+    sf::FloatRect                   m_area;
+    sf::RectangleShape              m_background;
+    sf::RectangleShape              m_cursor;
+    sf::VertexArray                 m_lines;
+    std::vector<PeakIndex::Peak>    m_peaks;
+};
+
+#endif //FFTSPECTRUM_WAVEFORM_HPP
@@ -19,9 +19,139 @@
 ////////////////////////////////////////////////////////////
 
 #include "Application.hpp"
+#include "BatchGenerator.hpp"
+#include "FeatureWriter.hpp"
+#include "FingerprintIndexer.hpp"
+#include "TileServer.hpp"
 
-int main()
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[])
 {
+    // "--serve [port]" generates the spectrograms of the settings without a window and serves their tiles
+    if (argc > 1 && std::string(argv[1]) == "--serve")
+    {
+        Settings settings;
+        if (!settings.loadFromFile("settings.txt"))
+            return 1;
+
+        const unsigned short port = (argc > 2) ? static_cast<unsigned short>(std::atoi(argv[2])) : TileServer::defaultPort;
+        TileServer server(settings);
+        if (!server.start(port))
+            return 1;
+
+        std::cout << "Serving the tiles of " << settings.filenames.size() << " files on localhost:" << server.getPort() << std::endl;
+        server.wait();
+        server.stop();
+
+        const TileServer::Statistics statistics = server.getStatistics();
+        std::cout << "Served " << statistics.requests << " requests (" << statistics.cacheHits << " from the cache, "
+                  << statistics.errors << " errors) in " << statistics.uptime.asSeconds() << " s, the median took "
+                  << statistics.medianLatency.asMicroseconds() / 1000.f << " ms." << std::endl;
+        return 0;
+    }
+
+    // "--index <index> [files...]" fingerprints the files, or the files of the settings, into an index
+    if (argc > 2 && std::string(argv[1]) == "--index")
+    {
+        Settings settings;
+        if (!settings.loadFromFile("settings.txt") && argc == 3)
+            return 1;
+
+        const std::vector<std::string> filenames = (argc > 3) ? std::vector<std::string>(argv + 3, argv + argc) : settings.filenames;
+        ThreadPool pool(settings.threads);
+        FingerprintIndexer indexer(settings, pool);
+        for (const std::string& filename : filenames)
+        {
+            if (!indexer.addFile(filename))
+                std::cout << "Could not open " << filename << ", it is not indexed." << std::endl;
+        }
+        if (!indexer.write(argv[2]))
+            return 1;
+
+        const FingerprintIndexer::Statistics statistics = indexer.getStatistics();
+        std::cout << "Indexed " << statistics.files << " files (" << std::fixed << std::setprecision(1) << statistics.duration.asSeconds() / 60 << " min) with "
+                  << statistics.landmarks << " landmarks in " << statistics.elapsed.asSeconds() << " s." << std::endl;
+        return 0;
+    }
+
+    // "--features [files...]" extracts the features of the files, or the files of the settings, and exports them like the settings say
+    if (argc > 1 && std::string(argv[1]) == "--features")
+    {
+        Settings settings;
+        if (!settings.loadFromFile("settings.txt") && argc == 2)
+            return 1;
+
+        const std::vector<std::string> filenames = (argc > 2) ? std::vector<std::string>(argv + 2, argv + argc) : settings.filenames;
+        const sf::Clock clock;
+        unsigned int fileCount = 0;
+        {
+            ThreadPool pool(settings.threads);
+            ResourceCache cache;
+            BatchGenerator batch(settings, pool, cache);
+            for (const std::string& filename : filenames)
+            {
+                const bool isAdded = batch.addFile(filename, [&settings, &filename] (const Spectrogram&)
+                {
+                    return std::unique_ptr<FrameSink>(new FeatureWriter(filename + ".features.npy", FrameSink::create(settings.exportFormat, filename)));
+                });
+                if (isAdded)
+                    ++fileCount;
+                else
+                    std::cout << "Could not open " << filename << ", its features are not extracted." << std::endl;
+            }
+            batch.wait();
+        }
+
+        std::cout << "Extracted the features of " << fileCount << " files in " << std::fixed << std::setprecision(1)
+                  << clock.getElapsedTime().asSeconds() << " s." << std::endl;
+        return 0;
+    }
+
+    // "--query <index> <clip>" finds the files of the index that contain the clip
+    if (argc > 3 && std::string(argv[1]) == "--query")
+    {
+        FingerprintIndex index;
+        if (!index.open(argv[2]))
+            return 1;
+
+        std::shared_ptr<sf::SoundBuffer> clip = std::make_shared<sf::SoundBuffer>();
+        if (!clip->loadFromFile(argv[3]))
+            return 1;
+
+        // the clip has to be transformed and stored like the files of the index, at their sample rate
+        Settings settings;
+        settings.FFTSize = index.getFFTSize();
+        settings.maxFrequency = index.getMaxFrequency();
+        settings.magnitudeFormat = index.getMagnitudeFormat();
+        settings.magnitudeRange = index.getMagnitudeRange();
+        ThreadPool pool(settings.threads);
+        FingerprintIndexer indexer(settings, pool, index.getSampleRate());
+
+        const sf::Clock clock;
+        std::vector<Fingerprinter::Landmark> landmarks;
+        if (!indexer.fingerprint(clip, landmarks))
+        {
+            std::cout << argv[3] << " can't be compared with the files of the index." << std::endl;
+            return 1;
+        }
+        const std::vector<FingerprintIndex::Match> matches = index.query(landmarks, 5);
+        const sf::Time elapsed = clock.getElapsedTime();
+
+        if (matches.empty())
+            std::cout << argv[3] << " was not found in the " << index.getFileCount() << " files of the index." << std::endl;
+        for (const FingerprintIndex::Match& match : matches)
+        {
+            std::cout << index.getFile(match.file).name << " at " << std::fixed << std::setprecision(2)
+                      << match.offset.asSeconds() << " s (" << match.score << " landmarks)" << std::endl;
+        }
+        std::cout << "The query took " << elapsed.asMilliseconds() << " ms." << std::endl;
+        return 0;
+    }
+
     Application app;
     return app.run();
 }